@@ -262,6 +262,9 @@
 #cmakedefine HAVE_VSNPRINTF 1
 #cmakedefine HAVE_LONG_LONG 1
 
+/* Define to 1 if you have the <sys/inotify.h> header file. */
+#cmakedefine HAVE_SYS_INOTIFY_H 1
+
 /* Define to 1 if you have the <sys/stat.h> header file. */
 #cmakedefine HAVE_SYS_STAT_H 1
 
@@ -82,6 +82,12 @@ void adios_set_max_buffer_size (uint64_t max_buffer_size_MB)
     ADIOST_CALLBACK_EXIT(adiost_event_set_max_buffer_size, max_buffer_size_MB);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void adios_set_stats_threads (int nthreads)
+{
+    adios_set_stats_threads_v1 (nthreads);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 int adios_open (int64_t * fd, const char * group_name, const char * name
                ,const char * mode, MPI_Comm comm
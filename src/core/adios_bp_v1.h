@@ -18,6 +18,12 @@
 #define ADIOS_VERSION_NUM_MASK                       0x000000FF
 #define ADIOS_VERSION_HAVE_SUBFILE                   0x00000100
 #define ADIOS_VERSION_HAVE_TIME_INDEX_CHARACTERISTIC 0x00000200
+
+/* The POSIX and MPI methods rewrite an empty <fname>.ready file after the
+ * footer of a step is complete, if they are given the step-marker=1 parameter.
+ * Stream readers on the same node wait for it instead of polling the file.
+ */
+#define ADIOS_STEP_MARKER_SUFFIX ".ready"
 enum ADIOS_CHARACTERISTICS
 {
      adios_characteristic_value          = 0
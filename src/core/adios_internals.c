@@ -17,7 +17,9 @@
 #include <arpa/inet.h>
 #include <stdint.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <assert.h>
+#include <pthread.h>
 
 
 #include "public/adios.h"
@@ -64,6 +66,10 @@ void adios_file_struct_init (struct adios_file_struct * fd)
     fd->nvars_written = 0;
     fd->attrs_start = 0;
     fd->nattrs_written = 0;
+    fd->zero_copy_min_size = 0;
+    fd->zero_copy = NULL;
+    fd->zero_copy_last = NULL;
+    fd->zero_copy_size = 0;
     fd->comm = MPI_COMM_NULL;
 }
 
@@ -2807,6 +2813,726 @@ void adios_merge_index_v1 (
     }
 }
 
+/* Merging the indices of many processes at once (global metadata on rank 0).
+   Calling adios_merge_index_v1 for each process is O(N^2) for N processes
+   because each call reallocates and copies the characteristics of every
+   variable. Here the buffers are parsed in parallel, then each variable's
+   characteristics are counted first and copied/merged only once into an
+   array of the final size.
+*/
+#define ADIOS_MERGE_MAX_THREADS 16
+#define ADIOS_MERGE_MIN_BUFFERS_PER_THREAD 32 // parsing fewer is not worth a thread
+
+struct adios_merge_parse_part
+{
+    int start;                // first buffer to parse
+    int n;                    // number of buffers to parse
+    char ** buffers;
+    uint64_t * buffer_sizes;
+    int attrs_buffer;
+    struct adios_index_process_group_struct_v1 ** pgs;  // per buffer
+    struct adios_index_var_struct_v1 ** vars;           // per buffer
+    struct adios_index_attribute_struct_v1 ** attrs;    // per buffer
+};
+
+// one variable of the main index and the items to be merged into it
+struct adios_merge_var
+{
+    struct adios_index_var_struct_v1 * var;
+    uint64_t count;           // characteristics count after the merge
+    int nitems;
+    int nitems_allocated;
+    struct adios_index_var_struct_v1 ** items;
+};
+
+struct adios_merge_vars_part
+{
+    struct adios_merge_var ** mvars;
+    int start;
+    int n;
+    int needs_sorting;
+};
+
+static int adios_merge_nthreads (int nwork, int min_work_per_thread)
+{
+    long ncpus = sysconf (_SC_NPROCESSORS_ONLN);
+    int nthreads = nwork / min_work_per_thread;
+    if (ncpus > 0 && nthreads > ncpus)
+        nthreads = (int) ncpus;
+    if (nthreads > ADIOS_MERGE_MAX_THREADS)
+        nthreads = ADIOS_MERGE_MAX_THREADS;
+    if (nthreads < 1)
+        nthreads = 1;
+    return nthreads;
+}
+
+// run fn on each part with a thread team, part 0 on the calling thread
+static void adios_merge_run_parts (void * (*fn)(void *), void * parts,
+                                   size_t part_size, int nparts)
+{
+    pthread_t threads [ADIOS_MERGE_MAX_THREADS];
+    int started [ADIOS_MERGE_MAX_THREADS];
+    int i;
+    for (i = 1; i < nparts; i++)
+    {
+        started[i] = !pthread_create (&threads[i], NULL, fn,
+                                      (char *) parts + i * part_size);
+        if (!started[i])
+            fn ((char *) parts + i * part_size);
+    }
+    fn (parts);
+    for (i = 1; i < nparts; i++)
+    {
+        if (started[i])
+            pthread_join (threads[i], NULL);
+    }
+}
+
+static void * adios_merge_parse_thread (void * arg)
+{
+    struct adios_merge_parse_part * p = (struct adios_merge_parse_part *) arg;
+    struct adios_bp_buffer_struct_v1 b;
+    int i;
+
+    adios_buffer_struct_init (&b);
+    for (i = p->start; i < p->start + p->n; i++)
+    {
+        b.buff = p->buffers[i];
+        b.length = p->buffer_sizes[i];
+        b.offset = 0;
+        p->pgs[i] = NULL;
+        p->vars[i] = NULL;
+        p->attrs[i] = NULL;
+        if (!b.length)
+            continue;
+        adios_parse_process_group_index_v1 (&b, &p->pgs[i], NULL);
+        adios_parse_vars_index_v1 (&b, &p->vars[i], NULL, NULL);
+        if (i == p->attrs_buffer)
+            adios_parse_attributes_index_v1 (&b, &p->attrs[i]);
+    }
+    return NULL;
+}
+
+static void adios_merge_free_var_item (struct adios_index_var_struct_v1 * item)
+{
+    free (item->characteristics);
+    free (item->group_name);
+    free (item->var_name);
+    free (item->var_path);
+    free (item);
+}
+
+static struct adios_index_characteristic_struct_v1 *
+adios_merge_var_chars (struct adios_index_var_struct_v1 * src, int isrc,
+                       struct adios_merge_var * mv)
+{
+    return (isrc ? mv->items[isrc-1]->characteristics : src->characteristics);
+}
+
+static uint64_t adios_merge_var_count (struct adios_index_var_struct_v1 * src, int isrc,
+                                       struct adios_merge_var * mv)
+{
+    return (isrc ? mv->items[isrc-1]->characteristics_count : src->characteristics_count);
+}
+
+/* k-way merge of the characteristics of all sources by time_index.
+   A binary min-heap of the sources is ordered by (time_index, source), so
+   the result is the same as merging the sources one by one into the
+   variable.
+*/
+static void adios_merge_var_sorted (struct adios_merge_var * mv,
+                                    struct adios_index_characteristic_struct_v1 * c)
+{
+    int nsrc = mv->nitems + 1;
+    int * heap = (int *) malloc (nsrc * sizeof(int));
+    uint64_t * pos = (uint64_t *) calloc (nsrc, sizeof(uint64_t));
+    struct adios_index_var_struct_v1 * v = mv->var;
+    int n = 0;
+    int i;
+
+#define MERGE_TIME(s) (adios_merge_var_chars (v, (s), mv)[pos[(s)]].time_index)
+#define MERGE_LESS(s1,s2) (MERGE_TIME(s1) < MERGE_TIME(s2) || \
+                           (MERGE_TIME(s1) == MERGE_TIME(s2) && (s1) < (s2)))
+
+    if (!heap || !pos)
+    {
+        // no memory for the heap, just concatenate (unsorted)
+        uint64_t k = 0;
+        for (i = 0; i < nsrc; i++)
+        {
+            uint64_t cnt = adios_merge_var_count (v, i, mv);
+            memcpy (c + k, adios_merge_var_chars (v, i, mv),
+                    cnt * sizeof (struct adios_index_characteristic_struct_v1));
+            k += cnt;
+        }
+        free (heap);
+        free (pos);
+        return;
+    }
+
+    for (i = 0; i < nsrc; i++)
+    {
+        if (adios_merge_var_count (v, i, mv) > 0)
+        {
+            // sift up
+            int j = n++;
+            while (j > 0 && MERGE_LESS (i, heap[(j-1)/2]))
+            {
+                heap[j] = heap[(j-1)/2];
+                j = (j-1)/2;
+            }
+            heap[j] = i;
+        }
+    }
+
+    while (n > 0)
+    {
+        int s = heap[0];
+        memcpy (c++, &adios_merge_var_chars (v, s, mv)[pos[s]],
+                sizeof (struct adios_index_characteristic_struct_v1));
+        pos[s]++;
+        if (pos[s] == adios_merge_var_count (v, s, mv))
+        {
+            s = heap[--n];
+        }
+        // sift down s from the root
+        int j = 0;
+        while (2*j+1 < n)
+        {
+            int child = 2*j+1;
+            if (child+1 < n && MERGE_LESS (heap[child+1], heap[child]))
+                child++;
+            if (!MERGE_LESS (heap[child], s))
+                break;
+            heap[j] = heap[child];
+            j = child;
+        }
+        if (n > 0)
+            heap[j] = s;
+    }
+#undef MERGE_LESS
+#undef MERGE_TIME
+
+    free (heap);
+    free (pos);
+}
+
+static void * adios_merge_vars_thread (void * arg)
+{
+    struct adios_merge_vars_part * p = (struct adios_merge_vars_part *) arg;
+    int i, k;
+
+    for (i = p->start; i < p->start + p->n; i++)
+    {
+        struct adios_merge_var * mv = p->mvars[i];
+        struct adios_index_var_struct_v1 * v = mv->var;
+        struct adios_index_characteristic_struct_v1 * c;
+
+        if (!mv->nitems)
+            continue;
+
+        c = malloc (mv->count * sizeof (struct adios_index_characteristic_struct_v1));
+        if (!c)
+        {
+            adios_error (err_no_memory, "error allocating memory to build "
+                         "var index of %s/%s. Index aborted\n",
+                         v->var_path, v->var_name);
+        }
+        else if (p->needs_sorting)
+        {
+            adios_merge_var_sorted (mv, c);
+        }
+        else
+        {
+            memcpy (c, v->characteristics, v->characteristics_count *
+                    sizeof (struct adios_index_characteristic_struct_v1));
+            uint64_t count = v->characteristics_count;
+            for (k = 0; k < mv->nitems; k++)
+            {
+                memcpy (c + count, mv->items[k]->characteristics,
+                        mv->items[k]->characteristics_count *
+                        sizeof (struct adios_index_characteristic_struct_v1));
+                count += mv->items[k]->characteristics_count;
+            }
+        }
+
+        if (c)
+        {
+            free (v->characteristics);
+            v->characteristics = c;
+            v->characteristics_count = mv->count;
+            v->characteristics_allocated = mv->count;
+        }
+        for (k = 0; k < mv->nitems; k++)
+        {
+            adios_merge_free_var_item (mv->items[k]);
+        }
+    }
+    return NULL;
+}
+
+// Counting pass: find the variable of each item in the main index and
+// sum up the final characteristics count of each variable
+static int adios_merge_count_vars (struct adios_index_struct_v1 * main_index,
+                                   int nbuffers,
+                                   struct adios_index_var_struct_v1 ** vars,
+                                   struct adios_merge_var *** mvars_out)
+{
+    qhashtbl_t * tbl = qhashtbl (500);
+    struct adios_merge_var ** mvars = NULL;
+    int nmvars = 0;
+    int nmvars_allocated = 0;
+    int i;
+
+    for (i = 0; i < nbuffers; i++)
+    {
+        struct adios_index_var_struct_v1 * v = vars[i];
+        while (v)
+        {
+            struct adios_index_var_struct_v1 * v_next = v->next;
+            struct adios_merge_var * mv;
+            v->next = NULL;
+
+            mv = (struct adios_merge_var *) tbl->get2 (tbl, v->var_path, v->var_name);
+            if (!mv)
+            {
+                struct adios_index_var_struct_v1 * olditem =
+                    (struct adios_index_var_struct_v1 *)
+                    main_index->hashtbl_vars->get2 (main_index->hashtbl_vars,
+                                                    v->var_path, v->var_name);
+                if (!olditem)
+                {
+                    // new variable, later items are merged into this one
+                    index_append_var_v1 (main_index, v, 0);
+                    olditem = v;
+                    v = NULL;
+                }
+
+                if (nmvars == nmvars_allocated)
+                {
+                    int n = (nmvars_allocated ? 2 * nmvars_allocated : 64);
+                    void * ptr = realloc (mvars, n * sizeof (struct adios_merge_var *));
+                    if (ptr)
+                    {
+                        mvars = (struct adios_merge_var **) ptr;
+                        nmvars_allocated = n;
+                    }
+                }
+                mv = (nmvars < nmvars_allocated ?
+                      (struct adios_merge_var *) calloc (1, sizeof (struct adios_merge_var)) :
+                      NULL);
+                if (!mv)
+                {
+                    adios_error (err_no_memory, "error allocating memory to build "
+                                 "var index.  Index aborted\n");
+                    if (v)
+                        adios_merge_free_var_item (v);
+                    v = v_next;
+                    continue;
+                }
+                mv->var = olditem;
+                mv->count = olditem->characteristics_count;
+                mvars[nmvars++] = mv;
+                tbl->put2 (tbl, olditem->var_path, olditem->var_name, mv);
+            }
+
+            if (v)
+            {
+                /* NOTE: we just match name + path, like index_append_var_v1 */
+                if (strcmp (mv->var->group_name, v->group_name))
+                {
+                    adios_error (err_unspecified, "Error when merging variable index lists. "
+                            "Variable in two different groups have the same path+name. "
+                            "Groups: %s and %s, variable: path=%s, name=%s. "
+                            "Index aborted\n",
+                            mv->var->group_name, v->group_name,
+                            v->var_path, v->var_name);
+                    adios_merge_free_var_item (v);
+                }
+                else
+                {
+                    if (mv->nitems == mv->nitems_allocated)
+                    {
+                        int n = (mv->nitems_allocated ? 2 * mv->nitems_allocated : 16);
+                        void * ptr = realloc (mv->items,
+                                n * sizeof (struct adios_index_var_struct_v1 *));
+                        if (ptr)
+                        {
+                            mv->items = (struct adios_index_var_struct_v1 **) ptr;
+                            mv->nitems_allocated = n;
+                        }
+                    }
+                    if (mv->nitems < mv->nitems_allocated)
+                    {
+                        mv->items[mv->nitems++] = v;
+                        mv->count += v->characteristics_count;
+                    }
+                    else
+                    {
+                        adios_error (err_no_memory, "error allocating memory to build "
+                                     "var index.  Index aborted\n");
+                        adios_merge_free_var_item (v);
+                    }
+                }
+            }
+            v = v_next;
+        }
+    }
+
+    tbl->free (tbl);
+    *mvars_out = mvars;
+    return nmvars;
+}
+
+void adios_merge_index_buffers_v1 (
+                   struct adios_index_struct_v1 * main_index
+                  ,int nbuffers
+                  ,char ** buffers
+                  ,uint64_t * buffer_sizes
+                  ,int attrs_buffer
+                  ,int needs_sorting
+                  )
+{
+    struct adios_merge_parse_part parse_parts [ADIOS_MERGE_MAX_THREADS];
+    struct adios_merge_vars_part vars_parts [ADIOS_MERGE_MAX_THREADS];
+    struct adios_index_process_group_struct_v1 ** pgs;
+    struct adios_index_var_struct_v1 ** vars;
+    struct adios_index_attribute_struct_v1 ** attrs;
+    struct adios_merge_var ** mvars = NULL;
+    int nmvars, nthreads, i;
+
+    if (nbuffers <= 0)
+        return;
+
+    pgs = (struct adios_index_process_group_struct_v1 **)
+            malloc (nbuffers * sizeof (struct adios_index_process_group_struct_v1 *));
+    vars = (struct adios_index_var_struct_v1 **)
+            malloc (nbuffers * sizeof (struct adios_index_var_struct_v1 *));
+    attrs = (struct adios_index_attribute_struct_v1 **)
+            malloc (nbuffers * sizeof (struct adios_index_attribute_struct_v1 *));
+    if (!pgs || !vars || !attrs)
+    {
+        adios_error (err_no_memory, "error allocating memory to merge "
+                     "the index of %d processes. Index aborted\n", nbuffers);
+        free (pgs);
+        free (vars);
+        free (attrs);
+        return;
+    }
+
+    /* 1. parse the buffers in parallel */
+    nthreads = adios_merge_nthreads (nbuffers, ADIOS_MERGE_MIN_BUFFERS_PER_THREAD);
+    for (i = 0; i < nthreads; i++)
+    {
+        parse_parts[i].start = (int) ((int64_t) nbuffers * i / nthreads);
+        parse_parts[i].n = (int) ((int64_t) nbuffers * (i+1) / nthreads) - parse_parts[i].start;
+        parse_parts[i].buffers = buffers;
+        parse_parts[i].buffer_sizes = buffer_sizes;
+        parse_parts[i].attrs_buffer = attrs_buffer;
+        parse_parts[i].pgs = pgs;
+        parse_parts[i].vars = vars;
+        parse_parts[i].attrs = attrs;
+    }
+    log_debug ("merge index of %d buffers with %d threads\n", nbuffers, nthreads);
+    adios_merge_run_parts (adios_merge_parse_thread, parse_parts,
+                           sizeof (struct adios_merge_parse_part), nthreads);
+
+    /* 2. PGs and attributes are simply appended in order */
+    for (i = 0; i < nbuffers; i++)
+    {
+        if (pgs[i])
+        {
+            if (pgs[i]->is_time_aggregated)
+                needs_sorting = 1;
+            index_append_process_group_v1 (main_index, pgs[i]);
+        }
+
+        struct adios_index_attribute_struct_v1 * a = attrs[i];
+        while (a)
+        {
+            struct adios_index_attribute_struct_v1 * a_temp = a->next;
+            a->next = 0;
+            index_append_attribute_v1 (&main_index->attrs_root, a);
+            a = a_temp;
+        }
+    }
+    if (main_index->pg_root && main_index->pg_root->is_time_aggregated)
+    {
+        // variable characteristics need to be sorted if time steps are buffered
+        needs_sorting = 1;
+    }
+
+    /* 3. count characteristics per variable, then build each variable's
+          characteristics array once, in parallel over the variables */
+    nmvars = adios_merge_count_vars (main_index, nbuffers, vars, &mvars);
+    nthreads = adios_merge_nthreads (nmvars, 4);
+    for (i = 0; i < nthreads; i++)
+    {
+        vars_parts[i].mvars = mvars;
+        vars_parts[i].start = (int) ((int64_t) nmvars * i / nthreads);
+        vars_parts[i].n = (int) ((int64_t) nmvars * (i+1) / nthreads) - vars_parts[i].start;
+        vars_parts[i].needs_sorting = needs_sorting;
+    }
+    adios_merge_run_parts (adios_merge_vars_thread, vars_parts,
+                           sizeof (struct adios_merge_vars_part), nthreads);
+
+    for (i = 0; i < nmvars; i++)
+    {
+        free (mvars[i]->items);
+        free (mvars[i]);
+    }
+    free (mvars);
+    free (pgs);
+    free (vars);
+    free (attrs);
+}
+
+/* Gathering the index of all processes to rank 0 through a k-ary tree.
+   The ranks of the communicator form contiguous subtrees: a process
+   owning ranks [lo,hi) splits [lo+1,hi) into at most fanout contiguous
+   ranges, the first rank of each range being its child. Every process
+   merges the index of its subtree before sending it up, so rank 0 only
+   receives fanout indices and the process order in the merged index is
+   the same as with a flat gather.
+*/
+#define ADIOS_INDEX_TREE_TAG_SIZE 2311
+#define ADIOS_INDEX_TREE_TAG_DATA 2312
+
+// child ranges of a process owning [lo,hi), returns the number of children
+static int adios_index_tree_children (int lo, int hi, int fanout,
+                                      int * child_lo, int * child_hi)
+{
+    int n = hi - lo - 1;
+    int nchildren = (n < fanout ? n : fanout);
+    int i;
+    for (i = 0; i < nchildren; i++)
+    {
+        child_lo[i] = lo + 1 + (int) ((int64_t) n * i / nchildren);
+        child_hi[i] = lo + 1 + (int) ((int64_t) n * (i+1) / nchildren);
+    }
+    return nchildren;
+}
+
+static void adios_index_tree_send (char * buf, uint64_t size, int dest, MPI_Comm comm)
+{
+    MPI_Send (&size, 1, MPI_UNSIGNED_LONG_LONG, dest, ADIOS_INDEX_TREE_TAG_SIZE, comm);
+    while (size > 0)
+    {
+        int count = (size > INT32_MAX ? INT32_MAX : (int) size);
+        MPI_Send (buf, count, MPI_BYTE, dest, ADIOS_INDEX_TREE_TAG_DATA, comm);
+        buf += count;
+        size -= count;
+    }
+}
+
+static char * adios_index_tree_recv (uint64_t * size, int source, MPI_Comm comm)
+{
+    MPI_Status status;
+    uint64_t remaining;
+    char * buf, * p;
+
+    MPI_Recv (size, 1, MPI_UNSIGNED_LONG_LONG, source, ADIOS_INDEX_TREE_TAG_SIZE,
+              comm, &status);
+    buf = (char *) malloc (*size > 0 ? *size : 1);
+    assert (buf);
+    p = buf;
+    remaining = *size;
+    while (remaining > 0)
+    {
+        int count = (remaining > INT32_MAX ? INT32_MAX : (int) remaining);
+        MPI_Recv (p, count, MPI_BYTE, source, ADIOS_INDEX_TREE_TAG_DATA, comm, &status);
+        p += count;
+        remaining -= count;
+    }
+    return buf;
+}
+
+int adios_gather_indices_tree_v1 (MPI_Comm comm
+                                 ,int fanout
+                                 ,char * index_buffer
+                                 ,uint64_t index_size
+                                 ,int needs_sorting
+                                 ,char *** buffers
+                                 ,uint64_t ** buffer_sizes
+                                 )
+{
+    int rank, size, lo, hi, parent = -1;
+    int * child_lo, * child_hi;
+    int nchildren, i;
+    char ** bufs;
+    uint64_t * sizes;
+
+    MPI_Comm_rank (comm, &rank);
+    MPI_Comm_size (comm, &size);
+    // no process has more than size-1 children
+    if (fanout > size - 1)
+        fanout = size - 1;
+    if (fanout < 1)
+        fanout = 1;
+
+    child_lo = (int *) malloc ((size_t) 2 * fanout * sizeof(int));
+    assert (child_lo);
+    child_hi = child_lo + fanout;
+
+    // walk down from the root to find our subtree and parent
+    lo = 0;
+    hi = size;
+    while (lo != rank)
+    {
+        nchildren = adios_index_tree_children (lo, hi, fanout, child_lo, child_hi);
+        for (i = 0; i < nchildren && child_hi[i] <= rank; i++)
+            ;
+        parent = lo;
+        lo = child_lo[i];
+        hi = child_hi[i];
+    }
+    nchildren = adios_index_tree_children (lo, hi, fanout, child_lo, child_hi);
+
+    // own index first, then the subtree of each child in rank order
+    bufs = (char **) malloc ((nchildren + 1) * sizeof (char *));
+    sizes = (uint64_t *) malloc ((nchildren + 1) * sizeof (uint64_t));
+    assert (bufs && sizes);
+    bufs[0] = index_buffer;
+    sizes[0] = index_size;
+    for (i = 0; i < nchildren; i++)
+    {
+        bufs[i+1] = adios_index_tree_recv (&sizes[i+1], child_lo[i], comm);
+    }
+    free (child_lo);
+
+    if (rank == 0)
+    {
+        // the caller merges the buffers
+        *buffers = bufs;
+        *buffer_sizes = sizes;
+        return nchildren + 1;
+    }
+
+    if (nchildren == 0)
+    {
+        adios_index_tree_send (index_buffer, index_size, parent, comm);
+    }
+    else
+    {
+        // merge the subtree, attributes of other processes are not merged
+        struct adios_index_struct_v1 * index = adios_alloc_index_v1 (1);
+        char * merged = 0;
+        uint64_t merged_size = 0;
+        uint64_t merged_offset = 0;
+
+        adios_merge_index_buffers_v1 (index, nchildren + 1, bufs, sizes, -1,
+                                      needs_sorting);
+        adios_write_index_v1 (&merged, &merged_size, &merged_offset, 0, index);
+        adios_index_tree_send (merged, merged_offset, parent, comm);
+
+        free (merged);
+        adios_clear_index_v1 (index);
+        adios_free_index_v1 (index);
+    }
+
+    for (i = 1; i <= nchildren; i++)
+    {
+        free (bufs[i]);
+    }
+    free (bufs);
+    free (sizes);
+    *buffers = NULL;
+    *buffer_sizes = NULL;
+    return 0;
+}
+
+/* Gathering buffers of any size to rank 0. MPI_Gatherv takes int counts
+   and displacements, so it is only used if all buffers together fit into
+   2GB. Otherwise rank 0 receives the buffer of every process point to
+   point, in pieces of at most 2GB.
+*/
+#define ADIOS_GATHER_TAG_DATA 2313
+
+char * adios_gather_buffers (MPI_Comm comm
+                            ,char * buffer
+                            ,uint64_t size
+                            ,uint64_t * sizes
+                            ,uint64_t * offsets
+                            )
+{
+    int rank, nproc, i, large = 0;
+    uint64_t total = 0;
+    char * recv_buffer = 0;
+
+    MPI_Comm_rank (comm, &rank);
+    MPI_Comm_size (comm, &nproc);
+
+    MPI_Gather (&size, 1, MPI_UNSIGNED_LONG_LONG
+               ,sizes, 1, MPI_UNSIGNED_LONG_LONG
+               ,0, comm
+               );
+
+    if (rank == 0)
+    {
+        for (i = 0; i < nproc; i++)
+        {
+            offsets[i] = total;
+            total += sizes[i];
+        }
+        large = (total > INT32_MAX);
+        recv_buffer = (char *) malloc (total > 0 ? total : 1);
+        assert (recv_buffer);
+    }
+    MPI_Bcast (&large, 1, MPI_INT, 0, comm);
+
+    if (!large)
+    {
+        int * counts = 0, * displs = 0;
+        if (rank == 0)
+        {
+            counts = (int *) malloc (2 * nproc * sizeof (int));
+            assert (counts);
+            displs = counts + nproc;
+            for (i = 0; i < nproc; i++)
+            {
+                counts[i] = (int) sizes[i];
+                displs[i] = (int) offsets[i];
+            }
+        }
+        MPI_Gatherv (buffer, (int) size, MPI_BYTE
+                    ,recv_buffer, counts, displs, MPI_BYTE
+                    ,0, comm
+                    );
+        free (counts);
+        return recv_buffer;
+    }
+
+    if (rank == 0)
+    {
+        MPI_Status status;
+        if (sizes[0] > 0)
+            memcpy (recv_buffer + offsets[0], buffer, sizes[0]);
+        for (i = 1; i < nproc; i++)
+        {
+            char * p = recv_buffer + offsets[i];
+            uint64_t remaining = sizes[i];
+            while (remaining > 0)
+            {
+                int count = (remaining > INT32_MAX ? INT32_MAX : (int) remaining);
+                MPI_Recv (p, count, MPI_BYTE, i, ADIOS_GATHER_TAG_DATA, comm, &status);
+                p += count;
+                remaining -= count;
+            }
+        }
+    }
+    else
+    {
+        while (size > 0)
+        {
+            int count = (size > INT32_MAX ? INT32_MAX : (int) size);
+            MPI_Send (buffer, count, MPI_BYTE, 0, ADIOS_GATHER_TAG_DATA, comm);
+            buffer += count;
+            size -= count;
+        }
+    }
+    return recv_buffer;
+}
+
 #if 0
 // obsolete, merge the index with sorting
 // sort pg/var indexes by time index
@@ -4872,6 +5598,27 @@ int adios_write_version_flag_v1 (char ** buffer
     return 0;
 }
 
+/* Touch the "step ready" marker of file base_path/name after the footer of
+ * a step has been written (see ADIOS_STEP_MARKER_SUFFIX) */
+void adios_write_step_marker_v1 (const char * base_path, const char * name)
+{
+    char * marker = malloc (strlen (base_path) + strlen (name)
+                            + strlen (ADIOS_STEP_MARKER_SUFFIX) + 1);
+    int f;
+
+    sprintf (marker, "%s%s%s", base_path, name, ADIOS_STEP_MARKER_SUFFIX);
+    f = open (marker, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (f == -1)
+    {
+        log_warn ("Cannot write the step marker %s: %s\n", marker, strerror (errno));
+    }
+    else
+    {
+        close (f);
+    }
+    free (marker);
+}
+
 static uint16_t calc_dimension_size (struct adios_dimension_struct * dimension)
 {
     uint16_t size = 0;
@@ -5287,7 +6034,663 @@ uint16_t adios_write_var_characteristics_v1 (struct adios_file_struct * fd
     return index_size;
 }
 
-int adios_generate_var_characteristics_v1 (struct adios_file_struct * fd, struct adios_var_struct * var)
+/*
+ * Statistics kernels used by adios_generate_var_characteristics_v1()
+ *
+ * One pass over a contiguous array calculates min/max (and sum, sum of squares 
+ * and count of valid elements in full statistics mode). 
+ * NaN values (and Inf values in full mode) are skipped by masking, not by branching.
+ * The array is processed in blocks of ADIOS_STAT_LANES elements, each element of a
+ * block is accumulated in its own lane. The lanes are reduced in fixed order at the end, 
+ * so the portable code and the AVX2/AVX-512 code (selected at runtime for doubles) give 
+ * the same result.
+ */
+#define ADIOS_STAT_LANES 8
+#define ADIOS_STAT_HIST_BLOCK 256
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) \
+    && !defined(__INTEL_COMPILER) && !defined(__PGI) && !defined(__NVCOMPILER) \
+    && ((defined(__clang__) && __clang_major__ >= 4) || (!defined(__clang__) && __GNUC__ >= 5))
+#  define ADIOS_STAT_X86_SIMD 1
+#  include <immintrin.h>
+#endif
+
+union adios_stat_value
+{
+    int8_t  i8;
+    uint8_t u8;
+    int16_t i16;
+    uint16_t u16;
+    int32_t i32;
+    uint32_t u32;
+    int64_t i64;
+    uint64_t u64;
+    float f;
+    double d;
+    long double ld;
+};
+
+/* Statistics of an array (or a part of it) */
+struct adios_stat_result
+{
+    union adios_stat_value min;
+    union adios_stat_value max;
+    double sum;
+    double sum_square;
+    uint64_t cnt;    // number of valid elements (full mode only)
+    int have_value;  // = 1 if there is at least one valid element
+};
+
+#define ADIOS_STAT_VALID_INT(x) (1)
+#define ADIOS_STAT_VALID_NOTNAN(x) (!isnan(x))
+#define ADIOS_STAT_VALID_FINITE(x) (isfinite(x))
+
+/* square of x or of d=(double)x, as the scalar code always calculated it */
+#define ADIOS_STAT_SQUARE_D(x,d) ((d) * (d))
+#define ADIOS_STAT_SQUARE_T(x,d) ((double) ((x) * (x)))
+
+/* Process nb elements (multiple of ADIOS_STAT_LANES) into lanes.
+   v0 is a valid value used in place of the invalid ones for min/max. */
+#define ADIOS_STAT_LANES_FN(T, FNAME, VALID, SQUARE, FULL) \
+static void FNAME (const T * data, uint64_t nb, T v0, \
+                   T * lmin, T * lmax, double * lsum, double * lsq, uint64_t * lcnt) \
+{ \
+    uint64_t i; \
+    int k; \
+    for (k = 0; k < ADIOS_STAT_LANES; k++) { \
+        lmin[k] = lmax[k] = v0; \
+        lsum[k] = lsq[k] = 0.0; \
+        lcnt[k] = 0; \
+    } \
+    for (i = 0; i < nb; i += ADIOS_STAT_LANES) { \
+        for (k = 0; k < ADIOS_STAT_LANES; k++) { \
+            T x = data[i+k]; \
+            int ok = VALID(x); \
+            T xm = ok ? x : v0; \
+            lmin[k] = (xm < lmin[k]) ? xm : lmin[k]; \
+            lmax[k] = (xm > lmax[k]) ? xm : lmax[k]; \
+            if (FULL) { \
+                double d = ok ? (double) x : 0.0; \
+                lsum[k] += d; \
+                lsq[k] += ok ? SQUARE(x,d) : 0.0; \
+                lcnt[k] += ok; \
+            } \
+        } \
+    } \
+}
+
+/* Calculate the statistics of n elements. LANES_FULL/LANES_MINMAX process the blocks,
+   the remainder is processed here one by one */
+#define ADIOS_STAT_CALC_FN(T, NAME, VALID_FULL, VALID_MINMAX, SQUARE, LANES_FULL, LANES_MINMAX) \
+static void adios_stat_calc_##NAME (const T * data, uint64_t n, int full, \
+                                    struct adios_stat_result * r) \
+{ \
+    T lmin[ADIOS_STAT_LANES], lmax[ADIOS_STAT_LANES]; \
+    double lsum[ADIOS_STAT_LANES], lsq[ADIOS_STAT_LANES]; \
+    uint64_t lcnt[ADIOS_STAT_LANES]; \
+    uint64_t i = 0, nb; \
+    int k; \
+    T * min = (T *) &r->min; \
+    T * max = (T *) &r->max; \
+    memset (r, 0, sizeof (struct adios_stat_result)); \
+    if (full) \
+        while (i < n && !VALID_FULL(data[i])) i++; \
+    else \
+        while (i < n && !VALID_MINMAX(data[i])) i++; \
+    if (i == n) \
+        return; \
+    r->have_value = 1; \
+    *min = *max = data[i]; \
+    nb = n - n % ADIOS_STAT_LANES; \
+    if (full) \
+        LANES_FULL (data, nb, data[i], lmin, lmax, lsum, lsq, lcnt); \
+    else \
+        LANES_MINMAX (data, nb, data[i], lmin, lmax, lsum, lsq, lcnt); \
+    for (k = 0; k < ADIOS_STAT_LANES; k++) { \
+        if (lmin[k] < *min) *min = lmin[k]; \
+        if (lmax[k] > *max) *max = lmax[k]; \
+        r->sum += lsum[k]; \
+        r->sum_square += lsq[k]; \
+        r->cnt += lcnt[k]; \
+    } \
+    for (i = nb; i < n; i++) { \
+        T x = data[i]; \
+        if (full) { \
+            if (!VALID_FULL(x)) continue; \
+            double d = (double) x; \
+            r->sum += d; \
+            r->sum_square += SQUARE(x,d); \
+            r->cnt++; \
+        } else if (!VALID_MINMAX(x)) { \
+            continue; \
+        } \
+        if (x < *min) *min = x; \
+        if (x > *max) *max = x; \
+    } \
+}
+
+/* Histogram of the finite values. Bins of a block of values are calculated first
+   with a branch-free binary search, then the frequencies are updated.
+   Bin index = number of breaks <= value */
+#define ADIOS_STAT_HIST_FN(T, NAME, VALID) \
+static void adios_stat_hist_##NAME (const T * data, uint64_t n, struct adios_hist_struct * hist) \
+{ \
+    uint32_t bins [ADIOS_STAT_HIST_BLOCK]; \
+    uint32_t valid [ADIOS_STAT_HIST_BLOCK]; \
+    const double * breaks = hist->breaks; \
+    uint64_t i; \
+    int j, m; \
+    for (i = 0; i < n; i += ADIOS_STAT_HIST_BLOCK) { \
+        m = (n - i < ADIOS_STAT_HIST_BLOCK ? n - i : ADIOS_STAT_HIST_BLOCK); \
+        for (j = 0; j < m; j++) { \
+            T a = data[i+j]; \
+            uint32_t lo = 0, len = hist->num_breaks; \
+            while (len > 0) { \
+                uint32_t half = len >> 1; \
+                int c = (breaks[lo + half] <= a); \
+                lo = c ? lo + half + 1 : lo; \
+                len = c ? len - half - 1 : half; \
+            } \
+            bins[j] = lo; \
+            valid[j] = VALID(a); \
+        } \
+        for (j = 0; j < m; j++) { \
+            hist->frequencies[bins[j]] += valid[j]; \
+        } \
+    } \
+}
+
+ADIOS_STAT_LANES_FN (double, adios_stat_lanes_full_double_generic, ADIOS_STAT_VALID_FINITE, ADIOS_STAT_SQUARE_D, 1)
+ADIOS_STAT_LANES_FN (double, adios_stat_lanes_minmax_double_generic, ADIOS_STAT_VALID_NOTNAN, ADIOS_STAT_SQUARE_D, 0)
+
+#ifdef ADIOS_STAT_X86_SIMD
+
+__attribute__((target("avx2")))
+static void adios_stat_lanes_double_avx2 (const double * data, uint64_t nb, double v0, int full,
+                   double * lmin, double * lmax, double * lsum, double * lsq, uint64_t * lcnt)
+{
+    const __m256d absmask = _mm256_castsi256_pd (_mm256_set1_epi64x (0x7fffffffffffffffLL));
+    const __m256d inf = _mm256_set1_pd (HUGE_VAL);
+    const __m256d vinit = _mm256_set1_pd (v0);
+    __m256d mn[2], mx[2], s[2], q[2];
+    __m256i c[2];
+    uint64_t i;
+    int h;
+
+    for (h = 0; h < 2; h++) {
+        mn[h] = mx[h] = vinit;
+        s[h] = q[h] = _mm256_setzero_pd ();
+        c[h] = _mm256_setzero_si256 ();
+    }
+
+    if (full)
+    {
+        for (i = 0; i < nb; i += ADIOS_STAT_LANES) {
+            for (h = 0; h < 2; h++) {
+                __m256d x = _mm256_loadu_pd (data + i + 4*h);
+                // finite <=> |x| < Inf (false for NaN)
+                __m256d ok = _mm256_cmp_pd (_mm256_and_pd (x, absmask), inf, _CMP_LT_OQ);
+                __m256d xm = _mm256_blendv_pd (vinit, x, ok);
+                __m256d d = _mm256_and_pd (x, ok);
+                mn[h] = _mm256_min_pd (xm, mn[h]);
+                mx[h] = _mm256_max_pd (xm, mx[h]);
+                s[h] = _mm256_add_pd (s[h], d);
+                q[h] = _mm256_add_pd (q[h], _mm256_mul_pd (d, d));
+                c[h] = _mm256_sub_epi64 (c[h], _mm256_castpd_si256 (ok)); // ok lanes are -1
+            }
+        }
+    }
+    else
+    {
+        for (i = 0; i < nb; i += ADIOS_STAT_LANES) {
+            for (h = 0; h < 2; h++) {
+                __m256d x = _mm256_loadu_pd (data + i + 4*h);
+                __m256d ok = _mm256_cmp_pd (x, x, _CMP_ORD_Q);
+                __m256d xm = _mm256_blendv_pd (vinit, x, ok);
+                mn[h] = _mm256_min_pd (xm, mn[h]);
+                mx[h] = _mm256_max_pd (xm, mx[h]);
+            }
+        }
+    }
+
+    for (h = 0; h < 2; h++) {
+        _mm256_storeu_pd (lmin + 4*h, mn[h]);
+        _mm256_storeu_pd (lmax + 4*h, mx[h]);
+        _mm256_storeu_pd (lsum + 4*h, s[h]);
+        _mm256_storeu_pd (lsq + 4*h, q[h]);
+        _mm256_storeu_si256 ((__m256i *) (lcnt + 4*h), c[h]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void adios_stat_lanes_double_avx512 (const double * data, uint64_t nb, double v0, int full,
+                   double * lmin, double * lmax, double * lsum, double * lsq, uint64_t * lcnt)
+{
+    const __m512i absmask = _mm512_set1_epi64 (0x7fffffffffffffffLL);
+    const __m512d inf = _mm512_set1_pd (HUGE_VAL);
+    const __m512d vinit = _mm512_set1_pd (v0);
+    const __m512i one = _mm512_set1_epi64 (1);
+    __m512d mn = vinit, mx = vinit;
+    __m512d s = _mm512_setzero_pd (), q = _mm512_setzero_pd ();
+    __m512i c = _mm512_setzero_si512 ();
+    uint64_t i;
+
+    if (full)
+    {
+        for (i = 0; i < nb; i += ADIOS_STAT_LANES) {
+            __m512d x = _mm512_loadu_pd (data + i);
+            __m512d ax = _mm512_castsi512_pd (_mm512_and_epi64 (_mm512_castpd_si512 (x), absmask));
+            __mmask8 ok = _mm512_cmp_pd_mask (ax, inf, _CMP_LT_OQ);
+            __m512d xm = _mm512_mask_blend_pd (ok, vinit, x);
+            __m512d d = _mm512_maskz_mov_pd (ok, x);
+            mn = _mm512_min_pd (xm, mn);
+            mx = _mm512_max_pd (xm, mx);
+            s = _mm512_add_pd (s, d);
+            q = _mm512_add_pd (q, _mm512_mul_pd (d, d));
+            c = _mm512_mask_add_epi64 (c, ok, c, one);
+        }
+    }
+    else
+    {
+        for (i = 0; i < nb; i += ADIOS_STAT_LANES) {
+            __m512d x = _mm512_loadu_pd (data + i);
+            __mmask8 ok = _mm512_cmp_pd_mask (x, x, _CMP_ORD_Q);
+            __m512d xm = _mm512_mask_blend_pd (ok, vinit, x);
+            mn = _mm512_min_pd (xm, mn);
+            mx = _mm512_max_pd (xm, mx);
+        }
+    }
+
+    _mm512_storeu_pd (lmin, mn);
+    _mm512_storeu_pd (lmax, mx);
+    _mm512_storeu_pd (lsum, s);
+    _mm512_storeu_pd (lsq, q);
+    _mm512_storeu_si512 ((void *) lcnt, c);
+}
+
+/* 0: generic code, 1: AVX2, 2: AVX-512F, -1: not yet checked */
+static int adios_stat_simd_level = -1;
+
+static int adios_stat_get_simd_level (void)
+{
+    if (adios_stat_simd_level < 0)
+    {
+        __builtin_cpu_init ();
+        if (__builtin_cpu_supports ("avx512f"))
+            adios_stat_simd_level = 2;
+        else if (__builtin_cpu_supports ("avx2"))
+            adios_stat_simd_level = 1;
+        else
+            adios_stat_simd_level = 0;
+        log_debug ("Statistics calculation uses %s instructions\n",
+                (adios_stat_simd_level == 2 ? "AVX-512" : 
+                 (adios_stat_simd_level == 1 ? "AVX2" : "generic")));
+    }
+    return adios_stat_simd_level;
+}
+#endif
+
+static void adios_stat_lanes_full_double (const double * data, uint64_t nb, double v0,
+                   double * lmin, double * lmax, double * lsum, double * lsq, uint64_t * lcnt)
+{
+#ifdef ADIOS_STAT_X86_SIMD
+    switch (adios_stat_get_simd_level())
+    {
+        case 2:
+            adios_stat_lanes_double_avx512 (data, nb, v0, 1, lmin, lmax, lsum, lsq, lcnt);
+            return;
+        case 1:
+            adios_stat_lanes_double_avx2 (data, nb, v0, 1, lmin, lmax, lsum, lsq, lcnt);
+            return;
+    }
+#endif
+    adios_stat_lanes_full_double_generic (data, nb, v0, lmin, lmax, lsum, lsq, lcnt);
+}
+
+static void adios_stat_lanes_minmax_double (const double * data, uint64_t nb, double v0,
+                   double * lmin, double * lmax, double * lsum, double * lsq, uint64_t * lcnt)
+{
+#ifdef ADIOS_STAT_X86_SIMD
+    switch (adios_stat_get_simd_level())
+    {
+        case 2:
+            adios_stat_lanes_double_avx512 (data, nb, v0, 0, lmin, lmax, lsum, lsq, lcnt);
+            return;
+        case 1:
+            adios_stat_lanes_double_avx2 (data, nb, v0, 0, lmin, lmax, lsum, lsq, lcnt);
+            return;
+    }
+#endif
+    adios_stat_lanes_minmax_double_generic (data, nb, v0, lmin, lmax, lsum, lsq, lcnt);
+}
+
+#define ADIOS_STAT_FUNCTIONS(T, NAME, VALID_FULL, VALID_MINMAX, SQUARE) \
+    ADIOS_STAT_LANES_FN (T, adios_stat_lanes_full_##NAME, VALID_FULL, SQUARE, 1) \
+    ADIOS_STAT_LANES_FN (T, adios_stat_lanes_minmax_##NAME, VALID_MINMAX, SQUARE, 0) \
+    ADIOS_STAT_CALC_FN (T, NAME, VALID_FULL, VALID_MINMAX, SQUARE, \
+                        adios_stat_lanes_full_##NAME, adios_stat_lanes_minmax_##NAME) \
+    ADIOS_STAT_HIST_FN (T, NAME, VALID_FULL)
+
+ADIOS_STAT_FUNCTIONS (int8_t, int8_t, ADIOS_STAT_VALID_INT, ADIOS_STAT_VALID_INT, ADIOS_STAT_SQUARE_D)
+ADIOS_STAT_FUNCTIONS (uint8_t, uint8_t, ADIOS_STAT_VALID_INT, ADIOS_STAT_VALID_INT, ADIOS_STAT_SQUARE_D)
+ADIOS_STAT_FUNCTIONS (int16_t, int16_t, ADIOS_STAT_VALID_INT, ADIOS_STAT_VALID_INT, ADIOS_STAT_SQUARE_D)
+ADIOS_STAT_FUNCTIONS (uint16_t, uint16_t, ADIOS_STAT_VALID_INT, ADIOS_STAT_VALID_INT, ADIOS_STAT_SQUARE_D)
+ADIOS_STAT_FUNCTIONS (int32_t, int32_t, ADIOS_STAT_VALID_INT, ADIOS_STAT_VALID_INT, ADIOS_STAT_SQUARE_D)
+ADIOS_STAT_FUNCTIONS (uint32_t, uint32_t, ADIOS_STAT_VALID_INT, ADIOS_STAT_VALID_INT, ADIOS_STAT_SQUARE_D)
+ADIOS_STAT_FUNCTIONS (int64_t, int64_t, ADIOS_STAT_VALID_INT, ADIOS_STAT_VALID_INT, ADIOS_STAT_SQUARE_D)
+ADIOS_STAT_FUNCTIONS (uint64_t, uint64_t, ADIOS_STAT_VALID_INT, ADIOS_STAT_VALID_INT, ADIOS_STAT_SQUARE_D)
+ADIOS_STAT_FUNCTIONS (float, float, ADIOS_STAT_VALID_FINITE, ADIOS_STAT_VALID_NOTNAN, ADIOS_STAT_SQUARE_T)
+ADIOS_STAT_FUNCTIONS (long double, long_double, ADIOS_STAT_VALID_FINITE, ADIOS_STAT_VALID_NOTNAN, ADIOS_STAT_SQUARE_T)
+/* double uses the SIMD lanes functions defined above */
+ADIOS_STAT_CALC_FN (double, double, ADIOS_STAT_VALID_FINITE, ADIOS_STAT_VALID_NOTNAN, ADIOS_STAT_SQUARE_D,
+                    adios_stat_lanes_full_double, adios_stat_lanes_minmax_double)
+ADIOS_STAT_HIST_FN (double, double, ADIOS_STAT_VALID_FINITE)
+
+/*
+ * Statistics of large arrays calculated by a team of threads
+ *
+ * The array is split into equal parts (multiple of ADIOS_STAT_LANES elements),
+ * each thread calculates the statistics and histogram of one part, and the
+ * partial results are reduced in a binary tree.
+ */
+
+/* Each thread gets at least this many bytes of the array */
+#define ADIOS_STAT_THREAD_MIN_SIZE (1024*1024)
+#define ADIOS_STAT_MAX_THREADS 64
+
+static int adios_stat_nthreads = 1;
+
+void adios_set_stats_threads_v1 (int nthreads)
+{
+    if (nthreads < 1)
+        nthreads = 1;
+    if (nthreads > ADIOS_STAT_MAX_THREADS)
+        nthreads = ADIOS_STAT_MAX_THREADS;
+    adios_stat_nthreads = nthreads;
+}
+
+struct adios_stat_part
+{
+    enum ADIOS_DATATYPES type;
+    int full;
+    const void * data;
+    uint64_t n;
+    struct adios_hist_struct * hist; // NULL if no histogram, else own frequencies
+    struct adios_stat_result r;
+    pthread_t thread;
+    int thread_started;
+};
+
+struct adios_stat_job
+{
+    struct adios_var_struct * var;
+    enum ADIOS_DATATYPES type;
+    int full;
+    int32_t map[32];
+    struct adios_hist_struct * hist; // histogram of var (NULL if not requested)
+    int nparts;
+    struct adios_stat_part * parts;
+};
+
+#define ADIOS_STAT_CASES(CALL) \
+    case adios_byte:             CALL (int8_t, int8_t); break; \
+    case adios_unsigned_byte:    CALL (uint8_t, uint8_t); break; \
+    case adios_short:            CALL (int16_t, int16_t); break; \
+    case adios_unsigned_short:   CALL (uint16_t, uint16_t); break; \
+    case adios_integer:          CALL (int32_t, int32_t); break; \
+    case adios_unsigned_integer: CALL (uint32_t, uint32_t); break; \
+    case adios_long:             CALL (int64_t, int64_t); break; \
+    case adios_unsigned_long:    CALL (uint64_t, uint64_t); break; \
+    case adios_real:             CALL (float, float); break; \
+    case adios_double:           CALL (double, double); break; \
+    case adios_long_double:      CALL (long double, long_double); break; \
+    default: break;
+
+static void adios_stat_calc_part (struct adios_stat_part * p)
+{
+#define ADIOS_STAT_CALC_PART(T,NAME) \
+    adios_stat_calc_##NAME ((const T *) p->data, p->n, p->full, &p->r); \
+    if (p->hist) \
+        adios_stat_hist_##NAME ((const T *) p->data, p->n, p->hist);
+
+    switch (p->type)
+    {
+        ADIOS_STAT_CASES (ADIOS_STAT_CALC_PART)
+    }
+#undef ADIOS_STAT_CALC_PART
+}
+
+static void * adios_stat_part_thread (void * arg)
+{
+    adios_stat_calc_part ((struct adios_stat_part *) arg);
+    return NULL;
+}
+
+/* Add the statistics of b to a */
+static void adios_stat_merge (enum ADIOS_DATATYPES type, struct adios_stat_result * a,
+                              const struct adios_stat_result * b)
+{
+#define ADIOS_STAT_MERGE_MINMAX(T,NAME) \
+    if (*(const T *) &b->min < *(T *) &a->min) *(T *) &a->min = *(const T *) &b->min; \
+    if (*(const T *) &b->max > *(T *) &a->max) *(T *) &a->max = *(const T *) &b->max;
+
+    if (!b->have_value)
+        return;
+    if (!a->have_value)
+    {
+        a->min = b->min;
+        a->max = b->max;
+        a->have_value = 1;
+    }
+    else
+    {
+        switch (type)
+        {
+            ADIOS_STAT_CASES (ADIOS_STAT_MERGE_MINMAX)
+        }
+    }
+    a->sum += b->sum;
+    a->sum_square += b->sum_square;
+    a->cnt += b->cnt;
+#undef ADIOS_STAT_MERGE_MINMAX
+}
+
+/* Store the final result in the (already allocated) statistics of the variable */
+static void adios_stat_store (struct adios_var_struct * var, enum ADIOS_DATATYPES type,
+                              int32_t * map, const struct adios_stat_result * r)
+{
+    struct adios_stat_struct * stats = var->stats[0];
+    memcpy (stats[map[adios_statistic_min]].data, &r->min,
+            adios_get_stat_size (NULL, type, adios_statistic_min));
+    memcpy (stats[map[adios_statistic_max]].data, &r->max,
+            adios_get_stat_size (NULL, type, adios_statistic_max));
+    if (map[adios_statistic_sum] != -1)
+        *(double *) stats[map[adios_statistic_sum]].data = r->sum;
+    if (map[adios_statistic_sum_square] != -1)
+        *(double *) stats[map[adios_statistic_sum_square]].data = r->sum_square;
+    if (map[adios_statistic_cnt] != -1)
+        *(uint32_t *) stats[map[adios_statistic_cnt]].data = (uint32_t) r->cnt;
+    if (map[adios_statistic_finite] != -1)
+        *(uint8_t *) stats[map[adios_statistic_finite]].data = r->have_value;
+}
+
+static void adios_stat_job_free (struct adios_stat_job * job)
+{
+    int i;
+    // parts[0] uses the histogram of the variable
+    for (i = 1; i < job->nparts; i++)
+    {
+        if (job->parts[i].hist)
+        {
+            free (job->parts[i].hist->frequencies);
+            free (job->parts[i].hist);
+        }
+    }
+    free (job->parts);
+    free (job);
+}
+
+static struct adios_stat_job * adios_stat_job_alloc (int nparts, struct adios_hist_struct * hist)
+{
+    struct adios_stat_job * job;
+    int i;
+
+    job = (struct adios_stat_job *) calloc (1, sizeof (struct adios_stat_job));
+    if (!job)
+        return NULL;
+    job->parts = (struct adios_stat_part *) calloc (nparts, sizeof (struct adios_stat_part));
+    if (!job->parts)
+    {
+        free (job);
+        return NULL;
+    }
+    job->nparts = nparts;
+    job->hist = hist;
+    if (hist)
+    {
+        job->parts[0].hist = hist;
+        for (i = 1; i < nparts; i++)
+        {
+            struct adios_hist_struct * h;
+            h = (struct adios_hist_struct *) malloc (sizeof (struct adios_hist_struct));
+            if (h)
+            {
+                *h = *hist;
+                h->frequencies = (uint32_t *) calloc (hist->num_breaks + 1, sizeof (uint32_t));
+                if (!h->frequencies)
+                {
+                    free (h);
+                    h = NULL;
+                }
+            }
+            if (!h)
+            {
+                adios_stat_job_free (job);
+                return NULL;
+            }
+            job->parts[i].hist = h;
+        }
+    }
+    return job;
+}
+
+/* Calculate statistics of n elements of type at data and store them in var.
+   If the array is large enough and more threads are allowed, the parts of
+   the array are processed by a thread team. If background is set, the job is 
+   returned without waiting for the threads, otherwise the calling thread 
+   processes the first part itself and waits for the others. 
+   Returns NULL if the statistics are complete. */
+static struct adios_stat_job * adios_stat_start (struct adios_var_struct * var,
+                enum ADIOS_DATATYPES type, int full, int32_t * map,
+                struct adios_hist_struct * hist, const void * data, uint64_t n,
+                int background)
+{
+    struct adios_stat_job * job = NULL;
+    uint64_t elemsize = adios_get_type_size (type, "");
+    uint64_t chunk, start;
+    int nparts, i;
+
+    nparts = adios_stat_nthreads;
+    if (n * elemsize / ADIOS_STAT_THREAD_MIN_SIZE < (uint64_t) nparts)
+        nparts = n * elemsize / ADIOS_STAT_THREAD_MIN_SIZE;
+
+    if (nparts > 1)
+        job = adios_stat_job_alloc (nparts, hist);
+
+    if (!job)
+    {
+        struct adios_stat_part p;
+        memset (&p, 0, sizeof (p));
+        p.type = type;
+        p.full = full;
+        p.data = data;
+        p.n = n;
+        p.hist = hist;
+        adios_stat_calc_part (&p);
+        adios_stat_store (var, type, map, &p.r);
+        return NULL;
+    }
+
+    job->var = var;
+    job->type = type;
+    job->full = full;
+    memcpy (job->map, map, sizeof (job->map));
+
+    chunk = (n + nparts - 1) / nparts;
+    chunk = (chunk + ADIOS_STAT_LANES - 1) / ADIOS_STAT_LANES * ADIOS_STAT_LANES;
+    start = 0;
+    for (i = 0; i < nparts; i++)
+    {
+        struct adios_stat_part * p = &job->parts[i];
+        p->type = type;
+        p->full = full;
+        p->data = (const char *) data + start * elemsize;
+        p->n = (n - start < chunk ? n - start : chunk);
+        start += p->n;
+        if (i == 0 && !background)
+            continue;
+        // if a thread cannot be created, the part is processed in adios_generate_var_characteristics_wait_v1()
+        if (!pthread_create (&p->thread, NULL, adios_stat_part_thread, p))
+            p->thread_started = 1;
+    }
+
+    log_debug ("Statistics of %s/%s are calculated by %d threads\n", var->path, var->name, nparts);
+
+    if (!background)
+    {
+        adios_generate_var_characteristics_wait_v1 (job);
+        return NULL;
+    }
+    return job;
+}
+
+void adios_generate_var_characteristics_wait_v1 (struct adios_stat_job * job)
+{
+    int i, k, stride;
+
+    if (!job)
+        return;
+
+    for (i = 0; i < job->nparts; i++)
+    {
+        if (!job->parts[i].thread_started)
+            adios_stat_calc_part (&job->parts[i]);
+    }
+
+    /* Tree reduction of the partial results into parts[0] */
+    for (stride = 1; stride < job->nparts; stride *= 2)
+    {
+        for (i = 0; i + stride < job->nparts; i += 2*stride)
+        {
+            struct adios_stat_part * a = &job->parts[i];
+            struct adios_stat_part * b = &job->parts[i+stride];
+            if (a->thread_started)
+            {
+                pthread_join (a->thread, NULL);
+                a->thread_started = 0;
+            }
+            if (b->thread_started)
+            {
+                pthread_join (b->thread, NULL);
+                b->thread_started = 0;
+            }
+            adios_stat_merge (job->type, &a->r, &b->r);
+            if (job->hist)
+            {
+                for (k = 0; k <= (int) job->hist->num_breaks; k++)
+                    a->hist->frequencies[k] += b->hist->frequencies[k];
+            }
+        }
+    }
+    if (job->parts[0].thread_started)
+        pthread_join (job->parts[0].thread, NULL); // only if nparts == 1
+
+    adios_stat_store (job->var, job->type, job->map, &job->parts[0].r);
+    adios_stat_job_free (job);
+}
+
+static struct adios_stat_job * adios_generate_var_characteristics (struct adios_file_struct * fd,
+                struct adios_var_struct * var, int background)
 {
     uint64_t total_size = 0;
     uint64_t n = 0;
@@ -5301,7 +6704,7 @@ int adios_generate_var_characteristics_v1 (struct adios_file_struct * fd, struct
     }
 
     if (var->bitmap == 0)
-        return 0;
+        return NULL;
 
     enum ADIOS_STATISTICS_FLAG stat_flag = fd->group->stats_flag;
     int32_t map[32];
@@ -5337,19 +6740,11 @@ int adios_generate_var_characteristics_v1 (struct adios_file_struct * fd, struct
 
 
 
-# define CHECK_FLOAT() (isnan (data [n]) || !isfinite (data [n]))
-# define CHECK_INT() (0)
-# define CHECK_FLOAT_NAN() (isnan (data [n]))
-# define CHECK_INT_NAN() (0)
-
-#define ADIOS_STATISTICS_FULL(a,b,NON_FINITE_CHECK) \
+#define ADIOS_STATISTICS_FULL(a) \
 {\
     a * data = (a *) var->data; \
     int i, j; \
     struct adios_stat_struct * stats = var->stats[0]; \
-    a * min, * max; \
-    double * sum, * sum_square; \
-    uint32_t * cnt; \
     struct adios_hist_struct * hist = 0; \
     i = j = 0; \
     while (var->bitmap >> j) { \
@@ -5363,53 +6758,15 @@ int adios_generate_var_characteristics_v1 (struct adios_file_struct * fd, struct
         } \
         j ++; \
     } \
-        min = (a *) stats[map[adios_statistic_min]].data; \
-        max = (a *) stats[map[adios_statistic_max]].data; \
-        sum = (double *) stats[map[adios_statistic_sum]].data; \
-        sum_square = (double *) stats[map[adios_statistic_sum_square]].data; \
-        cnt = (uint32_t *) stats[map[adios_statistic_cnt]].data; \
-        *cnt = 0;\
         if (map[adios_statistic_hist] != -1) {\
             hist = (struct adios_hist_struct *) stats[map[adios_statistic_hist]].data; \
             hist->frequencies = calloc ((hist->num_breaks + 1), adios_get_type_size(adios_unsigned_integer, "")); \
         } \
-        int have_finite_value = 0; \
-        n = 0; \
-        while ((n * b) < total_size) \
-        { \
-            if (NON_FINITE_CHECK()) {\
-                n ++; \
-                continue; \
-            }\
-            if (!have_finite_value) { \
-                *min = data [n]; \
-                *max = data [n]; \
-                *sum = data [n]; \
-                *sum_square = (data [n] * data [n]) ; \
-                *cnt = *cnt + 1; \
-                if (map[adios_statistic_hist] != -1) \
-                HIST(data [n]); \
-                have_finite_value = 1; \
-                n ++; \
-                continue; \
-            } \
-            if (data [n] < *min) \
-            *min = data [n]; \
-            if (data [n] > *max) \
-            *max = data [n]; \
-            *sum += data [n]; \
-            *sum_square += (data [n] * data [n]) ; \
-            *cnt = *cnt + 1; \
-            if (map[adios_statistic_hist] != -1) \
-            HIST(data [n]); \
-            n++; \
-        } \
-        if (map[adios_statistic_finite] != -1) \
-        * ((uint8_t * ) stats[map[adios_statistic_finite]].data) = have_finite_value; \
-        return 0; \
+        total_n = total_size / sizeof (a); \
+        return adios_stat_start (var, original_var_type, 1, map, hist, data, total_n, background); \
     }
 
-#define ADIOS_STATISTICS_MINMAX(a,b,NAN_CHECK) \
+#define ADIOS_STATISTICS_MINMAX(a) \
 {\
     a * data = (a *) var->data; \
     struct adios_stat_struct * stats = var->stats[0]; \
@@ -5419,40 +6776,15 @@ int adios_generate_var_characteristics_v1 (struct adios_file_struct * fd, struct
     stats[0].data = malloc(adios_get_stat_size(NULL, original_var_type, adios_statistic_min)); \
     stats[1].data = malloc(adios_get_stat_size(NULL, original_var_type, adios_statistic_max)); \
     stats[2].data = malloc(adios_get_stat_size(NULL, original_var_type, adios_statistic_finite)); \
-    a *min = (a *) stats[map[adios_statistic_min]].data; \
-    a *max = (a *) stats[map[adios_statistic_max]].data; \
-    int have_finite_value = 0; \
-    total_n = total_size / b; \
-    n = 0; \
-    while (n < total_n && NAN_CHECK()) \
-    { \
-        n++; \
-    } \
-    if (n < total_n) { \
-        *min = *data; \
-        *max = *data; \
-        have_finite_value = 1; \
-        data++; \
-        n++; \
-    }\
-    while (n < total_n) \
-    { \
-        if (*data < *min) \
-            *min = *data; \
-        if (*data > *max) \
-            *max = *data; \
-        n++; \
-        data++; \
-    } \
-    * ((uint8_t * ) stats[map[adios_statistic_finite]].data) = have_finite_value; \
-    return 0; \
+    total_n = total_size / sizeof (a); \
+    return adios_stat_start (var, original_var_type, 0, map, NULL, data, total_n, background); \
 }
 
-#define ADIOS_STATISTICS(a,b,NON_FINITE_CHECK,NAN_CHECK) \
+#define ADIOS_STATISTICS(a) \
     if (stat_flag == adios_stat_minmax) \
-        ADIOS_STATISTICS_MINMAX(a,b,NAN_CHECK) \
+        ADIOS_STATISTICS_MINMAX(a) \
     else \
-        ADIOS_STATISTICS_FULL(a,b,NON_FINITE_CHECK)
+        ADIOS_STATISTICS_FULL(a)
 
 
 #define MIN_MAX(a,b)\
@@ -5464,44 +6796,44 @@ int adios_generate_var_characteristics_v1 (struct adios_file_struct * fd, struct
         a * max = (a *) var->max; \
         *min = data [0]; \
         *max = data [0]; \
-        return 0; \
+        return NULL; \
     }
 
 
     switch (original_var_type)
     {
         case adios_byte:
-            ADIOS_STATISTICS(int8_t,1,CHECK_INT,CHECK_INT_NAN)
+            ADIOS_STATISTICS(int8_t)
 
         case adios_unsigned_byte:
-            ADIOS_STATISTICS(uint8_t,1,CHECK_INT,CHECK_INT_NAN)
+            ADIOS_STATISTICS(uint8_t)
 
         case adios_short:
-            ADIOS_STATISTICS(int16_t,2,CHECK_INT,CHECK_INT_NAN)
+            ADIOS_STATISTICS(int16_t)
 
         case adios_unsigned_short:
-            ADIOS_STATISTICS(uint16_t,2,CHECK_INT,CHECK_INT_NAN)
+            ADIOS_STATISTICS(uint16_t)
 
         case adios_integer:
-            ADIOS_STATISTICS(int32_t,4,CHECK_INT,CHECK_INT_NAN)
+            ADIOS_STATISTICS(int32_t)
 
         case adios_unsigned_integer:
-            ADIOS_STATISTICS(uint32_t,4,CHECK_INT,CHECK_INT_NAN)
+            ADIOS_STATISTICS(uint32_t)
 
         case adios_long:
-            ADIOS_STATISTICS(int64_t,8,CHECK_INT,CHECK_INT_NAN)
+            ADIOS_STATISTICS(int64_t)
 
         case adios_unsigned_long:
-            ADIOS_STATISTICS(uint64_t,8,CHECK_INT,CHECK_INT_NAN)
+            ADIOS_STATISTICS(uint64_t)
 
         case adios_real:
-            ADIOS_STATISTICS(float,4,CHECK_FLOAT,CHECK_FLOAT_NAN)
+            ADIOS_STATISTICS(float)
 
         case adios_double:
-            ADIOS_STATISTICS(double,8,CHECK_FLOAT,CHECK_FLOAT_NAN)
+            ADIOS_STATISTICS(double)
 
         case adios_long_double:
-            ADIOS_STATISTICS(long double,16,CHECK_FLOAT,CHECK_FLOAT_NAN)
+            ADIOS_STATISTICS(long double)
 
         case adios_complex:
         {
@@ -5634,7 +6966,7 @@ int adios_generate_var_characteristics_v1 (struct adios_file_struct * fd, struct
                 for (c = 0; c < count; c ++)
                     * ((uint8_t * ) stats[c][map[adios_statistic_finite]].data) = finite;
 
-            return 0;
+            return NULL;
         }
 
         case adios_double_complex:
@@ -5770,24 +7102,36 @@ int adios_generate_var_characteristics_v1 (struct adios_file_struct * fd, struct
                 for (c = 0; c < count; c ++)
                     * ((uint8_t * ) stats[c][map[adios_statistic_finite]].data) = finite;
 
-            return 0;
+            return NULL;
         }
         case adios_string:
         {
             var->stats = 0;
 
-            return 0;
+            return NULL;
         }
 
         default:
         {
             var->stats = 0;
 
-            return 0;
+            return NULL;
         }
     }
 }
 
+int adios_generate_var_characteristics_v1 (struct adios_file_struct * fd, struct adios_var_struct * var)
+{
+    adios_generate_var_characteristics (fd, var, 0);
+    return 0;
+}
+
+struct adios_stat_job * adios_generate_var_characteristics_start_v1 (struct adios_file_struct * fd,
+                                                                     struct adios_var_struct * var)
+{
+    return adios_generate_var_characteristics (fd, var, 1);
+}
+
 // data is only there for sizing
 uint64_t adios_write_var_header_v1 (struct adios_file_struct * fd
         ,struct adios_var_struct * v
@@ -301,6 +301,16 @@ struct adios_pg_struct
     struct adios_pg_struct  * next;
 };
 
+// A variable payload that was not copied into the buffer (zero-copy buffering).
+// The buffer has an untouched hole of 'size' bytes at 'offset' instead of the data.
+struct adios_zero_copy_struct
+{
+    uint64_t offset;     // offset of the hole in the buffer
+    uint64_t size;
+    const void * data;   // user's data, must be valid until adios_close()
+    struct adios_zero_copy_struct * next;
+};
+
 struct adios_file_struct
 {
     char * name;
@@ -328,6 +338,12 @@ struct adios_file_struct
     uint64_t attrs_start;    // offset for where to put the attr count
     uint32_t nattrs_written;  // count of attrs to write
 
+    uint64_t zero_copy_min_size; // > 0: payloads of this size or larger are not copied into the buffer 
+                                 // (set by a method in open(), which must write the holes from zero_copy)
+    struct adios_zero_copy_struct * zero_copy;      // list of holes in the buffer, in increasing offset
+    struct adios_zero_copy_struct * zero_copy_last; // last element of the list
+    uint64_t zero_copy_size;     // total size of the holes
+
     MPI_Comm comm;          // duplicate of comm received in adios_open()
 };
 void adios_file_struct_init (struct adios_file_struct * fd);
@@ -652,6 +668,7 @@ int adios_write_version_flag_v1 (char ** buffer
                            ,uint64_t * buffer_offset
                            ,uint32_t flag
                            );
+void adios_write_step_marker_v1 (const char * base_path, const char * name);
 int adios_write_open_process_group_header_v1 (struct adios_file_struct * fd);
 int adios_write_close_process_group_header_v1 (struct adios_file_struct * fd);
 
@@ -665,6 +682,17 @@ uint64_t adios_write_var_header_v1 (struct adios_file_struct * fd
 int adios_generate_var_characteristics_v1 (struct adios_file_struct * fd
                                           ,struct adios_var_struct * var
                                           );
+// Same as adios_generate_var_characteristics_v1 but the statistics of a large
+// array may be still calculated by a thread team in the background when it returns.
+// The returned job (NULL if the statistics are complete) must be passed to 
+// adios_generate_var_characteristics_wait_v1() before using the statistics.
+struct adios_stat_job;
+struct adios_stat_job * adios_generate_var_characteristics_start_v1 (struct adios_file_struct * fd
+                                                                    ,struct adios_var_struct * var
+                                                                    );
+void adios_generate_var_characteristics_wait_v1 (struct adios_stat_job * job);
+// Maximum number of threads used for calculating the statistics of one array
+void adios_set_stats_threads_v1 (int nthreads);
 uint16_t adios_write_var_characteristics_v1 (struct adios_file_struct * fd
                                             ,struct adios_var_struct * var
                                             );
@@ -701,6 +729,42 @@ void adios_merge_index_v1 (
                   ,int needs_sorting // merge-sort the characteristics to keep the time in order
                   );
 
+// merge the index buffers of many processes (in order) in parallel,
+// attributes are only parsed from buffers[attrs_buffer] (use -1 for none)
+void adios_merge_index_buffers_v1 (
+                   struct adios_index_struct_v1 * main_index
+                  ,int nbuffers
+                  ,char ** buffers
+                  ,uint64_t * buffer_sizes
+                  ,int attrs_buffer
+                  ,int needs_sorting // merge-sort the characteristics to keep the time in order
+                  );
+
+// gather the index buffers of all processes of comm to rank 0 through a
+// k-ary tree, where each process merges the index of its subtree.
+// On rank 0, returns the number of buffers: its own index_buffer first, then
+// the (merged) buffers received from the children. The caller must free the
+// received buffers and the arrays. Returns 0 on other ranks.
+int adios_gather_indices_tree_v1 (MPI_Comm comm
+                                 ,int fanout
+                                 ,char * index_buffer
+                                 ,uint64_t index_size
+                                 ,int needs_sorting
+                                 ,char *** buffers
+                                 ,uint64_t ** buffer_sizes
+                                 );
+
+// gather a buffer of any size from every process of comm to rank 0.
+// On rank 0, returns the buffers concatenated in rank order (the caller
+// must free it) and fills sizes and offsets (one entry per process).
+// sizes and offsets are not used on other ranks, which return NULL.
+char * adios_gather_buffers (MPI_Comm comm
+                            ,char * buffer
+                            ,uint64_t size
+                            ,uint64_t * sizes
+                            ,uint64_t * offsets
+                            );
+
 /* obsolete, merge the index with sorting
 void adios_sort_index_v1 (struct adios_index_process_group_struct_v1 ** p1
                          ,struct adios_index_var_struct_v1 ** v1
@@ -263,6 +263,17 @@ int adios_read_get_dimension_order (ADIOS_FILE * fp)
     return common_read_get_dimension_order (fp);
 }
 
+int adios_inq_var_ids_by_prefix (const ADIOS_FILE *fp, const char *prefix, int **varids)
+{
+    return common_read_find_vars_by_prefix (fp, prefix, varids);
+}
 
+int adios_inq_var_ids_by_pattern (const ADIOS_FILE *fp, const char *pattern, int **varids)
+{
+    return common_read_find_vars_by_pattern (fp, pattern, varids);
+}
 
-
+int adios_inq_var_path (const ADIOS_FILE *fp, const char *path, char ***names)
+{
+    return common_read_list_var_path (fp, path, names);
+}
@@ -14,6 +14,7 @@
 #include "core/common_read.h"
 #include "core/adios_subvolume.h"
 #include "core/adios_internals.h"
+#include "core/adios_logger.h"
 
 void vector_add(int ndim, uint64_t *dst_vec, const uint64_t *vec1, const uint64_t *vec2) {
     while (ndim--)
@@ -160,12 +161,9 @@ void copy_subvolume_ragged_offset_with_spec(void *dst, const void *src,
 
 
 /*
- * copy_subvolume delegates to the copy_subvolume_helper function, with the
- * following parameter translations:
- * 1) Element size (i.e. 8 bytes for double, etc.) is considered an additional,
- *    fastest-varying dimension
- * 2) All "contiguous" fastest-varying dimensions are collapsed into a single
- *    fastest-varying dimension
+ * copy_subvolume delegates to copy_strided_rows, with each element as a row
+ * and the byte strides of the source and destination buffers. All dimensions
+ * that are contiguous in both buffers are collapsed into longer rows there.
  */
 void copy_subvolume(void *dst, const void *src, int ndim, const uint64_t *subv_dims,
                     const uint64_t *dst_dims, const uint64_t *dst_subv_offsets,
@@ -202,70 +200,289 @@ void copy_subvolume_ragged(void *dst, const void *src, int ndim, const uint64_t
 }
 
 /*
- * Copies a given subvolume from 'src' to 'dst'. It recursively copies a
- * hyperplane of progressively lower dimensions, until it reaches the lowest
- * dimension, in which case it simply performs a memcpy.
+ * Row copy kernels of copy_strided_rows. The kernel is chosen once per copy
+ * from the row size and the byte-swapping unit, so the copy loop does not
+ * branch per row. Short rows of a fixed size are copied with a fixed-size
+ * memmove, which the compiler turns into a few moves. memmove is used since
+ * compact_subvolume_ragged_offset copies within one buffer.
  *
- * At any given call level to this function, 'src' and 'dst' point to the first
- * element of a hyperplane of the subvolume with dimension 'ndim'.
- *
- * @param dst the destination buffer
- * @param src the source buffer
- * @param ndim the number of dimensions
- * @param next_subv_dim the list of dimensions for the subvolume, starting with
- *        the slowest-changing
- * @param next_dst_stride the list of destination buffer strides for each
- *        dimension
- * @param next_src_stride the list of source buffer strides for each dimension
- * @param type the datatype of the elements in dst/src (NOTE: this is ONLY for
- *        the purpose of endianness swapping; strides/dimensions are in bytes)
- * @param swap_endianness if true, swap the endianness of each element
+ * Byte swapping is fused into the copy: every unit of 2, 4, 8 or 16 bytes is
+ * reversed while it is moved to the destination, instead of a second pass
+ * over the destination row. On x86 the SSSE3 byte shuffle reverses 16 bytes
+ * of units at once if the CPU supports it (checked at runtime).
  */
-static void copy_subvolume_helper(char *dst, const char *src,
-                                  int ndim, const uint64_t *next_subv_dim,
-                                  const uint64_t *next_dst_stride, const uint64_t *next_src_stride,
-                                  enum ADIOS_DATATYPES buftype, int swap_endianness) {
-    if (ndim == 1) {
-        memcpy(dst, src, *next_subv_dim);
-        if (swap_endianness) {
-            change_endianness(dst, *next_subv_dim, buftype);
-        }
-    } else {
-        int i;
-        for (i = 0; i < *next_subv_dim; i++) {
-            copy_subvolume_helper(dst, src, ndim - 1,
-                                  next_subv_dim + 1, next_dst_stride + 1, next_src_stride + 1,
-                                  buftype, swap_endianness);
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) \
+    && !defined(__INTEL_COMPILER) && !defined(__PGI) && !defined(__NVCOMPILER) \
+    && ((defined(__clang__) && __clang_major__ >= 4) || (!defined(__clang__) && __GNUC__ >= 5))
+#  define ADIOS_SUBV_X86_SIMD 1
+#  include <immintrin.h>
+#endif
+
+typedef void (*copy_row_fn)(char *dst, const char *src, uint64_t size);
+
+#define DEFINE_COPY_ROW_FIXED(n) \
+static void copy_row_##n(char *dst, const char *src, uint64_t size) { \
+    memmove(dst, src, n); \
+}
+DEFINE_COPY_ROW_FIXED(1)
+DEFINE_COPY_ROW_FIXED(2)
+DEFINE_COPY_ROW_FIXED(4)
+DEFINE_COPY_ROW_FIXED(8)
+DEFINE_COPY_ROW_FIXED(12)
+DEFINE_COPY_ROW_FIXED(16)
+DEFINE_COPY_ROW_FIXED(24)
+DEFINE_COPY_ROW_FIXED(32)
+DEFINE_COPY_ROW_FIXED(64)
+#undef DEFINE_COPY_ROW_FIXED
+
+static void copy_row_any(char *dst, const char *src, uint64_t size) {
+    memmove(dst, src, size);
+}
 
-            src += *next_src_stride;
-            dst += *next_dst_stride;
-        }
+static inline uint16_t bswap_16(uint16_t v) {
+    return (uint16_t)((v >> 8) | (v << 8));
+}
+
+static inline uint32_t bswap_32(uint32_t v) {
+    return ((v >> 24) & 0x000000ffu) | ((v >> 8) & 0x0000ff00u) |
+           ((v << 8) & 0x00ff0000u) | ((v << 24) & 0xff000000u);
+}
+
+static inline uint64_t bswap_64(uint64_t v) {
+    return ((uint64_t)bswap_32((uint32_t)v) << 32) | bswap_32((uint32_t)(v >> 32));
+}
+
+/*
+ * Scalar swapping copies of the units from 'start' to the end of the row.
+ * Bytes after the last whole unit are copied unchanged.
+ */
+static void copy_row_swap_2_from(char *dst, const char *src, uint64_t start, uint64_t size) {
+    uint64_t i;
+    uint16_t v;
+    for (i = start; i + 2 <= size; i += 2) {
+        memcpy(&v, src + i, 2);
+        v = bswap_16(v);
+        memcpy(dst + i, &v, 2);
+    }
+    if (i < size)
+        memcpy(dst + i, src + i, size - i);
+}
+
+static void copy_row_swap_4_from(char *dst, const char *src, uint64_t start, uint64_t size) {
+    uint64_t i;
+    uint32_t v;
+    for (i = start; i + 4 <= size; i += 4) {
+        memcpy(&v, src + i, 4);
+        v = bswap_32(v);
+        memcpy(dst + i, &v, 4);
+    }
+    if (i < size)
+        memcpy(dst + i, src + i, size - i);
+}
+
+static void copy_row_swap_8_from(char *dst, const char *src, uint64_t start, uint64_t size) {
+    uint64_t i;
+    uint64_t v;
+    for (i = start; i + 8 <= size; i += 8) {
+        memcpy(&v, src + i, 8);
+        v = bswap_64(v);
+        memcpy(dst + i, &v, 8);
+    }
+    if (i < size)
+        memcpy(dst + i, src + i, size - i);
+}
+
+static void copy_row_swap_16_from(char *dst, const char *src, uint64_t start, uint64_t size) {
+    uint64_t i;
+    uint64_t lo, hi;
+    for (i = start; i + 16 <= size; i += 16) {
+        memcpy(&lo, src + i, 8);
+        memcpy(&hi, src + i + 8, 8);
+        lo = bswap_64(lo);
+        hi = bswap_64(hi);
+        memcpy(dst + i, &hi, 8);
+        memcpy(dst + i + 8, &lo, 8);
+    }
+    if (i < size)
+        memcpy(dst + i, src + i, size - i);
+}
+
+static void copy_row_swap_2(char *dst, const char *src, uint64_t size) {
+    copy_row_swap_2_from(dst, src, 0, size);
+}
+static void copy_row_swap_4(char *dst, const char *src, uint64_t size) {
+    copy_row_swap_4_from(dst, src, 0, size);
+}
+static void copy_row_swap_8(char *dst, const char *src, uint64_t size) {
+    copy_row_swap_8_from(dst, src, 0, size);
+}
+static void copy_row_swap_16(char *dst, const char *src, uint64_t size) {
+    copy_row_swap_16_from(dst, src, 0, size);
+}
+
+#ifdef ADIOS_SUBV_X86_SIMD
+/* Shuffle 16 bytes at a time with 'mask', then finish the row in scalar code */
+#define DEFINE_COPY_ROW_SWAP_SSSE3(unit, m) \
+__attribute__((target("ssse3"))) \
+static void copy_row_swap_##unit##_ssse3(char *dst, const char *src, uint64_t size) { \
+    const __m128i mask = _mm_setr_epi8 m; \
+    uint64_t i; \
+    for (i = 0; i + 16 <= size; i += 16) { \
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i)); \
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(v, mask)); \
+    } \
+    copy_row_swap_##unit##_from(dst, src, i, size); \
+}
+DEFINE_COPY_ROW_SWAP_SSSE3(2,  (1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14))
+DEFINE_COPY_ROW_SWAP_SSSE3(4,  (3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12))
+DEFINE_COPY_ROW_SWAP_SSSE3(8,  (7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8))
+DEFINE_COPY_ROW_SWAP_SSSE3(16, (15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0))
+#undef DEFINE_COPY_ROW_SWAP_SSSE3
+
+static int subv_simd_level = -1;
+
+static int subv_get_simd_level(void) {
+    if (subv_simd_level < 0) {
+        __builtin_cpu_init();
+        subv_simd_level = __builtin_cpu_supports("ssse3") ? 1 : 0;
+        log_debug("subvolume copy: using %s byte swapping\n",
+                  subv_simd_level == 1 ? "SSSE3" : "generic");
     }
+    return subv_simd_level;
 }
+#endif
 
 /*
- * Same as copy_subvolume_helper, but uses memmove instead of memcpy for
- * safe(r) copies on overlapping buffers.
+ * Returns the size of the units whose bytes are reversed when the endianness
+ * of 'type' is swapped (as in change_endianness), or 1 if nothing is swapped.
  */
-static void copy_subvolume_helper_safe(char *dst, const char *src,
-                                       int ndim, const uint64_t *next_subv_dim,
-                                       const uint64_t *next_dst_stride, const uint64_t *next_src_stride,
-                                        enum ADIOS_DATATYPES buftype, int swap_endianness) {
-    if (ndim == 1) {
-        memmove(dst, src, *next_subv_dim);
-        if (swap_endianness) {
-            change_endianness(dst, *next_subv_dim, buftype);
+static int swap_unit_size(enum ADIOS_DATATYPES type) {
+    switch (type) {
+    case adios_byte:
+    case adios_unsigned_byte:
+    case adios_string:
+    case adios_string_array:
+        return 1;
+    case adios_complex:
+        return 4; // two floats
+    case adios_double_complex:
+        return 8; // two doubles
+    default: {
+        const int size = adios_get_type_size(type, NULL);
+        return size > 1 ? size : 1;
+    }
+    }
+}
+
+static copy_row_fn select_copy_row(uint64_t row_size, enum ADIOS_DATATYPES type, int swap_endianness) {
+    if (swap_endianness) {
+        const int unit = swap_unit_size(type);
+#ifdef ADIOS_SUBV_X86_SIMD
+        if (row_size >= 16 && subv_get_simd_level() >= 1) {
+            switch (unit) {
+            case 2:  return copy_row_swap_2_ssse3;
+            case 4:  return copy_row_swap_4_ssse3;
+            case 8:  return copy_row_swap_8_ssse3;
+            case 16: return copy_row_swap_16_ssse3;
+            }
         }
-    } else {
-        int i;
-        for (i = 0; i < *next_subv_dim; i++) {
-            copy_subvolume_helper(dst, src, ndim - 1,
-                                  next_subv_dim + 1, next_dst_stride + 1, next_src_stride + 1,
-                                  buftype, swap_endianness);
+#endif
+        switch (unit) {
+        case 2:  return copy_row_swap_2;
+        case 4:  return copy_row_swap_4;
+        case 8:  return copy_row_swap_8;
+        case 16: return copy_row_swap_16;
+        }
+    }
+
+    switch (row_size) {
+    case 1:  return copy_row_1;
+    case 2:  return copy_row_2;
+    case 4:  return copy_row_4;
+    case 8:  return copy_row_8;
+    case 12: return copy_row_12;
+    case 16: return copy_row_16;
+    case 24: return copy_row_24;
+    case 32: return copy_row_32;
+    case 64: return copy_row_64;
+    default: return copy_row_any;
+    }
+}
+
+void copy_strided_rows(void *dst, const void *src, int ndim, const uint64_t *counts,
+                       const uint64_t *dst_strides, const uint64_t *src_strides,
+                       uint64_t row_size,
+                       enum ADIOS_DATATYPES datum_type, enum ADIOS_FLAG swap_endianness) {
+    uint64_t cnt[ADIOS_SUBV_MAX_DIMS], dstr[ADIOS_SUBV_MAX_DIMS], sstr[ADIOS_SUBV_MAX_DIMS];
+    uint64_t idx[ADIOS_SUBV_MAX_DIMS];
+    char *d = (char *)dst;
+    const char *s = (const char *)src;
+    copy_row_fn copy_row;
+    uint64_t j;
+    int i, n = 0;
+
+    assert(ndim <= ADIOS_SUBV_MAX_DIMS);
+    if (row_size == 0)
+        return;
+
+    // Drop dimensions of length 1, and merge each dimension into the
+    // previous one where it just continues it in both buffers
+    for (i = 0; i < ndim; i++) {
+        if (counts[i] == 0)
+            return;
+        if (counts[i] == 1)
+            continue;
+        if (n > 0 &&
+            dstr[n-1] == counts[i] * dst_strides[i] &&
+            sstr[n-1] == counts[i] * src_strides[i]) {
+            cnt[n-1] *= counts[i];
+            dstr[n-1] = dst_strides[i];
+            sstr[n-1] = src_strides[i];
+        } else {
+            cnt[n] = counts[i];
+            dstr[n] = dst_strides[i];
+            sstr[n] = src_strides[i];
+            n++;
+        }
+    }
+
+    // If the rows of the innermost dimension are adjacent in both buffers,
+    // they are copied as one longer row
+    if (n > 0 && dstr[n-1] == row_size && sstr[n-1] == row_size) {
+        row_size *= cnt[n-1];
+        n--;
+    }
 
-            src += *next_src_stride;
-            dst += *next_dst_stride;
+    copy_row = select_copy_row(row_size, datum_type, swap_endianness == adios_flag_yes);
+
+    if (n == 0) {
+        copy_row(d, s, row_size);
+        return;
+    }
+
+    memset(idx, 0, n * sizeof(uint64_t));
+    for (;;) {
+        const uint64_t inner_dstr = dstr[n-1], inner_sstr = sstr[n-1];
+        const char *ss = s;
+        char *dd = d;
+        for (j = 0; j < cnt[n-1]; j++) {
+            copy_row(dd, ss, row_size);
+            dd += inner_dstr;
+            ss += inner_sstr;
+        }
+
+        // Advance the outer dimensions like an odometer
+        for (i = n - 2; i >= 0; i--) {
+            d += dstr[i];
+            s += sstr[i];
+            if (++idx[i] < cnt[i])
+                break;
+            d -= cnt[i] * dstr[i];
+            s -= cnt[i] * sstr[i];
+            idx[i] = 0;
         }
+        if (i < 0)
+            break;
     }
 }
 
@@ -277,37 +494,11 @@ void copy_subvolume_ragged_offset(void *dst, const void *src, int ndim, const ui
                                   enum ADIOS_DATATYPES datum_type, enum ADIOS_FLAG swap_endianness) {
 
     int i;
-    int last_noncovering_dim = 0; // Index of dimension that starts a contiguous block
-    int buffers_intersect = 0; // Whether the source and destination memory copy regions may intersect
-    uint64_t src_strides[32];
-    uint64_t dst_strides[32];
-    const int type_size = adios_get_type_size(datum_type, NULL);
-
-    // Find the last dimension for which the subvolume, source and destination
-    // spaces do not exactly match (i.e. non-zero offset or unequal lengths).
-    for (i = 0; i < ndim; i++) {
-        // If the subvolume, source and destination do not exactly match along
-        // this dimension, it is marked as incomplete
-        if (src_subv_offsets[i] != 0 ||
-            dst_subv_offsets[i] != 0 ||
-            subv_dims[i] != src_dims[i] ||
-            subv_dims[i] != dst_dims[i]) {
-
-            last_noncovering_dim = i;
-        }
-    }
+    uint64_t src_strides[ADIOS_SUBV_MAX_DIMS];
+    uint64_t dst_strides[ADIOS_SUBV_MAX_DIMS];
+    const int type_size = adios_get_type_size(datum_type, NULL); // Assumes non-string type
 
-    // Calculate the volume (number of bytes) of the region subtended by the
-    // contiguous dimensions (which start with the last non-covering dimension)
-    uint64_t contig_dims_volume = 1;
-    for (i = last_noncovering_dim; i < ndim; i++) {
-        contig_dims_volume *= subv_dims[i];
-    }
-    // Add the element size as a new "dimension", to convert from element-space
-    // to byte-space
-    contig_dims_volume *= type_size; // Assumes non-string type
-
-    // Compute strides for the dimensions
+    // Compute strides (in bytes) for the dimensions
     uint64_t src_volume = type_size;
     uint64_t dst_volume = type_size;
     for (i = ndim - 1; i >= 0; i--) {
@@ -318,9 +509,7 @@ void copy_subvolume_ragged_offset(void *dst, const void *src, int ndim, const ui
         dst_volume *= dst_dims[i];
     }
 
-    // Compute the starting offsets for src and dst. In theory we could skip
-    // the contiguous dimensions other than the first one, but just to be
-    // safe/simple we calculate them all.
+    // Compute the starting offsets for src and dst
     uint64_t src_offset = 0, dst_offset = 0;
     for (i = 0; i < ndim; i++) {
         src_offset += src_subv_offsets[i] * src_strides[i];
@@ -330,76 +519,11 @@ void copy_subvolume_ragged_offset(void *dst, const void *src, int ndim, const ui
     src_offset -= src_ragged_offset * type_size;
     dst_offset -= dst_ragged_offset * type_size;
 
-    // Save the old value of the first contiguous dimension, then replace it
-    // with a "collapsed" dimension consolidating all contiguous dimensions
-    // into one
-    // We "cheat" a bit by removing the const modifier. This is OK because we
-    // carefully put back the original value before returning. This is the only
-    // argument modification we do in this function besides filling 'dst'.
-    uint64_t first_contig_dim_value_old = subv_dims[last_noncovering_dim];
-    ((uint64_t*)subv_dims)[last_noncovering_dim] = contig_dims_volume;
-
-    // Compute whether the memory regions for the copy overlap
-    // If so, we need to use a safer copy method
-    if (0) { // FOR NOW, DON'T DO THIS, AS WE NEVER USE OVERLAPPING BUFFERS
-        uint64_t dst_end_offset = dst_offset;
-        uint64_t src_end_offset = src_offset;
-        // Match the stride counts as executed by the helper function: all but
-        // the last dimension contribute (length - 1) strides, with the last
-        // dimension contributing instead its length
-        for (i = 0; i < last_noncovering_dim; i++) {
-            src_end_offset += (subv_dims[i] - 1) * src_strides[i];
-            dst_end_offset += (subv_dims[i] - 1) * dst_strides[i];
-        }
-        src_end_offset += subv_dims[last_noncovering_dim];
-        dst_end_offset += subv_dims[last_noncovering_dim];
-
-        buffers_intersect =
-                intersect_segments((uint64_t)dst + dst_offset,
-                                   dst_end_offset - dst_offset,
-                                   (uint64_t)src + src_offset,
-                                   src_end_offset - src_offset,
-                                   NULL, NULL);
-
-        buffers_intersect = 0; // Look Ma, no asserts!
-
-        // Enfoce the safety condition for overlapping buffers here
-        if (buffers_intersect) {
-            assert((char*)src + src_offset >= (char*)dst + dst_offset);
-            for (i = 0; i < last_noncovering_dim + 1; i++)
-                assert(src_strides[i] >= dst_strides[i]);
-        }
-    }
-
-    //printf(">>> copy_subvolume is using %d contiguous dimensions...\n", ndim - first_contig_dim);
-
-    // Finally, delegate to the recursive worker function
-    if (buffers_intersect) {
-        copy_subvolume_helper_safe(
-                (char*)dst + dst_offset,            /* Offset dst buffer to the first element */
-                (char*)src + src_offset,            /* Offset src buffer to the first element */
-                last_noncovering_dim + 1,           /* Number of dimensions, modified for collapsed contiguous dimensions */
-                subv_dims,                          /* Subvolume dimensions (modified to collapse all contiguous dimensions) */
-                dst_strides,                        /* dst buffer dimension strides */
-                src_strides,                        /* src buffer dimension strides */
-                datum_type,                         /* The datatype of the buffer elements */
-                swap_endianness == adios_flag_yes   /* Whether to swap endianness */
-        );
-    } else {
-        copy_subvolume_helper(
-                (char*)dst + dst_offset,            /* Offset dst buffer to the first element */
-                (char*)src + src_offset,            /* Offset src buffer to the first element */
-                last_noncovering_dim + 1,           /* Number of dimensions, modified for collapsed contiguous dimensions */
-                subv_dims,                          /* Subvolume dimensions (modified to collapse all contiguous dimensions) */
-                dst_strides,                        /* dst buffer dimension strides */
-                src_strides,                        /* src buffer dimension strides */
-                datum_type,                         /* The datatype of the buffer elements */
-                swap_endianness == adios_flag_yes   /* Whether to swap endianness */
-        );
-    }
-
-    // Restore the old first contiguous dimension value
-    ((uint64_t*)subv_dims)[last_noncovering_dim] = first_contig_dim_value_old;
+    // The element is the row; copy_strided_rows collapses all dimensions
+    // that are contiguous in both buffers into longer rows
+    copy_strided_rows((char*)dst + dst_offset, (const char*)src + src_offset,
+                      ndim, subv_dims, dst_strides, src_strides, type_size,
+                      datum_type, swap_endianness);
 }
 
 uint64_t compute_linear_offset_in_volume(int ndim, const uint64_t *point, const uint64_t *dims) {
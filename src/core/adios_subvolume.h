@@ -13,7 +13,8 @@
  *    size of the corresponding stride in the destination volume
  *
  * If these conditions hold, no source memory will ever be overwritten
- * before it is copied. This can be proven inductively:
+ * before it is copied (each row is moved with memmove semantics). This can
+ * be proven inductively:
  * 1) The first memmove will copy a block of data to an equal or lower
  *    address than its source address, since the source pointer is
  *    not before the destination pointer
@@ -29,8 +30,8 @@
  * the start offsets, which incorporate the ragged offset, and strides,
  * which are not affected by the ragged offset.
  *
- * If a subvolume copy is attempted where both of these safety conditions do
- * not hold, an assertion will fail.
+ * The result of a subvolume copy where these safety conditions do not hold
+ * is undefined.
  *
  *  Created on: Jul 25, 2012
  *      Author: David A. Boyuka II
@@ -157,6 +158,32 @@ void copy_subvolume(void *dst, const void *src, int ndim, const uint64_t *subv_d
                     enum ADIOS_DATATYPES datum_type,
                     enum ADIOS_FLAG swap_endianness);
 
+#define ADIOS_SUBV_MAX_DIMS 32
+
+/*
+ * Copies 'ndim' nested loops of rows from 'src' to 'dst'. Along dimension i
+ * (the first dimension is the slowest-changing), counts[i] rows or blocks
+ * follow each other dst_strides[i]/src_strides[i] bytes apart; each row is
+ * 'row_size' bytes. This is the copy engine under copy_subvolume and
+ * adios_util_copy_data.
+ *
+ * Dimensions of length 1 are dropped, and dimensions that are contiguous in
+ * both buffers are collapsed into longer rows, before the rows are copied in
+ * one non-recursive loop. If swap_endianness is adios_flag_yes, the bytes of
+ * each element of type 'datum_type' are reversed during the copy (as
+ * change_endianness would do afterwards).
+ *
+ * @param ndim the number of dimensions, at most ADIOS_SUBV_MAX_DIMS
+ * @param counts the number of rows/blocks along each dimension
+ * @param dst_strides the byte distance in 'dst' along each dimension
+ * @param src_strides the byte distance in 'src' along each dimension
+ * @param row_size the size of one row in bytes
+ */
+void copy_strided_rows(void *dst, const void *src, int ndim, const uint64_t *counts,
+                       const uint64_t *dst_strides, const uint64_t *src_strides,
+                       uint64_t row_size,
+                       enum ADIOS_DATATYPES datum_type, enum ADIOS_FLAG swap_endianness);
+
 /*
  * The same as copy_subvolume, with the addition of optional ragged src/dst
  * arrays. These arrays are ragged iff the pointer supplied does not point to
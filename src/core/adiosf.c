@@ -87,6 +87,12 @@ void FC_FUNC_(adios_set_max_buffer_size, ADIOS_SET_MAX_BUFFER_SIZE) (int *max_bu
         adios_databuffer_set_max_size ((uint64_t)*max_buffer_size_MB * 1024L * 1024L);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void FC_FUNC_(adios_set_stats_threads, ADIOS_SET_STATS_THREADS) (int *nthreads)
+{
+    adios_set_stats_threads_v1 (*nthreads);
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 void FC_FUNC_(adios_open, ADIOS_OPEN) 
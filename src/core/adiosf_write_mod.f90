@@ -177,6 +177,11 @@ module adios_write_mod
             integer,        intent(in)  :: sizeMB
         end subroutine
 
+        subroutine adios_set_stats_threads (nthreads)
+            implicit none
+            integer,        intent(in)  :: nthreads
+        end subroutine
+
         subroutine adios_define_schema_version (group_id, schema_version)
             implicit none
             integer*8,      intent(in)  :: group_id
@@ -0,0 +1,756 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* Sidecar index cache of BP files.
+ *
+ * Layout of <fname>.idx (native byte order, all offsets from the beginning of the cache):
+ *   header
+ *   variable directory: vars_count * struct bp_index_cache_var
+ *   string table: group, variable names and paths, '\0' terminated
+ *   per variable: characteristics_count * struct bp_index_cache_characteristic
+ *                 followed by the heap of those characteristics
+ *
+ * The heap of one characteristic holds, in this order: the dimensions, the value,
+ * the statistics in the order of the bitmap for each statistics set, the
+ * pre-transform dimensions and the transform metadata.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "core/bp_index_cache.h"
+#include "core/bp_utils.h"
+#include "core/adios_bp_v1.h"
+#include "core/adios_logger.h"
+#include "core/transforms/adios_transforms_common.h"
+
+#define BP_INDEX_CACHE_MAGIC "BPIDXCHE"
+#define BP_INDEX_CACHE_VERSION 1
+#define BP_INDEX_CACHE_BYTE_ORDER 0x01020304
+#define BP_INDEX_CACHE_SUFFIX ".idx"
+
+struct bp_index_cache_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t bp_file_size;
+    int64_t  bp_mtime;
+    uint64_t pgs_index_offset;
+    uint64_t vars_index_offset;
+    uint64_t attrs_index_offset;
+    uint64_t vars_count;
+    uint64_t vars_length;
+    uint64_t vars_offset;
+    uint64_t strings_offset;
+    uint64_t total_size;
+};
+
+struct bp_index_cache_var
+{
+    uint64_t characteristics_offset;
+    uint64_t characteristics_count;
+    uint64_t group_name; // offsets in the string table
+    uint64_t var_name;
+    uint64_t var_path;
+    uint32_t id;
+    uint32_t type;
+};
+
+struct bp_index_cache_characteristic
+{
+    uint64_t offset;
+    uint64_t payload_offset;
+    uint64_t heap;
+    uint32_t var_id;
+    uint32_t file_index;
+    uint32_t time_index;
+    uint32_t bitmap;
+    uint32_t value_size; // 0 if there is no value
+    uint32_t pre_transform_type;
+    uint16_t transform_metadata_len;
+    uint8_t  dims_count;
+    uint8_t  pre_transform_dims_count;
+    uint8_t  transform_type;
+    uint8_t  has_stats;
+    uint8_t  padding[2];
+};
+
+/* growing memory buffer the cache is built in before it is written out */
+struct bp_index_cache_buffer
+{
+    char * buff;
+    uint64_t length;
+    uint64_t allocated;
+};
+
+static char * bp_index_cache_name (const char * fname)
+{
+    char * name = (char *) malloc (strlen (fname) + strlen (BP_INDEX_CACHE_SUFFIX) + 1);
+    if (name)
+    {
+        sprintf (name, "%s%s", fname, BP_INDEX_CACHE_SUFFIX);
+    }
+    return name;
+}
+
+static int bp_index_cache_header_matches (BP_FILE * fh, const struct bp_index_cache_header * h,
+                                          const struct stat * st)
+{
+    return !memcmp (h->magic, BP_INDEX_CACHE_MAGIC, sizeof (h->magic))
+        && h->version == BP_INDEX_CACHE_VERSION
+        && h->byte_order == BP_INDEX_CACHE_BYTE_ORDER
+        && h->bp_file_size == (uint64_t) st->st_size
+        && h->bp_file_size == fh->mfooter.file_size
+        && h->bp_mtime == (int64_t) st->st_mtime
+        && h->pgs_index_offset == fh->mfooter.pgs_index_offset
+        && h->vars_index_offset == fh->mfooter.vars_index_offset
+        && h->attrs_index_offset == fh->mfooter.attrs_index_offset;
+}
+
+/* Return 1 if len bytes at offset are inside the cache */
+static int bp_index_cache_span_ok (const struct bp_index_cache_header * h,
+                                   uint64_t offset, uint64_t len)
+{
+    return offset <= h->total_size && len <= h->total_size - offset;
+}
+
+/* Return 1 if offset is a '\0' terminated string inside the string table */
+static int bp_index_cache_string_ok (const struct bp_index_cache_header * h,
+                                     const char * base, uint64_t offset)
+{
+    uint64_t avail = h->total_size - h->strings_offset;
+    return offset < avail
+        && memchr (base + h->strings_offset + offset, 0, avail - offset) != NULL;
+}
+
+/* Advance *pos over the statistics of a characteristic, as
+ * bp_index_cache_restore_stats() decodes them. Return 0 if they do not fit.
+ */
+static int bp_index_cache_skip_stats (const struct bp_index_cache_header * h, const char * base,
+                                      uint32_t bitmap, enum ADIOS_DATATYPES original_var_type,
+                                      uint64_t * pos)
+{
+    uint8_t count = adios_get_stat_set_count (original_var_type);
+    uint8_t c, i;
+
+    for (c = 0; c < count; c++)
+    {
+        for (i = 0; bitmap >> i; i++)
+        {
+            uint64_t size;
+
+            if (!((bitmap >> i) & 1))
+                continue;
+
+            if (i == adios_statistic_hist)
+            {
+                uint32_t num_breaks;
+
+                if (!bp_index_cache_span_ok (h, *pos, 4))
+                    return 0;
+                memcpy (&num_breaks, base + *pos, 4);
+                size = 4 + 8 + 8 + ((uint64_t) num_breaks + 1) * 4 + (uint64_t) num_breaks * 8;
+            }
+            else
+            {
+                size = adios_get_stat_size (0, original_var_type, (enum ADIOS_STAT) i);
+            }
+
+            if (!bp_index_cache_span_ok (h, *pos, size))
+                return 0;
+            *pos += size;
+        }
+    }
+    return 1;
+}
+
+/* Check that everything bp_index_cache_load_var() is going to read for
+ * the variable d points inside the cache. Return 0 if it does not.
+ */
+static int bp_index_cache_var_ok (const struct bp_index_cache_header * h, const char * base,
+                                  const struct bp_index_cache_var * d)
+{
+    const struct bp_index_cache_characteristic * rec;
+    enum ADIOS_DATATYPES original_var_type;
+    uint64_t j;
+
+    if (!bp_index_cache_string_ok (h, base, d->group_name)
+        || !bp_index_cache_string_ok (h, base, d->var_name)
+        || !bp_index_cache_string_ok (h, base, d->var_path))
+        return 0;
+
+    if (!d->characteristics_count)
+        return 1;
+
+    if (d->characteristics_count > h->total_size / sizeof (*rec)
+        || !bp_index_cache_span_ok (h, d->characteristics_offset,
+                                    d->characteristics_count * sizeof (*rec)))
+        return 0;
+
+    rec = (const struct bp_index_cache_characteristic *) (base + d->characteristics_offset);
+    original_var_type = rec[0].transform_type != adios_transform_none
+                      ? (enum ADIOS_DATATYPES) rec[0].pre_transform_type
+                      : (enum ADIOS_DATATYPES) d->type;
+
+    for (j = 0; j < d->characteristics_count; j++)
+    {
+        uint64_t pos = rec[j].heap;
+        uint64_t size = 3 * 8 * (uint64_t) rec[j].dims_count + rec[j].value_size;
+
+        if (!bp_index_cache_span_ok (h, pos, size))
+            return 0;
+        pos += size;
+
+        if (rec[j].has_stats
+            && !bp_index_cache_skip_stats (h, base, rec[j].bitmap, original_var_type, &pos))
+            return 0;
+
+        size = 3 * 8 * (uint64_t) rec[j].pre_transform_dims_count + rec[j].transform_metadata_len;
+        if (!bp_index_cache_span_ok (h, pos, size))
+            return 0;
+    }
+    return 1;
+}
+
+int bp_index_cache_check (BP_FILE * fh)
+{
+    struct bp_index_cache_header h;
+    struct stat st, cst;
+    char * name;
+    int fd, valid = 0;
+
+    if (stat (fh->fname, &st))
+        return 0;
+
+    name = bp_index_cache_name (fh->fname);
+    if (!name)
+        return 0;
+
+    fd = open (name, O_RDONLY);
+    if (fd >= 0)
+    {
+        if (read (fd, &h, sizeof (h)) == sizeof (h) && !fstat (fd, &cst))
+        {
+            valid = bp_index_cache_header_matches (fh, &h, &st)
+                 && h.total_size == (uint64_t) cst.st_size;
+        }
+        close (fd);
+        log_debug ("Index cache %s is %s\n", name, valid ? "valid" : "out of date");
+    }
+
+    free (name);
+    return valid;
+}
+
+int bp_index_cache_open (BP_FILE * fh)
+{
+    struct bp_index_cache_header * h;
+    struct bp_index_cache_var * dir;
+    struct adios_index_var_struct_v1 ** root;
+    struct stat cst;
+    char * name, * base, * strings;
+    uint64_t i;
+    int fd, valid;
+
+    name = bp_index_cache_name (fh->fname);
+    if (!name)
+        return 1;
+
+    fd = open (name, O_RDONLY);
+    if (fd < 0 || fstat (fd, &cst) || (uint64_t) cst.st_size < sizeof (*h))
+    {
+        log_debug ("Cannot open index cache %s, errno %d\n", name, errno);
+        if (fd >= 0)
+            close (fd);
+        free (name);
+        return 1;
+    }
+
+    base = mmap (0, cst.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (base == MAP_FAILED)
+    {
+        log_debug ("Cannot map index cache %s, errno %d\n", name, errno);
+        free (name);
+        return 1;
+    }
+
+    h = (struct bp_index_cache_header *) base;
+    valid = h->total_size == (uint64_t) cst.st_size
+         && h->strings_offset <= h->total_size
+         && h->vars_count <= h->total_size / sizeof (struct bp_index_cache_var)
+         && h->vars_offset <= h->strings_offset
+         && h->vars_count * sizeof (struct bp_index_cache_var) <= h->strings_offset - h->vars_offset;
+
+    /* a truncated or damaged cache must not be read out of its mapping later */
+    dir = (struct bp_index_cache_var *) (base + h->vars_offset);
+    for (i = 0; valid && i < h->vars_count; i++)
+    {
+        valid = bp_index_cache_var_ok (h, base, &dir[i]);
+    }
+
+    if (!valid)
+    {
+        log_warn ("Index cache %s is corrupt, ignoring it\n", name);
+        munmap (base, cst.st_size);
+        free (name);
+        return 1;
+    }
+    free (name);
+
+    fh->index_cache = base;
+    fh->index_cache_size = cst.st_size;
+    fh->mfooter.vars_count = h->vars_count;
+    fh->mfooter.vars_length = h->vars_length;
+
+    strings = base + h->strings_offset;
+
+    fh->vars_table = (struct adios_index_var_struct_v1 **)
+                        malloc (sizeof (struct adios_index_var_struct_v1 *) * h->vars_count);
+    root = &fh->vars_root;
+    for (i = 0; i < h->vars_count; i++)
+    {
+        struct adios_index_var_struct_v1 * v = (struct adios_index_var_struct_v1 *)
+                        malloc (sizeof (struct adios_index_var_struct_v1));
+        v->id = dir[i].id;
+        v->type = (enum ADIOS_DATATYPES) dir[i].type;
+        v->group_name = strdup (strings + dir[i].group_name);
+        v->var_name = strdup (strings + dir[i].var_name);
+        v->var_path = strdup (strings + dir[i].var_path);
+        v->characteristics_count = dir[i].characteristics_count;
+        v->characteristics_allocated = dir[i].characteristics_count;
+        v->characteristics = 0; // decoded in bp_index_cache_load_var()
+        v->next = 0;
+
+        *root = v;
+        root = &v->next;
+        fh->vars_table[i] = v;
+    }
+
+    /* only the heaps of the variables that are used are going to be touched */
+    if (h->strings_offset < h->total_size)
+    {
+        madvise (base, h->total_size, MADV_RANDOM);
+    }
+
+    bp_build_vars_namelist (fh);
+
+    log_debug ("Loaded the index of %" PRIu64 " variables from the index cache\n", h->vars_count);
+    return 0;
+}
+
+static void bp_index_cache_restore_stats (struct adios_index_characteristic_struct_v1 * ch,
+                                          enum ADIOS_DATATYPES original_var_type, char ** heap)
+{
+    uint8_t count = adios_get_stat_set_count (original_var_type);
+    uint8_t c, i, idx;
+
+    ch->stats = malloc (count * sizeof (struct adios_index_characteristics_stat_struct *));
+    for (c = 0; c < count; c++)
+    {
+        ch->stats[c] = calloc (ADIOS_STAT_LENGTH, sizeof (struct adios_index_characteristics_stat_struct));
+
+        i = idx = 0;
+        while (ch->bitmap >> i)
+        {
+            if ((ch->bitmap >> i) & 1)
+            {
+                if (i == adios_statistic_hist)
+                {
+                    struct adios_index_characteristics_hist_struct * hist =
+                        malloc (sizeof (struct adios_index_characteristics_hist_struct));
+
+                    memcpy (&hist->num_breaks, *heap, 4);
+                    *heap += 4;
+                    memcpy (&hist->min, *heap, 8);
+                    *heap += 8;
+                    memcpy (&hist->max, *heap, 8);
+                    *heap += 8;
+                    hist->frequencies = malloc ((hist->num_breaks + 1) * 4);
+                    memcpy (hist->frequencies, *heap, (hist->num_breaks + 1) * 4);
+                    *heap += (hist->num_breaks + 1) * 4;
+                    hist->breaks = malloc (hist->num_breaks * 8);
+                    memcpy (hist->breaks, *heap, hist->num_breaks * 8);
+                    *heap += hist->num_breaks * 8;
+
+                    ch->stats[c][idx].data = hist;
+                }
+                else
+                {
+                    uint64_t size = adios_get_stat_size (0, original_var_type, (enum ADIOS_STAT) i);
+                    ch->stats[c][idx].data = malloc (size);
+                    memcpy (ch->stats[c][idx].data, *heap, size);
+                    *heap += size;
+                }
+                idx++;
+            }
+            i++;
+        }
+    }
+}
+
+void bp_index_cache_load_var (BP_FILE * fh, int varid)
+{
+    struct bp_index_cache_header * h = (struct bp_index_cache_header *) fh->index_cache;
+    struct bp_index_cache_var * d = (struct bp_index_cache_var *) (fh->index_cache + h->vars_offset) + varid;
+    struct adios_index_var_struct_v1 * v = fh->vars_table[varid];
+    struct bp_index_cache_characteristic * rec;
+    enum ADIOS_DATATYPES original_var_type;
+    uint64_t j;
+    char * heap;
+
+    rec = (struct bp_index_cache_characteristic *) (fh->index_cache + d->characteristics_offset);
+    v->characteristics = calloc (d->characteristics_count ? d->characteristics_count : 1,
+                                 sizeof (struct adios_index_characteristic_struct_v1));
+    if (!d->characteristics_count)
+        return;
+
+    /* the original type of a transformed variable comes from its first characteristic */
+    v->characteristics[0].transform.transform_type = rec[0].transform_type;
+    v->characteristics[0].transform.pre_transform_type = (enum ADIOS_DATATYPES) rec[0].pre_transform_type;
+    original_var_type = adios_transform_get_var_original_type_index (v);
+
+    for (j = 0; j < d->characteristics_count; j++)
+    {
+        struct adios_index_characteristic_struct_v1 * ch = &v->characteristics[j];
+        uint64_t size;
+
+        ch->offset = rec[j].offset;
+        ch->payload_offset = rec[j].payload_offset;
+        ch->var_id = rec[j].var_id;
+        ch->file_index = rec[j].file_index;
+        ch->time_index = rec[j].time_index;
+        ch->bitmap = rec[j].bitmap;
+        ch->transform.transform_type = rec[j].transform_type;
+        ch->transform.pre_transform_type = (enum ADIOS_DATATYPES) rec[j].pre_transform_type;
+
+        heap = fh->index_cache + rec[j].heap;
+
+        ch->dims.count = rec[j].dims_count;
+        if (rec[j].dims_count)
+        {
+            size = 3 * 8 * (uint64_t) rec[j].dims_count;
+            ch->dims.dims = (uint64_t *) malloc (size);
+            memcpy (ch->dims.dims, heap, size);
+            heap += size;
+        }
+
+        if (rec[j].value_size)
+        {
+            ch->value = malloc (rec[j].value_size);
+            memcpy (ch->value, heap, rec[j].value_size);
+            heap += rec[j].value_size;
+        }
+
+        if (rec[j].has_stats)
+        {
+            bp_index_cache_restore_stats (ch, original_var_type, &heap);
+        }
+
+        ch->transform.pre_transform_dimensions.count = rec[j].pre_transform_dims_count;
+        if (rec[j].pre_transform_dims_count)
+        {
+            size = 3 * 8 * (uint64_t) rec[j].pre_transform_dims_count;
+            ch->transform.pre_transform_dimensions.dims = (uint64_t *) malloc (size);
+            memcpy (ch->transform.pre_transform_dimensions.dims, heap, size);
+            heap += size;
+        }
+
+        ch->transform.transform_metadata_len = rec[j].transform_metadata_len;
+        if (rec[j].transform_metadata_len)
+        {
+            ch->transform.transform_metadata = malloc (rec[j].transform_metadata_len);
+            memcpy (ch->transform.transform_metadata, heap, rec[j].transform_metadata_len);
+        }
+    }
+}
+
+void bp_index_cache_close (BP_FILE * fh)
+{
+    if (fh->index_cache)
+    {
+        munmap (fh->index_cache, fh->index_cache_size);
+        fh->index_cache = 0;
+        fh->index_cache_size = 0;
+    }
+}
+
+/* Append len bytes (or zeros if data is NULL) and return their offset */
+static uint64_t bp_index_cache_append (struct bp_index_cache_buffer * cb, const void * data, uint64_t len)
+{
+    uint64_t offset = cb->length;
+
+    if (cb->length + len > cb->allocated)
+    {
+        uint64_t newsize = cb->allocated ? cb->allocated : 65536;
+        while (cb->length + len > newsize)
+            newsize *= 2;
+
+        char * b = realloc (cb->buff, newsize);
+        if (!b)
+        {
+            log_debug ("Cannot allocate %" PRIu64 " bytes for the index cache\n", newsize);
+            return (uint64_t) -1;
+        }
+        cb->buff = b;
+        cb->allocated = newsize;
+    }
+
+    if (data)
+        memcpy (cb->buff + cb->length, data, len);
+    else
+        memset (cb->buff + cb->length, 0, len);
+    cb->length += len;
+    return offset;
+}
+
+static int bp_index_cache_append_stats (struct bp_index_cache_buffer * cb,
+                                        struct adios_index_characteristic_struct_v1 * ch,
+                                        enum ADIOS_DATATYPES original_var_type)
+{
+    uint8_t count = adios_get_stat_set_count (original_var_type);
+    uint8_t c, i, idx;
+    int err = 0;
+
+    for (c = 0; c < count; c++)
+    {
+        i = idx = 0;
+        while (ch->bitmap >> i)
+        {
+            if ((ch->bitmap >> i) & 1)
+            {
+                if (i == adios_statistic_hist)
+                {
+                    struct adios_index_characteristics_hist_struct * hist =
+                        (struct adios_index_characteristics_hist_struct *) ch->stats[c][idx].data;
+
+                    err |= bp_index_cache_append (cb, &hist->num_breaks, 4) == (uint64_t) -1;
+                    err |= bp_index_cache_append (cb, &hist->min, 8) == (uint64_t) -1;
+                    err |= bp_index_cache_append (cb, &hist->max, 8) == (uint64_t) -1;
+                    err |= bp_index_cache_append (cb, hist->frequencies, (hist->num_breaks + 1) * 4) == (uint64_t) -1;
+                    err |= bp_index_cache_append (cb, hist->breaks, hist->num_breaks * 8) == (uint64_t) -1;
+                }
+                else
+                {
+                    uint64_t size = adios_get_stat_size (0, original_var_type, (enum ADIOS_STAT) i);
+                    err |= bp_index_cache_append (cb, ch->stats[c][idx].data, size) == (uint64_t) -1;
+                }
+                idx++;
+            }
+            i++;
+        }
+    }
+    return err;
+}
+
+static int bp_index_cache_append_var (struct bp_index_cache_buffer * cb,
+                                      struct adios_index_var_struct_v1 * v,
+                                      struct bp_index_cache_var * d)
+{
+    enum ADIOS_DATATYPES original_var_type;
+    uint64_t j, recs;
+    int err = 0;
+
+    d->characteristics_count = v->characteristics_count;
+    recs = bp_index_cache_append (cb, 0, v->characteristics_count
+                                         * sizeof (struct bp_index_cache_characteristic));
+    if (recs == (uint64_t) -1)
+        return 1;
+    d->characteristics_offset = recs;
+
+    if (!v->characteristics_count)
+        return 0;
+
+    original_var_type = adios_transform_get_var_original_type_index (v);
+
+    for (j = 0; j < v->characteristics_count && !err; j++)
+    {
+        struct adios_index_characteristic_struct_v1 * ch = &v->characteristics[j];
+        struct bp_index_cache_characteristic r;
+
+        memset (&r, 0, sizeof (r));
+        r.offset = ch->offset;
+        r.payload_offset = ch->payload_offset;
+        r.var_id = ch->var_id;
+        r.file_index = ch->file_index;
+        r.time_index = ch->time_index;
+        r.bitmap = ch->bitmap;
+        r.transform_type = ch->transform.transform_type;
+        r.pre_transform_type = ch->transform.pre_transform_type;
+        r.heap = cb->length;
+
+        if (ch->dims.dims)
+        {
+            r.dims_count = ch->dims.count;
+            err |= bp_index_cache_append (cb, ch->dims.dims, 3 * 8 * (uint64_t) ch->dims.count) == (uint64_t) -1;
+        }
+
+        if (ch->value)
+        {
+            r.value_size = bp_get_type_size (original_var_type, ch->value);
+            err |= bp_index_cache_append (cb, ch->value, r.value_size) == (uint64_t) -1;
+        }
+
+        if (ch->stats)
+        {
+            r.has_stats = 1;
+            err |= bp_index_cache_append_stats (cb, ch, original_var_type);
+        }
+
+        if (ch->transform.pre_transform_dimensions.dims)
+        {
+            r.pre_transform_dims_count = ch->transform.pre_transform_dimensions.count;
+            err |= bp_index_cache_append (cb, ch->transform.pre_transform_dimensions.dims,
+                                          3 * 8 * (uint64_t) r.pre_transform_dims_count) == (uint64_t) -1;
+        }
+
+        if (ch->transform.transform_metadata_len && ch->transform.transform_metadata)
+        {
+            r.transform_metadata_len = ch->transform.transform_metadata_len;
+            err |= bp_index_cache_append (cb, ch->transform.transform_metadata,
+                                          r.transform_metadata_len) == (uint64_t) -1;
+        }
+
+        /* the buffer may have been moved by the appends above */
+        memcpy (cb->buff + recs + j * sizeof (r), &r, sizeof (r));
+    }
+
+    return err;
+}
+
+int bp_index_cache_write (BP_FILE * fh)
+{
+    struct bp_index_cache_buffer cb = {0, 0, 0};
+    struct bp_index_cache_header h;
+    struct bp_index_cache_var * dir;
+    struct adios_index_var_struct_v1 * v;
+    struct stat st;
+    uint64_t i, vars_offset, strings_offset, written;
+    char * name, * tmpname;
+    int fd, err = 0;
+
+    if (stat (fh->fname, &st) || (uint64_t) st.st_size != fh->mfooter.file_size)
+        return 1;
+
+    memset (&h, 0, sizeof (h));
+    memcpy (h.magic, BP_INDEX_CACHE_MAGIC, sizeof (h.magic));
+    h.version = BP_INDEX_CACHE_VERSION;
+    h.byte_order = BP_INDEX_CACHE_BYTE_ORDER;
+    h.bp_file_size = st.st_size;
+    h.bp_mtime = st.st_mtime;
+    h.pgs_index_offset = fh->mfooter.pgs_index_offset;
+    h.vars_index_offset = fh->mfooter.vars_index_offset;
+    h.attrs_index_offset = fh->mfooter.attrs_index_offset;
+    h.vars_count = fh->mfooter.vars_count;
+    h.vars_length = fh->mfooter.vars_length;
+
+    bp_index_cache_append (&cb, &h, sizeof (h));
+    vars_offset = bp_index_cache_append (&cb, 0, h.vars_count * sizeof (struct bp_index_cache_var));
+    if (vars_offset == (uint64_t) -1)
+    {
+        free (cb.buff);
+        return 1;
+    }
+
+    /* string table */
+    strings_offset = cb.length;
+    for (i = 0, v = fh->vars_root; v && i < h.vars_count && !err; i++, v = v->next)
+    {
+        dir = (struct bp_index_cache_var *) (cb.buff + vars_offset) + i;
+        dir->id = v->id;
+        dir->type = v->type;
+        dir->group_name = cb.length - strings_offset;
+        err |= bp_index_cache_append (&cb, v->group_name, strlen (v->group_name) + 1) == (uint64_t) -1;
+        dir = (struct bp_index_cache_var *) (cb.buff + vars_offset) + i;
+        dir->var_name = cb.length - strings_offset;
+        err |= bp_index_cache_append (&cb, v->var_name, strlen (v->var_name) + 1) == (uint64_t) -1;
+        dir = (struct bp_index_cache_var *) (cb.buff + vars_offset) + i;
+        dir->var_path = cb.length - strings_offset;
+        err |= bp_index_cache_append (&cb, v->var_path, strlen (v->var_path) + 1) == (uint64_t) -1;
+    }
+    /* keep the characteristic records aligned */
+    if (!err && cb.length % 8)
+    {
+        err |= bp_index_cache_append (&cb, 0, 8 - cb.length % 8) == (uint64_t) -1;
+    }
+
+    for (i = 0, v = fh->vars_root; v && i < h.vars_count && !err; i++, v = v->next)
+    {
+        struct bp_index_cache_var d;
+        bp_find_var_byid (fh, i); // decode a lazily parsed variable
+        memcpy (&d, (struct bp_index_cache_var *) (cb.buff + vars_offset) + i, sizeof (d));
+        err |= bp_index_cache_append_var (&cb, v, &d);
+        memcpy ((struct bp_index_cache_var *) (cb.buff + vars_offset) + i, &d, sizeof (d));
+        if (!err && cb.length % 8)
+        {
+            err |= bp_index_cache_append (&cb, 0, 8 - cb.length % 8) == (uint64_t) -1;
+        }
+    }
+
+    if (err || i != h.vars_count)
+    {
+        free (cb.buff);
+        return 1;
+    }
+
+    ((struct bp_index_cache_header *) cb.buff)->vars_offset = vars_offset;
+    ((struct bp_index_cache_header *) cb.buff)->strings_offset = strings_offset;
+    ((struct bp_index_cache_header *) cb.buff)->total_size = cb.length;
+
+    /* write into a temporary file and rename it so that readers never see a partial cache */
+    name = bp_index_cache_name (fh->fname);
+    tmpname = (char *) malloc (strlen (name) + 32);
+    sprintf (tmpname, "%s.tmp.%d", name, (int) getpid ());
+
+    fd = open (tmpname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        log_debug ("Cannot create index cache %s, errno %d\n", tmpname, errno);
+        err = 1;
+    }
+    else
+    {
+        written = 0;
+        while (written < cb.length)
+        {
+            ssize_t n = write (fd, cb.buff + written, cb.length - written);
+            if (n <= 0)
+            {
+                if (n < 0 && errno == EINTR)
+                    continue;
+                err = 1;
+                break;
+            }
+            written += n;
+        }
+        close (fd);
+
+        if (err || rename (tmpname, name))
+        {
+            log_debug ("Cannot write index cache %s, errno %d\n", name, errno);
+            unlink (tmpname);
+            err = 1;
+        }
+        else
+        {
+            log_debug ("Wrote index cache %s, %" PRIu64 " bytes\n", name, cb.length);
+        }
+    }
+
+    free (tmpname);
+    free (name);
+    free (cb.buff);
+    return err;
+}
@@ -0,0 +1,36 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+#ifndef __BP_INDEX_CACHE_H__
+#define __BP_INDEX_CACHE_H__
+
+#include "core/bp_types.h"
+
+/* Sidecar cache of the parsed variable index of a BP file, stored in
+ * <fname>.idx next to the file. It is only valid for a BP file of the same
+ * size and modification time as recorded in the cache. A valid cache is
+ * mapped into memory and a variable's characteristics are decoded from it
+ * when the variable is first accessed.
+ */
+
+/* Return 1 if the cache of fh->fname exists and matches the BP file */
+int bp_index_cache_check (BP_FILE * fh);
+
+/* Map the cache and build the variable list of fh without decoding any
+ * characteristics. Return 0 on success.
+ */
+int bp_index_cache_open (BP_FILE * fh);
+
+/* Decode the characteristics of variable varid from the mapped cache */
+void bp_index_cache_load_var (BP_FILE * fh, int varid);
+
+/* Save the fully parsed variable index of fh into the cache. Return 0 on success. */
+int bp_index_cache_write (BP_FILE * fh);
+
+void bp_index_cache_close (BP_FILE * fh);
+
+#endif
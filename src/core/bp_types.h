@@ -47,6 +47,8 @@ struct BP_file_handle
 {
     uint32_t file_index;
     MPI_File fh;
+    char * mmap_base; // mapping of the subfile, only valid if the BP_FILE is mapped
+    uint64_t mmap_size;
     struct BP_file_handle * next;
     struct BP_file_handle * prev;
 };
@@ -61,6 +63,16 @@ struct BP_file_handle_header
 
 typedef struct BP_file_handle_header BP_file_handle_list;
 
+/* A file region read ahead with one call by adios_perform_reads(), which
+ * covers the slices of several read requests (data sieving) */
+struct BP_sieve_extent
+{
+    uint32_t file_index; // subfile index, 0 if the file has no subfiles
+    uint64_t offset;
+    uint64_t length;
+    char * buff;
+};
+
 typedef struct BP_FILE {
     MPI_File mpi_fh;
     char * fname; // Main file name is needed to calculate subfile names
@@ -76,6 +88,17 @@ typedef struct BP_FILE {
     struct BP_GROUP_ATTR * gattr_h;
     uint32_t tidx_start;
     uint32_t tidx_stop;
+    int mmap_enabled; // allow bp_open() to map the file if the reader is a single process
+    char * mmap_base; // private mapping of the whole file, or 0 if read through MPI-IO
+    uint64_t mmap_size;
+    int index_cache_enabled; // use/create the <fname>.idx sidecar index cache
+    char * index_cache; // mapping of a valid index cache, variables are decoded from it on demand
+    uint64_t index_cache_size;
+    int lazy_index_enabled; // decode the characteristics of a variable on first access
+    uint64_t * vars_index_offsets; // start of each variable's characteristics in index_b, if parsed lazily
+    struct adios_bp_buffer_struct_v1 * index_b; // footer kept after open for lazy parsing
+    struct BP_sieve_extent * sieve; // coalesced reads of the current adios_perform_reads(), sorted
+    int sieve_count;
     void * priv;
 } BP_FILE;
 
@@ -86,6 +109,9 @@ typedef struct BP_PROC {
     int * varid_mapping;
     read_request * local_read_request_list;
     void * b; //internal buffer for chunk reading
+    void * ring; // chunk buffers of reads without user memory, see chunk_ring_start() in read_bp.c
+    void * engine; // background reader of a non-blocking adios_perform_reads()
+    void * prefetch; // read-ahead of the next step, see prefetch_start() in read_bp.c
     void * priv;
 } BP_PROC;
 
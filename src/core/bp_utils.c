@@ -5,23 +5,35 @@
  * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
  */
 
+#include "config.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <stdarg.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
 #include <string.h>
 #include <math.h>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#include <poll.h>
+#endif
 #include "public/adios.h"
 #include "public/adios_read.h"
 #include "public/adios_error.h"
 #include "public/adios_version.h"
 #include "core/bp_utils.h"
+#include "core/bp_index_cache.h"
 #include "core/adios_internals.h"
 #include "core/adios_bp_v1.h"
 #include "core/adios_endianness.h"
 #include "core/adios_logger.h"
 #include "core/futils.h"
+#include "core/adios_clock.h"
 #include <limits.h> // ULLONG_MAX
 
 /* dimension value indicating a joined dimension for local arrays.
@@ -31,6 +43,8 @@ const uint64_t JoinedDimValue = (ULLONG_MAX-1);
 
 #define BYTE_ALIGN 8
 #define MINIFOOTER_SIZE 28
+/* slices of a mapped file smaller than this are not worth a madvise() call */
+#define MMAP_ADVISE_MIN_SIZE (64*1024)
 
 #include "core/transforms/adios_transforms_common.h" // NCSU ALACRITY-ADIOS
 
@@ -69,6 +83,7 @@ inline BP_FILE * GET_BP_FILE (const ADIOS_FILE * fp)
 /* prototypes */
 void * bp_read_data_from_buffer(struct adios_bp_buffer_struct_v1 *b, enum ADIOS_DATATYPES type, int nelems);
 int bp_parse_characteristics (struct adios_bp_buffer_struct_v1 * b, struct adios_index_var_struct_v1 ** root, uint64_t j);
+static void bp_free_group_tables (BP_FILE * fh);
 
 
 
@@ -111,6 +126,174 @@ void bp_realloc_aligned (struct adios_bp_buffer_struct_v1 * b
     b->length = size;
 }
 
+/* Map a whole BP file (or subfile) into memory for a single-process reader.
+ * The mapping is private and writable so that in-place operations on the
+ * buffer (e.g. byte swapping) never reach the file.
+ * Returns 0 if the file cannot be mapped, the caller then uses MPI-IO.
+ */
+char * bp_mmap_file (const char * fname, uint64_t * size)
+{
+    struct stat st;
+    char * base;
+    int fd;
+
+    *size = 0;
+    fd = open (fname, O_RDONLY);
+    if (fd < 0)
+    {
+        log_debug ("Cannot open %s for mapping, errno %d\n", fname, errno);
+        return 0;
+    }
+
+    if (fstat (fd, &st) || st.st_size == 0 || (uint64_t) st.st_size != (size_t) st.st_size)
+    {
+        close (fd);
+        return 0;
+    }
+
+    base = mmap (0, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (base == MAP_FAILED)
+    {
+        log_debug ("Cannot map %s (%" PRIu64 " bytes), errno %d\n",
+                   fname, (uint64_t) st.st_size, errno);
+        return 0;
+    }
+
+    *size = st.st_size;
+    log_debug ("Mapped %s, %" PRIu64 " bytes\n", fname, *size);
+    return base;
+}
+
+void bp_munmap_file (char * base, uint64_t size)
+{
+    if (base)
+        munmap (base, size);
+}
+
+/* Tell the kernel that [offset, offset+length) of a mapping will be needed soon */
+static void bp_madvise_willneed (char * base, uint64_t offset, uint64_t length)
+{
+    uint64_t pagesize = sysconf (_SC_PAGESIZE);
+    uint64_t start = offset & ~(pagesize - 1);
+
+    if (length < MMAP_ADVISE_MIN_SIZE)
+        return;
+
+    madvise (base + start, offset + length - start, MADV_WILLNEED);
+}
+
+/* Point b at a slice of a mapped file instead of reading the slice into
+ * b's own buffer. b->allocated_buff_ptr is left alone, so the next
+ * bp_realloc_aligned() switches back to the allocated buffer.
+ * Returns 1 on success, 0 if there is no mapping or the slice is outside of it.
+ */
+int bp_map_slice (struct adios_bp_buffer_struct_v1 * b, char * base, uint64_t size,
+                  uint64_t offset, uint64_t length)
+{
+    if (!base || offset > size || length > size - offset)
+        return 0;
+
+    bp_madvise_willneed (base, offset, length);
+    b->buff = base + offset;
+    b->length = length;
+    b->offset = 0;
+    return 1;
+}
+
+/* Same as bp_map_slice() but copies the slice into a user buffer */
+int bp_copy_mapped_slice (void * buf, char * base, uint64_t size,
+                          uint64_t offset, uint64_t length)
+{
+    if (!base || offset > size || length > size - offset)
+        return 0;
+
+    bp_madvise_willneed (base, offset, length);
+    memcpy (buf, base + offset, length);
+    return 1;
+}
+
+/* Find the coalesced read of fh that contains a whole slice */
+static struct BP_sieve_extent * bp_find_sieved_slice (BP_FILE * fh, uint32_t file_index,
+                                                      uint64_t offset, uint64_t length)
+{
+    struct BP_sieve_extent * e;
+    int lo = 0, hi = fh->sieve_count - 1, mid;
+
+    /* last extent that starts at or before the slice */
+    e = 0;
+    while (lo <= hi)
+    {
+        mid = (lo + hi) / 2;
+        if (fh->sieve[mid].file_index < file_index ||
+            (fh->sieve[mid].file_index == file_index && fh->sieve[mid].offset <= offset))
+        {
+            e = &fh->sieve[mid];
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+
+    if (!e || e->file_index != file_index || offset - e->offset > e->length ||
+        length > e->length - (offset - e->offset))
+        return 0;
+
+    return e;
+}
+
+/* Like bp_map_slice() for a slice that was read ahead by a coalesced read.
+ * The slice must not be modified in place, it may be shared by several requests.
+ */
+int bp_map_sieved_slice (BP_FILE * fh, uint32_t file_index,
+                         uint64_t offset, uint64_t length)
+{
+    struct BP_sieve_extent * e = bp_find_sieved_slice (fh, file_index, offset, length);
+
+    if (!e)
+        return 0;
+
+    fh->b->buff = e->buff + (offset - e->offset);
+    fh->b->length = length;
+    fh->b->offset = 0;
+    return 1;
+}
+
+/* Same as bp_map_sieved_slice() but copies the slice into a user buffer */
+int bp_copy_sieved_slice (BP_FILE * fh, void * buf, uint32_t file_index,
+                          uint64_t offset, uint64_t length)
+{
+    struct BP_sieve_extent * e = bp_find_sieved_slice (fh, file_index, offset, length);
+
+    if (!e)
+        return 0;
+
+    memcpy (buf, e->buff + (offset - e->offset), length);
+    return 1;
+}
+
+void bp_free_sieve (BP_FILE * fh)
+{
+    int i;
+
+    /* fh->b may still point into a sieve buffer */
+    if (fh->sieve_count && fh->b)
+    {
+        fh->b->buff = fh->b->allocated_buff_ptr;
+        fh->b->length = 0;
+    }
+
+    for (i = 0; i < fh->sieve_count; i++)
+    {
+        free (fh->sieve[i].buff);
+    }
+    free (fh->sieve);
+    fh->sieve = 0;
+    fh->sieve_count = 0;
+}
+
 /* Return 0: if file is little endian, 1 if file is big endian
  * We know if it is different from the current system, so here
  * we determine the current endianness and report accordingly.
@@ -298,15 +481,58 @@ static int bp_read_open_rootonly (const char * filename,
     return err;
 }
 
+/* Broadcast the footer read by rank 0 into fh->b of all other processes */
+static void bp_bcast_footer (BP_FILE * fh)
+{
+    int rank;
+    uint64_t footer_size = fh->mfooter.file_size-fh->mfooter.pgs_index_offset;
+
+    MPI_Comm_rank (fh->comm, &rank);
+
+    if (rank != 0)
+    {
+        if (!fh->b->buff || fh->b->length < footer_size)
+        {
+            bp_realloc_aligned (fh->b, footer_size);
+            assert (fh->b->buff);
+
+            memset (fh->b->buff, 0, footer_size);
+        }
+        fh->b->offset = 0;
+    }
+
+    MPI_Barrier (fh->comm);
+    // Broadcast the index which may be bigger than 2GB, so do it in chunks
+    uint64_t bytes_sent = 0;
+    int32_t to_send = 0;
+
+    while (bytes_sent < footer_size)
+    {
+        if (footer_size - bytes_sent > MAX_MPIWRITE_SIZE)
+        {
+            to_send = MAX_MPIWRITE_SIZE;
+        }
+        else
+        {
+            to_send = footer_size - bytes_sent;
+        }
+
+        MPI_Bcast (fh->b->buff + bytes_sent, to_send, MPI_BYTE, 0, fh->comm);
+        bytes_sent += to_send;
+    }
+}
+
 /* This routine does the parallel bp file open and index parsing.
  */
 int bp_open (const char * fname,
              MPI_Comm comm,
              BP_FILE * fh)
 {
-    int rank;
+    int rank, size;
+    int cache_ok = 0;
 
     MPI_Comm_rank (comm, &rank);
+    MPI_Comm_size (comm, &size);
 
     adios_buffer_struct_init (fh->b);
 
@@ -315,6 +541,13 @@ int bp_open (const char * fname,
         return -1;
     }
 
+    /* A single reader maps the file and parses/reads from the mapping.
+       MPI-IO stays open as a fallback for anything outside the mapping. */
+    if (fh->mmap_enabled && size == 1)
+    {
+        fh->mmap_base = bp_mmap_file (fname, &fh->mmap_size);
+    }
+
     /* Only rank 0 reads the footer and it broadcasts to all other processes */
     if (rank == 0)
     {
@@ -327,6 +560,15 @@ int bp_open (const char * fname,
     /* Broadcast to all other processors */
     MPI_Bcast (&fh->mfooter, sizeof (struct bp_minifooter), MPI_BYTE, 0, comm);
 
+    if (fh->index_cache_enabled)
+    {
+        if (rank == 0)
+        {
+            cache_ok = bp_index_cache_check (fh);
+        }
+        MPI_Bcast (&cache_ok, 1, MPI_INT, 0, comm);
+    }
+
     if (fh->mfooter.pgs_index_offset > 0)
     {
         /* This BP file has data not just metadata. We need to open it
@@ -342,49 +584,244 @@ int bp_open (const char * fname,
         }
     }
 
-    uint64_t footer_size = fh->mfooter.file_size-fh->mfooter.pgs_index_offset;
+    bp_bcast_footer (fh);
 
-    if (rank != 0)
+
+    /* Everyone parses the index on its own */
+    bp_parse_pgs (fh);
+    if (cache_ok && !bp_index_cache_open (fh))
     {
-        if (!fh->b->buff)
+        /* variables are decoded from the cache on first access */
+        fh->b->offset = fh->mfooter.attrs_index_offset - fh->mfooter.pgs_index_offset;
+    }
+    else
+    {
+        bp_parse_vars (fh);
+        if (rank == 0 && fh->index_cache_enabled && !cache_ok)
         {
-            bp_alloc_aligned (fh->b, footer_size);
-            assert (fh->b->buff);
-
-            memset (fh->b->buff, 0, footer_size);
-            fh->b->offset = 0;
+            bp_index_cache_write (fh);
         }
     }
+    bp_parse_attrs (fh);
 
-    MPI_Barrier (comm);
-    // Broadcast the index which may be bigger than 2GB, so do it in chunks
-    uint64_t bytes_sent = 0;
-    int32_t to_send = 0;
+    if (fh->vars_index_offsets)
+    {
+        /* Keep the footer for decoding the variables later. fh->b is
+           reused for reading data, so it gets a fresh buffer. */
+        fh->index_b = (struct adios_bp_buffer_struct_v1 *)
+                            malloc (sizeof (struct adios_bp_buffer_struct_v1));
+        *fh->index_b = *fh->b;
+        fh->b->allocated_buff_ptr = 0;
+        fh->b->buff = 0;
+        fh->b->length = 0;
+        fh->b->offset = 0;
+    }
 
-    while (bytes_sent < footer_size)
+    return 0;
+}
+
+/* Bring an open BP file up to date with the steps appended to it since
+ * it was opened or refreshed last time (stream mode).
+ * Only rank 0 looks at the file. If its size has changed and the new footer
+ * is complete, the footer is broadcast and only the new process groups and
+ * characteristics are decoded and appended to fh. The index entries known
+ * already are skipped using their lengths in the footer.
+ * Returns 1 if the index of fh has been extended, 0 if the file has not
+ * changed or it is being written right now, and -1 if the file was not
+ * simply appended to. In the latter case the state of fh is undefined, it
+ * must be closed and the file opened again.
+ */
+int bp_refresh (BP_FILE * fh)
+{
+    int rank, status = 0;
+    MPI_Offset file_size = 0;
+    struct bp_minifooter old = fh->mfooter;
+    char str[9];
+    MPI_Status st;
+
+    MPI_Comm_rank (fh->comm, &rank);
+
+    if (fh->vars_index_offsets || fh->index_cache)
     {
-        if (footer_size - bytes_sent > MAX_MPIWRITE_SIZE)
+        /* the index is not fully decoded, it cannot be extended */
+        return -1;
+    }
+
+    if (rank == 0)
+    {
+        MPI_File_get_size (fh->mpi_fh, &file_size);
+        if (file_size < old.file_size)
         {
-            to_send = MAX_MPIWRITE_SIZE;
+            status = -1;
         }
-        else
+        else if (file_size > old.file_size)
         {
-            to_send = footer_size - bytes_sent;
+            /* the footer is complete if the version string is there,
+               see check_bp_validity() */
+            MPI_File_seek (fh->mpi_fh, (MPI_Offset) file_size - MINIFOOTER_SIZE - 28, MPI_SEEK_SET);
+            MPI_File_read (fh->mpi_fh, str, 8, MPI_BYTE, &st);
+            str[8] = '\0';
+            status = !strcmp (str, "ADIOS-BP");
         }
 
-        MPI_Bcast (fh->b->buff + bytes_sent, to_send, MPI_BYTE, 0, comm);
-        bytes_sent += to_send;
+        if (status > 0)
+        {
+            /* b may point into the mapping or be shrunk by the reads since open */
+            bp_realloc_aligned (fh->b, MINIFOOTER_SIZE);
+            fh->b->offset = 0;
+
+            if (fh->mmap_base)
+            {
+                /* the old mapping does not cover the new steps */
+                close_all_BP_subfiles (fh);
+                bp_munmap_file (fh->mmap_base, fh->mmap_size);
+                fh->mmap_base = bp_mmap_file (fh->fname, &fh->mmap_size);
+            }
+
+            fh->b->file_size = file_size;
+            fh->mfooter.file_size = file_size;
+            if (bp_read_minifooter (fh))
+            {
+                status = -1;
+            }
+            else if (fh->mfooter.pgs_index_offset < old.pgs_index_offset
+                     || (fh->mfooter.pgs_index_offset > 0) != (old.pgs_index_offset > 0)
+                     || fh->mfooter.version != old.version)
+            {
+                status = -1;
+            }
+        }
+    }
+
+    MPI_Bcast (&status, 1, MPI_INT, 0, fh->comm);
+    if (status <= 0)
+    {
+        return status;
     }
 
+    MPI_Bcast (&fh->mfooter, sizeof (struct bp_minifooter), MPI_BYTE, 0, fh->comm);
+    fh->b->file_size = fh->mfooter.file_size;
+    bp_bcast_footer (fh);
 
-    /* Everyone parses the index on its own */
-    bp_parse_pgs (fh);
-    bp_parse_vars (fh);
-    bp_parse_attrs (fh);
+    /* the lookup tables are rebuilt from the extended index */
+    bp_free_group_tables (fh);
+    free (fh->vars_table);
+    fh->vars_table = 0;
+
+    if (bp_parse_pgs (fh) || bp_parse_vars (fh) || bp_parse_attrs (fh))
+    {
+        log_debug ("The index of %s cannot be extended, it has to be read again\n",
+                   fh->fname);
+        return -1;
+    }
+
+    log_debug ("Refreshed the index of %s: steps %u-%u\n",
+               fh->fname, fh->tidx_start, fh->tidx_stop);
+    return 1;
+}
 
+/* Start watching the directory of fname for the writers closing the file
+ * or touching its step marker (ADIOS_STEP_MARKER_SUFFIX).
+ * Returns a descriptor for bp_wait_for_change() or -1 if the file cannot
+ * be watched. Changes made on other nodes of a shared file system are not
+ * seen, so the wait has to be limited in time anyway.
+ */
+int bp_watch_file (const char * fname)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    const char * slash = strrchr (fname, '/');
+    char * dir;
+    int fd;
+
+    fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    if (fd == -1)
+    {
+        log_debug ("Cannot watch %s: %s\n", fname, strerror (errno));
+        return -1;
+    }
+
+    if (slash)
+    {
+        dir = strndup (fname, slash == fname ? 1 : slash - fname);
+    }
+    else
+    {
+        dir = strdup (".");
+    }
+
+    if (inotify_add_watch (fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_ATTRIB) == -1)
+    {
+        log_debug ("Cannot watch directory %s: %s\n", dir, strerror (errno));
+        close (fd);
+        fd = -1;
+    }
+    free (dir);
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+/* Wait at most msec milliseconds for fname or its step marker to be
+ * written. Just sleeps if fd is -1.
+ * Returns 1 if a change was seen, 0 if the time is out.
+ */
+int bp_wait_for_change (int fd, const char * fname, int msec)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    if (fd >= 0)
+    {
+        const char * slash = strrchr (fname, '/');
+        const char * base = slash ? slash + 1 : fname;
+        size_t len = strlen (base);
+        char events[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+        double t_end = adios_gettime_double () + msec / 1000.0;
+        struct pollfd pfd;
+        int wait_msec = msec;
+
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        while (wait_msec > 0)
+        {
+            int changed = 0;
+            ssize_t n;
+            char * p;
+
+            if (poll (&pfd, 1, wait_msec) > 0)
+            {
+                n = read (fd, events, sizeof (events));
+                for (p = events; n > 0 && p < events + n; )
+                {
+                    struct inotify_event * e = (struct inotify_event *) p;
+                    if ((e->mask & IN_Q_OVERFLOW)
+                        || (e->len && !strncmp (e->name, base, len)
+                            && (e->name[len] == '\0'
+                                || !strcmp (e->name + len, ADIOS_STEP_MARKER_SUFFIX))))
+                    {
+                        changed = 1;
+                    }
+                    p += sizeof (struct inotify_event) + e->len;
+                }
+                if (changed)
+                {
+                    return 1;
+                }
+            }
+            wait_msec = (int) ((t_end - adios_gettime_double ()) * 1000.0);
+        }
+        return 0;
+    }
+#endif
+    adios_nanosleep (msec/1000, (int)(((uint64_t)msec * 1000000L)%1000000000L));
     return 0;
 }
 
+void bp_unwatch_file (int fd)
+{
+    if (fd >= 0)
+        close (fd);
+}
+
 ADIOS_VARINFO * bp_inq_var_byid (const ADIOS_FILE * fp, int varid)
 {
     BP_PROC * p = GET_BP_PROC (fp);
@@ -474,6 +911,12 @@ thod returns.
 }
 
 MPI_File * get_BP_subfile_handle(BP_FILE *fh, uint32_t file_index)
+{
+    struct BP_file_handle * l = get_BP_subfile (fh, file_index);
+    return (l ? &l->fh : 0);
+}
+
+struct BP_file_handle * get_BP_subfile (BP_FILE *fh, uint32_t file_index)
 {
     BP_file_handle_list *lst = &fh->subfile_handles; //just for simplifying typing
     //printf ("%s # of handles=%d, search for file_index=%d, fh=%p\n", __func__, lst->n_handles, file_index, fh);
@@ -485,7 +928,7 @@ MPI_File * get_BP_subfile_handle(BP_FILE *fh, uint32_t file_index)
     while (l)
     {
         if (l->file_index == file_index)
-            return &l->fh;
+            return l;
 
         l = l->next;
     }
@@ -519,14 +962,29 @@ BP_FILE * BP_FILE_alloc (const char * fname, MPI_Comm comm)
     fh->subfile_handles.head = NULL;
     fh->subfile_handles.tail = NULL;
     fh->mpi_fh = MPI_FILE_NULL;
+    fh->mmap_enabled = 0;
+    fh->mmap_base = 0;
+    fh->mmap_size = 0;
+    fh->index_cache_enabled = 0;
+    fh->index_cache = 0;
+    fh->index_cache_size = 0;
+    fh->lazy_index_enabled = 0;
+    fh->vars_index_offsets = 0;
+    fh->index_b = 0;
+    fh->sieve = 0;
+    fh->sieve_count = 0;
     return fh;
 }
 
 static const int MAX_HANDLES = 512;
-static void close_BP_subfile (struct BP_file_handle * sfh)
+static void close_BP_subfile (BP_FILE * fh, struct BP_file_handle * sfh)
 {
     if (sfh)
+    {
         MPI_File_close (&sfh->fh);
+        if (fh->mmap_base)
+            bp_munmap_file (sfh->mmap_base, sfh->mmap_size);
+    }
 }
 
 void add_BP_subfile_handle (BP_FILE * fh, struct BP_file_handle * n)
@@ -563,7 +1021,7 @@ void add_BP_subfile_handle (BP_FILE * fh, struct BP_file_handle * n)
         lst->tail->prev->next = NULL;
         struct BP_file_handle * oldest = lst->tail;
         lst->tail = lst->tail->prev;
-        close_BP_subfile (oldest);
+        close_BP_subfile (fh, oldest);
         free (oldest);
         lst->n_handles--;
     }
@@ -580,7 +1038,7 @@ void close_all_BP_subfiles (BP_FILE * fh)
     {
         n = l->next;
 
-        MPI_File_close (&l->fh);
+        close_BP_subfile (fh, l);
         free (l);
 
         l = n;
@@ -591,14 +1049,83 @@ void close_all_BP_subfiles (BP_FILE * fh)
     lst->tail = NULL;
 }
 
-int bp_close (BP_FILE * fh)
+/* Free the per-group lookup tables built by bp_parse_pgs(), bp_parse_vars()
+ * and bp_parse_attrs() */
+static void bp_free_group_tables (BP_FILE * fh)
 {
     struct BP_GROUP_VAR * gh = fh->gvar_h;
     struct BP_GROUP_ATTR * ah = fh->gattr_h;
+    int i,j;
+
+    /* Free variable structures in BP_GROUP_VAR */
+    if (gh) {
+        for (j=0;j<2;j++) {
+            for (i=0;i<gh->group_count;i++) {
+                if (gh->time_index && gh->time_index[j] && gh->time_index[j][i])
+                    free(gh->time_index[j][i]);
+            }
+            if (gh->time_index && gh->time_index[j])
+                free(gh->time_index[j]);
+        }
+        free (gh->time_index);
+
+        for (i=0;i<gh->group_count;i++) {
+            if (gh->namelist && gh->namelist[i])
+                free(gh->namelist[i]);
+        }
+        if (gh->namelist)
+            free (gh->namelist);
+
+        for (i=0;i<fh->mfooter.vars_count;i++) {
+            if (gh->var_namelist && gh->var_namelist[i])
+                free(gh->var_namelist[i]);
+            if (gh->var_offsets && gh->var_offsets[i])
+                free(gh->var_offsets[i]);
+        }
+        if (gh->var_namelist)
+            free (gh->var_namelist);
+
+        if (gh->var_offsets)
+            free(gh->var_offsets);
+
+        if (gh->var_counts_per_group)
+            free(gh->var_counts_per_group);
+
+        if (gh->pg_offsets)
+            free (gh->pg_offsets);
+
+        free (gh);
+    }
+
+    fh->gvar_h = 0;
+
+    /* Free attribute structures in BP_GROUP_ATTR */
+    if (ah) {
+        for (i = 0; i < fh->mfooter.attrs_count; i++) {
+            if (ah->attr_offsets && ah->attr_offsets[i])
+                free(ah->attr_offsets[i]);
+            if (ah->attr_namelist && ah->attr_namelist[i])
+                free(ah->attr_namelist[i]);
+        }
+        if (ah->attr_offsets)
+            free(ah->attr_offsets);
+        if (ah->attr_namelist)
+            free(ah->attr_namelist);
+        if (ah->attr_counts_per_group)
+            free(ah->attr_counts_per_group);
+
+        free(ah);
+    }
+
+    fh->gattr_h = 0;
+}
+
+int bp_close (BP_FILE * fh)
+{
     struct adios_index_var_struct_v1 * vars_root = fh->vars_root, *vr;
     struct adios_index_attribute_struct_v1 * attrs_root = fh->attrs_root, *ar;
     struct bp_index_pg_struct_v1 * pgs_root = fh->pgs_root, *pr;
-    int i,j;
+    int j;
     MPI_File mpi_fh = fh->mpi_fh;
 
     adios_errno = 0;
@@ -606,19 +1133,36 @@ int bp_close (BP_FILE * fh)
         MPI_File_close (&mpi_fh);
 
     close_all_BP_subfiles (fh);
+    bp_munmap_file (fh->mmap_base, fh->mmap_size);
+    fh->mmap_base = 0;
+    bp_index_cache_close (fh);
+    bp_free_sieve (fh);
 
     if (fh->b) {
         adios_posix_close_internal (fh->b);
         free(fh->b);
     }
 
+    if (fh->index_b) {
+        /* the file descriptor is shared with fh->b, only the footer is ours */
+        if (fh->index_b->allocated_buff_ptr)
+            free (fh->index_b->allocated_buff_ptr);
+        free (fh->index_b);
+        fh->index_b = 0;
+    }
+
+    if (fh->vars_index_offsets) {
+        free (fh->vars_index_offsets);
+        fh->vars_index_offsets = 0;
+    }
+
     /* Free variable structures */
     /* alloc in bp_utils.c: bp_parse_vars() */
     /* FIXME: this while loop is identical to adios_internals.c:adios_clear_vars_index_v1() */
     while (vars_root) {
         vr = vars_root;
         vars_root = vars_root->next;
-        for (j = 0; j < vr->characteristics_count; j++) {
+        for (j = 0; vr->characteristics && j < vr->characteristics_count; j++) {
             // alloc in bp_utils.c:bp_parse_characteristics() <- bp_get_characteristics_data()
             if (vr->characteristics[j].dims.dims)
                 free (vr->characteristics[j].dims.dims);
@@ -703,91 +1247,31 @@ int bp_close (BP_FILE * fh)
         if (ar->group_name)
             free (ar->group_name);
         if (ar->attr_name)
-            free (ar->attr_name);
-        if (ar->attr_path)
-            free (ar->attr_path);
-        free(ar);
-    }
-
-    fh->attrs_root = 0;
-
-    /* Free process group structures */
-    /* alloc in bp_utils.c bp_parse_pgs() first loop */
-    //printf ("pgs: %d\n", fh->mfooter.pgs_count);
-    while (pgs_root) {
-        pr = pgs_root;
-        pgs_root = pgs_root->next;
-        //printf("%d\tpg pid=%d addr=%x next=%x\n",i, pr->process_id, pr, pr->next);
-        if (pr->group_name)
-            free(pr->group_name);
-        if (pr->time_index_name)
-            free(pr->time_index_name);
-        free(pr);
-    }
-
-    fh->pgs_root = 0;
-
-    /* Free variable structures in BP_GROUP_VAR */
-    if (gh) {
-        for (j=0;j<2;j++) {
-            for (i=0;i<gh->group_count;i++) {
-                if (gh->time_index && gh->time_index[j] && gh->time_index[j][i])
-                    free(gh->time_index[j][i]);
-            }
-            if (gh->time_index && gh->time_index[j])
-                free(gh->time_index[j]);
-        }
-        free (gh->time_index);
-
-        for (i=0;i<gh->group_count;i++) {
-            if (gh->namelist && gh->namelist[i])
-                free(gh->namelist[i]);
-        }
-        if (gh->namelist)
-            free (gh->namelist);
-
-        for (i=0;i<fh->mfooter.vars_count;i++) {
-            if (gh->var_namelist && gh->var_namelist[i])
-                free(gh->var_namelist[i]);
-            if (gh->var_offsets && gh->var_offsets[i])
-                free(gh->var_offsets[i]);
-        }
-        if (gh->var_namelist)
-            free (gh->var_namelist);
-
-        if (gh->var_offsets)
-            free(gh->var_offsets);
-
-        if (gh->var_counts_per_group)
-            free(gh->var_counts_per_group);
-
-        if (gh->pg_offsets)
-            free (gh->pg_offsets);
-
-        free (gh);
+            free (ar->attr_name);
+        if (ar->attr_path)
+            free (ar->attr_path);
+        free(ar);
     }
 
-    fh->gvar_h = 0;
-
-    /* Free attribute structures in BP_GROUP_ATTR */
-    if (ah) {
-        for (i = 0; i < fh->mfooter.attrs_count; i++) {
-            if (ah->attr_offsets && ah->attr_offsets[i])
-                free(ah->attr_offsets[i]);
-            if (ah->attr_namelist && ah->attr_namelist[i])
-                free(ah->attr_namelist[i]);
-        }
-        if (ah->attr_offsets)
-            free(ah->attr_offsets);
-        if (ah->attr_namelist)
-            free(ah->attr_namelist);
-        if (ah->attr_counts_per_group)
-            free(ah->attr_counts_per_group);
+    fh->attrs_root = 0;
 
-        free(ah);
+    /* Free process group structures */
+    /* alloc in bp_utils.c bp_parse_pgs() first loop */
+    //printf ("pgs: %d\n", fh->mfooter.pgs_count);
+    while (pgs_root) {
+        pr = pgs_root;
+        pgs_root = pgs_root->next;
+        //printf("%d\tpg pid=%d addr=%x next=%x\n",i, pr->process_id, pr, pr->next);
+        if (pr->group_name)
+            free(pr->group_name);
+        if (pr->time_index_name)
+            free(pr->time_index_name);
+        free(pr);
     }
 
-    fh->gattr_h = 0;
+    fh->pgs_root = 0;
+
+    bp_free_group_tables (fh);
 
     if (fh->fname)
     {
@@ -818,8 +1302,12 @@ int bp_read_minifooter (BP_FILE * bp_struct)
         memset (b->buff, 0, MINIFOOTER_SIZE);
         b->offset = 0;
     }
-    MPI_File_seek (bp_struct->mpi_fh, (MPI_Offset) attrs_end, MPI_SEEK_SET);
-    MPI_File_read (bp_struct->mpi_fh, b->buff, MINIFOOTER_SIZE, MPI_BYTE, &status);
+    if (!bp_copy_mapped_slice (b->buff, bp_struct->mmap_base, bp_struct->mmap_size,
+                               attrs_end, MINIFOOTER_SIZE))
+    {
+        MPI_File_seek (bp_struct->mpi_fh, (MPI_Offset) attrs_end, MPI_SEEK_SET);
+        MPI_File_read (bp_struct->mpi_fh, b->buff, MINIFOOTER_SIZE, MPI_BYTE, &status);
+    }
 
     /*memset (&mh->pgs_index_offset, 0, MINIFOOTER_SIZE);
     memcpy (&mh->pgs_index_offset, b->buff, MINIFOOTER_SIZE);*/
@@ -897,6 +1385,14 @@ int bp_read_minifooter (BP_FILE * bp_struct)
     /* FIXME: including the last 28 bytes read already above and it seems that is not processed anymore */
     /* It will be sent to all processes */
     uint64_t footer_size = mh->file_size - mh->pgs_index_offset;
+
+    /* A mapped file is parsed in place, there is nothing to read */
+    if (bp_map_slice (b, bp_struct->mmap_base, bp_struct->mmap_size,
+                      mh->pgs_index_offset, footer_size))
+    {
+        return 0;
+    }
+
     bp_realloc_aligned (b, footer_size);
     MPI_File_seek (bp_struct->mpi_fh,
             (MPI_Offset)  mh->pgs_index_offset,
@@ -987,28 +1483,68 @@ int bp_parse_pgs (BP_FILE * fh)
 
     for (i = 0; i < mh->pgs_count; i++) {
         uint16_t length_of_group;
+        uint16_t length_of_name;
         namelist[i] = 0;
         // validate remaining length
         BUFREAD16(b, length_of_group)
 
-        if (!*root)
+        if (*root)
+        {
+            /* Known from a previous parse of the file (bp_refresh()).
+               Make sure it is still the same process group. */
+            uint64_t entry_end = b->offset + length_of_group;
+            uint32_t time_index;
+            uint64_t offset_in_file;
+
+            BUFREAD16(b, length_of_name)
+            b->offset += length_of_name + 1 + 4;
+            BUFREAD16(b, length_of_name)
+            b->offset += length_of_name;
+            BUFREAD32(b, time_index)
+            BUFREAD64(b, offset_in_file)
+            if (time_index != (*root)->time_index
+                || offset_in_file != (*root)->offset_in_file
+                || b->offset != entry_end)
+            {
+                for (j = 0; j < group_count; j++)
+                    free (namelist[j]);
+                free (namelist);
+                free (grpidlist);
+                return 1;
+            }
+        }
+        else
         {
             *root = (struct bp_index_pg_struct_v1 *)
                 malloc (sizeof(struct bp_index_pg_struct_v1));
             memset (*root, 0, sizeof(struct bp_index_pg_struct_v1));
             (*root)->next = 0;
-        }
-        uint16_t length_of_name;
 
-        BUFREAD16(b, length_of_name)
-        (*root)->group_name = (char *) malloc (length_of_name + 1);
-        (*root)->group_name [length_of_name] = '\0';
-        memcpy ((*root)->group_name, b->buff + b->offset, length_of_name);
-        b->offset += length_of_name;
+            BUFREAD16(b, length_of_name)
+            (*root)->group_name = (char *) malloc (length_of_name + 1);
+            (*root)->group_name [length_of_name] = '\0';
+            memcpy ((*root)->group_name, b->buff + b->offset, length_of_name);
+            b->offset += length_of_name;
+
+            BUFREAD8(b, fortran_flag)
+            (*root)->adios_host_language_fortran =
+                (fortran_flag == 'y' ? adios_flag_yes : adios_flag_no);
+
+            BUFREAD32(b, (*root)->process_id)
+
+            BUFREAD16(b, length_of_name)
+            (*root)->time_index_name = (char *) malloc (length_of_name + 1);
+            (*root)->time_index_name [length_of_name] = '\0';
+            memcpy ((*root)->time_index_name, b->buff + b->offset, length_of_name);
+            b->offset += length_of_name;
 
+            BUFREAD32(b, (*root)->time_index)
+
+            BUFREAD64(b, (*root)->offset_in_file)
+        }
 
         if ( group_count == 0 ) {
-            namelist[group_count] = (char *) malloc (length_of_name + 1);
+            namelist[group_count] = (char *) malloc (strlen ((*root)->group_name) + 1);
             strcpy (namelist[group_count], (*root)->group_name);
             ++group_count;
             grpidlist[i] = group_count-1;
@@ -1020,7 +1556,7 @@ int bp_parse_pgs (BP_FILE * fh)
                 }
             }
             if (j==group_count) {
-                namelist[group_count] = (char *) malloc (length_of_name + 1);
+                namelist[group_count] = (char *) malloc (strlen ((*root)->group_name) + 1);
                 strcpy (namelist[group_count], (*root)->group_name);
                 ++group_count;
                 grpidlist[i] = group_count - 1;
@@ -1030,22 +1566,6 @@ int bp_parse_pgs (BP_FILE * fh)
 
         }
 
-        BUFREAD8(b, fortran_flag)
-        (*root)->adios_host_language_fortran =
-            (fortran_flag == 'y' ? adios_flag_yes : adios_flag_no);
-
-        BUFREAD32(b, (*root)->process_id)
-
-        BUFREAD16(b, length_of_name)
-        (*root)->time_index_name = (char *) malloc (length_of_name + 1);
-        (*root)->time_index_name [length_of_name] = '\0';
-        memcpy ((*root)->time_index_name, b->buff + b->offset, length_of_name);
-        b->offset += length_of_name;
-
-        BUFREAD32(b, (*root)->time_index)
-
-        BUFREAD64(b, (*root)->offset_in_file)
-
         if (i == 0)
             tidx_start = (*root)->time_index;
         if (i == mh->pgs_count-1) {
@@ -1200,6 +1720,168 @@ int bp_parse_pgs (BP_FILE * fh)
 /********************/
 /* Parse ATTRIBUTES */
 /********************/
+/* Skip a string of the index in b. Returns 1 if it equals str. */
+static int bp_skip_string (struct adios_bp_buffer_struct_v1 * b, const char * str)
+{
+    uint16_t len;
+    int match;
+
+    BUFREAD16(b, len)
+    match = (strlen (str) == len && !strncmp (str, b->buff + b->offset, len));
+    b->offset += len;
+
+    return match;
+}
+
+/* Decode the characteristics of attribute a from b, starting at the first-th one */
+static void bp_parse_attr_characteristics (BP_FILE * fh, struct adios_bp_buffer_struct_v1 * b,
+                                           struct adios_index_attribute_struct_v1 * a, uint64_t first)
+{
+    struct bp_minifooter * mh = &(fh->mfooter);
+    int bpversion = mh->version & ADIOS_VERSION_NUM_MASK;
+
+    // validate remaining length: offsets_count * (8 + 2 * (size of type))
+    uint64_t j;
+    a->characteristics = realloc (a->characteristics, a->characteristics_count
+                   * sizeof (struct adios_index_characteristic_struct_v1)
+                  );
+    memset (a->characteristics + first, 0
+           ,  (a->characteristics_count - first)
+            * sizeof (struct adios_index_characteristic_struct_v1)
+           );
+
+    for (j = 0; j < first; j++)
+    {
+        uint32_t characteristic_set_length;
+
+        b->offset += 1;
+        BUFREAD32(b, characteristic_set_length)
+        b->offset += characteristic_set_length;
+    }
+
+    for (j = first; j < a->characteristics_count; j++)
+    {
+        uint8_t characteristic_set_count;
+        uint32_t characteristic_set_length;
+        uint8_t item = 0;
+
+        BUFREAD8(b, characteristic_set_count)
+        BUFREAD32(b, characteristic_set_length)
+
+        while (item < characteristic_set_count)
+        {
+            uint8_t flag;
+            enum ADIOS_CHARACTERISTICS c;
+
+            BUFREAD8(b, flag)
+            c = (enum ADIOS_CHARACTERISTICS) flag;
+
+            switch (c)
+            {
+                case adios_characteristic_value:
+                    a->characteristics [j].value = 
+                        bp_read_data_from_buffer(b, a->type, a->nelems);
+                    break;
+
+                case adios_characteristic_offset:
+                    BUFREAD64(b, a->characteristics [j].offset)
+                    break;
+
+                case adios_characteristic_payload_offset:
+                    BUFREAD64(b, a->characteristics [j].payload_offset)
+                    break;
+
+                case adios_characteristic_file_index:
+                    BUFREAD32(b, a->characteristics [j].file_index);
+                    break;
+
+                case adios_characteristic_time_index:
+                    BUFREAD32(b, a->characteristics [j].time_index)
+                    break;
+                case adios_characteristic_var_id:
+                    if (bpversion > 1) {
+                        BUFREAD32(b, a->characteristics [j].var_id)
+                    } else {
+                        BUFREAD16(b, a->characteristics [j].var_id)
+                    }
+                    break;
+
+                case adios_characteristic_dimensions:
+                    {
+                        uint16_t dims_length;
+                        BUFREAD8(b,  a->characteristics [j].dims.count);
+                        BUFREAD16(b, dims_length);
+                        a->characteristics [j].dims.dims = (uint64_t *) malloc (dims_length);
+                        int di = 0;
+                        int dims_num = dims_length / sizeof(uint64_t);
+                        for (di = 0; di < dims_num; di ++) {
+                            BUFREAD64(b, (a->characteristics [j].dims.dims)[di]);
+                        }
+                        a->nelems  =  a->characteristics [j].dims.dims[0];
+
+                        break;
+                    }
+
+                default:
+                    break;
+            }
+            item++;
+        }
+        /* Old BP files do not have time_index characteristics, so we
+           set it here automatically: j div # of pgs per timestep
+           Assumed that in old BP files, all pgs write each variable in each timestep.*/
+        if (a->characteristics [j].time_index == 0) {
+            a->characteristics [j].time_index =
+                 j / (mh->pgs_count / (fh->tidx_stop - fh->tidx_start + 1)) + 1;
+            /*printf("OldBP: attr %s time_index set to %d\n",
+                    a->attr_name,
+                    a->characteristics [j].time_index);*/
+        }
+    }
+
+}
+
+/* Decode only the characteristics that were added to an already known
+ * attribute since the index was parsed last time (bp_refresh()).
+ * Returns 1 if the entry in b does not extend the same attribute.
+ */
+static int bp_parse_known_attr (BP_FILE * fh, struct adios_bp_buffer_struct_v1 * b,
+                                struct adios_index_attribute_struct_v1 * a)
+{
+    int bpversion = fh->mfooter.version & ADIOS_VERSION_NUM_MASK;
+    uint32_t attr_entry_length, id = a->id;
+    uint64_t attr_entry_start = b->offset;
+    uint64_t characteristics_sets_count, known = a->characteristics_count;
+    uint8_t flag;
+
+    BUFREAD32(b, attr_entry_length)
+    if (bpversion > 1) {
+        BUFREAD32(b, a->id)
+    } else {
+        BUFREAD16(b, a->id)
+    }
+    if (a->id != id
+        || !bp_skip_string (b, a->group_name)
+        || !bp_skip_string (b, a->attr_name)
+        || !bp_skip_string (b, a->attr_path))
+    {
+        return 1;
+    }
+
+    BUFREAD8(b, flag)
+    BUFREAD64(b, characteristics_sets_count)
+    if ((flag != a->type && a->type != adios_unknown) || characteristics_sets_count < known)
+    {
+        return 1;
+    }
+
+    a->characteristics_count = characteristics_sets_count;
+    a->characteristics_allocated = characteristics_sets_count;
+    bp_parse_attr_characteristics (fh, b, a, known);
+
+    return b->offset != attr_entry_start + 4 + attr_entry_length;
+}
+
 int bp_parse_attrs (BP_FILE * fh)
 {
     struct adios_bp_buffer_struct_v1 * b = fh->b;
@@ -1229,12 +1911,19 @@ int bp_parse_attrs (BP_FILE * fh)
     BUFREAD64(b, mh->attrs_length)
 
     for (i = 0; i < mh->attrs_count; i++) {
-        if (!*root)
+        if (*root)
         {
-            *root = (struct adios_index_attribute_struct_v1 *)
-                      malloc (sizeof (struct adios_index_attribute_struct_v1));
-            (*root)->next = 0;
+            /* known from a previous parse of the file (bp_refresh()) */
+            if (bp_parse_known_attr (fh, b, *root))
+            {
+                return 1;
+            }
+            root = &(*root)->next;
+            continue;
         }
+        *root = (struct adios_index_attribute_struct_v1 *)
+                  malloc (sizeof (struct adios_index_attribute_struct_v1));
+        (*root)->next = 0;
         (*root)->nelems = 1; // initialize to 1 in case there will be no dimension characteristic
         uint8_t flag;
         uint32_t attr_entry_length;
@@ -1282,95 +1971,8 @@ int bp_parse_attrs (BP_FILE * fh)
         (*root)->characteristics_count = characteristics_sets_count;
         (*root)->characteristics_allocated = characteristics_sets_count;
 
-        // validate remaining length: offsets_count * (8 + 2 * (size of type))
-        uint64_t j;
-        (*root)->characteristics = malloc (characteristics_sets_count
-                       * sizeof (struct adios_index_characteristic_struct_v1)
-                      );
-        memset ((*root)->characteristics, 0
-               ,  characteristics_sets_count
-                * sizeof (struct adios_index_characteristic_struct_v1)
-               );
-
-        for (j = 0; j < characteristics_sets_count; j++)
-        {
-            uint8_t characteristic_set_count;
-            uint32_t characteristic_set_length;
-            uint8_t item = 0;
-
-            BUFREAD8(b, characteristic_set_count)
-            BUFREAD32(b, characteristic_set_length)
-
-            while (item < characteristic_set_count)
-            {
-                uint8_t flag;
-                enum ADIOS_CHARACTERISTICS c;
-
-                BUFREAD8(b, flag)
-                c = (enum ADIOS_CHARACTERISTICS) flag;
-
-                switch (c)
-                {
-                    case adios_characteristic_value:
-                        (*root)->characteristics [j].value = 
-                            bp_read_data_from_buffer(b, (*root)->type, (*root)->nelems);
-                        break;
-
-                    case adios_characteristic_offset:
-                        BUFREAD64(b, (*root)->characteristics [j].offset)
-                        break;
-
-                    case adios_characteristic_payload_offset:
-                        BUFREAD64(b, (*root)->characteristics [j].payload_offset)
-                        break;
-
-                    case adios_characteristic_file_index:
-                        BUFREAD32(b, (*root)->characteristics [j].file_index);
-                        break;
-
-                    case adios_characteristic_time_index:
-                        BUFREAD32(b, (*root)->characteristics [j].time_index)
-                        break;
-                    case adios_characteristic_var_id:
-                        if (bpversion > 1) {
-                            BUFREAD32(b, (*root)->characteristics [j].var_id)
-                        } else {
-                            BUFREAD16(b, (*root)->characteristics [j].var_id)
-                        }
-                        break;
-
-                    case adios_characteristic_dimensions:
-                        {
-                            uint16_t dims_length;
-                            BUFREAD8(b,  (*root)->characteristics [j].dims.count);
-                            BUFREAD16(b, dims_length);
-                            (*root)->characteristics [j].dims.dims = (uint64_t *) malloc (dims_length);
-                            int di = 0;
-                            int dims_num = dims_length / sizeof(uint64_t);
-                            for (di = 0; di < dims_num; di ++) {
-                                BUFREAD64(b, ((*root)->characteristics [j].dims.dims)[di]);
-                            }
-                            (*root)->nelems  =  (*root)->characteristics [j].dims.dims[0];
-
-                            break;
-                        }
-
-                    default:
-                        break;
-                }
-                item++;
-            }
-            /* Old BP files do not have time_index characteristics, so we
-               set it here automatically: j div # of pgs per timestep
-               Assumed that in old BP files, all pgs write each variable in each timestep.*/
-            if ((*root)->characteristics [j].time_index == 0) {
-                (*root)->characteristics [j].time_index =
-                     j / (mh->pgs_count / (fh->tidx_stop - fh->tidx_start + 1)) + 1;
-                /*printf("OldBP: attr %s time_index set to %d\n",
-                        (*root)->attr_name,
-                        (*root)->characteristics [j].time_index);*/
-            }
-        }
+        (*root)->characteristics = 0;
+        bp_parse_attr_characteristics (fh, b, *root, 0);
 
         root = &(*root)->next;
     }
@@ -1458,18 +2060,26 @@ int bp_parse_attrs (BP_FILE * fh)
     return 0;
 }
 
-static void process_joined_array(struct adios_index_var_struct_v1 *v)
+/* Compute the global dimension and the offsets of a joined array for all its
+ * characteristics. The joined dimension is recognized on the first-th
+ * characteristic, the first one decoded from the file just now. The ones
+ * before it had their JoinedDimValue replaced by the global size already
+ * (when bp_refresh() appends the characteristics of new steps).
+ */
+static void process_joined_array(struct adios_index_var_struct_v1 *v, uint64_t first)
 {
-    if (v->characteristics[0].value)  // scalar
+    if (first >= v->characteristics_count)
         return;
-    if (!is_global_array(&(v->characteristics[0])))
+    if (v->characteristics[first].value)  // scalar
         return;
-    int ndim = v->characteristics[0].dims.count;
+    if (!is_global_array(&(v->characteristics[first])))
+        return;
+    int ndim = v->characteristics[first].dims.count;
     int joindim = -1;
     int i, j;
     for (i = 0; i < ndim; i++)
     {
-        if (v->characteristics[0].dims.dims[i*3+1] == JoinedDimValue)
+        if (v->characteristics[first].dims.dims[i*3+1] == JoinedDimValue)
         {
             joindim = i;
             log_debug("Variable %s is a Joined Array in dimension %d\n", v->var_name, i);
@@ -1511,6 +2121,105 @@ static void process_joined_array(struct adios_index_var_struct_v1 *v)
 /*******************/
 /* Parse VARIABLES */
 /*******************/
+/* Decode the characteristics of v from b, starting at the first-th one.
+ * The ones before it are already decoded in v->characteristics and are
+ * only skipped in b. */
+static void bp_parse_var_characteristics (BP_FILE * fh, struct adios_bp_buffer_struct_v1 * b,
+                                          struct adios_index_var_struct_v1 * v, uint64_t first)
+{
+    struct bp_minifooter * mh = &(fh->mfooter);
+
+    // validate remaining length: offsets_count *
+    // (8 + 2 * (size of type))
+    v->characteristics = realloc (v->characteristics, v->characteristics_count
+        * sizeof (struct adios_index_characteristic_struct_v1)
+        );
+    memset (v->characteristics + first, 0
+        ,  (v->characteristics_count - first)
+        * sizeof (struct adios_index_characteristic_struct_v1)
+           );
+    // NOTE: Above memset assumes that all 0's is a valid initialization.
+    //       This is true, currently, but be careful in the future.
+
+    uint64_t j;
+    for (j = 0; j < first; j++)
+    {
+        uint32_t characteristic_set_length;
+
+        b->offset += 1;
+        BUFREAD32(b, characteristic_set_length)
+        b->offset += characteristic_set_length;
+    }
+
+    for (j = first; j < v->characteristics_count; j++)
+    {
+        uint8_t characteristic_set_count;
+        uint32_t characteristic_set_length;
+        uint8_t item = 0;
+
+        BUFREAD8(b, characteristic_set_count)
+        BUFREAD32(b, characteristic_set_length)
+
+        while (item < characteristic_set_count) {
+            bp_parse_characteristics (b, &v, j);
+            item++;
+        }
+
+        /* Old BP files do not have time_index characteristics, so we
+           set it here automatically: j div # of pgs per timestep
+           Assumed that in old BP files, all pgs write each variable in each timestep.*/
+        if (v->characteristics [j].time_index == 0) {
+            v->characteristics [j].time_index =
+                 j / (mh->pgs_count / (fh->tidx_stop - fh->tidx_start + 1)) + 1;
+            /*printf("OldBP: var %s time_index set to %d\n",
+                    v->var_name,
+                    v->characteristics [j].time_index);*/
+        }
+    }
+    process_joined_array(v, first);
+}
+
+/* Decode only the characteristics that were added to an already known
+ * variable since the index was parsed last time (bp_refresh()).
+ * Returns 1 if the entry in b does not extend the same variable.
+ */
+static int bp_parse_known_var (BP_FILE * fh, struct adios_bp_buffer_struct_v1 * b,
+                               struct adios_index_var_struct_v1 * v)
+{
+    int bpversion = fh->mfooter.version & ADIOS_VERSION_NUM_MASK;
+    uint32_t var_entry_length, id = v->id;
+    uint64_t var_entry_start = b->offset;
+    uint64_t characteristics_sets_count, known = v->characteristics_count;
+    uint8_t flag;
+
+    BUFREAD32(b, var_entry_length)
+    if (bpversion > 1) {
+        BUFREAD32(b, v->id)
+    } else {
+        BUFREAD16(b, v->id)
+    }
+    if (v->id != id
+        || !bp_skip_string (b, v->group_name)
+        || !bp_skip_string (b, v->var_name)
+        || !bp_skip_string (b, v->var_path))
+    {
+        return 1;
+    }
+
+    BUFREAD8(b, flag)
+    BUFREAD64(b, characteristics_sets_count)
+    if (flag != v->type || characteristics_sets_count < known)
+    {
+        return 1;
+    }
+
+    v->characteristics_count = characteristics_sets_count;
+    v->characteristics_allocated = characteristics_sets_count;
+    bp_parse_var_characteristics (fh, b, v, known);
+
+    return b->offset != var_entry_start + 4 + var_entry_length;
+}
+
 int bp_parse_vars (BP_FILE * fh)
 {
     struct adios_bp_buffer_struct_v1 * b = fh->b;
@@ -1541,19 +2250,34 @@ int bp_parse_vars (BP_FILE * fh)
 
     // To speed find_var_byid(). Q. Liu, 11-2013.
     fh->vars_table = (struct adios_index_var_struct_v1 **) malloc (8*(size_t)mh->vars_count);
+    if (fh->lazy_index_enabled)
+    {
+        fh->vars_index_offsets = (uint64_t *) calloc (mh->vars_count, sizeof (uint64_t));
+    }
     // validate remaining length
     int i;
     for (i = 0; i < mh->vars_count; i++) {
-        if (!*root) {
-            *root = (struct adios_index_var_struct_v1 *)
-                malloc (sizeof (struct adios_index_var_struct_v1));
-            (*root)->next = 0;
+        if (*root) {
+            /* known from a previous parse of the file (bp_refresh()) */
+            if (bp_parse_known_var (fh, b, *root))
+            {
+                return 1;
+            }
             fh->vars_table[i] = *root;
+            root = &(*root)->next;
+            continue;
         }
+        *root = (struct adios_index_var_struct_v1 *)
+            malloc (sizeof (struct adios_index_var_struct_v1));
+        (*root)->next = 0;
+        (*root)->characteristics = 0;
+        fh->vars_table[i] = *root;
+
         uint8_t flag;
         uint32_t var_entry_length;
         uint16_t len;
         uint64_t characteristics_sets_count;
+        uint64_t var_entry_start = b->offset;
 
         BUFREAD32(b, var_entry_length)
         if (bpversion > 1) {
@@ -1587,49 +2311,32 @@ int bp_parse_vars (BP_FILE * fh)
         (*root)->characteristics_count = characteristics_sets_count;
         (*root)->characteristics_allocated = characteristics_sets_count;
 
-        // validate remaining length: offsets_count *
-        // (8 + 2 * (size of type))
-        (*root)->characteristics = malloc (characteristics_sets_count
-            * sizeof (struct adios_index_characteristic_struct_v1)
-            );
-        memset ((*root)->characteristics, 0
-            ,  characteristics_sets_count
-            * sizeof (struct adios_index_characteristic_struct_v1)
-               );
-        // NOTE: Above memset assumes that all 0's is a valid initialization.
-        //       This is true, currently, but be careful in the future.
-
-        uint64_t j;
-        for (j = 0; j < characteristics_sets_count; j++)
+        if (fh->vars_index_offsets && var_entry_length)
         {
-            uint8_t characteristic_set_count;
-            uint32_t characteristic_set_length;
-            uint8_t item = 0;
-
-            BUFREAD8(b, characteristic_set_count)
-            BUFREAD32(b, characteristic_set_length)
-
-            while (item < characteristic_set_count) {
-                bp_parse_characteristics (b, root, j);
-                item++;
-            }
-
-            /* Old BP files do not have time_index characteristics, so we
-               set it here automatically: j div # of pgs per timestep
-               Assumed that in old BP files, all pgs write each variable in each timestep.*/
-            if ((*root)->characteristics [j].time_index == 0) {
-                (*root)->characteristics [j].time_index =
-                     j / (mh->pgs_count / (fh->tidx_stop - fh->tidx_start + 1)) + 1;
-                /*printf("OldBP: var %s time_index set to %d\n",
-                        (*root)->var_name,
-                        (*root)->characteristics [j].time_index);*/
-            }
+            /* skip the characteristics, bp_find_var_byid() decodes them */
+            (*root)->characteristics = 0;
+            fh->vars_index_offsets[i] = b->offset;
+            b->offset = var_entry_start + 4 + var_entry_length;
+        }
+        else
+        {
+            bp_parse_var_characteristics (fh, b, *root, 0);
         }
-        process_joined_array((*root));
         root = &(*root)->next;
     }
 
-    root = vars_root;
+    bp_build_vars_namelist (fh);
+    return 0;
+}
+
+/* Build the per-group variable lists of fh->gvar_h from the variable index.
+ * Variables whose characteristics are not decoded yet get no offset list.
+ */
+void bp_build_vars_namelist (BP_FILE * fh)
+{
+    struct bp_minifooter * mh = &(fh->mfooter);
+    struct adios_index_var_struct_v1 ** root = &(fh->vars_root);
+    int i;
     uint32_t * var_counts_per_group;
     uint16_t *  var_gids;
     uint64_t ** var_offsets;
@@ -1693,10 +2400,12 @@ int bp_parse_vars (BP_FILE * fh)
         }
         //printf ("Variable %d full path is [%s]\n", i, var_namelist[i]);
 
-        var_offsets[i] = (uint64_t *) malloc (
-                sizeof(uint64_t)*(*root)->characteristics_count);
-        for (j=0;j < (*root)->characteristics_count;j++) {
-            var_offsets[i][j] = (*root)->characteristics [j].offset;
+        if ((*root)->characteristics) {
+            var_offsets[i] = (uint64_t *) malloc (
+                    sizeof(uint64_t)*(*root)->characteristics_count);
+            for (j=0;j < (*root)->characteristics_count;j++) {
+                var_offsets[i][j] = (*root)->characteristics [j].offset;
+            }
         }
 
         //struct adios_index_characteristic_dims_struct_v1 * pdims;
@@ -1710,7 +2419,6 @@ int bp_parse_vars (BP_FILE * fh)
     fh->gvar_h->var_namelist = var_namelist;
     fh->gvar_h->var_counts_per_group=var_counts_per_group;
     fh->gvar_h->var_offsets = var_offsets;
-    return 0;
 }
 
 int bp_parse_characteristics (struct adios_bp_buffer_struct_v1 * b,
@@ -3309,10 +4017,46 @@ struct adios_index_var_struct_v1 * bp_find_var_byid (BP_FILE * fh, int varid)
         return NULL;
     }
 */
+    if (!fh->vars_table[varid]->characteristics)
+    {
+        if (fh->index_cache)
+        {
+            bp_index_cache_load_var (fh, varid);
+        }
+        else if (fh->vars_index_offsets && fh->vars_index_offsets[varid])
+        {
+            /* during bp_open() the footer is still in fh->b */
+            struct adios_bp_buffer_struct_v1 * b = fh->index_b ? fh->index_b : fh->b;
+            uint64_t offset = b->offset;
+
+            b->offset = fh->vars_index_offsets[varid];
+            bp_parse_var_characteristics (fh, b, fh->vars_table[varid], 0);
+            b->offset = offset;
+        }
+    }
     return fh->vars_table[varid];
  //   return var_root;
 }
 
+/* Decode the characteristics of a variable that was found by walking the
+   variable list instead of bp_find_var_byid() */
+void bp_load_var (BP_FILE * fh, struct adios_index_var_struct_v1 * v)
+{
+    int i;
+
+    if (v->characteristics || (!fh->index_cache && !fh->vars_index_offsets))
+        return;
+
+    for (i = 0; i < fh->mfooter.vars_count; i++)
+    {
+        if (fh->vars_table[i] == v)
+        {
+            bp_find_var_byid (fh, i);
+            break;
+        }
+    }
+}
+
 int is_global_array (struct adios_index_characteristic_struct_v1 *ch) {
     return is_global_array_generic(&ch->dims);
 }
@@ -20,6 +20,17 @@ BP_PROC * GET_BP_PROC (const ADIOS_FILE * fp);
 BP_FILE * GET_BP_FILE (const ADIOS_FILE * fp);
 void bp_alloc_aligned (struct adios_bp_buffer_struct_v1 * b, uint64_t size);
 void bp_realloc_aligned (struct adios_bp_buffer_struct_v1 * b, uint64_t size);
+char * bp_mmap_file (const char * fname, uint64_t * size);
+void bp_munmap_file (char * base, uint64_t size);
+int bp_map_slice (struct adios_bp_buffer_struct_v1 * b, char * base, uint64_t size,
+                  uint64_t offset, uint64_t length);
+int bp_copy_mapped_slice (void * buf, char * base, uint64_t size,
+                          uint64_t offset, uint64_t length);
+int bp_map_sieved_slice (BP_FILE * fh, uint32_t file_index,
+                         uint64_t offset, uint64_t length);
+int bp_copy_sieved_slice (BP_FILE * fh, void * buf, uint32_t file_index,
+                          uint64_t offset, uint64_t length);
+void bp_free_sieve (BP_FILE * fh);
 int bp_get_endianness( uint32_t change_endianness );
 int adios_step_to_time (const ADIOS_FILE * fp, int varid, int from_steps);
 int adios_step_to_time_v1 (const ADIOS_FILE * fp, struct adios_index_var_struct_v1 * v, int from_steps);
@@ -33,18 +44,25 @@ int bp_get_characteristics_data (void ** ptr_data,
 int bp_read_close (struct adios_bp_buffer_struct_v1 * b);
 
 MPI_File * get_BP_subfile_handle(BP_FILE *fh, uint32_t file_index);
+struct BP_file_handle * get_BP_subfile (BP_FILE *fh, uint32_t file_index);
 void add_BP_subfile_handle (struct BP_FILE *fh, struct BP_file_handle * n);
 void close_all_BP_subfiles (BP_FILE * fh);
 int get_time (struct adios_index_var_struct_v1 * v, int step);
 int bp_open (const char * fname,
              MPI_Comm comm,
              BP_FILE * fh);
+int bp_refresh (BP_FILE * fh);
+int bp_watch_file (const char * fname);
+int bp_wait_for_change (int fd, const char * fname, int msec);
+void bp_unwatch_file (int fd);
 ADIOS_VARINFO * bp_inq_var_byid (const ADIOS_FILE * fp, int varid);
 int bp_close (BP_FILE * fh);
 int bp_read_minifooter (BP_FILE * bp_struct);
 int bp_parse_pgs (BP_FILE * fh);
 int bp_parse_attrs (BP_FILE * fh);
 int bp_parse_vars (BP_FILE * fh);
+void bp_build_vars_namelist (BP_FILE * fh);
+void bp_load_var (BP_FILE * fh, struct adios_index_var_struct_v1 * v);
 int bp_seek_to_step (ADIOS_FILE * fp, int tostep, int show_hidden_attrs);
 int64_t get_var_start_index (struct adios_index_var_struct_v1 * v, int t);
 int64_t get_var_stop_index (struct adios_index_var_struct_v1 * v, int t);
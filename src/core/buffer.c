@@ -8,25 +8,38 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <inttypes.h>
 #include <unistd.h>   /* _SC_PAGE_SIZE, _SC_AVPHYS_PAGES */
 #include <limits.h>   /* ULLONG_MAX */
 #include <assert.h>
+#include <pthread.h>
+#include <sys/mman.h>
 
 #if defined(__APPLE__)
 #    include <mach/mach.h>
 #endif
 
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#    define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef MAP_NORESERVE
+#    define MAP_NORESERVE 0
+#endif
+
 #include "core/buffer.h"
 #include "core/adios_logger.h"
 #include "public/adios_error.h"
 
-#define BYTE_ALIGN 8
-
 /* Data buffer in adios_open() will be allocated with this default size
    if no better size information is available */
 #define DATABUFFER_DEFAULT_SIZE 16777216L
 
+/* Number of unused buffers kept in the pool between output steps. 
+   Two allows for filling one buffer while the other one is written out
+   by a method in the background (e.g. POSIX with async=1) */
+#define DATABUFFER_POOL_SIZE 2
+
 // max buffer size per file opened
 static uint64_t max_size = 
 #ifdef UULONG_MAX
@@ -35,11 +48,151 @@ static uint64_t max_size =
     18446744073709551615ULL; 
 #endif
 
+/* Buffers are mmap'ed, page aligned memory regions, which are kept in a pool 
+   after adios_close() and reused in the next adios_open(). 
+   The pages are touched only once in a run, not in every output step.
+   The mapped length of a buffer is always its size rounded up to the page size.
+*/
+struct databuffer_pool_entry
+{
+    void * ptr;
+    uint64_t size; // length of mapping
+};
+
+static struct databuffer_pool_entry pool [DATABUFFER_POOL_SIZE];
+static int pool_count = 0;
+// buffers are returned to the pool by background writer threads too
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t databuffer_pagesize (void)
+{
+    static uint64_t pagesize = 0;
+    if (!pagesize)
+        pagesize = (uint64_t) sysconf (_SC_PAGE_SIZE);
+    return pagesize;
+}
+
+static uint64_t databuffer_mapsize (uint64_t size)
+{
+    uint64_t ps = databuffer_pagesize();
+    if (size == 0)
+        size = 1;
+    return (size + ps - 1) & ~(ps - 1);
+}
+
+static void * databuffer_map (uint64_t size)
+{
+    // zero-copy holes are never touched, don't reserve swap space for them
+    void * b = mmap (NULL, size, PROT_READ | PROT_WRITE, 
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (b == MAP_FAILED)
+        return NULL;
+#ifdef MADV_HUGEPAGE
+    // fewer page faults and TLB misses on multi-GB buffers
+    madvise (b, size, MADV_HUGEPAGE);
+#endif
+    return b;
+}
+
+/* Grow (or shrink) a mapping. On Linux, mremap() moves the pages without 
+   copying the content, so extending the buffer costs no memcpy. */
+static void * databuffer_remap (void * old, uint64_t oldsize, uint64_t newsize)
+{
+    if (!old)
+        return databuffer_map (newsize);
+    if (newsize == oldsize)
+        return old;
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+    void * b = mremap (old, oldsize, newsize, MREMAP_MAYMOVE);
+    if (b == MAP_FAILED)
+        return NULL;
+    return b;
+#else
+    if (newsize < oldsize)
+    {
+        munmap ((char*)old + newsize, oldsize - newsize);
+        return old;
+    }
+    void * b = databuffer_map (newsize);
+    if (b)
+    {
+        memcpy (b, old, oldsize);
+        munmap (old, oldsize);
+    }
+    return b;
+#endif
+}
+
+/* Get the largest buffer from the pool or NULL if the pool is empty */
+static void * databuffer_pool_get (uint64_t * size)
+{
+    void * b = NULL;
+    int i, k = -1;
+    pthread_mutex_lock (&pool_mutex);
+    for (i = 0; i < pool_count; i++)
+    {
+        if (k == -1 || pool[i].size > pool[k].size)
+            k = i;
+    }
+    if (k >= 0)
+    {
+        b = pool[k].ptr;
+        *size = pool[k].size;
+        pool[k] = pool[pool_count-1];
+        pool_count--;
+    }
+    pthread_mutex_unlock (&pool_mutex);
+    return b;
+}
+
+/* Put a buffer back into the pool. If the pool is full, the smallest buffer is unmapped */
+static void databuffer_pool_put (void * b, uint64_t size)
+{
+    int i, k = -1;
+    pthread_mutex_lock (&pool_mutex);
+    if (pool_count < DATABUFFER_POOL_SIZE)
+    {
+        pool[pool_count].ptr = b;
+        pool[pool_count].size = size;
+        pool_count++;
+        b = NULL;
+    }
+    else
+    {
+        for (i = 0; i < pool_count; i++)
+        {
+            if (k == -1 || pool[i].size < pool[k].size)
+                k = i;
+        }
+        if (pool[k].size < size)
+        {
+            void * t = pool[k].ptr;
+            uint64_t ts = pool[k].size;
+            pool[k].ptr = b;
+            pool[k].size = size;
+            b = t;
+            size = ts;
+        }
+    }
+    pthread_mutex_unlock (&pool_mutex);
+    if (b)
+        munmap (b, size);
+}
+
 void adios_databuffer_set_max_size (uint64_t v)  { max_size = v; }
 
+/* The holes of zero-copy payloads do not count against the max size */
+static uint64_t databuffer_max_size (struct adios_file_struct *fd)
+{
+    if (max_size + fd->zero_copy_size < max_size)
+        return max_size; // max_size is "unlimited"
+    return max_size + fd->zero_copy_size;
+}
+
 uint64_t adios_databuffer_get_extension_size (struct adios_file_struct *fd)
 {
     uint64_t size = DATABUFFER_DEFAULT_SIZE;
+    uint64_t max_size = databuffer_max_size (fd);
     if (size > max_size - fd->buffer_size)
     {
         if (fd->buffer_size <= max_size)
@@ -55,27 +208,75 @@ uint64_t adios_databuffer_get_extension_size (struct adios_file_struct *fd)
     return size;
 }
 
+/* Set fd's buffer to (at least) 'size' bytes, from the pool, or by growing the existing one */
+static int databuffer_set_size (struct adios_file_struct *fd, uint64_t size)
+{
+    uint64_t mapsize = databuffer_mapsize (size);
+    uint64_t max_size = databuffer_max_size (fd);
+    void * b;
+
+    if (size <= fd->buffer_size)
+        return 0;
+
+    if (fd->allocated_bufptr)
+    {
+        uint64_t cursize = databuffer_mapsize (fd->buffer_size);
+        if (mapsize <= cursize)
+        {
+            // the mapping is already big enough
+            fd->buffer_size = (cursize <= max_size ? cursize : size);
+            return 0;
+        }
+        b = databuffer_remap (fd->allocated_bufptr, cursize, mapsize);
+    }
+    else
+    {
+        uint64_t poolsize = 0;
+        b = databuffer_pool_get (&poolsize);
+        if (b && poolsize > mapsize && poolsize <= max_size)
+        {
+            // use the whole (bigger) buffer from the pool
+            mapsize = poolsize;
+            size = poolsize;
+        }
+        else if (b)
+        {
+            void * nb = databuffer_remap (b, poolsize, mapsize);
+            if (!nb)
+            {
+                // the old mapping is still valid, keep it for later
+                databuffer_pool_put (b, poolsize);
+            }
+            b = nb;
+        }
+        else
+        {
+            b = databuffer_map (mapsize);
+        }
+    }
+
+    if (!b)
+        return 1;
+
+    fd->allocated_bufptr = b;
+    fd->buffer = (char *) b;
+    log_debug ("Data buffer extended from %" PRIu64 " to %" PRIu64 " bytes\n", fd->buffer_size, size);
+    // use the page padding too if allowed
+    fd->buffer_size = (mapsize <= max_size ? mapsize : size);
+    return 0;
+}
+
 int adios_databuffer_resize (struct adios_file_struct *fd, uint64_t size)
 {
     /* This function works as malloc if fd->allocated_bufptr is NULL, so
        there is no need for a separate first-allocation function */
     int retval = 0;
+    uint64_t max_size = databuffer_max_size (fd);
 
     if (size <= max_size) 
     {
-        // try to alloc/realloc a buffer to requested size
-        // align usable buffer to BYTE_ALIGN bytes
-        void * b = realloc (fd->allocated_bufptr, size +  BYTE_ALIGN - 1);
-        if (b)
-        {
-            fd->allocated_bufptr = b;
-            uint64_t p = (uint64_t) fd->allocated_bufptr;
-            fd->buffer = (char *) ((p + BYTE_ALIGN - 1) & ~(BYTE_ALIGN - 1));
-            log_debug ("Data buffer extended from %" PRIu64 " to %" PRIu64 " bytes\n", fd->buffer_size, size);
-            fd->buffer_size = size;
-
-        }
-        else
+        // try to get a buffer of requested size
+        if (databuffer_set_size (fd, size))
         {
             retval = 1;
             log_warn ("Cannot allocate %" PRIu64 " bytes for buffered output of group %s. "
@@ -86,18 +287,8 @@ int adios_databuffer_resize (struct adios_file_struct *fd, uint64_t size)
     else
     {
         retval = 1;
-        // try to alloc/realloc a buffer to max allowed size
-        // align usable buffer to BYTE_ALIGN bytes
-        void * b = realloc (fd->allocated_bufptr, max_size +  BYTE_ALIGN - 1);
-        if (b)
-        {
-            fd->allocated_bufptr = b;
-            uint64_t p = (uint64_t) fd->allocated_bufptr;
-            fd->buffer = (char *) ((p + BYTE_ALIGN - 1) & ~(BYTE_ALIGN - 1));
-            log_debug ("Data buffer extended from %" PRIu64 " to %" PRIu64 " bytes\n", fd->buffer_size, size);
-            fd->buffer_size = max_size;
-
-        }
+        // try to get a buffer of max allowed size
+        databuffer_set_size (fd, max_size);
         log_warn ("Cannot allocate %" PRIu64 " bytes for buffered output of group %s "
                 " because max allowed is %" PRIu64 " bytes. "
                 "Continue buffering with buffer size %" PRIu64 " MB\n",
@@ -110,12 +301,124 @@ int adios_databuffer_resize (struct adios_file_struct *fd, uint64_t size)
 void adios_databuffer_free (struct adios_file_struct *fd)
 {
     if (fd->allocated_bufptr)
-        free (fd->allocated_bufptr);
+        databuffer_pool_put (fd->allocated_bufptr, databuffer_mapsize (fd->buffer_size));
     fd->allocated_bufptr = 0;
     fd->buffer = 0;
     fd->buffer_size = 0;
     fd->offset = 0;
     fd->bytes_written = 0;
+    adios_databuffer_clear_zero_copy (fd);
+}
+
+void * adios_databuffer_detach (struct adios_file_struct *fd, char ** buffer, uint64_t * size)
+{
+    void * b = fd->allocated_bufptr;
+    *buffer = fd->buffer;
+    *size = fd->buffer_size;
+    fd->allocated_bufptr = 0;
+    fd->buffer = 0;
+    fd->buffer_size = 0;
+    return b;
+}
+
+void adios_databuffer_release (void * allocated_bufptr, uint64_t size)
+{
+    if (allocated_bufptr)
+        databuffer_pool_put (allocated_bufptr, databuffer_mapsize (size));
+}
+
+void adios_databuffer_pool_free (void)
+{
+    void * b;
+    uint64_t size;
+    while ((b = databuffer_pool_get (&size)))
+        munmap (b, size);
+}
+
+int adios_databuffer_add_zero_copy (struct adios_file_struct *fd, const void * data, uint64_t size)
+{
+    struct adios_zero_copy_struct * z;
+
+    if (fd->offset + size > fd->buffer_size)
+        return 1;
+
+    if (fd->zero_copy_last && 
+        fd->zero_copy_last->offset + fd->zero_copy_last->size == fd->offset &&
+        (const char *) fd->zero_copy_last->data + fd->zero_copy_last->size == (const char *) data)
+    {
+        // continuation of the previous hole (e.g. consecutive blocks of the same array)
+        fd->zero_copy_last->size += size;
+    }
+    else
+    {
+        z = (struct adios_zero_copy_struct *) malloc (sizeof (struct adios_zero_copy_struct));
+        if (!z)
+            return 1;
+        z->offset = fd->offset;
+        z->size = size;
+        z->data = data;
+        z->next = NULL;
+        if (fd->zero_copy_last)
+            fd->zero_copy_last->next = z;
+        else
+            fd->zero_copy = z;
+        fd->zero_copy_last = z;
+    }
+
+    fd->zero_copy_size += size;
+    fd->offset += size;
+    if (fd->bytes_written < fd->offset)
+        fd->bytes_written = fd->offset;
+    return 0;
+}
+
+void adios_databuffer_clear_zero_copy (struct adios_file_struct *fd)
+{
+    struct adios_zero_copy_struct * z;
+    while (fd->zero_copy)
+    {
+        z = fd->zero_copy->next;
+        free (fd->zero_copy);
+        fd->zero_copy = z;
+    }
+    fd->zero_copy_last = NULL;
+    fd->zero_copy_size = 0;
+}
+
+int adios_databuffer_get_iovec (struct adios_file_struct *fd, struct iovec ** iov)
+{
+    struct adios_zero_copy_struct * z;
+    uint64_t pos = 0;
+    int n = 1;
+
+    for (z = fd->zero_copy; z; z = z->next)
+        n += 2;
+
+    *iov = (struct iovec *) malloc (n * sizeof (struct iovec));
+    if (!*iov)
+        return -1;
+
+    n = 0;
+    for (z = fd->zero_copy; z && z->offset < fd->bytes_written; z = z->next)
+    {
+        if (z->offset > pos)
+        {
+            (*iov)[n].iov_base = fd->buffer + pos;
+            (*iov)[n].iov_len = z->offset - pos;
+            n++;
+        }
+        (*iov)[n].iov_base = (void *) z->data;
+        (*iov)[n].iov_len = z->size;
+        n++;
+        pos = z->offset + z->size;
+    }
+    if (pos < fd->bytes_written)
+    {
+        (*iov)[n].iov_base = fd->buffer + pos;
+        (*iov)[n].iov_len = fd->bytes_written - pos;
+        n++;
+    }
+    return n;
 }
 
 
@@ -8,6 +8,7 @@
 #ifndef ADIOS_BUFFER_H
 #define ADIOS_BUFFER_H
 
+#include <sys/uio.h>   /* struct iovec */
 #include "public/adios_types.h"
 #include "core/adios_internals.h"
 
@@ -24,10 +25,42 @@ uint64_t adios_databuffer_get_extension_size (struct adios_file_struct *fd);
 
 /* Resize (or create) the buffer to 'size' if size is less than maximum. 
    It does NOT resize the buffer up to the maximum if size is greater than the maximum
+   A new buffer is taken from the buffer pool if available. The buffer may become
+   larger than 'size' (rounded up to page size or the size of the pooled buffer).
 */
 int adios_databuffer_resize (struct adios_file_struct *fd, uint64_t size);
+/* Give the buffer back to the buffer pool to be reused in the next adios_open() */
 void adios_databuffer_free (struct adios_file_struct *fd);
 
+/* Take the buffer away from the file struct, e.g. to let a method write it out in the background.
+   The returned pointer must be given back with adios_databuffer_release() later, 
+   *buffer is set to the start of the data within it and *size to its size.
+   fd is left without a buffer but fd->offset and fd->bytes_written are kept.
+*/
+void * adios_databuffer_detach (struct adios_file_struct *fd, char ** buffer, uint64_t * size);
+
+/* Return a detached buffer to the buffer pool. Thread-safe. */
+void adios_databuffer_release (void * allocated_bufptr, uint64_t size);
+
+/* Unmap all buffers kept in the pool (in adios_finalize) */
+void adios_databuffer_pool_free (void);
+
+/* Zero-copy buffering: record 'size' bytes of 'data' at fd->offset instead of copying 
+   them into the buffer. The hole left in the buffer is never touched so it costs no memory,
+   and it does not count against the maximum buffer size.
+   fd->offset and fd->bytes_written are advanced as if the data was copied.
+*/
+int adios_databuffer_add_zero_copy (struct adios_file_struct *fd, const void * data, uint64_t size);
+
+/* Forget the recorded holes, after the buffer has been written out or is reset */
+void adios_databuffer_clear_zero_copy (struct adios_file_struct *fd);
+
+/* Describe fd->buffer[0..fd->bytes_written) as a list of memory segments, 
+   where the holes are replaced by the user's data. *iov is allocated here and 
+   has to be freed by the caller. Returns the number of segments, or -1 on error.
+*/
+int adios_databuffer_get_iovec (struct adios_file_struct *fd, struct iovec ** iov);
+
 
 
 /*
@@ -106,6 +106,9 @@ int common_adios_finalize(int mype) {
     }
   }
 
+  // methods are done with their buffers now
+  adios_databuffer_pool_free();
+
   adios_cleanup();
 
 #if defined(WITH_NCSU_TIMER) && defined(TIMER_LEVEL) && (TIMER_LEVEL <= 0)
@@ -373,6 +376,17 @@ int common_adios_open(int64_t *fd_p, const char *group_name, const char *name,
       }
     }
 
+    if (fd->zero_copy_min_size &&
+        (g->methods->next || TimeAggregated(g) || fd->bufstrat == no_buffering)) {
+      /* Holes in the buffer can only be filled by the method that asked for them,
+         and user data is not available after adios_close() */
+      log_warn(
+          "Zero-copy buffering is turned off for group %s. It requires a "
+          "single method and no time aggregation\n",
+          g->name);
+      fd->zero_copy_min_size = 0;
+    }
+
     if (fd->bufstrat != no_buffering) {
       /* Allocate BP buffer with remembered size or max size or default size */
       uint64_t expected_bufsize;
@@ -610,6 +624,27 @@ static int common_adios_write_transform_helper(struct adios_file_struct *fd,
   return 1;
 }
 
+/* Return the payload size of v if it should not be copied into the buffer
+   (zero-copy buffering), 0 otherwise */
+static uint64_t common_adios_zero_copy_size(struct adios_file_struct *fd,
+                                            struct adios_var_struct *v) {
+  uint64_t size;
+  if (!fd->zero_copy_min_size || v->transform_type != adios_transform_none ||
+      !v->dimensions)
+    return 0;
+  size = adios_get_var_size(v, v->data);
+  return (size >= fd->zero_copy_min_size ? size : 0);
+}
+
+static void common_adios_write_payload(struct adios_file_struct *fd,
+                                       struct adios_var_struct *v,
+                                       uint64_t zero_copy_size) {
+  if (zero_copy_size &&
+      !adios_databuffer_add_zero_copy(fd, v->data, zero_copy_size))
+    return;
+  adios_write_var_payload_v1(fd, v);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /* common_adios_write is just a partial implementation. It expects filled out
  * structures. This is because C and Fortran implementations of adios_write are
@@ -625,10 +660,15 @@ int common_adios_write(struct adios_file_struct *fd, struct adios_var_struct *v,
   struct adios_method_list_struct *m = fd->group->methods;
 
   // First, before doing any transformation, compute variable statistics,
-  // as we can't do this after the data is transformed
-  adios_generate_var_characteristics_v1(fd, v);
+  // as we can't do this after the data is transformed.
+  // Large arrays may be processed in the background while the payload is
+  // copied into the buffer; stats_job must be waited for before the header
+  // is written.
+  struct adios_stat_job *stats_job =
+      adios_generate_var_characteristics_start_v1(fd, v);
 
   uint64_t vsize = 0;
+  uint64_t zcsize = common_adios_zero_copy_size(fd, v);
   if (fd->bufstate == buffering_ongoing) {
     // Second, estimate the size needed for buffering and extend buffer when
     // needed
@@ -643,8 +683,21 @@ int common_adios_write(struct adios_file_struct *fd, struct adios_var_struct *v,
       /* Trouble: this variable does not fit into the current buffer */
       // First, try to realloc the buffer
       uint64_t extrasize = adios_databuffer_get_extension_size(fd);
+      uint64_t newsize;
+      int resize_failed;
       if (extrasize < vsize) extrasize = vsize;
-      if (adios_databuffer_resize(fd, fd->buffer_size + extrasize)) {
+      newsize = fd->buffer_size + extrasize;
+      // a zero-copy payload leaves a hole in the buffer that does not count
+      // against the max buffer size, ask only for what is needed
+      if (zcsize) newsize = fd->offset + vsize;
+      fd->zero_copy_size += zcsize;
+      resize_failed = adios_databuffer_resize(fd, newsize);
+      fd->zero_copy_size -= zcsize;
+      if (resize_failed) {
+        // the method may build the index from the statistics
+        adios_generate_var_characteristics_wait_v1(stats_job);
+        stats_job = NULL;
+
         /* Second, let the method deal with it */
         log_debug(
             "adios_write(): buffer needs to be dumped before buffering "
@@ -673,12 +726,17 @@ int common_adios_write(struct adios_file_struct *fd, struct adios_var_struct *v,
         }
 
         if (fd->bufstrat == continue_with_new_pg) {
+          // the method has written out the holes too
+          adios_databuffer_clear_zero_copy(fd);
           // special case: fd->buffer_size is smaller than this single variable,
           // and the extension failed:
           // try to extend it to contain this single variable (plus headers) in
           // the next PG
           if (fd->buffer_size < vsize + 1024) {
-            if (adios_databuffer_resize(fd, vsize + 1024)) {
+            fd->zero_copy_size += zcsize;
+            resize_failed = adios_databuffer_resize(fd, vsize + 1024);
+            fd->zero_copy_size -= zcsize;
+            if (resize_failed) {
               adios_error(
                   err_no_memory,
                   "adios_write(): buffer cannot accommodate variable %s/%s "
@@ -717,15 +775,38 @@ int common_adios_write(struct adios_file_struct *fd, struct adios_var_struct *v,
     if (fd->bufstate == buffering_ongoing) {
       /* Now buffer only if we have the buffer for it */
       if (fd->buffer_size > fd->offset + vsize) {
-        // var payload sent for sizing information
-        adios_write_var_header_v1(fd, v);
+        if (stats_job) {
+          // Copy the payload behind the space reserved for the header while
+          // the statistics are calculated, then write the header.
+          // The header size does not depend on the values of the statistics.
+          uint16_t header_size = adios_calc_var_overhead_v1(v);
+          uint64_t header_offset = fd->offset;
+          uint64_t end_offset;
+
+          fd->offset += header_size;
+          common_adios_write_payload(fd, v, zcsize);
+          end_offset = fd->offset;
+
+          adios_generate_var_characteristics_wait_v1(stats_job);
+          stats_job = NULL;
+
+          fd->offset = header_offset;
+          adios_write_var_header_v1(fd, v);
+          assert(fd->offset == header_offset + header_size);
+          fd->offset = end_offset;
+        } else {
+          // var payload sent for sizing information
+          adios_write_var_header_v1(fd, v);
 
-        // write payload
-        adios_write_var_payload_v1(fd, v);
+          // write payload
+          common_adios_write_payload(fd, v, zcsize);
+        }
       }
     }
   } else  // Else, do a transform
   {
+    adios_generate_var_characteristics_wait_v1(stats_job);
+    stats_job = NULL;
 #if defined(WITH_NCSU_TIMER) && defined(TIMER_LEVEL) && (TIMER_LEVEL <= 0)
     timer_start("adios_transform");
 #endif
@@ -747,6 +828,9 @@ int common_adios_write(struct adios_file_struct *fd, struct adios_var_struct *v,
 #endif
   }
 
+  // statistics were not needed for buffering the variable
+  adios_generate_var_characteristics_wait_v1(stats_job);
+
   // now tell each transport attached that it is being written unless buffering
   // is stopped
   if (fd->bufstate == buffering_ongoing || fd->bufstrat == no_buffering) {
@@ -1396,9 +1480,10 @@ int common_adios_close(struct adios_file_struct *fd) {
     // allocation in the next cycle.
     // This only works for non-time-aggregation. In time aggregation,
     // bytes_written is the current size of all buffered steps
+    // Zero-copy holes need no memory, the buffer can grow cheaply for them.
     if (NotTimeAggregated(fd->group)) {
-      if (fd->group->max_pg_size < fd->bytes_written) {
-        fd->group->max_pg_size = fd->bytes_written;
+      if (fd->group->max_pg_size < fd->bytes_written - fd->zero_copy_size) {
+        fd->group->max_pg_size = fd->bytes_written - fd->zero_copy_size;
       }
     }
     if (NotTimeAggregated(fd->group) || TimeAggregationLastStep(fd->group)) {
@@ -11,6 +11,7 @@
 #include <errno.h>
 #include <assert.h>
 #include <inttypes.h>
+#include <fnmatch.h>  // shell pattern matching
 #include "public/adios_error.h"
 #include "core/adios_logger.h"
 #include "core/common_read.h"
@@ -59,6 +60,8 @@ struct common_read_internals_struct {
     uint32_t    full_nattrs;         /* fp->nvars to save here for a group view */
     char     ** full_attrnamelist;   /* fp->attr_namelist to save here if one group is viewed */
     qhashtbl_t *hashtbl_vars;    /* speed up search for var_namelist to varid  */
+    struct var_index_entry * var_index; /* variables sorted by name for prefix and pattern search */
+    int         var_index_size;
 
     // NCSU ALACRITY-ADIOS - Table of sub-requests issued by transform method
     adios_transform_read_request *transform_reqgroups;
@@ -71,6 +74,7 @@ struct common_read_internals_struct {
 };
 
 // NCSU ALACRITY-ADIOS - Forward declaration/function prototypes
+static void free_var_index (struct common_read_internals_struct * internals);
 static void common_read_free_blockinfo(ADIOS_VARBLOCK **varblock, int sum_nblocks);
 
 
@@ -81,6 +85,7 @@ int common_read_init_method (enum ADIOS_READ_METHOD method,
 {
     PairStruct *params, *p, *prev_p;
     int verbose_level, removeit, save;
+    long nthreads;
     int retval;
     char *end;
 
@@ -136,6 +141,19 @@ int common_read_init_method (enum ADIOS_READ_METHOD method,
             }
             removeit = 1;
         }
+        else if (!strcasecmp (p->name, "transform_threads"))
+        {
+            if (p->value) {
+                errno = 0;
+                nthreads = strtol(p->value, &end, 10);
+                if (errno || (end != 0 && *end != '\0') || nthreads < 0) {
+                    log_error ("Invalid 'transform_threads' parameter passed to read init function: '%s'\n", p->value);
+                } else {
+                    adios_transform_set_read_threads (nthreads);
+                }
+            }
+            removeit = 1;
+        }
         else if (!strcasecmp (p->name, "abort_on_error"))
         {
             adios_abort_on_error = 1;
@@ -583,6 +601,7 @@ int common_read_close (ADIOS_FILE *fp)
 
         if (internals->hashtbl_vars)
             internals->hashtbl_vars->free (internals->hashtbl_vars);
+        free_var_index (internals);
 
         free (internals);
     } else {
@@ -663,6 +682,7 @@ int common_read_advance_step (ADIOS_FILE *fp, int last, float timeout_sec)
                 // Re-create hashtable from the variable names as key and their index as value
                 if (internals->hashtbl_vars)
                     internals->hashtbl_vars->free (internals->hashtbl_vars);
+                free_var_index (internals);
                 hashsize = calc_hash_size(fp->nvars);
                 internals->hashtbl_vars = qhashtbl(hashsize);
                 for (i=0; i<fp->nvars; i++) {
@@ -759,6 +779,259 @@ static int common_read_find_var (const ADIOS_FILE *fp, const char *name, int qui
     return varid;
 }
 
+/* The name index lists all variables sorted by name, without a leading '/',
+   so that all names with a given prefix are found with a binary search.
+   It is built at the first pattern search and dropped when the list of
+   variables changes.
+*/
+struct var_index_entry {
+    const char * key;   /* variable name without leading '/' */
+    int varid;          /* id in the full list of variables */
+};
+
+static int cmp_var_index_entry (const void * a, const void * b)
+{
+    return strcmp (((const struct var_index_entry *) a)->key,
+                   ((const struct var_index_entry *) b)->key);
+}
+
+static void free_var_index (struct common_read_internals_struct * internals)
+{
+    free (internals->var_index);
+    internals->var_index = NULL;
+    internals->var_index_size = 0;
+}
+
+static struct var_index_entry * get_var_index (const ADIOS_FILE * fp)
+{
+    struct common_read_internals_struct * internals =
+        (struct common_read_internals_struct *) fp->internal_data;
+    char ** names = fp->var_namelist;
+    int i, n = fp->nvars;
+
+    if (internals->var_index || !n)
+        return internals->var_index;
+
+    if (internals->group_in_view > -1) {
+        names = internals->full_varnamelist;
+        n = internals->full_nvars;
+    }
+
+    internals->var_index = (struct var_index_entry *) malloc (n * sizeof (struct var_index_entry));
+    if (!internals->var_index) {
+        adios_error (err_no_memory, "Could not allocate memory for the index of variable names\n");
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        internals->var_index[i].key = (names[i][0] == '/' ? names[i] + 1 : names[i]);
+        internals->var_index[i].varid = i;
+    }
+    qsort (internals->var_index, n, sizeof (struct var_index_entry), cmp_var_index_entry);
+    internals->var_index_size = n;
+    log_debug ("Built the index of %d variable names\n", n);
+    return internals->var_index;
+}
+
+/* First entry of the index that is not smaller than key */
+static int var_index_lower_bound (const struct var_index_entry * index, int n, const char * key)
+{
+    int lo = 0, hi = n, mid;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (strcmp (index[mid].key, key) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* varid in the current group view, -1 if the variable is not in the view */
+static int var_index_viewed_id (const ADIOS_FILE * fp, int varid)
+{
+    struct common_read_internals_struct * internals =
+        (struct common_read_internals_struct *) fp->internal_data;
+    varid -= internals->group_varid_offset;
+    return (varid >= 0 && varid < fp->nvars ? varid : -1);
+}
+
+/* Search the variables with a name starting with 'prefix' or, if 'pattern' is set,
+   matching the shell pattern 'prefix'. A pattern is narrowed down to the names
+   starting with its characters before the first wildcard.
+*/
+static int common_read_find_vars (const ADIOS_FILE * fp, const char * prefix, int pattern, int ** varids)
+{
+    const struct var_index_entry * index;
+    struct common_read_internals_struct * internals;
+    char * lit;
+    int n, i, lo, hi, id, nfound = 0;
+    size_t len;
+
+    adios_errno = err_no_error;
+    if (varids)
+        *varids = NULL;
+    if (!fp) {
+        adios_error (err_invalid_file_pointer, "Null pointer passed as file to variable search\n");
+        return -1;
+    }
+    if (!prefix || !varids) {
+        adios_error (err_invalid_argument, "Null pointer passed as %s to variable search\n",
+                     (prefix ? "result" : (pattern ? "pattern" : "prefix")));
+        return -1;
+    }
+
+    internals = (struct common_read_internals_struct *) fp->internal_data;
+    index = get_var_index (fp);
+    if (!index)
+        return (fp->nvars ? -1 : 0);
+    n = internals->var_index_size;
+
+    if (prefix[0] == '/')
+        prefix++;
+    len = (pattern ? strcspn (prefix, "*?[\\") : strlen (prefix));
+    lit = strndup (prefix, len);
+    if (!lit) {
+        adios_error (err_no_memory, "Could not allocate memory for variable search\n");
+        return -1;
+    }
+
+    // the names starting with the literal part are in [lo, hi)
+    lo = var_index_lower_bound (index, n, lit);
+    for (hi = lo; hi < n && !strncmp (index[hi].key, lit, len); hi++)
+        ;
+    free (lit);
+    if (hi == lo)
+        return 0;
+
+    *varids = (int *) malloc ((hi - lo) * sizeof (int));
+    if (!*varids) {
+        adios_error (err_no_memory, "Could not allocate memory for variable search\n");
+        return -1;
+    }
+
+    for (i = lo; i < hi; i++)
+    {
+        if (pattern && fnmatch (prefix, index[i].key, FNM_PATHNAME))
+            continue;
+        id = var_index_viewed_id (fp, index[i].varid);
+        if (id >= 0)
+            (*varids)[nfound++] = id;
+    }
+
+    if (!nfound) {
+        free (*varids);
+        *varids = NULL;
+    }
+    return nfound;
+}
+
+int common_read_find_vars_by_prefix (const ADIOS_FILE * fp, const char * prefix, int ** varids)
+{
+    return common_read_find_vars (fp, prefix, 0, varids);
+}
+
+int common_read_find_vars_by_pattern (const ADIOS_FILE * fp, const char * pattern, int ** varids)
+{
+    return common_read_find_vars (fp, pattern, 1, varids);
+}
+
+int common_read_list_var_path (const ADIOS_FILE * fp, const char * path, char *** names)
+{
+    const struct var_index_entry * index;
+    struct common_read_internals_struct * internals;
+    char * dir, * skip;
+    const char * child, * slash;
+    int n, i, j, k, nfound = 0;
+    size_t len;
+
+    adios_errno = err_no_error;
+    if (names)
+        *names = NULL;
+    if (!fp) {
+        adios_error (err_invalid_file_pointer, "Null pointer passed as file to adios_inq_var_path()\n");
+        return -1;
+    }
+    if (!path || !names) {
+        adios_error (err_invalid_argument, "Null pointer passed as %s to adios_inq_var_path()\n",
+                     (path ? "result" : "path"));
+        return -1;
+    }
+
+    internals = (struct common_read_internals_struct *) fp->internal_data;
+    index = get_var_index (fp);
+    if (!index)
+        return (fp->nvars ? -1 : 0);
+    n = internals->var_index_size;
+
+    // "dir/" is the prefix of the entries under the path, "" at the root
+    while (path[0] == '/')
+        path++;
+    len = strlen (path);
+    while (len > 0 && path[len-1] == '/')
+        len--;
+    dir = (char *) malloc (len + 2);
+    *names = (char **) malloc (n * sizeof (char *));
+    if (!dir || !*names) {
+        free (dir);
+        free (*names);
+        *names = NULL;
+        adios_error (err_no_memory, "Could not allocate memory for adios_inq_var_path()\n");
+        return -1;
+    }
+    memcpy (dir, path, len);
+    if (len)
+        dir[len++] = '/';
+    dir[len] = '\0';
+
+    i = var_index_lower_bound (index, n, dir);
+    while (i < n && !strncmp (index[i].key, dir, len))
+    {
+        child = index[i].key + len;
+        slash = strchr (child, '/');
+        if (!slash) {
+            // a variable right under the path
+            if (var_index_viewed_id (fp, index[i].varid) >= 0)
+                (*names)[nfound++] = strdup (child);
+            i++;
+            continue;
+        }
+
+        // a subdirectory: all its names follow "child/" and precede "child0" ('0' is '/'+1)
+        k = (int) (slash - index[i].key);
+        skip = (char *) malloc (k + 2);
+        if (!skip)
+            break;
+        memcpy (skip, index[i].key, k);
+        skip[k] = '/' + 1;
+        skip[k+1] = '\0';
+        j = var_index_lower_bound (index + i, n - i, skip) + i;
+        free (skip);
+
+        if (internals->group_in_view > -1) {
+            // list it only if the view has a variable in it
+            for (k = i; k < j && var_index_viewed_id (fp, index[k].varid) < 0; k++)
+                ;
+            if (k == j) {
+                i = j;
+                continue;
+            }
+        }
+
+        (*names)[nfound] = (char *) malloc (slash - child + 2);
+        memcpy ((*names)[nfound], child, slash - child + 1);
+        (*names)[nfound][slash - child + 1] = '\0';
+        nfound++;
+        i = j;
+    }
+    free (dir);
+
+    if (!nfound) {
+        free (*names);
+        *names = NULL;
+    }
+    return nfound;
+}
+
 static int common_read_find_attr (int n, char ** namelist, const char *name, int quiet)
 {
     /** Find a string name in a list of names and return the index.
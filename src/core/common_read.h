@@ -108,6 +108,11 @@ int common_read_type_size(enum ADIOS_DATATYPES type, const void *data);
 int common_read_get_grouplist (const ADIOS_FILE  *fp, char ***group_namelist);
 int common_read_group_view (ADIOS_FILE  *fp, int groupid);
 
+/* search variables by name in the sorted name index, see adios_read_ext.h */
+int common_read_find_vars_by_prefix (const ADIOS_FILE *fp, const char *prefix, int **varids);
+int common_read_find_vars_by_pattern (const ADIOS_FILE *fp, const char *pattern, int **varids);
+int common_read_list_var_path (const ADIOS_FILE *fp, const char *path, char ***names);
+
 /* internal function to support version 1 time-dimension reads
    called from adios_read_v1.c and adiosf_read_v1.c 
 */
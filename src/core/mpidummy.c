@@ -151,6 +151,20 @@ int MPI_Scatterv( void *sendbuf, int *sendcnts, int *displs,
   return ier ;
 }
 
+int MPI_Send(void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm)
+{
+  // there is no other process to send to
+  snprintf(mpierrmsg, MPI_MAX_ERROR_STRING, "could not send data\n" );
+  return MPI_ERR_COMM ;
+}
+
+int MPI_Recv(void *buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Status *status)
+{
+  // there is no other process to receive from
+  snprintf(mpierrmsg, MPI_MAX_ERROR_STRING, "could not receive data\n" );
+  return MPI_ERR_COMM ;
+}
+
 int MPI_Allreduce(const void *sendbuf, void *recvbuf, int count,
                   MPI_Datatype datatype, MPI_Op op, MPI_Comm comm)
 {
@@ -369,9 +369,8 @@ inline static uint64_t adios_patch_data_wb_to_wb(void *dst, uint64_t dst_ragged_
 		void *copy_dst = (char*)dst + (copy_elem_offset - dst_elem_offset) * typesize;
 		void *copy_src = (char*)src + (copy_elem_offset - src_elem_offset) * typesize;
 
-		memcpy(copy_dst, copy_src, copy_nelems * typesize);
-		if (swap_endianness == adios_flag_yes)
-			change_endianness(copy_dst, copy_nelems * typesize, datum_type);
+		copy_strided_rows(copy_dst, copy_src, 0, NULL, NULL, NULL,
+		                  copy_nelems * typesize, datum_type, swap_endianness);
 
 		return copy_nelems;
 	} else {
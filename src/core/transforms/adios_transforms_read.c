@@ -1,5 +1,8 @@
 #include <stddef.h>
+#include <stdlib.h>
 #include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "core/adios_bp_v1.h"
 #include "core/adios_internals.h"
@@ -880,50 +883,228 @@ void adios_transform_process_read_chunk(adios_transform_read_request **reqgroups
     }
 }
 
+/*
+ * Number of threads decoding PG reqgroups in adios_transform_process_all_reads,
+ * set by the "transform_threads" read method parameter. 0: one thread per
+ * online core. The default is 1, since there is usually one reader process per
+ * core already.
+ */
+static int transform_read_threads = 1;
+
+#define MAX_TRANSFORM_READ_THREADS 64
+
+void adios_transform_set_read_threads(int nthreads) {
+    transform_read_threads = (nthreads > 0 ? nthreads : 0);
+}
+
+static int get_transform_read_threads(void) {
+    long n = transform_read_threads;
+    if (n <= 0) {
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+        if (n < 1) n = 1;
+    }
+    if (n > MAX_TRANSFORM_READ_THREADS) n = MAX_TRANSFORM_READ_THREADS;
+    return (int)n;
+}
+
+/*
+ * Returns 1 if PG reqgroups of the given transform may be decoded concurrently.
+ * Only plugins whose read side keeps all state in the PG reqgroup and calls a
+ * reentrant library are listed; everything else is decoded in the calling thread.
+ */
+static int transform_decodes_in_parallel(enum ADIOS_TRANSFORM_TYPE transform_type) {
+    switch (transform_type) {
+    case adios_transform_identity:
+    case adios_transform_zlib:
+    case adios_transform_bzip2:
+    case adios_transform_lz4:
+    case adios_transform_zfp:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Marks all subrequests of a PG reqgroup as completed, and applies the
+ * datablocks that the transform method returns to the user buffer. If 'lock'
+ * is given, it serializes the updates of the completion counters of the
+ * parent read reqgroup, which other threads complete concurrently.
+ */
+static void complete_pg_reqgroup(adios_transform_read_request *reqgroup,
+                                 adios_transform_pg_read_request *pg_reqgroup,
+                                 pthread_mutex_t *lock)
+{
+    adios_transform_raw_read_request *subreq;
+    adios_datablock *result;
+
+    // Complete every child subreq
+    for (subreq = pg_reqgroup->subreqs; subreq; subreq = subreq->next) {
+        // Skip completed subreqs
+        if (subreq->completed) continue;
+
+        // Mark the subreq as completed
+        if (lock) pthread_mutex_lock(lock);
+        adios_transform_raw_read_request_mark_complete(reqgroup, pg_reqgroup, subreq);
+        if (lock) pthread_mutex_unlock(lock);
+        assert(subreq->completed);
+
+        // Make the required call to the transform method to apply the results
+        result = adios_transform_subrequest_completed(reqgroup, pg_reqgroup, subreq);
+        if (result) apply_datablock_to_result_and_free(result, reqgroup);
+    }
+    assert(pg_reqgroup->completed);
+
+    // Make the required call to the transform method to apply the results
+    // Each PG reqgroup patches the disjoint region of its own block in the
+    // user buffer, so this needs no locking
+    result = adios_transform_pg_reqgroup_completed(reqgroup, pg_reqgroup);
+    if (result) apply_datablock_to_result_and_free(result, reqgroup);
+}
+
+/* PG reqgroups of a blocking read, decoded by a pool of threads */
+struct pg_decode_task {
+    adios_transform_read_request *reqgroup;
+    adios_transform_pg_read_request *pg_reqgroup;
+};
+
+struct pg_decode_pool {
+    struct pg_decode_task *tasks;
+    int ntasks;
+    int next_task;         // next task to take
+    pthread_mutex_t lock;  // protects next_task and the reqgroups' completion counters
+};
+
+static void * pg_decode_worker(void *arg) {
+    struct pg_decode_pool *pool = (struct pg_decode_pool *)arg;
+    int t;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        t = pool->next_task++;
+        pthread_mutex_unlock(&pool->lock);
+        if (t >= pool->ntasks)
+            break;
+        complete_pg_reqgroup(pool->tasks[t].reqgroup, pool->tasks[t].pg_reqgroup, &pool->lock);
+    }
+    return NULL;
+}
+
+/*
+ * Decodes the incomplete PG reqgroups of all given read reqgroups (of
+ * transforms that allow it) with up to get_transform_read_threads() threads,
+ * including the calling thread.
+ */
+static void decode_pg_reqgroups_in_parallel(adios_transform_read_request **reqgroups, int nreqgroups) {
+    struct pg_decode_pool pool;
+    pthread_t threads[MAX_TRANSFORM_READ_THREADS];
+    adios_transform_pg_read_request *pg_reqgroup;
+    int nthreads, nstarted = 0, ntasks = 0, i;
+
+    nthreads = get_transform_read_threads();
+    if (nthreads < 2)
+        return;
+
+    for (i = 0; i < nreqgroups; i++) {
+        if (!transform_decodes_in_parallel(reqgroups[i]->transinfo->transform_type))
+            continue;
+        for (pg_reqgroup = reqgroups[i]->pg_reqgroups; pg_reqgroup; pg_reqgroup = pg_reqgroup->next)
+            if (!pg_reqgroup->completed)
+                ntasks++;
+    }
+    if (ntasks < 2)
+        return;
+
+    pool.tasks = (struct pg_decode_task *)malloc(ntasks * sizeof(struct pg_decode_task));
+    if (!pool.tasks)
+        return; // decoded serially by the caller
+    pool.ntasks = 0;
+    pool.next_task = 0;
+    for (i = 0; i < nreqgroups; i++) {
+        if (!transform_decodes_in_parallel(reqgroups[i]->transinfo->transform_type))
+            continue;
+        for (pg_reqgroup = reqgroups[i]->pg_reqgroups; pg_reqgroup; pg_reqgroup = pg_reqgroup->next) {
+            if (!pg_reqgroup->completed) {
+                pool.tasks[pool.ntasks].reqgroup = reqgroups[i];
+                pool.tasks[pool.ntasks].pg_reqgroup = pg_reqgroup;
+                pool.ntasks++;
+            }
+        }
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+
+    if (nthreads > ntasks)
+        nthreads = ntasks;
+    log_debug("Decoding %d transformed blocks with %d threads\n", ntasks, nthreads);
+
+    // The calling thread is one of the workers; if a thread cannot be
+    // started, the others take over its share
+    for (i = 0; i < nthreads - 1; i++) {
+        if (pthread_create(&threads[nstarted], NULL, pg_decode_worker, &pool) == 0)
+            nstarted++;
+    }
+    pg_decode_worker(&pool);
+    for (i = 0; i < nstarted; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_mutex_destroy(&pool.lock);
+    free(pool.tasks);
+}
+
 /*
  * Process all read reqgroups, assuming they have been fully completed,
  * producing all required results based on the raw data read.
  * (This function is called after a blocking perform_reads completes)
+ *
+ * The PG reqgroups are decoded by a pool of threads first (see
+ * decode_pg_reqgroups_in_parallel); whatever remains, and the read reqgroup
+ * completions, are processed in order in the calling thread.
  */
 void adios_transform_process_all_reads(adios_transform_read_request **reqgroups_head) {
     // Mark all subrequests, PG request groups and read request groups
     // as completed, calling callbacks as needed
     adios_transform_read_request *reqgroup;
+    adios_transform_read_request **reqgroups = NULL;
     adios_transform_pg_read_request *pg_reqgroup;
-    adios_transform_raw_read_request *subreq;
     adios_datablock *result;
-
-    // Complete each read reqgroup in turn
+    int nreqgroups = 0, i;
+
+    // Detach the list of read reqgroups, freeing leftover completed ones
+    // immediately, with no further processing
+    for (reqgroup = *reqgroups_head; reqgroup; reqgroup = reqgroup->next)
+        nreqgroups++;
+    if (nreqgroups)
+        reqgroups = (adios_transform_read_request **)malloc(nreqgroups * sizeof(adios_transform_read_request *));
+    i = 0;
     while ((reqgroup = adios_transform_read_request_pop(reqgroups_head)) != NULL) {
-        // Free leftover read request groups immediately, with no further processing
         if (reqgroup->completed) {
             adios_transform_read_request_free(&reqgroup);
             continue;
         }
+        if (reqgroups) {
+            reqgroups[i++] = reqgroup;
+        } else {
+            // Out of memory for the list: process this reqgroup right away
+            for (pg_reqgroup = reqgroup->pg_reqgroups; pg_reqgroup; pg_reqgroup = pg_reqgroup->next)
+                if (!pg_reqgroup->completed)
+                    complete_pg_reqgroup(reqgroup, pg_reqgroup, NULL);
+            result = adios_transform_read_reqgroup_completed(reqgroup);
+            if (result) apply_datablock_to_result_and_free(result, reqgroup);
+            adios_transform_read_request_free(&reqgroup);
+        }
+    }
+    nreqgroups = i;
 
-        // Complete every child PG reqgroup
+    decode_pg_reqgroups_in_parallel(reqgroups, nreqgroups);
+
+    // Complete each read reqgroup in turn
+    for (i = 0; i < nreqgroups; i++) {
+        reqgroup = reqgroups[i];
+
+        // Complete every child PG reqgroup not decoded in parallel
         for (pg_reqgroup = reqgroup->pg_reqgroups; pg_reqgroup; pg_reqgroup = pg_reqgroup->next) {
             // Skip completed PG reqgroups
             if (pg_reqgroup->completed) continue;
-
-            // Complete every child subreq
-            for (subreq = pg_reqgroup->subreqs; subreq; subreq = subreq->next) {
-                // Skip completed subreqs
-                if (subreq->completed) continue;
-
-                // Mark the subreq as completed
-                adios_transform_raw_read_request_mark_complete(reqgroup, pg_reqgroup, subreq);
-                assert(subreq->completed);
-
-                // Make the required call to the transform method to apply the results
-                result = adios_transform_subrequest_completed(reqgroup, pg_reqgroup, subreq);
-                if (result) apply_datablock_to_result_and_free(result, reqgroup);
-            }
-            assert(pg_reqgroup->completed);
-
-            // Make the required call to the transform method to apply the results
-            result = adios_transform_pg_reqgroup_completed(reqgroup, pg_reqgroup);
-            if (result) apply_datablock_to_result_and_free(result, reqgroup);
+            complete_pg_reqgroup(reqgroup, pg_reqgroup, NULL);
         }
         assert(reqgroup->completed);
 
@@ -934,4 +1115,5 @@ void adios_transform_process_all_reads(adios_transform_read_request **reqgroups_
         // Now that the read reqgroup has been processed, free it (which also frees all children)
         adios_transform_read_request_free(&reqgroup);
     }
+    free(reqgroups);
 }
@@ -79,4 +79,10 @@ void adios_transform_process_read_chunk(adios_transform_read_request **reqgroups
  */
 void adios_transform_process_all_reads(adios_transform_read_request **reqgroups_head);
 
+/*
+ * Sets the number of threads that decode transformed blocks in
+ * adios_transform_process_all_reads (0: one per online core, default 1).
+ */
+void adios_transform_set_read_threads(int nthreads);
+
 #endif /* ADIOS_TRANSFORMS_READ_H_ */
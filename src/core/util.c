@@ -12,6 +12,7 @@
 #include "core/bp_utils.h"
 #include "core/common_read.h"
 #include "core/adios_endianness.h"
+#include "core/adios_subvolume.h"
 #include "core/adios_logger.h"
 
 /* Reverse the order in an array in place.
@@ -128,40 +129,26 @@ void adios_util_copy_data (void *dst, void *src,
         enum ADIOS_DATATYPES type
         )
 {
-    unsigned int i, j;
-    uint64_t dst_offset_new=0;
-    uint64_t src_offset_new=0;
-    uint64_t src_step, dst_step;
-    if (ndim-1==idim) {
-        for (i=0;i<size_in_dset[idim];i++) {
-            memcpy ((char *)dst + (i*dst_stride+dst_offset)*size_of_type,
-                    (char *)src + (i*src_stride+src_offset)*size_of_type,
-                    ele_num*size_of_type);
-            if (change_endiness == adios_flag_yes) {
-                change_endianness ((char *)dst + (i*dst_stride+dst_offset)*size_of_type, 
-                                   ele_num*size_of_type, type);
-            }
-        }
-        return;
-    }
+    uint64_t counts[ADIOS_SUBV_MAX_DIMS];
+    uint64_t src_strides[ADIOS_SUBV_MAX_DIMS];
+    uint64_t dst_strides[ADIOS_SUBV_MAX_DIMS];
+    uint64_t src_step = size_of_type, dst_step = size_of_type;
+    int i;
 
-    for (i = 0; i<size_in_dset[idim];i++) {
-        // get the different step granularity 
-        // for each different reading pattern broke
-        src_step = 1;
-        dst_step = 1;
-        for (j = idim+1; j <= ndim-1;j++) {
-            src_step *= ldims[j];
-            dst_step *= readsize[j];
-        }
-        src_offset_new =src_offset + i * src_stride * src_step;
-        dst_offset_new = dst_offset + i * dst_stride * dst_step;
-        adios_util_copy_data ( dst, src, idim+1, ndim, size_in_dset,
-                ldims,readsize,
-                dst_stride, src_stride,
-                dst_offset_new, src_offset_new,
-                ele_num, size_of_type, change_endiness, type);
+    // Byte strides of dimensions idim..ndim-1 in both buffers; the
+    // copy engine walks them without recursion
+    for (i = ndim-1; i >= idim; i--) {
+        counts[i-idim] = size_in_dset[i];
+        src_strides[i-idim] = src_stride * src_step;
+        dst_strides[i-idim] = dst_stride * dst_step;
+        src_step *= ldims[i];
+        dst_step *= readsize[i];
     }
+
+    copy_strided_rows ((char *)dst + dst_offset*size_of_type,
+                       (char *)src + src_offset*size_of_type,
+                       ndim-idim, counts, dst_strides, src_strides,
+                       ele_num*size_of_type, type, change_endiness);
 }
 
 void list_insert_read_request_tail (read_request ** h, read_request * q)
@@ -94,6 +94,10 @@ int adios_allocate_buffer (
 // To set maximum buffer size for each adios_open()...adios_close() operation.
 void adios_set_max_buffer_size (uint64_t max_buffer_size_MB);
 
+// To set the maximum number of threads calculating the statistics of one array 
+// in adios_write(). Each thread processes at least 1MB of data. Default is 1.
+void adios_set_stats_threads (int nthreads);
+
 // To declare a ADIOS group
 int adios_declare_group (int64_t * id, 
                          const char * name,
@@ -13,7 +13,8 @@ enum ADIOS_QUERY_METHOD
     ADIOS_QUERY_METHOD_MINMAX   = 0,
     ADIOS_QUERY_METHOD_FASTBIT  = 1,
     ADIOS_QUERY_METHOD_ALACRITY = 2,
-    ADIOS_QUERY_METHOD_UNKNOWN  = 3,
+    ADIOS_QUERY_METHOD_SCAN     = 3,
+    ADIOS_QUERY_METHOD_UNKNOWN  = 4,
     ADIOS_QUERY_METHOD_COUNT = ADIOS_QUERY_METHOD_UNKNOWN
 };
     
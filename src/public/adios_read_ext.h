@@ -134,6 +134,35 @@ void adios_free_pg_intersections(ADIOS_PG_INTERSECTIONS **intersections);
  */
 int adios_read_get_dimension_order (ADIOS_FILE *);
 
+/* Find the variables whose names start with 'prefix', e.g. "/fields/".
+ * A leading '/' is ignored in the prefix and in the names.
+ * The search uses an index of the names sorted at the first call, so it
+ * does not scan all variables of the file.
+ * *varids is set to an array of the matching variable ids (in the current
+ * group view) in the order of their names, to be freed by the caller, or to
+ * NULL if there is no match.
+ * Returns the number of matching variables, -1 on error (sets adios_errno)
+ */
+int adios_inq_var_ids_by_prefix (const ADIOS_FILE *fp, const char *prefix, int **varids);
+
+/* Find the variables whose names match the shell wildcard 'pattern'
+ * (see fnmatch(3)), e.g. "/fields/b*" or "/fields/?". '*' and '?' do not match '/'.
+ * Only the names starting with the characters before the first wildcard
+ * are matched against the pattern. Results are returned as in
+ * adios_inq_var_ids_by_prefix().
+ */
+int adios_inq_var_ids_by_pattern (const ADIOS_FILE *fp, const char *pattern, int **varids);
+
+/* List the entries directly under 'path' in the hierarchy of variable names,
+ * e.g. "a" and "b/" for "/fields" if the file has the variables
+ * "/fields/a", "/fields/b/x" and "/fields/b/y". Names of subdirectories end
+ * with '/'. "" or "/" lists the top level.
+ * *names is set to an array of the names in sorted order, to be freed by the
+ * caller together with each name, or to NULL if there is no entry.
+ * Returns the number of entries, -1 on error (sets adios_errno)
+ */
+int adios_inq_var_path (const ADIOS_FILE *fp, const char *path, char ***names);
+
 #endif  /*__INCLUDED_FROM_FORTRAN_API__*/
 
 #ifdef __cplusplus
@@ -14,6 +14,7 @@
 FORWARD_DECLARE(minmax)
 FORWARD_DECLARE(fastbit)
 FORWARD_DECLARE(alac)
+FORWARD_DECLARE(scan)
 
 typedef int      (* ADIOS_QUERY_FREE_FN) (ADIOS_QUERY* q);
 typedef int      (* ADIOS_QUERY_FINALIZE_FN) ();
@@ -0,0 +1,1351 @@
+/*
+ * query_scan.c
+ *
+ * Built-in query method that evaluates the query on the data itself and
+ * returns the exact points satisfying it. Writeblocks that surely have no hits
+ * are pruned using the per-block min/max statistics (as in the minmax method),
+ * only the remaining blocks are read and the predicates are evaluated on
+ * them by a pool of threads.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+#include <limits.h>
+#include <float.h>
+#include <pthread.h>
+#include "public/adios_error.h"
+#include "public/adios_query.h"
+#include "public/adios_selection.h"
+#include "core/common_read.h"
+#include "core/a2sel.h"
+#include "core/adios_logger.h"
+#include "common_query.h"
+#include "query_utils.h"
+#include "config.h"  // HAVE_STRTOLD
+
+/* Do not start a thread for less elements than this */
+#define SCAN_MIN_ELEMENTS_PER_THREAD 65536
+/* Upper limit of the number of evaluating threads */
+#define SCAN_MAX_THREADS 64
+
+#if HAVE_STRTOLD
+#  define  LONGDOUBLE long double
+#  define  STRTOLONGDOUBLE(x,y) strtold(x,y)
+#else
+#  define  LONGDOUBLE double
+#  define  STRTOLONGDOUBLE(x,y) strtod(x,y)
+#endif
+
+enum SCAN_VALUE_CLASS {
+    SCAN_SIGNED,
+    SCAN_UNSIGNED,
+    SCAN_REAL,
+    SCAN_LONGDOUBLE
+};
+
+typedef struct {
+    signed long long i;
+    unsigned long long u;
+    int negative;          // unsigned class: the value is below 0 (u is 0)
+    double d;
+    LONGDOUBLE ld;
+} SCAN_VALUE;
+
+typedef struct {
+    ADIOS_QUERY *q;        // leaf of the query tree
+    enum SCAN_VALUE_CLASS vclass;
+    SCAN_VALUE value;      // predicate value converted for the variable's type
+    uint64_t *start;       // start of the query domain in the variable's global space
+    int elemsize;
+    char *data;            // values of the current tile
+    int owns_data;         // 0: data is shared with an earlier leaf reading the same region
+} SCAN_LEAF;
+
+typedef struct {
+    uint64_t *start;       // start of the tile relative to the query domain
+    uint64_t *count;
+    int block;             // index of the writeblock of the first variable the tile was cut from
+    uint64_t nhits;
+    uint64_t *hits;        // 1D offsets of the hits in the tile
+} SCAN_TILE;
+
+typedef struct {
+    int ndim;
+    uint64_t *count;       // size of the query domain, the same for every leaf
+
+    int nleaves;
+    SCAN_LEAF *leaves;
+
+    int ntiles;            // tiles with at least one hit
+    SCAN_TILE *tiles;
+
+    int is_outputBoundary_set; // did we set outputBoundary
+    uint64_t *outstart;    // start of output selection from first eval call (for one step)
+    uint64_t *outcount;
+
+    int current_tile;      // end of last evaluation (remember it to be able
+    uint64_t current_hit;  // to continue in consecutive evaluate calls)
+} SCAN_INTERNAL;
+
+#define INTERNAL(q) ((SCAN_INTERNAL*) (q->queryInternal))
+
+static void free_internal (ADIOS_QUERY *q)
+{
+    if (q->queryInternal != NULL) {
+        SCAN_INTERNAL* qi = (SCAN_INTERNAL*) q->queryInternal;
+        int i;
+        for (i = 0; i < qi->nleaves; i++) {
+            free (qi->leaves[i].start);
+            if (qi->leaves[i].owns_data)
+                free (qi->leaves[i].data);
+        }
+        free (qi->leaves);
+        for (i = 0; i < qi->ntiles; i++) {
+            free (qi->tiles[i].start);
+            free (qi->tiles[i].count);
+            free (qi->tiles[i].hits);
+        }
+        free (qi->tiles);
+        free (qi->count);
+        free (qi->outstart);
+        free (qi->outcount);
+        free (qi);
+        q->queryInternal = NULL;
+    }
+}
+
+static void create_internal (ADIOS_QUERY *q)
+{
+    if (q->queryInternal == NULL) {
+        SCAN_INTERNAL* internal = calloc (1, sizeof(SCAN_INTERNAL));
+        q->queryInternal = (void *)internal;
+    }
+}
+
+/* Number of threads evaluating a tile: ADIOS_QUERY_SCAN_THREADS from the
+   environment, or 1 so that the cores of a node are left to the other
+   processes of a parallel reader */
+static int scan_nthreads (void)
+{
+    static int nthreads = 0;
+    if (!nthreads) {
+        char *env = getenv ("ADIOS_QUERY_SCAN_THREADS");
+        long n = 0;
+        if (env) {
+            n = atol (env);
+        }
+        if (n < 1)
+            n = 1;
+        if (n > SCAN_MAX_THREADS)
+            n = SCAN_MAX_THREADS;
+        nthreads = (int) n;
+        log_debug ("query scan: use up to %d threads for evaluation\n", nthreads);
+    }
+    return nthreads;
+}
+
+static int is_supported_type (enum ADIOS_DATATYPES type)
+{
+    switch (type)
+    {
+        case adios_unsigned_byte:
+        case adios_byte:
+        case adios_unsigned_short:
+        case adios_short:
+        case adios_unsigned_integer:
+        case adios_integer:
+        case adios_unsigned_long:
+        case adios_long:
+        case adios_real:
+        case adios_double:
+        case adios_long_double:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static enum SCAN_VALUE_CLASS value_class (enum ADIOS_DATATYPES type)
+{
+    switch (type)
+    {
+        case adios_unsigned_byte:
+        case adios_unsigned_short:
+        case adios_unsigned_integer:
+        case adios_unsigned_long:
+            return SCAN_UNSIGNED;
+        case adios_real:
+        case adios_double:
+            return SCAN_REAL;
+        case adios_long_double:
+            return SCAN_LONGDOUBLE;
+        default:
+            return SCAN_SIGNED;
+    }
+}
+
+/* Convert a value of the variable's type (e.g. a block min/max) into its value class */
+static void void_to_value (void *v, enum ADIOS_DATATYPES type, SCAN_VALUE *val)
+{
+    switch (type)
+    {
+        case adios_unsigned_byte:
+            val->u = *(unsigned char *) v;
+            break;
+        case adios_byte:
+            val->i = *(signed char *) v;
+            break;
+        case adios_unsigned_short:
+            val->u = *(unsigned short *) v;
+            break;
+        case adios_short:
+            val->i = *(signed short *) v;
+            break;
+        case adios_unsigned_integer:
+            val->u = *(unsigned int *) v;
+            break;
+        case adios_integer:
+            val->i = *(signed int *) v;
+            break;
+        case adios_unsigned_long:
+            val->u = *(unsigned long long *) v;
+            break;
+        case adios_long:
+            val->i = *(signed long long *) v;
+            break;
+        case adios_real:
+            val->d = *(float *) v;
+            break;
+        case adios_double:
+            val->d = *(double *) v;
+            break;
+        case adios_long_double:
+            val->ld = *(LONGDOUBLE *) v;
+            break;
+        default:
+            break;
+    }
+}
+
+static void string_to_value (const char *v_str, enum SCAN_VALUE_CLASS vclass, SCAN_VALUE *val)
+{
+    switch (vclass)
+    {
+        case SCAN_UNSIGNED:
+            // strtoull() would wrap a negative value around
+            while (isspace ((unsigned char) *v_str))
+                v_str++;
+            if (*v_str == '-' && strtoll (v_str, NULL, 10) < 0) {
+                val->negative = 1;
+                val->u = 0;
+            } else {
+                val->negative = 0;
+                val->u = strtoull (v_str, NULL, 10);
+            }
+            break;
+        case SCAN_SIGNED:
+            val->i = strtoll (v_str, NULL, 10);
+            break;
+        case SCAN_REAL:
+            val->d = strtod (v_str, NULL);
+            break;
+        case SCAN_LONGDOUBLE:
+            val->ld = STRTOLONGDOUBLE (v_str, NULL);
+            break;
+    }
+}
+
+/* Compare two values of the same class: returns <0, 0, >0 */
+static int compare_values (const SCAN_VALUE *a, const SCAN_VALUE *b, enum SCAN_VALUE_CLASS vclass)
+{
+    switch (vclass)
+    {
+        case SCAN_UNSIGNED:
+            if (a->negative || b->negative)
+                return b->negative - a->negative;
+            return (a->u > b->u) - (a->u < b->u);
+        case SCAN_SIGNED:
+            return (a->i > b->i) - (a->i < b->i);
+        case SCAN_REAL:
+            return (a->d > b->d) - (a->d < b->d);
+        case SCAN_LONGDOUBLE:
+            return (a->ld > b->ld) - (a->ld < b->ld);
+    }
+    return 0;
+}
+
+/* Can a block with the given min/max values have a point satisfying the leaf's predicate? */
+static int block_may_match (const SCAN_LEAF *leaf, void *minp, void *maxp)
+{
+    SCAN_VALUE min, max;
+    memset (&min, 0, sizeof(min));
+    memset (&max, 0, sizeof(max));
+    enum ADIOS_DATATYPES type = leaf->q->varinfo->type;
+    if (!minp || !maxp)
+        return 1;
+    void_to_value (minp, type, &min);
+    void_to_value (maxp, type, &max);
+    int cmin = compare_values (&min, &leaf->value, leaf->vclass);
+    int cmax = compare_values (&max, &leaf->value, leaf->vclass);
+    switch (leaf->q->predicateOp)
+    {
+        case ADIOS_LT:
+            return cmin < 0;
+        case ADIOS_LTEQ:
+            return cmin <= 0;
+        case ADIOS_GT:
+            return cmax > 0;
+        case ADIOS_GTEQ:
+            return cmax >= 0;
+        case ADIOS_EQ:
+            return cmin <= 0 && cmax >= 0;
+        case ADIOS_NE:
+            return !(cmin == 0 && cmax == 0);
+    }
+    return 1;
+}
+
+static int count_leaves (ADIOS_QUERY *q)
+{
+    if (!q->left && !q->right)
+        return 1;
+    return (q->left ? count_leaves ((ADIOS_QUERY*) q->left) : 0) +
+           (q->right ? count_leaves ((ADIOS_QUERY*) q->right) : 0);
+}
+
+static void collect_leaves (ADIOS_QUERY *q, SCAN_LEAF *leaves, int *n)
+{
+    if (!q->left && !q->right) {
+        leaves[*n].q = q;
+        (*n)++;
+        return;
+    }
+    if (q->left)
+        collect_leaves ((ADIOS_QUERY*) q->left, leaves, n);
+    if (q->right)
+        collect_leaves ((ADIOS_QUERY*) q->right, leaves, n);
+}
+
+static int tree_depth (ADIOS_QUERY *q)
+{
+    if (!q->left && !q->right)
+        return 0;
+    int l = (q->left ? tree_depth ((ADIOS_QUERY*) q->left) : 0);
+    int r = (q->right ? tree_depth ((ADIOS_QUERY*) q->right) : 0);
+    return 1 + (l > r ? l : r);
+}
+
+static SCAN_LEAF * find_leaf (SCAN_INTERNAL *qi, ADIOS_QUERY *q)
+{
+    int i;
+    for (i = 0; i < qi->nleaves; i++) {
+        if (qi->leaves[i].q == q)
+            return &qi->leaves[i];
+    }
+    return NULL;
+}
+
+// varinfo contains blocks for many timesteps, we need the index where the current timestep starts
+static int block_start_index (ADIOS_VARINFO *v, int timestep)
+{
+    int i, idx = 0;
+    for (i = 0; i < timestep; i++) {
+        // FIXME: this may be incorrect for variables that are not written at every timestep into the file
+        idx += v->nblocks[i];
+    }
+    return idx;
+}
+
+/* Can the query be evaluated by this method? Checks the leaves only, the
+   sizes of writeblock selections can only be checked at a given timestep.
+   As a side effect, the varinfo is retrieved for all variables. */
+static int can_evaluate (ADIOS_QUERY *q, int *ndim, uint64_t *count)
+{
+    if (q->left || q->right) {
+        int supported = 1;
+        if (q->left)
+            supported = can_evaluate ((ADIOS_QUERY*) q->left, ndim, count);
+        if (supported && q->right)
+            supported = can_evaluate ((ADIOS_QUERY*) q->right, ndim, count);
+        return supported;
+    }
+
+    // If this is a query leaf node, we support SCAN query iff
+    // - the selection is bounding box or writeblock or NULL
+    // - the variable is a global array of a numeric type
+    // - the domain has the same number of dimensions and size as in other leaves
+    if (q->sel && q->sel->type != ADIOS_SELECTION_BOUNDINGBOX &&
+            q->sel->type != ADIOS_SELECTION_WRITEBLOCK)
+        return 0;
+    if (!q->varinfo)
+        q->varinfo = common_read_inq_var (q->file, q->varName);
+    if (!q->varinfo)
+        return 0;
+
+    ADIOS_VARINFO *v = q->varinfo;
+    if (!v->global || v->ndim == 0 || v->ndim > 32 || !is_supported_type (v->type))
+        return 0;
+
+    const uint64_t *c = NULL;
+    if (!q->sel) {
+        c = v->dims;
+    } else if (q->sel->type == ADIOS_SELECTION_BOUNDINGBOX) {
+        if (q->sel->u.bb.ndim != v->ndim)
+            return 0;
+        c = q->sel->u.bb.count;
+    }
+
+    if (*ndim == 0) {
+        *ndim = v->ndim;
+    } else if (*ndim != v->ndim) {
+        return 0;
+    }
+    if (c) {
+        if (count[0] == 0) {
+            memcpy (count, c, v->ndim * sizeof(uint64_t));
+        } else if (memcmp (count, c, v->ndim * sizeof(uint64_t))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Set the start and count of the leaf's query domain at the timestep */
+static int leaf_domain (ADIOS_QUERY *q, int timestep, uint64_t *start, const uint64_t **count)
+{
+    ADIOS_VARINFO *v = q->varinfo;
+    if (!q->sel) {
+        memset (start, 0, v->ndim * sizeof(uint64_t));
+        *count = v->dims;
+    } else if (q->sel->type == ADIOS_SELECTION_BOUNDINGBOX) {
+        memcpy (start, q->sel->u.bb.start, v->ndim * sizeof(uint64_t));
+        *count = q->sel->u.bb.count;
+    } else {
+        int idx = q->sel->u.block.index;
+        if (!q->sel->u.block.is_absolute_index) {
+            if (idx < 0 || idx >= v->nblocks[timestep]) {
+                adios_error (err_invalid_argument,
+                        "Query scan: invalid writeblock index %d for variable %s\n",
+                        idx, q->varName);
+                return -1;
+            }
+            idx += block_start_index (v, timestep);
+        }
+        if (idx < 0 || idx >= v->sum_nblocks) {
+            adios_error (err_invalid_argument,
+                    "Query scan: invalid writeblock index %d for variable %s\n",
+                    idx, q->varName);
+            return -1;
+        }
+        memcpy (start, v->blockinfo[idx].start, v->ndim * sizeof(uint64_t));
+        *count = v->blockinfo[idx].count;
+    }
+    return 0;
+}
+
+/* Intersect a box with a block, both given in global coordinates.
+   Returns 0 if they do not intersect. */
+static int intersect_block (int ndim, const uint64_t *start, const uint64_t *count,
+                            const ADIOS_VARBLOCK *b, uint64_t *istart, uint64_t *icount)
+{
+    int d;
+    for (d = 0; d < ndim; d++) {
+        uint64_t lo = (start[d] > b->start[d] ? start[d] : b->start[d]);
+        uint64_t hi1 = start[d] + count[d];
+        uint64_t hi2 = b->start[d] + b->count[d];
+        uint64_t hi = (hi1 < hi2 ? hi1 : hi2);
+        if (hi <= lo)
+            return 0;
+        if (istart) {
+            istart[d] = lo;
+            icount[d] = hi - lo;
+        }
+    }
+    return 1;
+}
+
+/* Can the tile have a point satisfying the leaf's predicate according to
+   the min/max statistics of the leaf variable's blocks covering the tile?
+   'hint' is the index of the block the tile was cut from in the first
+   leaf's variable, which is the only block to check when the variables have
+   the same decomposition. */
+static int leaf_may_match (SCAN_INTERNAL *qi, SCAN_LEAF *leaf, SCAN_TILE *t, int timestep, int hint)
+{
+    ADIOS_VARINFO *v = leaf->q->varinfo;
+    if (!v->statistics || !v->statistics->blocks)
+        return 1;
+
+    int ndim = qi->ndim;
+    int d, i;
+    uint64_t start[ndim];
+    for (d = 0; d < ndim; d++)
+        start[d] = leaf->start[d] + t->start[d];
+
+    int bstart = block_start_index (v, timestep);
+    int nblocks = v->nblocks[timestep];
+    ADIOS_VARBLOCK *blocks = v->blockinfo + bstart;
+
+    if (hint < nblocks) {
+        int inside = 1;
+        for (d = 0; d < ndim; d++) {
+            if (start[d] < blocks[hint].start[d] ||
+                start[d] + t->count[d] > blocks[hint].start[d] + blocks[hint].count[d]) {
+                inside = 0;
+                break;
+            }
+        }
+        if (inside)
+            return block_may_match (leaf, v->statistics->blocks->mins[bstart+hint],
+                                    v->statistics->blocks->maxs[bstart+hint]);
+    }
+
+    for (i = 0; i < nblocks; i++) {
+        if (intersect_block (ndim, start, t->count, &blocks[i], NULL, NULL) &&
+            block_may_match (leaf, v->statistics->blocks->mins[bstart+i],
+                             v->statistics->blocks->maxs[bstart+i]))
+            return 1;
+    }
+    return 0;
+}
+
+/* Evaluate the query tree on a tile using the statistics only.
+   Returns 0 if the tile surely has no hits. */
+static int tile_may_match (SCAN_INTERNAL *qi, ADIOS_QUERY *q, SCAN_TILE *t, int timestep, int hint)
+{
+    if (!q->left && !q->right)
+        return leaf_may_match (qi, find_leaf (qi, q), t, timestep, hint);
+    if (!q->left || !q->right)
+        return tile_may_match (qi, (ADIOS_QUERY*) (q->left ? q->left : q->right), t, timestep, hint);
+
+    int l = tile_may_match (qi, (ADIOS_QUERY*) q->left, t, timestep, hint);
+    if (q->combineOp == ADIOS_QUERY_OP_AND && !l)
+        return 0;
+    if (q->combineOp == ADIOS_QUERY_OP_OR && l)
+        return 1;
+    return tile_may_match (qi, (ADIOS_QUERY*) q->right, t, timestep, hint);
+}
+
+/* Every element is below (above=1) or above (above=0) the predicate value */
+static void fill_constant (enum ADIOS_PREDICATE_MODE op, int above, uint64_t n, unsigned char *mask)
+{
+    int v;
+    if (above)
+        v = (op == ADIOS_LT || op == ADIOS_LTEQ || op == ADIOS_NE);
+    else
+        v = (op == ADIOS_GT || op == ADIOS_GTEQ || op == ADIOS_NE);
+    memset (mask, v, n);
+}
+
+/* Floats compared with a double value that is not a float: turn the predicate
+   into an equivalent one with a float value, since there is no float between
+   the value and its nearest float. Returns 0 or 1 if the result is the same
+   for every element, -1 otherwise. */
+static int float_predicate (enum ADIOS_PREDICATE_MODE *op, double v, float *vf)
+{
+    if (v > FLT_MAX)
+        return (*op == ADIOS_LT || *op == ADIOS_LTEQ || *op == ADIOS_NE);
+    if (v < -FLT_MAX)
+        return (*op == ADIOS_GT || *op == ADIOS_GTEQ || *op == ADIOS_NE);
+
+    float f = (float) v;
+    *vf = f;
+    if ((double) f == v || v != v)
+        return -1;
+    switch (*op)
+    {
+        case ADIOS_LT:
+        case ADIOS_LTEQ:
+            *op = ((double) f > v ? ADIOS_LT : ADIOS_LTEQ);
+            break;
+        case ADIOS_GT:
+        case ADIOS_GTEQ:
+            *op = ((double) f > v ? ADIOS_GTEQ : ADIOS_GT);
+            break;
+        case ADIOS_EQ:
+            return 0;
+        case ADIOS_NE:
+            return 1;
+    }
+    return -1;
+}
+
+/* Compare elements of type T as type CT with the value V */
+#define SCAN_KERNEL(T,CT,V) {                                                     \
+    const T * d = ((const T *) data) + lo;                                        \
+    const CT v = (CT) (V);                                                        \
+    switch (op) {                                                                 \
+        case ADIOS_LT:   for (k = 0; k < n; k++) mask[k] = ((CT) d[k] <  v); break; \
+        case ADIOS_LTEQ: for (k = 0; k < n; k++) mask[k] = ((CT) d[k] <= v); break; \
+        case ADIOS_GT:   for (k = 0; k < n; k++) mask[k] = ((CT) d[k] >  v); break; \
+        case ADIOS_GTEQ: for (k = 0; k < n; k++) mask[k] = ((CT) d[k] >= v); break; \
+        case ADIOS_EQ:   for (k = 0; k < n; k++) mask[k] = ((CT) d[k] == v); break; \
+        case ADIOS_NE:   for (k = 0; k < n; k++) mask[k] = ((CT) d[k] != v); break; \
+    }                                                                             \
+}
+
+/* Integers are compared in their own type, which is the fastest, so the
+   predicate value has to be checked against the range of the type first */
+#define SCAN_INT_KERNEL(T,MIN,MAX,V) {                                            \
+    if ((V) < (MIN))                                                              \
+        fill_constant (op, 0, n, mask);                                           \
+    else if ((V) > (MAX))                                                         \
+        fill_constant (op, 1, n, mask);                                           \
+    else                                                                          \
+        SCAN_KERNEL (T, T, V)                                                     \
+}
+
+/* Unsigned values below 0 are handled in leaf_kernel() */
+#define SCAN_UINT_KERNEL(T,MAX,V) {                                               \
+    if ((V) > (MAX))                                                              \
+        fill_constant (op, 1, n, mask);                                           \
+    else                                                                          \
+        SCAN_KERNEL (T, T, V)                                                     \
+}
+
+/* Evaluate a leaf's predicate on elements lo..lo+n-1 of the tile into mask[0..n-1].
+   The loops are kept simple so that the compiler can vectorize them. */
+static void leaf_kernel (const SCAN_LEAF *leaf, uint64_t lo, uint64_t n, unsigned char *mask)
+{
+    uint64_t k;
+    const char *data = leaf->data;
+    enum ADIOS_PREDICATE_MODE op = leaf->q->predicateOp;
+    const unsigned long long vu = leaf->value.u;
+    const signed long long vi = leaf->value.i;
+    const double vd = leaf->value.d;
+    const LONGDOUBLE vld = leaf->value.ld;
+
+    if (leaf->vclass == SCAN_UNSIGNED && leaf->value.negative) {
+        // every element of an unsigned type is above a negative value
+        fill_constant (op, 0, n, mask);
+        return;
+    }
+
+    switch (leaf->q->varinfo->type)
+    {
+        case adios_unsigned_byte:
+            SCAN_UINT_KERNEL (unsigned char, UCHAR_MAX, vu)
+            break;
+        case adios_byte:
+            SCAN_INT_KERNEL (signed char, SCHAR_MIN, SCHAR_MAX, vi)
+            break;
+        case adios_unsigned_short:
+            SCAN_UINT_KERNEL (unsigned short, USHRT_MAX, vu)
+            break;
+        case adios_short:
+            SCAN_INT_KERNEL (signed short, SHRT_MIN, SHRT_MAX, vi)
+            break;
+        case adios_unsigned_integer:
+            SCAN_UINT_KERNEL (unsigned int, UINT_MAX, vu)
+            break;
+        case adios_integer:
+            SCAN_INT_KERNEL (signed int, INT_MIN, INT_MAX, vi)
+            break;
+        case adios_unsigned_long:
+            SCAN_KERNEL (unsigned long long, unsigned long long, vu)
+            break;
+        case adios_long:
+            SCAN_KERNEL (signed long long, signed long long, vi)
+            break;
+        case adios_real:
+            {
+                float vf = 0.0;
+                int c = float_predicate (&op, vd, &vf);
+                if (c >= 0)
+                    memset (mask, c, n);
+                else
+                    SCAN_KERNEL (float, float, vf)
+            }
+            break;
+        case adios_double:
+            SCAN_KERNEL (double, double, vd)
+            break;
+        case adios_long_double:
+            SCAN_KERNEL (LONGDOUBLE, LONGDOUBLE, vld)
+            break;
+        default:
+            memset (mask, 0, n);
+            break;
+    }
+}
+
+#undef SCAN_UINT_KERNEL
+#undef SCAN_INT_KERNEL
+#undef SCAN_KERNEL
+
+/* Evaluate the (sub)query on elements lo..lo+n-1 of the tile into mask[0..n-1].
+   scratch has room for n bytes for each level of the tree below q. */
+static void eval_rec (SCAN_INTERNAL *qi, ADIOS_QUERY *q, uint64_t lo, uint64_t n,
+                      unsigned char *mask, unsigned char *scratch)
+{
+    uint64_t k;
+    if (!q->left && !q->right) {
+        leaf_kernel (find_leaf (qi, q), lo, n, mask);
+        return;
+    }
+    if (!q->left || !q->right) {
+        eval_rec (qi, (ADIOS_QUERY*) (q->left ? q->left : q->right), lo, n, mask, scratch);
+        return;
+    }
+
+    eval_rec (qi, (ADIOS_QUERY*) q->left, lo, n, mask, scratch);
+    if (q->combineOp == ADIOS_QUERY_OP_AND) {
+        // skip evaluating right side if left produced already zero results
+        for (k = 0; k < n; k++) {
+            if (mask[k])
+                break;
+        }
+        if (k == n)
+            return;
+    }
+    eval_rec (qi, (ADIOS_QUERY*) q->right, lo, n, scratch, scratch + n);
+    if (q->combineOp == ADIOS_QUERY_OP_AND) {
+        for (k = 0; k < n; k++)
+            mask[k] &= scratch[k];
+    } else {
+        for (k = 0; k < n; k++)
+            mask[k] |= scratch[k];
+    }
+}
+
+typedef struct {
+    SCAN_INTERNAL *qi;
+    ADIOS_QUERY *q;
+    int depth;
+    uint64_t lo;           // range of tile elements evaluated by this thread
+    uint64_t n;
+    uint64_t nhits;
+    uint64_t *hits;        // offsets of the hits in the tile
+    int error;
+} SCAN_WORK;
+
+static void * scan_worker (void *arg)
+{
+    SCAN_WORK *w = (SCAN_WORK *) arg;
+    uint64_t k, nhits = 0;
+
+    unsigned char *mask = (unsigned char *) malloc ((w->depth + 1) * w->n);
+    if (!mask) {
+        w->error = 1;
+        return NULL;
+    }
+    eval_rec (w->qi, w->q, w->lo, w->n, mask, mask + w->n);
+
+    for (k = 0; k < w->n; k++)
+        nhits += mask[k];
+
+    w->hits = NULL;
+    if (nhits > 0) {
+        w->hits = (uint64_t *) malloc (nhits * sizeof(uint64_t));
+        if (!w->hits) {
+            free (mask);
+            w->error = 1;
+            return NULL;
+        }
+        nhits = 0;
+        for (k = 0; k < w->n; k++) {
+            if (mask[k])
+                w->hits[nhits++] = w->lo + k;
+        }
+    }
+    w->nhits = nhits;
+    free (mask);
+    return NULL;
+}
+
+/* Evaluate the query on a tile whose data has been read into the leaves.
+   The tile is split into contiguous ranges evaluated by separate threads.
+   Returns 0 on success, -1 on error. */
+static int eval_tile (ADIOS_QUERY *q, SCAN_TILE *t, uint64_t nelems)
+{
+    SCAN_INTERNAL *qi = INTERNAL(q);
+    int nthreads = scan_nthreads ();
+    int i, error = 0;
+
+    uint64_t maxthreads = (nelems + SCAN_MIN_ELEMENTS_PER_THREAD - 1) / SCAN_MIN_ELEMENTS_PER_THREAD;
+    if ((uint64_t) nthreads > maxthreads)
+        nthreads = (int) maxthreads;
+    if (nthreads < 1)
+        nthreads = 1;
+
+    SCAN_WORK work[nthreads];
+    pthread_t threads[nthreads];
+    int started[nthreads];
+
+    // ranges are a multiple of 64 elements so that threads do not share cache lines of their masks
+    uint64_t chunk = (nelems + nthreads - 1) / nthreads;
+    chunk = (chunk + 63) & ~(uint64_t) 63;
+
+    int depth = tree_depth (q);
+    uint64_t lo = 0;
+    for (i = 0; i < nthreads; i++) {
+        work[i].qi = qi;
+        work[i].q = q;
+        work[i].depth = depth;
+        work[i].lo = lo;
+        work[i].n = (lo < nelems ? (nelems - lo < chunk ? nelems - lo : chunk) : 0);
+        work[i].nhits = 0;
+        work[i].hits = NULL;
+        work[i].error = 0;
+        lo += work[i].n;
+        started[i] = 0;
+    }
+
+    // the first range is evaluated by the calling thread
+    for (i = 1; i < nthreads; i++) {
+        if (work[i].n > 0 && !pthread_create (&threads[i], NULL, scan_worker, &work[i])) {
+            started[i] = 1;
+        }
+    }
+    scan_worker (&work[0]);
+    for (i = 1; i < nthreads; i++) {
+        if (started[i]) {
+            pthread_join (threads[i], NULL);
+        } else if (work[i].n > 0) {
+            log_debug ("query scan: could not start a thread, evaluate range in the calling thread\n");
+            scan_worker (&work[i]);
+        }
+    }
+
+    t->nhits = 0;
+    for (i = 0; i < nthreads; i++) {
+        error |= work[i].error;
+        t->nhits += work[i].nhits;
+    }
+
+    t->hits = NULL;
+    if (!error && t->nhits > 0) {
+        t->hits = (uint64_t *) malloc (t->nhits * sizeof(uint64_t));
+        if (t->hits) {
+            uint64_t n = 0;
+            for (i = 0; i < nthreads; i++) {
+                if (work[i].nhits) {
+                    memcpy (t->hits + n, work[i].hits, work[i].nhits * sizeof(uint64_t));
+                    n += work[i].nhits;
+                }
+            }
+        } else {
+            error = 1;
+        }
+    }
+    for (i = 0; i < nthreads; i++)
+        free (work[i].hits);
+
+    if (error) {
+        adios_error (err_no_memory, "Query scan: cannot allocate memory to evaluate the query\n");
+        t->nhits = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/* Read the tile of every variable in the query. Leaves on the same variable
+   and the same region share the data. Returns 0 on success, -1 on error. */
+static int read_tile (SCAN_INTERNAL *qi, SCAN_TILE *t, int timestep)
+{
+    int ndim = qi->ndim;
+    int i, j, d;
+    int retval = 0;
+    ADIOS_SELECTION *sels[qi->nleaves];
+
+    for (i = 0; i < qi->nleaves; i++) {
+        SCAN_LEAF *leaf = &qi->leaves[i];
+        sels[i] = NULL;
+        if (!leaf->owns_data)
+            continue;
+
+        uint64_t start[ndim];
+        for (d = 0; d < ndim; d++)
+            start[d] = leaf->start[d] + t->start[d];
+        sels[i] = a2sel_boundingbox (ndim, start, t->count);
+        if (common_read_schedule_read_byid (leaf->q->file, sels[i], leaf->q->varinfo->varid,
+                                            timestep, 1, NULL, leaf->data)) {
+            retval = -1;
+        }
+    }
+
+    // perform the reads once for every file used in the query
+    for (i = 0; i < qi->nleaves && retval == 0; i++) {
+        if (!sels[i])
+            continue;
+        for (j = 0; j < i; j++) {
+            if (sels[j] && qi->leaves[j].q->file == qi->leaves[i].q->file)
+                break;
+        }
+        if (j == i && common_read_perform_reads (qi->leaves[i].q->file, 1)) {
+            retval = -1;
+        }
+    }
+
+    for (i = 0; i < qi->nleaves; i++) {
+        if (sels[i])
+            a2sel_free (sels[i]);
+    }
+    return retval;
+}
+
+/* Set up the leaves and their query domains at the timestep.
+   Returns 0 on success, -1 on error. */
+static int setup_leaves (ADIOS_QUERY *q, int timestep)
+{
+    SCAN_INTERNAL *qi = INTERNAL(q);
+    int i, j;
+
+    qi->nleaves = count_leaves (q);
+    qi->leaves = (SCAN_LEAF *) calloc (qi->nleaves, sizeof(SCAN_LEAF));
+    if (!qi->leaves) {
+        adios_error (err_no_memory, "Query scan: cannot allocate memory for the query\n");
+        return -1;
+    }
+    int n = 0;
+    collect_leaves (q, qi->leaves, &n);
+
+    for (i = 0; i < qi->nleaves; i++) {
+        SCAN_LEAF *leaf = &qi->leaves[i];
+        ADIOS_QUERY *lq = leaf->q;
+        ADIOS_VARINFO *v = lq->varinfo;
+        const uint64_t *count;
+
+        if (!v->blockinfo)
+            common_read_inq_var_blockinfo (lq->file, v); // get per block dimensions
+        if (!v->statistics)
+            common_read_inq_var_stat (lq->file, v, 0, 1); // get per block statistics
+        if (!v->blockinfo) {
+            adios_error (err_invalid_varname, "Query scan: cannot get the writeblocks of variable %s\n",
+                    lq->varName);
+            return -1;
+        }
+
+        if (i == 0) {
+            qi->ndim = v->ndim;
+            qi->count = (uint64_t *) malloc (qi->ndim * sizeof(uint64_t));
+        }
+        leaf->start = (uint64_t *) malloc (qi->ndim * sizeof(uint64_t));
+        if (!qi->count || !leaf->start) {
+            adios_error (err_no_memory, "Query scan: cannot allocate memory for the query\n");
+            return -1;
+        }
+        if (leaf_domain (lq, timestep, leaf->start, &count))
+            return -1;
+        if (i == 0) {
+            memcpy (qi->count, count, qi->ndim * sizeof(uint64_t));
+        } else if (memcmp (qi->count, count, qi->ndim * sizeof(uint64_t))) {
+            adios_error (err_incompatible_queries,
+                    "Query scan: the selection of variable %s has a different size "
+                    "than the selection of variable %s\n", lq->varName, qi->leaves[0].q->varName);
+            return -1;
+        }
+
+        leaf->vclass = value_class (v->type);
+        string_to_value (lq->predicateValue, leaf->vclass, &leaf->value);
+        leaf->elemsize = common_read_type_size (v->type, NULL);
+
+        leaf->owns_data = 1;
+        for (j = 0; j < i; j++) {
+            if (qi->leaves[j].owns_data && qi->leaves[j].q->file == lq->file &&
+                qi->leaves[j].q->varinfo->varid == v->varid &&
+                !memcmp (qi->leaves[j].start, leaf->start, qi->ndim * sizeof(uint64_t))) {
+                leaf->owns_data = 0;
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Cut the query domain into tiles along the writeblocks of the first variable,
+   prune them with the statistics, then read and evaluate the remaining ones.
+   Returns the total number of hits, -1 on error */
+static int64_t scan_process (ADIOS_QUERY *q, int timestep)
+{
+    SCAN_INTERNAL *qi = INTERNAL(q);
+    SCAN_LEAF *first = &qi->leaves[0];
+    ADIOS_VARINFO *v = first->q->varinfo;
+    int ndim = qi->ndim;
+    int i, j, d;
+    int64_t total = 0;
+
+    int bstart = block_start_index (v, timestep);
+    int nblocks = v->nblocks[timestep];
+
+    qi->tiles = (SCAN_TILE *) calloc (nblocks, sizeof(SCAN_TILE));
+    if (!qi->tiles && nblocks > 0) {
+        adios_error (err_no_memory, "Query scan: cannot allocate memory for the query\n");
+        return -1;
+    }
+
+    // cut the tiles and find the largest to allocate the data buffers
+    SCAN_TILE *tiles = qi->tiles;
+    int ntiles = 0;
+    uint64_t maxelems = 0;
+    uint64_t start[ndim], count[ndim];
+    for (i = 0; i < nblocks; i++) {
+        if (!intersect_block (ndim, first->start, qi->count, &v->blockinfo[bstart+i], start, count)) {
+            continue;
+        }
+        SCAN_TILE *t = &tiles[ntiles];
+        t->start = (uint64_t *) malloc (ndim * sizeof(uint64_t));
+        t->count = (uint64_t *) malloc (ndim * sizeof(uint64_t));
+        qi->ntiles = ++ntiles;
+        if (!t->start || !t->count) {
+            adios_error (err_no_memory, "Query scan: cannot allocate memory for the query\n");
+            return -1;
+        }
+        uint64_t nelems = 1;
+        for (d = 0; d < ndim; d++) {
+            t->start[d] = start[d] - first->start[d];
+            t->count[d] = count[d];
+            nelems *= count[d];
+        }
+        if (nelems > maxelems)
+            maxelems = nelems;
+        t->block = i;
+    }
+
+    for (i = 0; i < qi->nleaves; i++) {
+        SCAN_LEAF *leaf = &qi->leaves[i];
+        if (leaf->owns_data) {
+            leaf->data = (char *) malloc (maxelems * leaf->elemsize);
+            if (!leaf->data && maxelems > 0) {
+                adios_error (err_no_memory, "Query scan: cannot allocate %" PRIu64
+                        " bytes to read variable %s\n", maxelems * leaf->elemsize, leaf->q->varName);
+                return -1;
+            }
+        } else {
+            for (j = 0; j < i; j++) {
+                if (qi->leaves[j].owns_data && qi->leaves[j].q->file == leaf->q->file &&
+                    qi->leaves[j].q->varinfo->varid == leaf->q->varinfo->varid &&
+                    !memcmp (qi->leaves[j].start, leaf->start, ndim * sizeof(uint64_t))) {
+                    leaf->data = qi->leaves[j].data;
+                    break;
+                }
+            }
+        }
+    }
+
+    int nread = 0;
+    int nkept = 0;
+    for (i = 0; i < ntiles; i++) {
+        SCAN_TILE *t = &tiles[i];
+        if (tile_may_match (qi, q, t, timestep, t->block)) {
+            uint64_t nelems = 1;
+            for (d = 0; d < ndim; d++)
+                nelems *= t->count[d];
+            if (read_tile (qi, t, timestep) || eval_tile (q, t, nelems)) {
+                return -1;
+            }
+            nread++;
+        }
+        if (t->nhits > 0) {
+            // keep tiles with hits only
+            if (nkept != i) {
+                SCAN_TILE tmp = tiles[nkept];
+                tiles[nkept] = *t;
+                *t = tmp;
+            }
+            total += tiles[nkept].nhits;
+            nkept++;
+        }
+    }
+    for (i = nkept; i < ntiles; i++) {
+        free (tiles[i].start);
+        free (tiles[i].count);
+        free (tiles[i].hits);
+    }
+    qi->ntiles = nkept;
+
+    // the data is not needed anymore
+    for (i = 0; i < qi->nleaves; i++) {
+        if (qi->leaves[i].owns_data)
+            free (qi->leaves[i].data);
+        qi->leaves[i].data = NULL;
+        qi->leaves[i].owns_data = 0;
+    }
+
+    log_debug ("query scan: %d of %d writeblocks were read, %d have hits, total hits = %" PRId64 "\n",
+            nread, ntiles, nkept, total);
+    return total;
+}
+
+// Do the evaluation first time for this timestep
+// Return the total number of results available, -1 on error
+static int64_t do_evaluate_now (ADIOS_QUERY *q, int timestep)
+{
+    free_internal (q);
+    create_internal (q);
+    if (!q->queryInternal) {
+        adios_error (err_no_memory, "Query scan: cannot allocate memory for the query\n");
+        return -1;
+    }
+
+    q->resultsReadSoFar = 0;
+    q->maxResultsDesired = 0;
+
+    int64_t nhits = -1;
+    if (!setup_leaves (q, timestep))
+        nhits = scan_process (q, timestep);
+    if (nhits < 0) {
+        free_internal (q);
+        return -1;
+    }
+
+    q->maxResultsDesired = (uint64_t) nhits;
+    return nhits;
+}
+
+/* Remember the output selection at the first evaluation call of a timestep
+   or check that follow-up calls use the same. The points are returned in
+   the output selection's space, or in the space of the first variable's
+   selection if there is no output selection. */
+static int set_output_boundary (ADIOS_QUERY *q, ADIOS_SELECTION *outputBoundary)
+{
+    SCAN_INTERNAL *qi = INTERNAL(q);
+    int ndim = qi->ndim;
+    const uint64_t *start, *count;
+
+    if (outputBoundary == NULL) {
+        start = qi->leaves[0].start;
+        count = qi->count;
+    } else if (outputBoundary->type == ADIOS_SELECTION_BOUNDINGBOX) {
+        if (outputBoundary->u.bb.ndim != ndim) {
+            adios_error (err_incompatible_queries,
+                    "%s: the outputBoundary selection is not compatible with the "
+                    "selections used in the query conditions\n", __func__);
+            return -1;
+        }
+        start = outputBoundary->u.bb.start;
+        count = outputBoundary->u.bb.count;
+    } else {
+        adios_error (err_unsupported_selection,
+                "%s: the scan query method supports bounding box "
+                "outputBoundary selections only\n", __func__);
+        return -1;
+    }
+
+    if (memcmp (count, qi->count, ndim * sizeof(uint64_t))) {
+        adios_error (err_incompatible_queries,
+                "%s: the outputBoundary selection is not compatible with the "
+                "selections used in the query conditions\n", __func__);
+        return -1;
+    }
+
+    if (!qi->is_outputBoundary_set) {
+        qi->outstart = (uint64_t *) malloc (ndim * sizeof(uint64_t));
+        qi->outcount = (uint64_t *) malloc (ndim * sizeof(uint64_t));
+        if (!qi->outstart || !qi->outcount) {
+            adios_error (err_no_memory, "Query scan: cannot allocate memory for the query\n");
+            return -1;
+        }
+        memcpy (qi->outstart, start, ndim * sizeof(uint64_t));
+        memcpy (qi->outcount, count, ndim * sizeof(uint64_t));
+        qi->is_outputBoundary_set = 1;
+    } else if (memcmp (qi->outstart, start, ndim * sizeof(uint64_t))) {
+        adios_error (err_incompatible_queries,
+                "%s: follow-up query evaluation calls must use the same outputBoundary selection"
+                "as the first evaluation call\n", __func__);
+        return -1;
+    }
+    return 0;
+}
+
+/* Make the list of point selections of the next 'retrieval_size' hits,
+   one selection for each tile. Points are N-dimensional global coordinates. */
+static ADIOS_SELECTION * build_results (ADIOS_QUERY *q, uint64_t retrieval_size, int *nselections)
+{
+    SCAN_INTERNAL *qi = INTERNAL(q);
+    int ndim = qi->ndim;
+    int fortran_order = futils_is_called_from_fortran();
+    int i, d, nsel = 0;
+    uint64_t n, left;
+
+    // count the tiles touched by this batch
+    left = retrieval_size;
+    n = qi->current_hit;
+    for (i = qi->current_tile; i < qi->ntiles && left > 0; i++) {
+        uint64_t avail = qi->tiles[i].nhits - n;
+        left -= (avail < left ? avail : left);
+        n = 0;
+        nsel++;
+    }
+
+    ADIOS_SELECTION *result = (ADIOS_SELECTION *) calloc (nsel, sizeof(ADIOS_SELECTION));
+    if (!result) {
+        adios_error (err_no_memory, "Query scan: cannot allocate memory for the results\n");
+        *nselections = 0;
+        return NULL;
+    }
+
+    ADIOS_SELECTION *r = result;
+    left = retrieval_size;
+    for (i = qi->current_tile; i < qi->ntiles && left > 0; i++) {
+        SCAN_TILE *t = &qi->tiles[i];
+        uint64_t first = qi->current_hit;
+        uint64_t npoints = t->nhits - first;
+        if (npoints > left)
+            npoints = left;
+
+        uint64_t *points = (uint64_t *) malloc (npoints * ndim * sizeof(uint64_t));
+        if (!points) {
+            adios_error (err_no_memory, "Query scan: cannot allocate memory for the results\n");
+            while (r > result) {
+                r--;
+                free (r->u.points.points);
+            }
+            free (result);
+            *nselections = 0;
+            return NULL;
+        }
+        uint64_t *p = points;
+        for (n = first; n < first + npoints; n++) {
+            // 1D offset in tile -> N-D coordinate in output selection
+            uint64_t off = t->hits[n];
+            for (d = ndim-1; d >= 0; d--) {
+                uint64_t c = qi->outstart[d] + t->start[d] + off % t->count[d];
+                off /= t->count[d];
+                if (fortran_order)
+                    p[ndim-1-d] = c;
+                else
+                    p[d] = c;
+            }
+            p += ndim;
+        }
+
+        r->type = ADIOS_SELECTION_POINTS;
+        r->u.points.ndim = ndim;
+        r->u.points.npoints = npoints;
+        r->u.points.points = points;
+        r->u.points.container_selection = NULL;
+        r->u.points._free_points_on_delete = 1;
+        r++;
+
+        left -= npoints;
+        if (first + npoints < t->nhits) {
+            qi->current_hit = first + npoints;
+            break;
+        }
+        qi->current_hit = 0;
+        qi->current_tile = i + 1;
+    }
+
+    *nselections = (int) (r - result);
+    return result;
+}
+
+/*====================================================================================*/
+/*                                  Public functions
+*/
+
+int adios_query_scan_can_evaluate(ADIOS_QUERY* q)
+{
+    // we can evaluate only iff
+    // - every query item is on a NULL, bounding box or writeblock selection
+    // - the variable in each query item is a global array of a numeric type
+    // - the selections have the same number of dimensions and size
+    int ndim = 0;
+    uint64_t count[32];
+    memset (count, 0, sizeof(count));
+    return can_evaluate (q, &ndim, count);
+}
+
+
+int64_t adios_query_scan_estimate(ADIOS_QUERY* q, int timestep)
+{
+    const int absoluteTimestep = adios_get_actual_timestep(q, timestep);
+    // timestep is always 0 for streaming; the absolute timestep for files
+    // absoluteTimestep makes it possible to realize we have a new step
+    // in a stream here
+
+    int64_t retval = do_evaluate_now (q, timestep);
+    if (retval > -1) {
+        // this is treated as the first call to evaluate the query for a new timestep
+        // so no need to evaluate again when the evaluate function is called for the same timestep
+        q->onTimeStep = absoluteTimestep;
+    }
+    return retval;
+}
+
+
+int adios_query_scan_evaluate(ADIOS_QUERY* q,
+                   int timestep,
+                   uint64_t batchSize,
+                   ADIOS_SELECTION* outputBoundry,
+                   ADIOS_QUERY_RESULT * queryResult)
+{
+#ifdef BREAKDOWN
+    double tStart = 0, tEnd = 0;
+    tStart = dclock();
+#endif
+    const int absoluteTimestep = adios_get_actual_timestep(q, timestep);
+    // timestep is always 0 for streaming; the absolute timestep for files
+    // absoluteTimestep makes it possible to realize we have a new step
+    // in a stream here
+
+    if (q->onTimeStep != absoluteTimestep || !q->queryInternal)
+    {
+        // this is the first call to evaluate the query for a new timestep
+        if (!adios_query_scan_can_evaluate (q)) {
+            adios_error (err_incompatible_queries,
+                    "%s: the query is not compatible with the scan query method\n", __func__);
+            queryResult->status = ADIOS_QUERY_RESULT_ERROR;
+            return -1;
+        }
+        if (do_evaluate_now (q, timestep) < 0) {
+            queryResult->status = ADIOS_QUERY_RESULT_ERROR;
+            return -1;
+        }
+        q->onTimeStep = absoluteTimestep;
+    }
+
+    if (set_output_boundary (q, outputBoundry)) {
+        queryResult->status = ADIOS_QUERY_RESULT_ERROR;
+        return -1;
+    }
+
+    // calculate how many results we will return at this time
+    uint64_t retrievalSize = q->maxResultsDesired - q->resultsReadSoFar;
+    if (retrievalSize == 0) {
+        queryResult->nselections = 0;
+        queryResult->selections = NULL;
+        queryResult->npoints = 0;
+        queryResult->status = ADIOS_QUERY_NO_MORE_RESULTS;
+        return 0;
+    }
+    if (retrievalSize > batchSize) {
+        retrievalSize = batchSize;
+    }
+
+    int nselections;
+    queryResult->selections = build_results (q, retrievalSize, &nselections);
+    if (!queryResult->selections) {
+        queryResult->status = ADIOS_QUERY_RESULT_ERROR;
+        return -1;
+    }
+    queryResult->nselections = nselections;
+    queryResult->npoints = retrievalSize;
+
+    q->resultsReadSoFar += retrievalSize;
+
+#ifdef BREAKDOWN
+    tEnd= dclock();
+    printf("time [scan plugin] : %f \n", tEnd - tStart);
+#endif
+
+    if (q->resultsReadSoFar < q->maxResultsDesired)
+        queryResult->status = ADIOS_QUERY_HAS_MORE_RESULTS;
+    else
+        queryResult->status = ADIOS_QUERY_NO_MORE_RESULTS;
+    return 0;
+}
+
+
+int adios_query_scan_free(ADIOS_QUERY* query) {
+
+    if (query == NULL)
+        return 0;
+    free_internal (query);
+    return 1;
+}
+
+int adios_query_scan_finalize() { /* there is nothing to finalize */ return 0; }
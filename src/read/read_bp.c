@@ -15,6 +15,7 @@
 #include <math.h>
 #include <assert.h>
 #include <errno.h>
+#include <pthread.h>
 #include "public/adios_read.h"
 #include "public/adios_error.h"
 #include "public/adios_types.h"
@@ -29,6 +30,7 @@
 #include "core/a2sel.h"
 #include "core/adios_clock.h"
 #include "core/adios_selection_util.h"
+#include "core/adios_subvolume.h"
 
 #include "core/transforms/adios_transforms_transinfo.h"
 #include "core/transforms/adios_transforms_common.h" // NCSU ALACRITY-ADIOS
@@ -38,14 +40,30 @@
 #endif
 
 static int chunk_buffer_size = 1024*1024*16;
+static int chunk_buffers = 2; // ring of chunk buffers for reads without user memory
 static int poll_interval_msec = 10000; // 10 secs by default
 static int show_hidden_attrs = 0; // don't show hidden attr by default
+static int use_mmap = 1; // map the file if there is a single reader
+static int use_index_cache = 0; // keep the variable index in <fname>.idx
+static int use_lazy_index = 1; // decode a variable's index when it is first accessed
+static int use_sieve = 1; // coalesce nearby reads of one adios_perform_reads()
+static int use_inotify = 1; // wait for stream steps with inotify instead of sleeping
+static int sieve_gap = 64*1024; // max bytes between two reads to be coalesced
+static int sieve_buffer_size = 1024*1024*64; // memory for coalesced reads
+static int use_prefetch = 0; // read the selections of the last adios_perform_reads() for the next step
+static uint64_t prefetch_buffer_size = 1024*1024*256; // memory for read-ahead
 
 static ADIOS_VARCHUNK * read_var_bb  (const ADIOS_FILE * fp, read_request * r);
 static ADIOS_VARCHUNK * read_var_pts (const ADIOS_FILE * fp, read_request * r);
 static ADIOS_VARCHUNK * read_var_wb  (const ADIOS_FILE * fp, read_request * r);
 
 static int map_req_varid (const ADIOS_FILE * fp, int varid);
+static void read_engine_finish (BP_PROC * p);
+static void chunk_ring_finish (BP_PROC * p);
+static void prefetch_wait (BP_PROC * p);
+static void prefetch_drop_served (BP_PROC * p);
+static void prefetch_free (BP_PROC * p);
+static void prefetch_start (const ADIOS_FILE * fp);
 static int adios_wbidx_to_pgidx (const ADIOS_FILE * fp, read_request * r, int step_offset);
 
 // NCSU - For custom memory allocation
@@ -98,170 +116,187 @@ static int adios_wbidx_to_pgidx (const ADIOS_FILE * fp, read_request * r, int st
         }                                                                           \
     }
 
-#define MPI_FILE_READ_OPS1                          \
-        bp_realloc_aligned(fh->b, slice_size);      \
-        fh->b->offset = 0;                          \
-                                                    \
-        MPI_File_seek (fh->mpi_fh                   \
-                      ,(MPI_Offset)slice_offset     \
-                      ,MPI_SEEK_SET                 \
-                      );                            \
-        MPI_FILE_READ64 (fh->mpi_fh                 \
-                        ,fh->b->buff                \
-                        ,slice_size                 \
-                        ,MPI_BYTE                   \
-                        ,&status                    \
-                        );                          \
-        fh->b->offset = 0;                          \
-
-// To read subfiles
-#define MPI_FILE_READ_OPS2                                                                  \
-        bp_realloc_aligned(fh->b, slice_size);                                              \
-        fh->b->offset = 0;                                                                  \
-                                                                                            \
-        MPI_File * sfh;                                                                     \
-        sfh = get_BP_subfile_handle (fh, v->characteristics[start_idx + idx].file_index);   \
-        if (!sfh)                                                                           \
+#define MPI_FILE_READ_OPS1                                                                  \
+        if (!bp_map_slice (fh->b, fh->mmap_base, fh->mmap_size,                             \
+                           slice_offset, slice_size) &&                                     \
+            !bp_map_sieved_slice (fh, 0, slice_offset, slice_size))                         \
         {                                                                                   \
-            int err;                                                                        \
-            char * ch, * name_no_path, * name;                                              \
-            MPI_Info info = MPI_INFO_NULL;                                                  \
-            struct BP_file_handle * new_h =                                                 \
-                  (struct BP_file_handle *) malloc (sizeof (struct BP_file_handle));        \
-            new_h->file_index = v->characteristics[start_idx + idx].file_index;             \
-            new_h->next = 0;                                                                \
-            if ( (ch = strrchr (fh->fname, '/')) )                                          \
-            {                                                                               \
-                name_no_path = (char *) malloc (strlen (ch + 1) + 1);                       \
-                strcpy (name_no_path, ch + 1);                                              \
-            }                                                                               \
-            else                                                                            \
-            {                                                                               \
-                name_no_path = (char *) malloc (strlen (fh->fname) + 1);                    \
-                strcpy (name_no_path, fh->fname);                                           \
-            }                                                                               \
+            bp_realloc_aligned(fh->b, slice_size);                                          \
+            fh->b->offset = 0;                                                              \
                                                                                             \
-            name = (char *) malloc (strlen (fh->fname) + 5 + strlen (name_no_path) + 1 + 10 + 1); \
-            sprintf (name, "%s.dir/%s.%d", fh->fname, name_no_path, new_h->file_index);     \
-            err = MPI_File_open (MPI_COMM_SELF                                                   \
-                                ,name                                                       \
-                                ,MPI_MODE_RDONLY                                            \
-                                ,info                                                       \
-                                ,&new_h->fh                                                 \
-                                );                                                          \
-                                                                                            \
-           if (err)                                                                         \
-           {                                                                                \
-               fprintf (stderr, "can not open file %s\n", name);                            \
-               return 0;                                                                    \
-           }                                                                                \
-           add_BP_subfile_handle (fh, new_h);                                                  \
-           sfh = &new_h->fh;                                                                \
-                                                                                            \
-           free (name_no_path);                                                             \
-           free (name);                                                                     \
+            MPI_File_seek (fh->mpi_fh                                                       \
+                          ,(MPI_Offset)slice_offset                                         \
+                          ,MPI_SEEK_SET                                                     \
+                          );                                                                \
+            MPI_FILE_READ64 (fh->mpi_fh                                                     \
+                            ,fh->b->buff                                                    \
+                            ,slice_size                                                     \
+                            ,MPI_BYTE                                                       \
+                            ,&status                                                        \
+                            );                                                              \
         }                                                                                   \
-                                                                                            \
-        MPI_File_seek (*sfh                                                                 \
-                      ,(MPI_Offset)slice_offset                                             \
-                      ,MPI_SEEK_SET                                                         \
-                      );                                                                    \
-        MPI_FILE_READ64 (*sfh                                                               \
-                        ,fh->b->buff                                                        \
-                        ,slice_size                                                         \
-                        ,MPI_BYTE                                                           \
-                        ,&status                                                            \
-                        );                                                                  \
         fh->b->offset = 0;                                                                  \
 
+// To read subfiles
+#define MPI_FILE_READ_OPS2                                                                           \
+        struct BP_file_handle * sfh;                                                                 \
+        sfh = open_BP_subfile (fh, v->characteristics[start_idx + idx].file_index);                  \
+        if (!sfh)                                                                                    \
+        {                                                                                            \
+            return 0;                                                                                \
+        }                                                                                            \
+                                                                                                     \
+        if (!bp_map_slice (fh->b, sfh->mmap_base, sfh->mmap_size,                                    \
+                           slice_offset, slice_size) &&                                              \
+            !bp_map_sieved_slice (fh, sfh->file_index, slice_offset, slice_size))                    \
+        {                                                                                            \
+            bp_realloc_aligned(fh->b, slice_size);                                                   \
+                                                                                                     \
+            MPI_File_seek (sfh->fh                                                                   \
+                          ,(MPI_Offset)slice_offset                                                  \
+                          ,MPI_SEEK_SET                                                              \
+                          );                                                                         \
+            MPI_FILE_READ64 (sfh->fh                                                                 \
+                            ,fh->b->buff                                                             \
+                            ,slice_size                                                              \
+                            ,MPI_BYTE                                                                \
+                            ,&status                                                                 \
+                            );                                                                       \
+        }                                                                                            \
+        fh->b->offset = 0;                                                                           \
+
 //We also need to be able to read old .bp which doesn't have 'payload_offset'
-#define MPI_FILE_READ_OPS3                                                                  \
-        MPI_File_seek (fh->mpi_fh                                                           \
-                      ,(MPI_Offset) v->characteristics[start_idx + idx].offset       \
-                      ,MPI_SEEK_SET);                                                       \
-        MPI_File_read (fh->mpi_fh, fh->b->buff, 8, MPI_BYTE, &status);                      \
-        tmpcount= *((uint64_t*)fh->b->buff);                                                \
-                                                                                            \
-        bp_realloc_aligned(fh->b, tmpcount + 8);                                            \
-        fh->b->offset = 0;                                                                  \
-                                                                                            \
-        MPI_File_seek (fh->mpi_fh                                                           \
-                      ,(MPI_Offset) (v->characteristics[start_idx + idx].offset)     \
-                      ,MPI_SEEK_SET);                                                       \
-        MPI_FILE_READ64 (fh->mpi_fh, fh->b->buff, tmpcount + 8, MPI_BYTE, &status);         \
-        fh->b->offset = 0;                                                                  \
-        adios_parse_var_data_header_v1 (fh->b, &var_header);                                \
+#define MPI_FILE_READ_OPS3                                                                            \
+        if (fh->mmap_base && v->characteristics[start_idx + idx].offset + 8 <= fh->mmap_size)         \
+        {                                                                                             \
+            tmpcount = *((uint64_t*)(fh->mmap_base + v->characteristics[start_idx + idx].offset));    \
+        }                                                                                             \
+        else                                                                                          \
+        {                                                                                             \
+            MPI_File_seek (fh->mpi_fh                                                                 \
+                          ,(MPI_Offset) v->characteristics[start_idx + idx].offset                    \
+                          ,MPI_SEEK_SET);                                                             \
+            bp_realloc_aligned(fh->b, 8);                                                             \
+            MPI_File_read (fh->mpi_fh, fh->b->buff, 8, MPI_BYTE, &status);                            \
+            tmpcount= *((uint64_t*)fh->b->buff);                                                      \
+        }                                                                                             \
+                                                                                                      \
+        if (!bp_map_slice (fh->b, fh->mmap_base, fh->mmap_size,                                       \
+                           v->characteristics[start_idx + idx].offset, tmpcount + 8))                 \
+        {                                                                                             \
+            bp_realloc_aligned(fh->b, tmpcount + 8);                                                  \
+            fh->b->offset = 0;                                                                        \
+                                                                                                      \
+            MPI_File_seek (fh->mpi_fh                                                                 \
+                          ,(MPI_Offset) (v->characteristics[start_idx + idx].offset)                  \
+                          ,MPI_SEEK_SET);                                                             \
+            MPI_FILE_READ64 (fh->mpi_fh, fh->b->buff, tmpcount + 8, MPI_BYTE, &status);               \
+        }                                                                                             \
+        fh->b->offset = 0;                                                                            \
+        adios_parse_var_data_header_v1 (fh->b, &var_header);                                          \
 
 // NCSU ALACRITY-ADIOS: After much pain and consideration, I've decided to implement a
 //     2nd version of this function to avoid substantial wasted time in the writeblock method
-#define MPI_FILE_READ_OPS1_BUF(buf)                 \
-        MPI_File_seek (fh->mpi_fh                   \
-                      ,(MPI_Offset)slice_offset     \
-                      ,MPI_SEEK_SET                 \
-                      );                            \
-        MPI_FILE_READ64 (fh->mpi_fh                 \
-                        ,(buf)                      \
-                        ,slice_size                 \
-                        ,MPI_BYTE                   \
-                        ,&status                    \
-                        );
+#define MPI_FILE_READ_OPS1_BUF(buf)                                                         \
+        if (!bp_copy_mapped_slice ((buf), fh->mmap_base, fh->mmap_size,                     \
+                                   slice_offset, slice_size) &&                             \
+            !bp_copy_sieved_slice (fh, (buf), 0, slice_offset, slice_size))                 \
+        {                                                                                   \
+            MPI_File_seek (fh->mpi_fh                                                       \
+                          ,(MPI_Offset)slice_offset                                         \
+                          ,MPI_SEEK_SET                                                     \
+                          );                                                                \
+            MPI_FILE_READ64 (fh->mpi_fh                                                     \
+                            ,(buf)                                                          \
+                            ,slice_size                                                     \
+                            ,MPI_BYTE                                                       \
+                            ,&status                                                        \
+                            );                                                              \
+        }
 
 // To read subfiles
-#define MPI_FILE_READ_OPS2_BUF(buf)                                                         \
-        MPI_File * sfh;                                                                     \
-        sfh = get_BP_subfile_handle (fh, v->characteristics[start_idx + idx].file_index);   \
-        if (!sfh)                                                                           \
-        {                                                                                   \
-            int err;                                                                        \
-            char * ch, * name_no_path, * name;                                              \
-            MPI_Info info = MPI_INFO_NULL;                                                  \
-            struct BP_file_handle * new_h =                                                 \
-                  (struct BP_file_handle *) malloc (sizeof (struct BP_file_handle));        \
-            new_h->file_index = v->characteristics[start_idx + idx].file_index;             \
-            new_h->next = 0;                                                                \
-            if ((ch = strrchr (fh->fname, '/')))                                              \
-            {                                                                               \
-                name_no_path = (char *) malloc (strlen (ch + 1) + 1);                       \
-                strcpy (name_no_path, ch + 1);                                              \
-            }                                                                               \
-            else                                                                            \
-            {                                                                               \
-                name_no_path = (char *) malloc (strlen (fh->fname) + 1);                    \
-                strcpy (name_no_path, fh->fname);                                           \
-            }                                                                               \
-                                                                                            \
-            name = (char *) malloc (strlen (fh->fname) + 5 + strlen (name_no_path) + 1 + 10 + 1); \
-            sprintf (name, "%s.dir/%s.%d", fh->fname, name_no_path, new_h->file_index);     \
-            err = MPI_File_open (MPI_COMM_SELF                                                   \
-                                ,name                                                       \
-                                ,MPI_MODE_RDONLY                                            \
-                                ,info                                                       \
-                                ,&new_h->fh                                                 \
-                                );                                                          \
-                                                                                            \
-           if (err)                                                                         \
-           {                                                                                \
-               fprintf (stderr, "can not open file %s\n", name);                            \
-               return 0;                                                                    \
-           }                                                                                \
-           add_BP_subfile_handle (fh, new_h);                                                 \
-           sfh = &new_h->fh;                                                                \
-                                                                                            \
-           free (name_no_path);                                                             \
-           free (name);                                                                     \
-        }                                                                                   \
-                                                                                            \
-        MPI_File_seek (*sfh                                                                 \
-                      ,(MPI_Offset)slice_offset                                             \
-                      ,MPI_SEEK_SET                                                         \
-                      );                                                                    \
-        MPI_FILE_READ64 (*sfh                                                               \
-                        ,(buf)                                                              \
-                        ,slice_size                                                         \
-                        ,MPI_BYTE                                                           \
-                        ,&status                                                            \
+#define MPI_FILE_READ_OPS2_BUF(buf)                                                                  \
+        struct BP_file_handle * sfh;                                                                 \
+        sfh = open_BP_subfile (fh, v->characteristics[start_idx + idx].file_index);                  \
+        if (!sfh)                                                                                    \
+        {                                                                                            \
+            return 0;                                                                                \
+        }                                                                                            \
+                                                                                                     \
+        if (!bp_copy_mapped_slice ((buf), sfh->mmap_base, sfh->mmap_size,                            \
+                                   slice_offset, slice_size) &&                                      \
+            !bp_copy_sieved_slice (fh, (buf), sfh->file_index, slice_offset, slice_size))            \
+        {                                                                                            \
+            MPI_File_seek (sfh->fh                                                                   \
+                          ,(MPI_Offset)slice_offset                                                  \
+                          ,MPI_SEEK_SET                                                              \
+                          );                                                                         \
+            MPI_FILE_READ64 (sfh->fh                                                                 \
+                            ,(buf)                                                                   \
+                            ,slice_size                                                              \
+                            ,MPI_BYTE                                                                \
+                            ,&status                                                                 \
+                            );                                                                       \
+        }
+
+
+/* Return the handle of a subfile, open (and map) it at first access */
+static struct BP_file_handle * open_BP_subfile (BP_FILE * fh, uint32_t file_index)
+{
+    int err;
+    char * ch, * name_no_path, * name;
+    MPI_Info info = MPI_INFO_NULL;
+    struct BP_file_handle * new_h;
+
+    new_h = get_BP_subfile (fh, file_index);
+    if (new_h)
+    {
+        return new_h;
+    }
+
+    new_h = (struct BP_file_handle *) malloc (sizeof (struct BP_file_handle));
+    new_h->file_index = file_index;
+    new_h->next = 0;
+    new_h->mmap_base = 0;
+    new_h->mmap_size = 0;
+    if ( (ch = strrchr (fh->fname, '/')) )
+    {
+        name_no_path = (char *) malloc (strlen (ch + 1) + 1);
+        strcpy (name_no_path, ch + 1);
+    }
+    else
+    {
+        name_no_path = (char *) malloc (strlen (fh->fname) + 1);
+        strcpy (name_no_path, fh->fname);
+    }
+
+    name = (char *) malloc (strlen (fh->fname) + 5 + strlen (name_no_path) + 1 + 10 + 1);
+    sprintf (name, "%s.dir/%s.%d", fh->fname, name_no_path, new_h->file_index);
+    err = MPI_File_open (MPI_COMM_SELF
+                        ,name
+                        ,MPI_MODE_RDONLY
+                        ,info
+                        ,&new_h->fh
                         );
 
+    if (err)
+    {
+        fprintf (stderr, "can not open file %s\n", name);
+        free (new_h);
+        free (name_no_path);
+        free (name);
+        return 0;
+    }
+    if (fh->mmap_base)
+    {
+        new_h->mmap_base = bp_mmap_file (name, &new_h->mmap_size);
+    }
+    add_BP_subfile_handle (fh, new_h);
+
+    free (name_no_path);
+    free (name);
+    return new_h;
+}
 
 /* This routine release one step. It only frees the var/attr namelist. */
 static void release_step (ADIOS_FILE *fp)
@@ -319,40 +354,25 @@ static BP_FILE * open_file (const char * fname, MPI_Comm comm)
     }
 
     fh = BP_FILE_alloc (fname, comm);
+    fh->mmap_enabled = use_mmap;
 
     bp_open (fname, comm, fh);
 
     return fh;
 }
 
-/* This routine set ADIOS_FILE fields from BP_FILE struct */
+/* This routine set ADIOS_FILE fields from a new or refreshed BP_FILE struct */
 void build_ADIOS_FILE_struct (ADIOS_FILE * fp, BP_FILE * fh)
 {
-    BP_PROC * p;
-    int rank;
+    BP_PROC * p = GET_BP_PROC (fp);
 
     log_debug ("build_ADIOS_FILE_struct is called\n");
 
-    MPI_Comm_rank (fh->comm, &rank);
-
-    p = (BP_PROC *) malloc (sizeof (BP_PROC));
-    assert (p);
     p->fh = fh;
-    p->streaming = 1;
-    p->varid_mapping = 0;
-    p->local_read_request_list = 0;
-    p->b = 0;
-    p->priv = 0;
 
-    fp->fh = (uint64_t) p;
     fp->file_size = fh->mfooter.file_size;
     fp->version = fh->mfooter.version & ADIOS_VERSION_NUM_MASK;
     fp->endianness = bp_get_endianness (fh->mfooter.change_endianness);
-    fp->last_step = fh->tidx_stop - 1;
-
-    /* Seek to the initial step. */
-    release_step (fp);
-    bp_seek_to_step (fp, 0, show_hidden_attrs);
 
     /* For file, the last step is tidx_stop */
     fp->last_step = fh->tidx_stop - 1;
@@ -360,12 +380,33 @@ void build_ADIOS_FILE_struct (ADIOS_FILE * fp, BP_FILE * fh)
     return;
 }
 
-static int get_new_step (ADIOS_FILE * fp, const char * fname, MPI_Comm comm, int last_tidx, float timeout_sec)
+/* Poll the file of a stream until it has steps after last_tidx.
+ * The open BP_FILE is extended with the index of the new steps by
+ * bp_refresh(), which costs only a file size check on rank 0 while nothing
+ * is written. The file is opened again only if it was not simply appended to.
+ * Between two checks rank 0 waits for the writer to close the file or touch
+ * its step marker (inotify), or sleeps poll_interval_msec if it cannot.
+ */
+static int get_new_step (ADIOS_FILE * fp, int last_tidx, float timeout_sec)
 {
+    BP_PROC * p = GET_BP_PROC (fp);
     BP_FILE * new_fh;
+    char * fname = strdup (p->fh->fname);
+    MPI_Comm comm = p->fh->comm;
+    int rank, status, watching;
+    int watch = -1;
     double t1 = adios_gettime_double();
 
     log_debug ("enter get_new_step\n");
+
+    MPI_Comm_rank (comm, &rank);
+    if (rank == 0 && use_inotify && timeout_sec != 0.0)
+    {
+        watch = bp_watch_file (fname);
+    }
+    watching = (watch >= 0);
+    MPI_Bcast (&watching, 1, MPI_INT, 0, comm);
+
     /* First check if the file has been updated with more steps. */
     /* While loop for handling timeout
        timeout > 0: wait up to this long to open the stream
@@ -377,26 +418,32 @@ static int get_new_step (ADIOS_FILE * fp, const char * fname, MPI_Comm comm, int
 
     while (stay_in_poll_loop)
     {
-        /* Re-open the file */
-        new_fh = open_file (fname, comm);
-        if (!new_fh)
-        {
-            // file is bad so keeps polling.
-            stay_in_poll_loop = 1;
-        }
-        else if (new_fh && new_fh->tidx_stop == last_tidx)
+        status = p->fh ? bp_refresh (p->fh) : -1;
+        if (status < 0)
         {
-            // file is good but no new steps in it. Continue polling.
-            bp_close (new_fh);
-            stay_in_poll_loop = 1;
+            /* Re-open the file */
+            if (p->fh)
+            {
+                bp_close (p->fh);
+                p->fh = 0;
+            }
+            new_fh = open_file (fname, comm);
+            if (new_fh)
+            {
+                build_ADIOS_FILE_struct (fp, new_fh);
+                status = 1;
+            }
         }
-        else
+
+        if (status > 0 && p->fh->tidx_stop != last_tidx)
         {
             // the file looks good and there are new steps written.
-            build_ADIOS_FILE_struct (fp, new_fh);
+            build_ADIOS_FILE_struct (fp, p->fh);
             stay_in_poll_loop = 0;
             found_stream = 1;
         }
+        // else the file is bad or has no new steps in it. Continue polling.
+
         // check if we need to stay in loop
         if (stay_in_poll_loop)
         {
@@ -404,24 +451,25 @@ static int get_new_step (ADIOS_FILE * fp, const char * fname, MPI_Comm comm, int
             {
                 stay_in_poll_loop = 0;
             }
-            else if (timeout_sec < 0.0)
-            {
-                stay_in_poll_loop = 1;
-            }
             else if (timeout_sec > 0.0 && (adios_gettime_double () - t1 > timeout_sec))
             {
                 log_debug ("Time is out in get_new_step()\n");
                 stay_in_poll_loop = 0;
             }
-            else
+            else if (rank == 0 || !watching)
             {
-                adios_nanosleep (poll_interval_msec/1000,
-                    (int)(((uint64_t)poll_interval_msec * 1000000L)%1000000000L));
+                // the other processes wait for rank 0 in the next bp_refresh()
+                bp_wait_for_change (watch, fname, poll_interval_msec);
             }
         }
 
+        // leave the loop together with rank 0, the clocks may differ
+        MPI_Bcast (&stay_in_poll_loop, 1, MPI_INT, 0, comm);
+
     } // while (stay_in_poll_loop)
 
+    bp_unwatch_file (watch);
+    free (fname);
     log_debug ("exit get_new_step\n");
 
     return found_stream;
@@ -941,11 +989,9 @@ static ADIOS_VARCHUNK * read_var_bb (const ADIOS_FILE *fp, read_request * r)
                          MPI_FILE_READ_OPS3
                     }
 
-                    memcpy ((char *)data, fh->b->buff + fh->b->offset, slice_size);
-                    if (fh->mfooter.change_endianness == adios_flag_yes)
-                    {
-                        change_endianness (data, slice_size, v->type);
-                    }
+                    copy_strided_rows (data, fh->b->buff + fh->b->offset,
+                                       0, NULL, NULL, NULL, slice_size,
+                                       v->type, fh->mfooter.change_endianness);
                 }
                 else if (hole_break == 0)
                 {
@@ -1004,11 +1050,9 @@ static ADIOS_VARCHUNK * read_var_bb (const ADIOS_FILE *fp, read_request * r)
                         MPI_FILE_READ_OPS3
                     }
 
-                    memcpy ((char *)data + write_offset, fh->b->buff + fh->b->offset, slice_size);
-                    if (fh->mfooter.change_endianness == adios_flag_yes)
-                    {
-                        change_endianness((char *)data + write_offset, slice_size, v->type);
-                    }
+                    copy_strided_rows ((char *)data + write_offset, fh->b->buff + fh->b->offset,
+                                       0, NULL, NULL, NULL, slice_size,
+                                       v->type, fh->mfooter.change_endianness);
 
                     //write_offset +=  slice_size;
                 }
@@ -1159,6 +1203,324 @@ static ADIOS_VARCHUNK * read_var_bb (const ADIOS_FILE *fp, read_request * r)
     return chunk;
 }
 
+/* A point of a point selection in the block-grouped point read.
+   block is the characteristic holding the point (-1 if none). offset is first
+   the global coordinate of the point in the slowest dimension, then its
+   linear offset inside the block. index is its position in the caller's list.
+*/
+struct point_ref
+{
+    int64_t block;
+    uint64_t offset;
+    uint64_t index;
+};
+
+static int cmp_point_ref (const void * a, const void * b)
+{
+    const struct point_ref * x = (const struct point_ref *) a;
+    const struct point_ref * y = (const struct point_ref *) b;
+
+    if (x->block != y->block)
+        return (x->block < y->block ? -1 : 1);
+    if (x->offset != y->offset)
+        return (x->offset < y->offset ? -1 : 1);
+    return (x->index < y->index ? -1 : (x->index > y->index));
+}
+
+/* Check whether the points of request r can be read from the writeblocks
+   directly: every block in the requested steps has to be an untransformed
+   global array with 'ndim' dimensions and a known payload offset.
+*/
+static int points_by_blocks_supported (const ADIOS_FILE * fp, struct adios_index_var_struct_v1 * v,
+                                       read_request * r, int ndim)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh = GET_BP_FILE (fp);
+    int file_is_fortran = is_fortran_file (fh);
+    uint64_t ldims[32], gdims[32], offsets[32];
+    int64_t start_idx, stop_idx, idx;
+    int step, t, time, has_time;
+
+    if (ndim <= 0 || futils_is_called_from_fortran ())
+        return 0;
+
+    for (step = 0; step < r->nsteps; step++)
+    {
+        t = fp->current_step + r->from_steps + step;
+        time = p->streaming ? fh->tidx_start + t : get_time (v, t);
+        start_idx = get_var_start_index (v, time);
+        stop_idx = get_var_stop_index (v, time);
+        if (start_idx < 0 || stop_idx < 0)
+            continue;
+
+        for (idx = start_idx; idx <= stop_idx; idx++)
+        {
+            struct adios_index_characteristic_struct_v1 * ch = &v->characteristics[idx];
+            if (ch->transform.transform_type != adios_transform_none || !ch->payload_offset)
+                return 0;
+            if (!bp_get_dimension_generic_notime (&ch->dims, ldims, gdims, offsets,
+                                                  file_is_fortran, &has_time))
+                return 0;
+            if (ch->dims.count - has_time != ndim)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/* Read 'nelements' elements of the writeblock 'idx' from 'element_offset' on
+   into data, in file byte order. Returns 0 if the data cannot be read.
+*/
+static int read_block_elements (const ADIOS_FILE * fp, struct adios_index_var_struct_v1 * v,
+                                int64_t idx, uint64_t element_offset, uint64_t nelements,
+                                int size_of_type, void * data)
+{
+    BP_FILE * fh = GET_BP_FILE (fp);
+    struct adios_index_characteristic_struct_v1 * ch = &v->characteristics[idx];
+    uint64_t slice_offset, slice_size, total_read = 0;
+    MPI_File mfh = fh->mpi_fh;
+    char * mmap_base = fh->mmap_base;
+    uint64_t mmap_size = fh->mmap_size;
+    uint32_t file_index = 0;
+    MPI_Status status;
+    int read_len, count;
+
+    slice_offset = ch->payload_offset + element_offset * size_of_type;
+    slice_size = nelements * size_of_type;
+
+    if (has_subfiles (fh))
+    {
+        struct BP_file_handle * sfh = open_BP_subfile (fh, ch->file_index);
+        if (!sfh)
+        {
+            return 0;
+        }
+        mfh = sfh->fh;
+        mmap_base = sfh->mmap_base;
+        mmap_size = sfh->mmap_size;
+        file_index = sfh->file_index;
+    }
+
+    if (bp_copy_mapped_slice (data, mmap_base, mmap_size, slice_offset, slice_size) ||
+        bp_copy_sieved_slice (fh, data, file_index, slice_offset, slice_size))
+    {
+        return 1;
+    }
+
+    // as MPI_FILE_READ64, but a short read fails the extent
+    MPI_File_seek (mfh, (MPI_Offset) slice_offset, MPI_SEEK_SET);
+    while (total_read < slice_size)
+    {
+        read_len = (slice_size - total_read > MAX_MPIWRITE_SIZE) ?
+                        MAX_MPIWRITE_SIZE : (int) (slice_size - total_read);
+        MPI_File_read (mfh, (char *) data + total_read, read_len, MPI_BYTE, &status);
+        MPI_Get_count (&status, MPI_BYTE, &count);
+        if (count != read_len)
+        {
+            log_error ("Could only read %d of %d bytes of variable %s at offset %" PRIu64 "\n",
+                       count, read_len, v->var_name, slice_offset + total_read);
+            return 0;
+        }
+        total_read += count;
+    }
+    return 1;
+}
+
+/* Read the points of a point selection with a bounding box container at one
+   step, without reading the bounding box of the points.
+   The points are sorted and grouped by the writeblock that holds them, points
+   of a block that are at most sieve_gap bytes apart are coalesced into one
+   extent, and only the extents are read. The values are stored in dest in the
+   caller's order of points. Points outside of the container or of all
+   writeblocks get 0.
+   Returns 0 on success, err_no_memory if memory could not be allocated and
+   err_file_read_error if an extent could not be read.
+*/
+static int read_points_by_blocks (const ADIOS_FILE * fp, struct adios_index_var_struct_v1 * v,
+                                  read_request * r, int step, int size_of_type, char * dest,
+                                  uint64_t * nelems_read, int * nreads_performed, uint64_t * nerr)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh = GET_BP_FILE (fp);
+    ADIOS_SELECTION_POINTS_STRUCT * pts = &r->sel->u.points;
+    ADIOS_SELECTION_BOUNDINGBOX_STRUCT * cont = &pts->container_selection->u.bb;
+    int ndim = cont->ndim;
+    int file_is_fortran = is_fortran_file (fh);
+    uint64_t npoints = pts->npoints;
+    uint64_t ldims[32], gdims[32], offsets[32];
+    uint64_t i, j, k, n, lo, hi;
+    int64_t start_idx, stop_idx, idx;
+    int d, t, time;
+
+    memset (dest, 0, npoints * size_of_type);
+
+    t = fp->current_step + r->from_steps + step;
+    time = p->streaming ? fh->tidx_start + t : get_time (v, t);
+    start_idx = get_var_start_index (v, time);
+    stop_idx = get_var_stop_index (v, time);
+    if (start_idx < 0 || stop_idx < 0)
+    {
+        adios_error (err_no_data_at_timestep,"Variable %s has no data at %d time step\n",
+                     v->var_name, t);
+        return 0;
+    }
+
+    uint64_t * coords = (uint64_t *) malloc (npoints * ndim * sizeof(uint64_t));
+    struct point_ref * refs = (struct point_ref *) malloc (npoints * sizeof(struct point_ref));
+    if (!coords || !refs)
+    {
+        free (coords);
+        free (refs);
+        return err_no_memory;
+    }
+
+    // global coordinates of the points
+    if (pts->ndim == ndim)
+    {
+        for (i = 0; i < npoints; i++)
+        {
+            for (d = 0; d < ndim; d++)
+            {
+                coords[i*ndim+d] = pts->points[i*ndim+d] + cont->start[d];
+            }
+        }
+    }
+    else
+    {
+        a2sel_points_1DtoND_box (npoints, pts->points, ndim, cont->start, cont->count, 1, coords);
+    }
+
+    // sort the points inside the container by their slowest coordinate
+    n = 0;
+    for (i = 0; i < npoints; i++)
+    {
+        uint64_t * c = coords + i*ndim;
+        for (d = 0; d < ndim; d++)
+        {
+            if (c[d] < cont->start[d] || c[d] >= cont->start[d] + cont->count[d])
+                break;
+        }
+        if (d < ndim)
+        {
+            (*nerr)++;
+            continue;
+        }
+        refs[n].block = -1;
+        refs[n].offset = c[0];
+        refs[n].index = i;
+        n++;
+    }
+    qsort (refs, n, sizeof(struct point_ref), cmp_point_ref);
+
+    // find the block of each point; a later block wins like in read_var_bb()
+    for (idx = start_idx; idx <= stop_idx; idx++)
+    {
+        bp_get_dimension_characteristics_notime (&(v->characteristics[idx]),
+                                                 ldims, gdims, offsets, file_is_fortran);
+        lo = 0;
+        hi = n;
+        while (lo < hi)
+        {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (refs[mid].offset < offsets[0])
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        for (j = lo; j < n && refs[j].offset < offsets[0] + ldims[0]; j++)
+        {
+            uint64_t * c = coords + refs[j].index*ndim;
+            for (d = 1; d < ndim; d++)
+            {
+                if (c[d] < offsets[d] || c[d] >= offsets[d] + ldims[d])
+                    break;
+            }
+            if (d == ndim)
+                refs[j].block = idx;
+        }
+    }
+
+    // linear offset of each point in its block
+    for (j = 0; j < n; j++)
+    {
+        if (refs[j].block < 0)
+            continue;
+        bp_get_dimension_characteristics_notime (&(v->characteristics[refs[j].block]),
+                                                 ldims, gdims, offsets, file_is_fortran);
+        uint64_t * c = coords + refs[j].index*ndim;
+        uint64_t offset = 0;
+        for (d = 0; d < ndim; d++)
+        {
+            offset = offset * ldims[d] + (c[d] - offsets[d]);
+        }
+        refs[j].offset = offset;
+    }
+    free (coords);
+
+    // group the points by block, in file order inside each block
+    qsort (refs, n, sizeof(struct point_ref), cmp_point_ref);
+
+    uint64_t gap = sieve_gap / size_of_type;
+    uint64_t maxn = sieve_buffer_size / size_of_type;
+    if (maxn < 1)
+        maxn = 1;
+    char * buf = NULL;
+    uint64_t bufn = 0;
+    int retval = 0;
+
+    i = 0;
+    while (i < n && refs[i].block < 0)
+        i++;
+    while (i < n)
+    {
+        // extend the extent while the next point of the block is close enough
+        j = i + 1;
+        while (j < n && refs[j].block == refs[i].block
+               && refs[j].offset <= refs[j-1].offset + gap + 1
+               && refs[j].offset - refs[i].offset < maxn)
+        {
+            j++;
+        }
+        uint64_t nelems = refs[j-1].offset - refs[i].offset + 1;
+
+        if (nelems > bufn)
+        {
+            char * newbuf = (char *) realloc (buf, nelems * size_of_type);
+            if (!newbuf)
+            {
+                retval = err_no_memory;
+                break;
+            }
+            buf = newbuf;
+            bufn = nelems;
+        }
+
+        if (!read_block_elements (fp, v, refs[i].block, refs[i].offset, nelems, size_of_type, buf))
+        {
+            retval = err_file_read_error;
+            break;
+        }
+
+        // scatter the values back to the caller's order
+        for (k = i; k < j; k++)
+        {
+            char * to = dest + refs[k].index * size_of_type;
+            memcpy (to, buf + (refs[k].offset - refs[i].offset) * size_of_type, size_of_type);
+            if (fh->mfooter.change_endianness == adios_flag_yes)
+            {
+                change_endianness (to, size_of_type, v->type);
+            }
+        }
+        *nelems_read += nelems;
+        (*nreads_performed)++;
+        i = j;
+    }
+
+    free (buf);
+    free (refs);
+    return retval;
+}
+
 /* This routine reads in data for point selection.
 */
 static ADIOS_VARCHUNK * read_var_pts (const ADIOS_FILE *fp, read_request * r)
@@ -1310,7 +1672,33 @@ static ADIOS_VARCHUNK * read_var_pts (const ADIOS_FILE *fp, read_request * r)
         nsel->u.bb.count = (uint64_t *) malloc (nsel->u.bb.ndim * sizeof(uint64_t));
         assert (nsel->u.bb.start && nsel->u.bb.count);
 
-        if ((sel->u.points.npoints < 5) || (r->nsteps > 1))
+        if ((sel->u.points.npoints >= 5) &&
+            points_by_blocks_supported (fp, v, r, bndim))
+        {
+            /* Points in a Bounding Box container */
+            // Read only extents around the points from the writeblocks holding them
+            for (step = 0; step < r->nsteps; step++)
+            {
+                ttemp = MPI_Wtime();
+                int status = read_points_by_blocks (fp, v, r, step, size_of_type, dest,
+                                                    &nelems_read, &nreads_performed, &nerr);
+                if (status == err_no_memory)
+                {
+                    adios_error (err_no_memory, "Could not allocate memory to read %" PRIu64
+                            " points\n", sel->u.points.npoints);
+                }
+                else if (status)
+                {
+                    adios_error (status, "Could not read the %" PRIu64 " points of variable %s\n",
+                            sel->u.points.npoints, v->var_name);
+                }
+                t_read += MPI_Wtime() - ttemp;
+                points_read += sel->u.points.npoints;
+                dest += sel->u.points.npoints * size_of_type;
+                nelems_container += adios_get_nelements_of_box (bndim, container->u.bb.start, container->u.bb.count);
+            }
+        }
+        else if ((sel->u.points.npoints < 5) || (r->nsteps > 1))
         {
             // few points to read, read them one by one
             for (d = 0; d < nsel->u.bb.ndim; d++)
@@ -1530,7 +1918,8 @@ static ADIOS_VARCHUNK * read_var_pts (const ADIOS_FILE *fp, read_request * r)
 
 int adios_read_bp_init_method (MPI_Comm comm, PairStruct * params)
 {
-    int  max_chunk_size, pollinterval;
+    int  max_chunk_size, pollinterval, gap, sieve_size, nbuffers;
+    long prefetch_size;
     PairStruct * p = params;
 
     while (p)
@@ -1570,29 +1959,217 @@ int adios_read_bp_init_method (MPI_Comm comm, PairStruct * params)
 
             log_debug ("show_hidden_attrs is set\n");
         }
-
-        p = p->next;
-    }
-
-    return 0;
-}
-
-int adios_read_bp_finalize_method ()
-{
-    /* Set these back to default */
-    chunk_buffer_size = 1024*1024*16;
-    poll_interval_msec = 10000; // 10 secs by default
-    show_hidden_attrs = 0; // don't show hidden attr by default
-
-    return 0;
-}
-
-static int open_stream (ADIOS_FILE * fp, const char * fname,
-                        MPI_Comm comm, float timeout_sec)
-{
-    int rank;
-    BP_PROC * p;
-    BP_FILE * fh;
+        else if (!strcasecmp (p->name, "mmap"))
+        {
+            if (!strcasecmp (p->value, "no") || !strcasecmp (p->value, "off") ||
+                !strcmp (p->value, "0"))
+            {
+                use_mmap = 0;
+            }
+            else if (!strcasecmp (p->value, "yes") || !strcasecmp (p->value, "on") ||
+                     !strcmp (p->value, "1"))
+            {
+                use_mmap = 1;
+            }
+            else
+            {
+                log_error ("Invalid 'mmap' parameter given to the READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+            log_debug ("mmap is %s for READ_BP read method\n", use_mmap ? "on" : "off");
+        }
+        else if (!strcasecmp (p->name, "index_cache"))
+        {
+            if (!strcasecmp (p->value, "no") || !strcasecmp (p->value, "off") ||
+                !strcmp (p->value, "0"))
+            {
+                use_index_cache = 0;
+            }
+            else if (!strcasecmp (p->value, "yes") || !strcasecmp (p->value, "on") ||
+                     !strcmp (p->value, "1"))
+            {
+                use_index_cache = 1;
+            }
+            else
+            {
+                log_error ("Invalid 'index_cache' parameter given to the READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+            log_debug ("index_cache is %s for READ_BP read method\n",
+                       use_index_cache ? "on" : "off");
+        }
+        else if (!strcasecmp (p->name, "lazy_index"))
+        {
+            if (!strcasecmp (p->value, "no") || !strcasecmp (p->value, "off") ||
+                !strcmp (p->value, "0"))
+            {
+                use_lazy_index = 0;
+            }
+            else if (!strcasecmp (p->value, "yes") || !strcasecmp (p->value, "on") ||
+                     !strcmp (p->value, "1"))
+            {
+                use_lazy_index = 1;
+            }
+            else
+            {
+                log_error ("Invalid 'lazy_index' parameter given to the READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+            log_debug ("lazy_index is %s for READ_BP read method\n",
+                       use_lazy_index ? "on" : "off");
+        }
+        else if (!strcasecmp (p->name, "sieve"))
+        {
+            if (!strcasecmp (p->value, "no") || !strcasecmp (p->value, "off") ||
+                !strcmp (p->value, "0"))
+            {
+                use_sieve = 0;
+            }
+            else if (!strcasecmp (p->value, "yes") || !strcasecmp (p->value, "on") ||
+                     !strcmp (p->value, "1"))
+            {
+                use_sieve = 1;
+            }
+            else
+            {
+                log_error ("Invalid 'sieve' parameter given to the READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+            log_debug ("sieve is %s for READ_BP read method\n", use_sieve ? "on" : "off");
+        }
+        else if (!strcasecmp (p->name, "sieve_gap"))
+        {
+            errno = 0;
+            gap = strtol(p->value, NULL, 10);
+            if (gap >= 0 && gap <= 1024*1024 && !errno)
+            {
+                log_debug ("sieve_gap set to %dKB for READ_BP read method\n", gap);
+                sieve_gap = gap * 1024;
+            }
+            else
+            {
+                log_error ("Invalid 'sieve_gap' parameter given to the READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+        }
+        else if (!strcasecmp (p->name, "sieve_buffer_size"))
+        {
+            errno = 0;
+            sieve_size = strtol(p->value, NULL, 10);
+            if (sieve_size > 0 && sieve_size < 2048 && !errno)
+            {
+                log_debug ("sieve_buffer_size set to %dMB for READ_BP read method\n",
+                           sieve_size);
+                sieve_buffer_size = sieve_size * 1024 * 1024;
+            }
+            else
+            {
+                log_error ("Invalid 'sieve_buffer_size' parameter given to the READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+        }
+        else if (!strcasecmp (p->name, "inotify"))
+        {
+            if (!strcasecmp (p->value, "no") || !strcasecmp (p->value, "off") ||
+                !strcmp (p->value, "0"))
+            {
+                use_inotify = 0;
+            }
+            else if (!strcasecmp (p->value, "yes") || !strcasecmp (p->value, "on") ||
+                     !strcmp (p->value, "1"))
+            {
+                use_inotify = 1;
+            }
+            else
+            {
+                log_error ("Invalid 'inotify' parameter given to the READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+            log_debug ("inotify is %s for READ_BP read method\n", use_inotify ? "on" : "off");
+        }
+        else if (!strcasecmp (p->name, "prefetch"))
+        {
+            if (!strcasecmp (p->value, "no") || !strcasecmp (p->value, "off") ||
+                !strcmp (p->value, "0"))
+            {
+                use_prefetch = 0;
+            }
+            else if (!strcasecmp (p->value, "yes") || !strcasecmp (p->value, "on") ||
+                     !strcmp (p->value, "1"))
+            {
+                use_prefetch = 1;
+            }
+            else
+            {
+                log_error ("Invalid 'prefetch' parameter given to the READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+            log_debug ("prefetch is %s for READ_BP read method\n", use_prefetch ? "on" : "off");
+        }
+        else if (!strcasecmp (p->name, "prefetch_buffer_size"))
+        {
+            errno = 0;
+            prefetch_size = strtol(p->value, NULL, 10);
+            if (prefetch_size > 0 && !errno)
+            {
+                log_debug ("prefetch_buffer_size set to %ldMB for READ_BP read method\n",
+                           prefetch_size);
+                prefetch_buffer_size = (uint64_t) prefetch_size * 1024 * 1024;
+            }
+            else
+            {
+                log_error ("Invalid 'prefetch_buffer_size' parameter given to the READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+        }
+        else if (!strcasecmp (p->name, "chunk_buffers"))
+        {
+            errno = 0;
+            nbuffers = strtol(p->value, NULL, 10);
+            if (nbuffers > 0 && nbuffers <= 64 && !errno)
+            {
+                log_debug ("chunk_buffers set to %d for READ_BP read method\n", nbuffers);
+                chunk_buffers = nbuffers;
+            }
+            else
+            {
+                log_error ("Invalid 'chunk_buffers' parameter given to the READ_BP "
+                            "read method: '%s'\n", p->value);
+            }
+        }
+
+        p = p->next;
+    }
+
+    return 0;
+}
+
+int adios_read_bp_finalize_method ()
+{
+    /* Set these back to default */
+    chunk_buffer_size = 1024*1024*16;
+    chunk_buffers = 2;
+    poll_interval_msec = 10000; // 10 secs by default
+    show_hidden_attrs = 0; // don't show hidden attr by default
+    use_mmap = 1;
+    use_index_cache = 0;
+    use_lazy_index = 1;
+    use_sieve = 1;
+    sieve_gap = 64*1024;
+    sieve_buffer_size = 1024*1024*64;
+    use_inotify = 1;
+    use_prefetch = 0;
+    prefetch_buffer_size = 1024*1024*256;
+
+    return 0;
+}
+
+static int open_stream (ADIOS_FILE * fp, const char * fname,
+                        MPI_Comm comm, float timeout_sec)
+{
+    int rank;
+    BP_PROC * p;
+    BP_FILE * fh;
     int stay_in_poll_loop = 1;
     int file_ok = 0;
     double t1 = adios_gettime_double();
@@ -1612,6 +2189,9 @@ static int open_stream (ADIOS_FILE * fp, const char * fname,
     // Only rank 0 does the poll
     if (rank == 0)
     {
+        // wake up as soon as the writer closes the file instead of sleeping
+        int watch = (use_inotify && timeout_sec != 0.0) ? bp_watch_file (fname) : -1;
+
         while (stay_in_poll_loop)
         {
             adios_errno = err_no_error; // clear previous intermittent error
@@ -1632,8 +2212,7 @@ static int open_stream (ADIOS_FILE * fp, const char * fname,
                     }
                     else if (timeout_sec < 0.0) // check file until it arrives
                     {
-                        adios_nanosleep (poll_interval_msec/1000,
-                            (int)(((uint64_t)poll_interval_msec * 1000000L)%1000000000L));
+                        bp_wait_for_change (watch, fname, poll_interval_msec);
                         stay_in_poll_loop = 1;
                     }
                     else if (timeout_sec > 0.0 && (adios_gettime_double () - t1 > timeout_sec))
@@ -1642,8 +2221,7 @@ static int open_stream (ADIOS_FILE * fp, const char * fname,
                     }
                     else
                     {
-                        adios_nanosleep (poll_interval_msec/1000,
-                            (int)(((uint64_t)poll_interval_msec * 1000000L)%1000000000L));
+                        bp_wait_for_change (watch, fname, poll_interval_msec);
                     }
                 }
             }
@@ -1652,6 +2230,7 @@ static int open_stream (ADIOS_FILE * fp, const char * fname,
                 stay_in_poll_loop = 0;
             }
         } // while (stay_in_poll_loop)
+        bp_unwatch_file (watch);
 
         if (!file_ok)
         {
@@ -1671,6 +2250,7 @@ static int open_stream (ADIOS_FILE * fp, const char * fname,
     }
 
     fh = BP_FILE_alloc (fname, comm);
+    fh->mmap_enabled = use_mmap;
 
     p = (BP_PROC *) malloc (sizeof (BP_PROC));
     assert (p);
@@ -1679,6 +2259,9 @@ static int open_stream (ADIOS_FILE * fp, const char * fname,
     p->varid_mapping = 0;
     p->local_read_request_list = 0;
     p->b = 0;
+    p->ring = 0;
+    p->engine = 0;
+    p->prefetch = 0;
     p->priv = 0;
 
     /* BP file open and gp/var/att parsing */
@@ -1731,6 +2314,11 @@ ADIOS_FILE * adios_read_bp_open_file (const char * fname, MPI_Comm comm)
     MPI_Comm_rank (comm, &rank);
 
     fh = BP_FILE_alloc (fname, comm);
+    fh->mmap_enabled = use_mmap;
+    /* the cache and lazy parsing are for complete files only, streams
+       look at the steps of all variables when seeking */
+    fh->index_cache_enabled = use_index_cache;
+    fh->lazy_index_enabled = use_lazy_index;
 
     p = (BP_PROC *) malloc (sizeof (BP_PROC));
     assert (p);
@@ -1739,6 +2327,9 @@ ADIOS_FILE * adios_read_bp_open_file (const char * fname, MPI_Comm comm)
     p->varid_mapping = 0; // maps perceived id to real id
     p->local_read_request_list = 0;
     p->b = 0;
+    p->ring = 0;
+    p->engine = 0;
+    p->prefetch = 0;
     p->priv = 0;
 
     /* The ADIOS_FILE struct looks like the following */
@@ -1805,6 +2396,10 @@ int adios_read_bp_close (ADIOS_FILE * fp)
     BP_PROC * p = GET_BP_PROC (fp);
     BP_FILE * fh = GET_BP_FILE (fp);
 
+    read_engine_finish (p);
+    chunk_ring_finish (p);
+    prefetch_free (p);
+
     if (p->fh)
     {
         bp_close (fh);
@@ -1867,12 +2462,15 @@ int adios_read_bp_advance_step (ADIOS_FILE * fp, int last, float timeout_sec)
 {
     BP_PROC * p = GET_BP_PROC (fp);
     BP_FILE * fh = GET_BP_FILE (fp);
-    int last_tidx;
-    MPI_Comm comm;
-    char * fname;
 
     log_debug ("adios_read_bp_advance_step\n");
 
+    /* pending reads refer to the current step */
+    read_engine_finish (p);
+    chunk_ring_finish (p);
+    prefetch_wait (p);
+    prefetch_drop_served (p);
+
     //TODO: this part of code needs to cleaned up a bit. Some if-else branches can be merged. Q.Liu
     adios_errno = 0;
     if (last == 0) // read in the next step
@@ -1882,55 +2480,35 @@ int adios_read_bp_advance_step (ADIOS_FILE * fp, int last, float timeout_sec)
             release_step (fp);
             bp_seek_to_step (fp, ++fp->current_step, show_hidden_attrs);
         }
-        else // re-open to read in footer again. We should keep polling until there are new steps in OR
+        else // read in the footer again. We should keep polling until there are new steps in OR
              // time out.
         {
-            last_tidx = fh->tidx_stop;
-            fname = strdup (fh->fname);
-            comm = fh->comm;
-
-            if (p->fh)
-            {
-                bp_close (fh);
-                p->fh = 0;
-            }
-
-            if (!get_new_step (fp, fname, comm, last_tidx, timeout_sec))
+            if (!get_new_step (fp, fh->tidx_stop, timeout_sec))
             {
                 // With file reading, how can we tell it is the end of the streams?
                 adios_errno = err_step_notready;
             }
 
-            free (fname);
-
             if (adios_errno == 0)
             {
+                /* the new steps follow the current one in the refreshed index */
                 release_step (fp);
-                bp_seek_to_step (fp, fp->last_step + 1, show_hidden_attrs);
-                fp->current_step = fp->last_step + 1;
+                if (fp->current_step < fp->last_step)
+                    fp->current_step++;
+                else
+                    fp->current_step = fp->last_step;
+                bp_seek_to_step (fp, fp->current_step, show_hidden_attrs);
             }
         }
     }
-    else // read in newest step. Re-open no matter whether current_step < last_step
+    else // read in newest step. Re-read the footer no matter whether current_step < last_step
     {
-        last_tidx = fh->tidx_stop;
-        fname = strdup (fh->fname);
-        comm = fh->comm;
-
-        if (p->fh)
-        {
-            bp_close (fh);
-            p->fh = 0;
-        }
-
         // lockmode is currently not supported.
-        if (!get_new_step (fp, fh->fname, fh->comm, last_tidx, timeout_sec))
+        if (!get_new_step (fp, fh->tidx_stop, timeout_sec))
         {
             adios_errno = err_step_notready;
         }
 
-        free (fname);
-
         if (adios_errno == 0)
         {
             release_step (fp);
@@ -1939,6 +2517,12 @@ int adios_read_bp_advance_step (ADIOS_FILE * fp, int last, float timeout_sec)
         }
     }
 
+    if (adios_errno == 0)
+    {
+        /* read the next step ahead if it is in the index now */
+        prefetch_start (fp);
+    }
+
     return adios_errno;
 }
 
@@ -3260,135 +3844,1138 @@ int adios_read_bp_schedule_read_byid (const ADIOS_FILE * fp, const ADIOS_SELECTI
     return 0;
 }
 
-int adios_read_bp_perform_reads (const ADIOS_FILE *fp, int blocking)
+/* Data sieving across all requests of one adios_perform_reads() call.
+ * Each request is expanded into the file extents its read will touch: the
+ * span of the selection within every intersecting block, or the whole
+ * writeblock. The extents are sorted by (subfile, offset) and neighbors
+ * that are at most sieve_gap bytes apart are merged. Every merged group of
+ * two or more extents is read with a single call into fh->sieve, from where
+ * the OPS macros serve the slices of the individual requests. Other reads
+ * go to the file as before.
+ */
+struct sieve_list
 {
-    BP_PROC * p = GET_BP_PROC (fp);
-    read_request * r;
-    ADIOS_VARCHUNK * chunk;
+    struct BP_sieve_extent * e;
+    int n;
+    int alloc;
+};
 
-    /* 1. prepare all reads */
-    // check if all user memory is provided for blocking read
-    if (blocking)
-    {
-        r = p->local_read_request_list;
-        while (r)
-        {
-            if (!r->data)
-            {
-                adios_error (err_operation_not_supported,
-                    "Blocking mode at adios_perform_reads() requires that user "
-                    "provides the memory for each read request. Request for "
-                    "variable %d was scheduled without user-allocated memory\n",
-                    r->varid);
-                return err_operation_not_supported;
-            }
+static void sieve_add_extent (struct sieve_list * l, uint32_t file_index,
+                              uint64_t offset, uint64_t length)
+{
+    struct BP_sieve_extent * e;
 
-            r = r->next;
-        }
-    }
-    else
+    /* large slices are read efficiently by themselves */
+    if (!offset || !length || length > (uint64_t) sieve_buffer_size)
     {
-        return 0;
+        return;
     }
 
-    while (p->local_read_request_list)
+    if (l->n == l->alloc)
     {
-        chunk = read_var (fp, p->local_read_request_list);
+        l->alloc = l->alloc ? 2 * l->alloc : 64;
+        e = (struct BP_sieve_extent *) realloc (l->e, l->alloc * sizeof (struct BP_sieve_extent));
+        if (!e)
+        {
+            return;
+        }
+        l->e = e;
+    }
 
-        // remove head from list
-        r = p->local_read_request_list;
-        p->local_read_request_list = p->local_read_request_list->next;
-        a2sel_free (r->sel);
-        r->sel = NULL;
-        free(r);
+    e = &l->e[l->n++];
+    e->file_index = file_index;
+    e->offset = offset;
+    e->length = length;
+    e->buff = 0;
+}
 
-        common_read_free_chunk (chunk);
-    }
+static int sieve_extent_cmp (const void * a, const void * b)
+{
+    const struct BP_sieve_extent * x = (const struct BP_sieve_extent *) a;
+    const struct BP_sieve_extent * y = (const struct BP_sieve_extent *) b;
 
+    if (x->file_index != y->file_index)
+        return x->file_index < y->file_index ? -1 : 1;
+    if (x->offset != y->offset)
+        return x->offset < y->offset ? -1 : 1;
     return 0;
 }
 
-/* This routine split a 'big' request into smaller ones which can be fit into
- * buffer_size bytes of memory.
- */
-static read_request * split_req (const ADIOS_FILE * fp, const read_request * r, int buffer_size)
+/* Extents of a bounding box request, following read_var_bb() */
+static void sieve_plan_bb (const ADIOS_FILE * fp, read_request * r, struct sieve_list * l)
 {
+    BP_PROC * p = GET_BP_PROC (fp);
     BP_FILE * fh = GET_BP_FILE (fp);
-
-    read_request * h = 0;
-    ADIOS_SELECTION * sel = r->sel;
     struct adios_index_var_struct_v1 * v;
-    int type_size, n_elements, ndim;
-    int i, j, varid, remain, done;
-    uint64_t pos[32], subbb[32], start[32], count[32];
+    uint64_t start[32], count[32], ldims[32], gdims[32], offsets[32], stride[32];
+    uint64_t lo, hi, first, last;
+    int64_t start_idx, stop_idx, idx;
+    int j, t, time, ndim, size_of_type, file_is_fortran, has_subfile, is_global;
+    int dummy = -1;
+    struct adios_index_characteristic_struct_v1 * ch;
 
-    log_debug ("split_req()\n");
-    varid = r->varid; //map_req_varid (fp, r->varid); // NCSU ALACRITY-ADIOS: Bugfix: r->varid has already been mapped
-    v = bp_find_var_byid (fh, varid);
-    type_size = bp_get_type_size (v->type, "");
-    assert (type_size);
+    v = bp_find_var_byid (fh, r->varid);
+    if (!v || !v->characteristics_count ||
+        v->characteristics[0].transform.transform_type != adios_transform_none)
+    {
+        return;
+    }
 
-    n_elements = buffer_size / type_size;
+    file_is_fortran = is_fortran_file (fh);
+    has_subfile = has_subfiles (fh);
+    ndim = r->sel->u.bb.ndim;
+    if (ndim > 32)
+    {
+        return;
+    }
 
-    printf ("n_elements = %d\n", n_elements);
-    //TODO: handle string
-    if (sel->type == ADIOS_SELECTION_BOUNDINGBOX)
+    /* read_var_bb() swaps the selection itself, work on a copy */
+    memcpy (start, r->sel->u.bb.start, ndim * sizeof (uint64_t));
+    memcpy (count, r->sel->u.bb.count, ndim * sizeof (uint64_t));
+    if (futils_is_called_from_fortran ())
     {
-        ndim = sel->u.bb.ndim;
-        // convert chunk size to position within the bounding box
-        for (i = ndim - 1; i > -1; i--)
+        swap_order (ndim, start, &dummy);
+        swap_order (ndim, count, &dummy);
+    }
+
+    size_of_type = bp_get_type_size (v->type, v->characteristics [0].value);
+
+    for (t = fp->current_step + r->from_steps; t < fp->current_step + r->from_steps + r->nsteps; t++)
+    {
+        time = p->streaming ? fh->tidx_start + t : get_time (v, t);
+        start_idx = get_var_start_index (v, time);
+        stop_idx = get_var_stop_index (v, time);
+        if (start_idx < 0 || stop_idx < 0)
         {
-            pos[i] = n_elements % sel->u.bb.count[i];
-            assert (sel->u.bb.count[i]);
-            n_elements /= sel->u.bb.count[i];
+            continue;
         }
 
-        log_debug ("pos = ");
-        for (i = 0; i < ndim; i++)
+        if (ndim == 0)
         {
-            log_debug_cont ("%" PRIu64 " ", pos[i]);
+            ch = &v->characteristics[start_idx];
+            sieve_add_extent (l, has_subfile ? ch->file_index : 0,
+                              ch->payload_offset, size_of_type);
+            continue;
         }
-        log_debug_cont ("\n");
 
-        // calculate sub-bounding-box
-        for (i = ndim - 1; i > -1; i--)
+        for (idx = start_idx; idx <= stop_idx; idx++)
         {
-            if (pos[i] != sel->u.bb.count[i] - 1)
+            ch = &v->characteristics[idx];
+            is_global = bp_get_dimension_characteristics_notime (ch, ldims, gdims, offsets,
+                                                                 file_is_fortran);
+            if (!is_global)
             {
-                j = 0;
-                while (j <= i && pos[j] == 0)
-                {
-                    subbb[j] = 0;
-                    j++;
-                }
+                /* only the first block of a local array is read */
+                stop_idx = idx;
+            }
 
-                if (j <= i)
+            /* span of the selection within the payload of the block */
+            first = 0;
+            last = 0;
+            for (j = ndim - 1; j >= 0; j--)
+            {
+                stride[j] = (j == ndim - 1) ? 1 : stride[j + 1] * ldims[j + 1];
+            }
+            for (j = 0; j < ndim; j++)
+            {
+                lo = start[j] > offsets[j] ? start[j] : offsets[j];
+                hi = start[j] + count[j] < offsets[j] + ldims[j] ?
+                     start[j] + count[j] : offsets[j] + ldims[j];
+                if (lo >= hi)
                 {
-                    subbb[j] = pos[j];
-                    j++;
-                    while (j <= i)
-                    {
-                        subbb[j] = sel->u.bb.count[j];
-                        j++;
-                    }
+                    break;
                 }
-                break;
+                first += (lo - offsets[j]) * stride[j];
+                last += (hi - 1 - offsets[j]) * stride[j];
             }
-            else
+            if (j < ndim)
             {
-                subbb[i] = sel->u.bb.count[i];
+                continue;
             }
-        }
 
-        log_debug ("subbb = ");
-        for (i = 0; i < ndim; i++)
-        {
-            log_debug_cont ("%" PRIu64 " ", subbb[i]);
+            sieve_add_extent (l, has_subfile ? ch->file_index : 0,
+                              ch->payload_offset + first * size_of_type,
+                              (last - first + 1) * size_of_type);
         }
-        log_debug_cont ("\n");
+    }
+}
 
-        memcpy (start, sel->u.bb.start, ndim * 8);
-        memcpy (count, sel->u.bb.count, ndim * 8);
+/* Extents of a writeblock request, following read_var_wb() */
+static void sieve_plan_wb (const ADIOS_FILE * fp, read_request * r, struct sieve_list * l)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh = GET_BP_FILE (fp);
+    const ADIOS_SELECTION_WRITEBLOCK_STRUCT * wb = &r->sel->u.block;
+    struct adios_index_var_struct_v1 * v;
+    struct adios_index_characteristic_struct_v1 * ch;
+    uint64_t ldims[32], gdims[32], offsets[32];
+    uint64_t offset, length;
+    int i, j, idx, time, ndim, size_of_type;
+
+    v = bp_find_var_byid (fh, r->varid);
+    if (!v)
+    {
+        return;
+    }
+
+    for (i = 0; i < r->nsteps; i++)
+    {
+        if (wb->is_absolute_index && !p->streaming)
+        {
+            idx = wb->index;
+        }
+        else
+        {
+            /* adios_wbidx_to_pgidx() complains about missing steps, leave that to the read */
+            time = adios_step_to_time (fp, r->varid, r->from_steps + i);
+            if (get_var_start_index (v, time) < 0 || get_var_stop_index (v, time) < 0)
+            {
+                continue;
+            }
+            idx = adios_wbidx_to_pgidx (fp, r, i);
+            if (idx > get_var_stop_index (v, time))
+            {
+                continue;
+            }
+        }
+        if (idx < 0 || idx >= v->characteristics_count)
+        {
+            continue;
+        }
+
+        ch = &v->characteristics[idx];
+        ndim = ch->dims.count;
+        size_of_type = bp_get_type_size (v->type, ch->value);
+        offset = ch->payload_offset;
+
+        if (ndim == 0)
+        {
+            length = size_of_type;
+        }
+        else if (wb->is_sub_pg_selection)
+        {
+            length = wb->nelements * size_of_type;
+            offset += wb->element_offset * size_of_type;
+        }
+        else
+        {
+            length = size_of_type;
+            bp_get_dimension_characteristics (ch, ldims, gdims, offsets);
+            for (j = 0; j < ndim; j++)
+            {
+                length *= ldims [j];
+            }
+        }
+
+        sieve_add_extent (l, has_subfiles (fh) ? ch->file_index : 0, offset, length);
+    }
+}
+
+/* Read one merged group of extents into e->buff */
+static int sieve_read_extent (BP_FILE * fh, struct BP_sieve_extent * e)
+{
+    struct BP_file_handle * sfh;
+    MPI_File mfh = fh->mpi_fh;
+    MPI_Status status;
+
+    if (has_subfiles (fh))
+    {
+        sfh = open_BP_subfile (fh, e->file_index);
+        if (!sfh)
+        {
+            return 0;
+        }
+        mfh = sfh->fh;
+    }
+
+    e->buff = (char *) malloc (e->length);
+    if (!e->buff)
+    {
+        return 0;
+    }
+
+    MPI_File_seek (mfh, (MPI_Offset) e->offset, MPI_SEEK_SET);
+    MPI_FILE_READ64 (mfh, e->buff, e->length, MPI_BYTE, &status);
+
+    return 1;
+}
+
+static void sieve_requests (const ADIOS_FILE * fp, read_request * requests)
+{
+    BP_FILE * fh = GET_BP_FILE (fp);
+    struct sieve_list l = {0, 0, 0};
+    struct BP_sieve_extent g;
+    read_request * r;
+    uint64_t budget = sieve_buffer_size, end;
+    int i, k, n;
+
+    bp_free_sieve (fh);
+
+    /* everything is in memory already if the file is mapped */
+    if (!use_sieve || fh->mmap_base)
+    {
+        return;
+    }
+
+    for (r = requests; r; r = r->next)
+    {
+        if (r->sel->type == ADIOS_SELECTION_BOUNDINGBOX)
+        {
+            sieve_plan_bb (fp, r, &l);
+        }
+        else if (r->sel->type == ADIOS_SELECTION_WRITEBLOCK)
+        {
+            sieve_plan_wb (fp, r, &l);
+        }
+    }
+
+    if (l.n < 2)
+    {
+        free (l.e);
+        return;
+    }
+
+    qsort (l.e, l.n, sizeof (struct BP_sieve_extent), sieve_extent_cmp);
+
+    /* merge in place, the groups are written over the front of the list */
+    k = 0;
+    i = 0;
+    while (i < l.n)
+    {
+        g = l.e[i];
+        end = g.offset + g.length;
+        for (n = 1; i + n < l.n; n++)
+        {
+            struct BP_sieve_extent * e = &l.e[i + n];
+            if (e->file_index != g.file_index ||
+                e->offset > end + sieve_gap ||
+                (e->offset + e->length > end ? e->offset + e->length : end) - g.offset
+                    > (uint64_t) sieve_buffer_size)
+            {
+                break;
+            }
+            if (e->offset + e->length > end)
+            {
+                end = e->offset + e->length;
+            }
+        }
+        i += n;
+        g.length = end - g.offset;
+
+        if (n > 1 && g.length <= budget && sieve_read_extent (fh, &g))
+        {
+            budget -= g.length;
+            l.e[k++] = g;
+        }
+    }
+
+    if (k)
+    {
+        log_debug ("Coalesced the reads of %d extents into %d reads\n", l.n, k);
+        fh->sieve = l.e;
+        fh->sieve_count = k;
+    }
+    else
+    {
+        free (l.e);
+    }
+}
+
+/* Non-blocking reads are performed by a background thread. It reads the
+ * requests with user-provided memory one by one and queues the chunks in
+ * completion order for adios_read_bp_check_reads(). Requests without user
+ * memory are left for check_reads, which reads them into its own buffer
+ * once the thread has finished.
+ */
+struct read_engine_chunk
+{
+    ADIOS_VARCHUNK * chunk;
+    struct read_engine_chunk * next;
+};
+
+struct read_engine
+{
+    const ADIOS_FILE * fp;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_mutex_t io_mutex;          // held while the thread uses the file handle and fh->b
+    read_request * requests;           // not read yet, owned by the thread
+    struct read_engine_chunk * head;   // completed chunks, not returned yet
+    struct read_engine_chunk * tail;
+    int done;                          // the thread has finished all requests
+    int error;                         // adios_errno of the failed read, 0 if none
+};
+
+static void * read_engine_main (void * arg)
+{
+    struct read_engine * e = (struct read_engine *) arg;
+    read_request * r;
+    ADIOS_VARCHUNK * chunk;
+    struct read_engine_chunk * c;
+    int error = 0;
+
+    pthread_mutex_lock (&e->io_mutex);
+    sieve_requests (e->fp, e->requests);
+    pthread_mutex_unlock (&e->io_mutex);
+
+    while (e->requests && !error)
+    {
+        r = e->requests;
+        pthread_mutex_lock (&e->io_mutex);
+        chunk = read_var (e->fp, r);
+        pthread_mutex_unlock (&e->io_mutex);
+        if (!chunk)
+        {
+            error = adios_errno ? adios_errno : err_unspecified;
+        }
+
+        e->requests = r->next;
+        a2sel_free (r->sel);
+        r->sel = NULL;
+        free (r);
+
+        if (chunk)
+        {
+            c = (struct read_engine_chunk *) malloc (sizeof (struct read_engine_chunk));
+            c->chunk = chunk;
+            c->next = 0;
+
+            pthread_mutex_lock (&e->mutex);
+            if (e->tail)
+                e->tail->next = c;
+            else
+                e->head = c;
+            e->tail = c;
+            pthread_cond_signal (&e->cond);
+            pthread_mutex_unlock (&e->mutex);
+        }
+    }
+
+    pthread_mutex_lock (&e->io_mutex);
+    bp_free_sieve (GET_BP_FILE (e->fp));
+    pthread_mutex_unlock (&e->io_mutex);
+
+    pthread_mutex_lock (&e->mutex);
+    e->error = error;
+    e->done = 1;
+    pthread_cond_signal (&e->cond);
+    pthread_mutex_unlock (&e->mutex);
+
+    return NULL;
+}
+
+/* Reading from a second thread is only safe if MPI allows it or if the
+ * whole file is served from the memory mapping.
+ */
+static int read_engine_allowed (const ADIOS_FILE * fp)
+{
+#ifdef _NOMPI
+    return 1;
+#else
+    BP_FILE * fh = GET_BP_FILE (fp);
+    int provided = MPI_THREAD_SINGLE;
+
+    MPI_Query_thread (&provided);
+    return provided == MPI_THREAD_MULTIPLE || (fh->mmap_base && !has_subfiles (fh));
+#endif
+}
+
+static struct read_engine * read_engine_start (const ADIOS_FILE * fp, read_request * requests)
+{
+    struct read_engine * e = (struct read_engine *) calloc (1, sizeof (struct read_engine));
+
+    if (!e)
+        return NULL;
+
+    e->fp = fp;
+    e->requests = requests;
+    pthread_mutex_init (&e->mutex, NULL);
+    pthread_mutex_init (&e->io_mutex, NULL);
+    pthread_cond_init (&e->cond, NULL);
+
+    if (pthread_create (&e->thread, NULL, read_engine_main, e))
+    {
+        log_warn ("Cannot start a thread for non-blocking reads, "
+                  "reads will be performed in adios_check_reads()\n");
+        pthread_mutex_destroy (&e->mutex);
+        pthread_mutex_destroy (&e->io_mutex);
+        pthread_cond_destroy (&e->cond);
+        free (e);
+        return NULL;
+    }
+
+    log_debug ("Started a thread for non-blocking reads\n");
+    return e;
+}
+
+/* Wait for the next completed chunk. Returns NULL when the engine has no more
+ * chunks, *error is set if a read has failed.
+ */
+static ADIOS_VARCHUNK * read_engine_next (struct read_engine * e, int * error)
+{
+    struct read_engine_chunk * c;
+    ADIOS_VARCHUNK * chunk = NULL;
+
+    pthread_mutex_lock (&e->mutex);
+    while (!e->head && !e->done)
+    {
+        pthread_cond_wait (&e->cond, &e->mutex);
+    }
+
+    c = e->head;
+    if (c)
+    {
+        e->head = c->next;
+        if (!e->head)
+            e->tail = NULL;
+    }
+    *error = (c ? 0 : e->error);
+    pthread_mutex_unlock (&e->mutex);
+
+    if (c)
+    {
+        chunk = c->chunk;
+        free (c);
+    }
+    return chunk;
+}
+
+/* Wait for the engine to finish and drop the chunks that were not returned.
+ * The data of those chunks is in user memory already.
+ */
+static void read_engine_finish (BP_PROC * p)
+{
+    struct read_engine * e = (struct read_engine *) p->engine;
+    struct read_engine_chunk * c;
+
+    if (!e)
+        return;
+
+    pthread_join (e->thread, NULL);
+
+    while (e->head)
+    {
+        c = e->head;
+        e->head = c->next;
+        common_read_free_chunk (c->chunk);
+        free (c);
+    }
+
+    if (e->requests)
+    {
+        list_free_read_request (e->requests);
+    }
+
+    pthread_mutex_destroy (&e->mutex);
+    pthread_mutex_destroy (&e->io_mutex);
+    pthread_cond_destroy (&e->cond);
+    free (e);
+    p->engine = 0;
+}
+
+/* Step read-ahead ("prefetch" parameter). The bounding box and point
+ * requests of the last adios_perform_reads() are remembered. Once the step
+ * after them is in the index (right after a blocking adios_perform_reads(),
+ * or after adios_advance_step() brought it in), the same selections are read
+ * for that step by a background thread into a cache of at most
+ * prefetch_buffer_size bytes. Requests of the next adios_perform_reads()
+ * that match a cached read exactly are copied from the cache instead of
+ * being read from the file; cached reads that were not asked for are
+ * dropped there.
+ * The thread uses the file handle and fh->b, so every function that reads
+ * data, or changes the step, waits for it first (prefetch_wait).
+ */
+struct prefetch_entry
+{
+    int varid;              // mapped varid
+    int step;               // first step, fp->current_step + from_steps of the request
+    int nsteps;
+    ADIOS_SELECTION * sel;
+    uint64_t datasize;
+    void * data;            // cached data, NULL if the read failed
+    struct prefetch_entry * next;
+};
+
+struct prefetcher
+{
+    const ADIOS_FILE * fp;
+    pthread_t thread;
+    int running;                       // the thread has not been joined yet
+    struct prefetch_entry * history;   // requests of the last perform_reads, no data
+    struct prefetch_entry * cache;     // reads of the next step
+    uint64_t cache_size;
+    struct read_engine_chunk * served; // chunks of non-blocking requests served from the
+    struct read_engine_chunk * served_tail; // cache, not returned by check_reads yet
+};
+
+static void prefetch_free_entries (struct prefetch_entry * e)
+{
+    struct prefetch_entry * next;
+
+    while (e)
+    {
+        next = e->next;
+        a2sel_free (e->sel);
+        free (e->data);
+        free (e);
+        e = next;
+    }
+}
+
+static void prefetch_wait (BP_PROC * p)
+{
+    struct prefetcher * pf = (struct prefetcher *) p->prefetch;
+
+    if (pf && pf->running)
+    {
+        pthread_join (pf->thread, NULL);
+        pf->running = 0;
+    }
+}
+
+/* Drop the served chunks that adios_check_reads() has not returned. Their
+ * data is in user memory already.
+ */
+static void prefetch_drop_served (BP_PROC * p)
+{
+    struct prefetcher * pf = (struct prefetcher *) p->prefetch;
+    struct read_engine_chunk * c;
+
+    if (!pf)
+        return;
+
+    while (pf->served)
+    {
+        c = pf->served;
+        pf->served = c->next;
+        common_read_free_chunk (c->chunk);
+        free (c);
+    }
+    pf->served_tail = NULL;
+}
+
+static void prefetch_free (BP_PROC * p)
+{
+    struct prefetcher * pf = (struct prefetcher *) p->prefetch;
+
+    if (!pf)
+        return;
+
+    prefetch_wait (p);
+    prefetch_drop_served (p);
+    prefetch_free_entries (pf->history);
+    prefetch_free_entries (pf->cache);
+    free (pf);
+    p->prefetch = 0;
+}
+
+static int prefetch_same_selection (const ADIOS_SELECTION * a, const ADIOS_SELECTION * b)
+{
+    if (a->type != b->type)
+        return 0;
+
+    switch (a->type)
+    {
+        case ADIOS_SELECTION_BOUNDINGBOX:
+            return a->u.bb.ndim == b->u.bb.ndim &&
+                   !memcmp (a->u.bb.start, b->u.bb.start, a->u.bb.ndim * sizeof (uint64_t)) &&
+                   !memcmp (a->u.bb.count, b->u.bb.count, a->u.bb.ndim * sizeof (uint64_t));
+        case ADIOS_SELECTION_POINTS:
+            return a->u.points.ndim == b->u.points.ndim &&
+                   a->u.points.npoints == b->u.points.npoints &&
+                   !a->u.points.container_selection && !b->u.points.container_selection &&
+                   !memcmp (a->u.points.points, b->u.points.points,
+                            a->u.points.npoints * a->u.points.ndim * sizeof (uint64_t));
+        default:
+            return 0;
+    }
+}
+
+/* Only bounding box and point reads are remembered; the errors of the other
+ * read paths would leak into adios_errno from the background thread.
+ */
+static int prefetch_can_read (const read_request * r)
+{
+    if (!r->data)
+        return 0;
+    if (r->sel->type == ADIOS_SELECTION_BOUNDINGBOX)
+        return 1;
+    return r->sel->type == ADIOS_SELECTION_POINTS && !r->sel->u.points.container_selection;
+}
+
+/* Remember a request of this adios_perform_reads() for the next read-ahead */
+static void prefetch_remember (const ADIOS_FILE * fp, const read_request * r)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    struct prefetcher * pf = (struct prefetcher *) p->prefetch;
+    struct prefetch_entry * e, ** tail;
+
+    if (!pf || !prefetch_can_read (r))
+        return;
+
+    e = (struct prefetch_entry *) calloc (1, sizeof (struct prefetch_entry));
+    if (!e)
+        return;
+    e->varid = r->varid;
+    e->step = fp->current_step + r->from_steps;
+    e->nsteps = r->nsteps;
+    e->sel = a2sel_copy (r->sel);
+    e->datasize = r->datasize;
+
+    tail = &pf->history;
+    while (*tail)
+        tail = &(*tail)->next;
+    *tail = e;
+}
+
+static int prefetch_overlap (const read_request * a, const read_request * b)
+{
+    return a->data && b->data &&
+           (char *) a->data < (char *) b->data + b->datasize &&
+           (char *) b->data < (char *) a->data + a->datasize;
+}
+
+/* Queue the chunk of a request served from the cache in non-blocking mode,
+ * which adios_check_reads() returns before reading anything else.
+ * Returns 0 if the chunk cannot be allocated.
+ */
+static int prefetch_queue_served (const ADIOS_FILE * fp, const read_request * r)
+{
+    struct prefetcher * pf = (struct prefetcher *) GET_BP_PROC (fp)->prefetch;
+    struct adios_index_var_struct_v1 * v = bp_find_var_byid (GET_BP_FILE (fp), r->varid);
+    struct read_engine_chunk * c;
+    ADIOS_VARCHUNK * chunk;
+
+    c = (struct read_engine_chunk *) malloc (sizeof (struct read_engine_chunk));
+    chunk = (ADIOS_VARCHUNK *) malloc (sizeof (ADIOS_VARCHUNK));
+    if (!c || !chunk)
+    {
+        free (c);
+        free (chunk);
+        return 0;
+    }
+
+    chunk->varid = r->varid;
+    chunk->type = v->type;
+    chunk->from_steps = r->from_steps;
+    chunk->nsteps = r->nsteps;
+    chunk->sel = a2sel_copy (r->sel);
+    chunk->data = r->data;
+
+    c->chunk = chunk;
+    c->next = NULL;
+    if (pf->served_tail)
+        pf->served_tail->next = c;
+    else
+        pf->served = c;
+    pf->served_tail = c;
+    return 1;
+}
+
+/* Copy the requests of this adios_perform_reads() from the cache. The
+ * served requests are removed from the list and the rest of the cache is
+ * dropped. In non-blocking mode a chunk is queued for each served request,
+ * so that adios_check_reads() still returns it. A request is not served
+ * early if a request before it in the list writes into the same memory.
+ * The served requests (and in non-blocking mode all others too) are
+ * remembered for the next read-ahead; a blocking read remembers the others
+ * once they have been read without error.
+ */
+static void prefetch_serve (const ADIOS_FILE * fp, read_request ** requests, int blocking)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    struct prefetcher * pf = (struct prefetcher *) p->prefetch;
+    struct prefetch_entry * e, ** ep;
+    read_request * r, * q, ** rp;
+    int served = 0;
+
+    if (!pf)
+        return;
+
+    prefetch_drop_served (p);
+    prefetch_free_entries (pf->history);
+    pf->history = 0;
+
+    rp = requests;
+    while (*rp)
+    {
+        r = *rp;
+        e = NULL;
+        if (prefetch_can_read (r))
+        {
+            for (ep = &pf->cache; *ep; ep = &(*ep)->next)
+            {
+                if ((*ep)->data && (*ep)->varid == r->varid &&
+                    (*ep)->step == fp->current_step + r->from_steps &&
+                    (*ep)->nsteps == r->nsteps && (*ep)->datasize == r->datasize &&
+                    prefetch_same_selection ((*ep)->sel, r->sel))
+                {
+                    e = *ep;
+                    break;
+                }
+            }
+            for (q = *requests; e && q != r; q = q->next)
+            {
+                if (prefetch_overlap (q, r))
+                    e = NULL;
+            }
+            if (e && !blocking && !prefetch_queue_served (fp, r))
+                e = NULL;
+        }
+
+        if (e)
+        {
+            prefetch_remember (fp, r);
+            memcpy (r->data, e->data, e->datasize);
+            *ep = e->next;
+            e->next = 0;
+            pf->cache_size -= e->datasize;
+            prefetch_free_entries (e);
+
+            *rp = r->next;
+            a2sel_free (r->sel);
+            free (r);
+            served++;
+        }
+        else
+        {
+            if (!blocking)
+                prefetch_remember (fp, r);
+            rp = &r->next;
+        }
+    }
+
+    if (served || pf->cache)
+    {
+        log_debug ("Served %d reads from the read-ahead cache\n", served);
+    }
+
+    prefetch_free_entries (pf->cache);
+    pf->cache = 0;
+    pf->cache_size = 0;
+}
+
+static void * prefetch_main (void * arg)
+{
+    struct prefetcher * pf = (struct prefetcher *) arg;
+    const ADIOS_FILE * fp = pf->fp;
+    read_request * requests = 0, ** tail = &requests, * r;
+    struct prefetch_entry * e;
+    ADIOS_VARCHUNK * chunk;
+
+    for (e = pf->cache; e; e = e->next)
+    {
+        r = (read_request *) calloc (1, sizeof (read_request));
+        if (!r)
+            break;
+        r->sel = a2sel_copy (e->sel);
+        r->varid = e->varid;
+        r->from_steps = e->step - fp->current_step;
+        r->nsteps = e->nsteps;
+        r->data = e->data;
+        r->datasize = e->datasize;
+        r->priv = e;
+        *tail = r;
+        tail = &r->next;
+    }
+
+    sieve_requests (fp, requests);
+
+    while (requests)
+    {
+        r = requests;
+        chunk = read_var (fp, r);
+        if (chunk)
+        {
+            common_read_free_chunk (chunk);
+        }
+        else
+        {
+            e = (struct prefetch_entry *) r->priv;
+            free (e->data);
+            e->data = NULL;
+        }
+
+        requests = r->next;
+        a2sel_free (r->sel);
+        free (r);
+    }
+
+    bp_free_sieve (GET_BP_FILE (fp));
+    return NULL;
+}
+
+/* Check that a variable has data in all steps of a read-ahead, so that the
+ * background reads do not report errors.
+ */
+static int prefetch_has_data (const ADIOS_FILE * fp, struct adios_index_var_struct_v1 * v,
+                              int step, int nsteps)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh = GET_BP_FILE (fp);
+    int t, time;
+
+    for (t = step; t < step + nsteps; t++)
+    {
+        time = (p->streaming ? (int) fh->tidx_start + t : get_time (v, t));
+        if (time < 0 || get_var_start_index (v, time) < 0 || get_var_stop_index (v, time) < 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Start reading the remembered requests for the steps that follow them,
+ * if those steps are available and are not cached yet.
+ */
+static void prefetch_start (const ADIOS_FILE * fp)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    BP_FILE * fh = GET_BP_FILE (fp);
+    struct prefetcher * pf = (struct prefetcher *) p->prefetch;
+    struct prefetch_entry * h, * e, * c, ** tail;
+    struct adios_index_var_struct_v1 * v;
+    int step, n = 0;
+
+    if (!pf || pf->running || p->engine || p->ring || !read_engine_allowed (fp))
+        return;
+
+    tail = &pf->cache;
+    while (*tail)
+        tail = &(*tail)->next;
+
+    for (h = pf->history; h; h = h->next)
+    {
+        step = h->step + h->nsteps;
+        if (step + h->nsteps - 1 > fp->last_step)
+            continue;
+
+        for (c = pf->cache; c; c = c->next)
+        {
+            if (c->varid == h->varid && c->step == step && c->nsteps == h->nsteps &&
+                prefetch_same_selection (c->sel, h->sel))
+            {
+                break;
+            }
+        }
+        if (c)
+            continue;
+
+        v = bp_find_var_byid (fh, h->varid);
+        if (!v || !prefetch_has_data (fp, v, step, h->nsteps))
+            continue;
+
+        if (pf->cache_size + h->datasize > prefetch_buffer_size)
+            continue;
+
+        e = (struct prefetch_entry *) calloc (1, sizeof (struct prefetch_entry));
+        if (!e)
+            break;
+        e->data = malloc (h->datasize);
+        if (!e->data)
+        {
+            free (e);
+            break;
+        }
+        e->varid = h->varid;
+        e->step = step;
+        e->nsteps = h->nsteps;
+        e->sel = a2sel_copy (h->sel);
+        e->datasize = h->datasize;
+        pf->cache_size += e->datasize;
+        *tail = e;
+        tail = &e->next;
+        n++;
+    }
+
+    if (!n)
+        return;
+
+    pf->fp = fp;
+    if (pthread_create (&pf->thread, NULL, prefetch_main, pf))
+    {
+        log_warn ("Cannot start a thread to read ahead the next step\n");
+        prefetch_free_entries (pf->cache);
+        pf->cache = 0;
+        pf->cache_size = 0;
+        return;
+    }
+    pf->running = 1;
+    log_debug ("Reading ahead %d requests of the next step\n", n);
+}
+
+int adios_read_bp_perform_reads (const ADIOS_FILE *fp, int blocking)
+{
+    BP_PROC * p = GET_BP_PROC (fp);
+    read_request * r;
+    ADIOS_VARCHUNK * chunk;
+    int saved_errno;
+
+    /* reads started by a previous non-blocking call complete first */
+    read_engine_finish (p);
+    chunk_ring_finish (p);
+    prefetch_wait (p);
+
+    /* serve what was read ahead, and remember the requests for the next step */
+    if (use_prefetch && !p->prefetch)
+    {
+        p->prefetch = calloc (1, sizeof (struct prefetcher));
+    }
+    prefetch_serve (fp, &p->local_read_request_list, blocking);
+
+    /* 1. prepare all reads */
+    // check if all user memory is provided for blocking read
+    if (blocking)
+    {
+        r = p->local_read_request_list;
+        while (r)
+        {
+            if (!r->data)
+            {
+                adios_error (err_operation_not_supported,
+                    "Blocking mode at adios_perform_reads() requires that user "
+                    "provides the memory for each read request. Request for "
+                    "variable %d was scheduled without user-allocated memory\n",
+                    r->varid);
+                return err_operation_not_supported;
+            }
+
+            r = r->next;
+        }
+    }
+    else
+    {
+        read_request * async = 0, ** tail = &async, ** rp = &p->local_read_request_list;
+
+        if (!read_engine_allowed (fp))
+        {
+            return 0;
+        }
+
+        /* hand over the requests with user memory to the engine */
+        while (*rp)
+        {
+            r = *rp;
+            if (r->data)
+            {
+                *rp = r->next;
+                r->next = 0;
+                *tail = r;
+                tail = &r->next;
+            }
+            else
+            {
+                rp = &r->next;
+            }
+        }
+
+        if (async)
+        {
+            p->engine = read_engine_start (fp, async);
+            if (!p->engine)
+            {
+                /* put them back for check_reads */
+                *tail = p->local_read_request_list;
+                p->local_read_request_list = async;
+            }
+        }
+        return 0;
+    }
+
+    sieve_requests (fp, p->local_read_request_list);
+
+    while (p->local_read_request_list)
+    {
+        saved_errno = adios_errno;
+        adios_errno = 0;
+        chunk = read_var (fp, p->local_read_request_list);
+        if (adios_errno == 0)
+        {
+            prefetch_remember (fp, p->local_read_request_list);
+            adios_errno = saved_errno;
+        }
+
+        // remove head from list
+        r = p->local_read_request_list;
+        p->local_read_request_list = p->local_read_request_list->next;
+        a2sel_free (r->sel);
+        r->sel = NULL;
+        free(r);
+
+        common_read_free_chunk (chunk);
+    }
+
+    bp_free_sieve (GET_BP_FILE (fp));
+
+    prefetch_start (fp);
+
+    return 0;
+}
+
+/* This routine split a 'big' request into smaller ones which can be fit into
+ * buffer_size bytes of memory.
+ */
+static read_request * split_req (const ADIOS_FILE * fp, const read_request * r, int buffer_size)
+{
+    BP_FILE * fh = GET_BP_FILE (fp);
+
+    read_request * h = 0;
+    ADIOS_SELECTION * sel = r->sel;
+    struct adios_index_var_struct_v1 * v;
+    int type_size, n_elements, ndim;
+    int i, j, varid, remain, done;
+    uint64_t subbb[32], start[32], count[32];
+
+    log_debug ("split_req()\n");
+    varid = r->varid; //map_req_varid (fp, r->varid); // NCSU ALACRITY-ADIOS: Bugfix: r->varid has already been mapped
+    v = bp_find_var_byid (fh, varid);
+    type_size = bp_get_type_size (v->type, "");
+    assert (type_size);
+
+    n_elements = buffer_size / type_size;
+    if (n_elements < 1)
+    {
+        n_elements = 1;
+    }
+
+    log_debug ("n_elements = %d\n", n_elements);
+    //TODO: handle string
+    if (sel->type == ADIOS_SELECTION_BOUNDINGBOX)
+    {
+        ndim = sel->u.bb.ndim;
+        // the largest sub-bounding-box of n_elements: full fastest dimensions,
+        // then as many as fit of the next dimension, 1 in the slower ones
+        uint64_t nfit = 1;
+        for (i = ndim - 1; i > -1; i--)
+        {
+            assert (sel->u.bb.count[i]);
+            if (nfit * sel->u.bb.count[i] <= n_elements)
+            {
+                subbb[i] = sel->u.bb.count[i];
+                nfit *= sel->u.bb.count[i];
+            }
+            else
+            {
+                subbb[i] = n_elements / nfit;
+                for (j = 0; j < i; j++)
+                {
+                    subbb[j] = 1;
+                }
+                break;
+            }
+        }
+
+        log_debug ("subbb = ");
+        for (i = 0; i < ndim; i++)
+        {
+            log_debug_cont ("%" PRIu64 " ", subbb[i]);
+        }
+        log_debug_cont ("\n");
+
+        memcpy (start, sel->u.bb.start, ndim * 8);
+        memcpy (count, sel->u.bb.count, ndim * 8);
 
         while (1)
         {
@@ -3501,6 +5088,9 @@ static read_request * split_req (const ADIOS_FILE * fp, const read_request * r,
             assert (newreq->sel);
             newreq->sel->type = ADIOS_SELECTION_POINTS;
             newreq->sel->u.points.ndim = sel->u.points.ndim;
+            newreq->sel->u.points._free_points_on_delete = 1;
+            newreq->sel->u.points.container_selection =
+                sel->u.points.container_selection ? a2sel_copy (sel->u.points.container_selection) : NULL;
             newreq->sel->u.points.npoints = (remain > n_elements ? n_elements : remain);
             newreq->sel->u.points.points = malloc (newreq->sel->u.points.npoints * newreq->sel->u.points.ndim * 8);
             assert (newreq->sel->u.points.points);
@@ -3519,17 +5109,361 @@ static read_request * split_req (const ADIOS_FILE * fp, const read_request * r,
 
             list_insert_read_request_next (&h, newreq);
 
-            remain -= n_elements;
+            remain -= newreq->sel->u.points.npoints;
         }
     }
     else if (sel->type == ADIOS_SELECTION_WRITEBLOCK)
     {
+        // split the writeblock into linear ranges of elements
+        uint64_t offset = 0, nelems = r->datasize / type_size;
+        if (sel->u.block.is_sub_pg_selection)
+        {
+            offset = sel->u.block.element_offset;
+            nelems = sel->u.block.nelements;
+        }
+
+        while (nelems)
+        {
+            read_request * newreq = (read_request *) malloc (sizeof (read_request));
+            assert (newreq);
+
+            newreq->sel = a2sel_copy (sel);
+            assert (newreq->sel);
+            newreq->sel->u.block.is_sub_pg_selection = 1;
+            newreq->sel->u.block.element_offset = offset;
+            newreq->sel->u.block.nelements = (nelems > n_elements ? n_elements : nelems);
+
+            newreq->varid = r->varid;
+            newreq->from_steps = r->from_steps;
+            newreq->nsteps = r->nsteps;
+            newreq->data = r->data;
+            newreq->datasize = type_size * newreq->sel->u.block.nelements;
+            newreq->priv = r->priv;
+            newreq->next = 0;
+
+            list_insert_read_request_next (&h, newreq);
 
+            offset += newreq->sel->u.block.nelements;
+            nelems -= newreq->sel->u.block.nelements;
+        }
     }
 
     return h;
 }
 
+/* Reads without user memory are returned by adios_read_bp_check_reads() in
+ * chunks of at most chunk_buffer_size bytes, read into a ring of
+ * chunk_buffers buffers. The buffers are allocated once per ring and reused,
+ * so memory use does not depend on the size of the requests. A thread reads
+ * the next chunks into the free buffers while the caller processes the last
+ * returned chunk, whose buffer is released at the next call. Without a thread,
+ * each chunk is read by the call that returns it.
+ */
+struct chunk_ring
+{
+    const ADIOS_FILE * fp;
+    read_request * requests;    // not read yet, owned by the reader
+    int nslots;
+    uint64_t slot_size;         // bytes of each buffer
+    void ** buffers;            // allocated at first use
+    ADIOS_VARCHUNK ** chunks;   // completed chunk in each buffer, not returned yet
+    int head;                   // buffer of the next chunk to return
+    int tail;                   // buffer of the next chunk to read
+    int count;                  // number of completed chunks not returned yet
+    int user;                   // buffer of the chunk the caller holds, -1 if none
+    int threaded;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_mutex_t io_mutex;   // held while a chunk is read from the file
+    int stop;                   // the thread should finish
+    int done;                   // all requests are read
+    int error;                  // adios_errno of the failed read, 0 if none
+};
+
+/* Read the next chunk into the tail buffer, splitting the next request if it
+ * does not fit. Returns 0 and sets done if there is nothing more to read.
+ */
+static int chunk_ring_read (struct chunk_ring * ring)
+{
+    read_request * r, * subreqs;
+    ADIOS_VARCHUNK * chunk = NULL;
+    int error = 0;
+
+    while ((r = ring->requests) && r->datasize * r->nsteps > ring->slot_size)
+    {
+        subreqs = split_req (ring->fp, r, (int) (ring->slot_size / r->nsteps));
+        if (!subreqs || subreqs->datasize * subreqs->nsteps > ring->slot_size)
+        {
+            if (subreqs)
+            {
+                list_free_read_request (subreqs);
+            }
+            adios_error (err_operation_not_supported,
+                         "Request for variable %d does not fit into the %" PRIu64
+                         " bytes of a chunk buffer and cannot be split\n",
+                         r->varid, ring->slot_size);
+            error = err_operation_not_supported;
+            break;
+        }
+
+        ring->requests = r->next;
+        a2sel_free (r->sel);
+        free (r);
+
+        r = subreqs;
+        while (r->next)
+        {
+            r = r->next;
+        }
+        r->next = ring->requests;
+        ring->requests = subreqs;
+    }
+
+    if (r && !error)
+    {
+        if (!ring->buffers[ring->tail])
+        {
+            ring->buffers[ring->tail] = malloc (ring->slot_size);
+        }
+
+        if (ring->buffers[ring->tail])
+        {
+            r->data = ring->buffers[ring->tail];
+            pthread_mutex_lock (&ring->io_mutex);
+            chunk = read_var (ring->fp, r);
+            pthread_mutex_unlock (&ring->io_mutex);
+            if (!chunk)
+            {
+                error = adios_errno ? adios_errno : err_unspecified;
+            }
+        }
+        else
+        {
+            adios_error (err_no_memory, "Could not allocate %" PRIu64
+                         " bytes for a chunk buffer\n", ring->slot_size);
+            error = err_no_memory;
+        }
+
+        ring->requests = r->next;
+        a2sel_free (r->sel);
+        free (r);
+    }
+
+    pthread_mutex_lock (&ring->mutex);
+    if (chunk)
+    {
+        ring->chunks[ring->tail] = chunk;
+        ring->tail = (ring->tail + 1) % ring->nslots;
+        ring->count++;
+    }
+    else
+    {
+        ring->error = error;
+        ring->done = 1;
+    }
+    pthread_cond_broadcast (&ring->cond);
+    pthread_mutex_unlock (&ring->mutex);
+
+    return (chunk != NULL);
+}
+
+static void * chunk_ring_main (void * arg)
+{
+    struct chunk_ring * ring = (struct chunk_ring *) arg;
+    int stop;
+
+    do
+    {
+        // wait for a free buffer
+        pthread_mutex_lock (&ring->mutex);
+        while (!ring->stop && ring->count + (ring->user >= 0) >= ring->nslots)
+        {
+            pthread_cond_wait (&ring->cond, &ring->mutex);
+        }
+        stop = ring->stop;
+        pthread_mutex_unlock (&ring->mutex);
+    } while (!stop && chunk_ring_read (ring));
+
+    return NULL;
+}
+
+/* Take over the requests and start reading them in chunks. */
+static struct chunk_ring * chunk_ring_start (const ADIOS_FILE * fp, read_request * requests)
+{
+    struct chunk_ring * ring = (struct chunk_ring *) calloc (1, sizeof (struct chunk_ring));
+    struct adios_index_var_struct_v1 * v;
+    read_request * r;
+    uint64_t size, minsize;
+
+    if (!ring)
+        return NULL;
+
+    ring->nslots = chunk_buffers;
+    ring->buffers = (void **) calloc (ring->nslots, sizeof (void *));
+    ring->chunks = (ADIOS_VARCHUNK **) calloc (ring->nslots, sizeof (ADIOS_VARCHUNK *));
+    if (!ring->buffers || !ring->chunks)
+    {
+        free (ring->buffers);
+        free (ring->chunks);
+        free (ring);
+        return NULL;
+    }
+
+    ring->fp = fp;
+    ring->requests = requests;
+    ring->user = -1;
+
+    // buffers need not be larger than the largest request, but should fit one element of each
+    for (r = requests; r; r = r->next)
+    {
+        v = bp_find_var_byid (GET_BP_FILE (fp), r->varid);
+        minsize = (uint64_t) bp_get_type_size (v->type, "") * r->nsteps;
+        size = r->datasize * r->nsteps;
+        if (size > (uint64_t) chunk_buffer_size)
+        {
+            size = (minsize > (uint64_t) chunk_buffer_size ? minsize : (uint64_t) chunk_buffer_size);
+        }
+        if (size > ring->slot_size)
+        {
+            ring->slot_size = size;
+        }
+    }
+
+    pthread_mutex_init (&ring->mutex, NULL);
+    pthread_mutex_init (&ring->io_mutex, NULL);
+    pthread_cond_init (&ring->cond, NULL);
+
+    if (ring->nslots > 1 && read_engine_allowed (fp))
+    {
+        if (!pthread_create (&ring->thread, NULL, chunk_ring_main, ring))
+        {
+            ring->threaded = 1;
+        }
+        else
+        {
+            log_warn ("Cannot start a thread for chunked reads, "
+                      "chunks will be read in adios_check_reads()\n");
+        }
+    }
+
+    log_debug ("Reading in chunks of %" PRIu64 " bytes with %d buffers%s\n",
+               ring->slot_size, ring->nslots, ring->threaded ? " in a thread" : "");
+    return ring;
+}
+
+/* Release the chunk returned last and return the next one. Returns NULL when
+ * there are no more chunks, *error is set if a read has failed.
+ */
+static ADIOS_VARCHUNK * chunk_ring_next (struct chunk_ring * ring, int * error)
+{
+    ADIOS_VARCHUNK * chunk = NULL;
+
+    pthread_mutex_lock (&ring->mutex);
+    if (ring->user >= 0)
+    {
+        ring->user = -1;
+        pthread_cond_broadcast (&ring->cond);
+    }
+
+    if (!ring->threaded && !ring->count && !ring->done)
+    {
+        pthread_mutex_unlock (&ring->mutex);
+        chunk_ring_read (ring);
+        pthread_mutex_lock (&ring->mutex);
+    }
+
+    while (!ring->count && !ring->done)
+    {
+        pthread_cond_wait (&ring->cond, &ring->mutex);
+    }
+
+    if (ring->count)
+    {
+        chunk = ring->chunks[ring->head];
+        ring->chunks[ring->head] = NULL;
+        ring->user = ring->head;
+        ring->head = (ring->head + 1) % ring->nslots;
+        ring->count--;
+    }
+    *error = (chunk ? 0 : ring->error);
+    pthread_mutex_unlock (&ring->mutex);
+
+    return chunk;
+}
+
+/* Stop reading and free the buffers, with the chunks that were not returned. */
+static void chunk_ring_finish (BP_PROC * p)
+{
+    struct chunk_ring * ring = (struct chunk_ring *) p->ring;
+    int i;
+
+    if (!ring)
+        return;
+
+    if (ring->threaded)
+    {
+        pthread_mutex_lock (&ring->mutex);
+        ring->stop = 1;
+        pthread_cond_broadcast (&ring->cond);
+        pthread_mutex_unlock (&ring->mutex);
+        pthread_join (ring->thread, NULL);
+    }
+
+    for (i = 0; i < ring->nslots; i++)
+    {
+        if (ring->chunks[i])
+        {
+            common_read_free_chunk (ring->chunks[i]);
+        }
+        free (ring->buffers[i]);
+    }
+
+    if (ring->requests)
+    {
+        list_free_read_request (ring->requests);
+    }
+
+    pthread_mutex_destroy (&ring->mutex);
+    pthread_mutex_destroy (&ring->io_mutex);
+    pthread_cond_destroy (&ring->cond);
+    free (ring->buffers);
+    free (ring->chunks);
+    free (ring);
+    p->ring = 0;
+}
+
+/* Keep the background readers away from the file handle and fh->b while
+ * the calling thread reads data outside of the read requests. Unlike
+ * adios_read_bp_perform_reads(), this must not drop the chunks of a
+ * non-blocking read that adios_check_reads() has not returned yet, so the
+ * engine and the chunk ring are only paused between two reads.
+ */
+static void background_reads_pause (BP_PROC * p)
+{
+    prefetch_wait (p);
+    if (p->engine)
+    {
+        pthread_mutex_lock (&((struct read_engine *) p->engine)->io_mutex);
+    }
+    if (p->ring)
+    {
+        pthread_mutex_lock (&((struct chunk_ring *) p->ring)->io_mutex);
+    }
+}
+
+static void background_reads_resume (BP_PROC * p)
+{
+    if (p->ring)
+    {
+        pthread_mutex_unlock (&((struct chunk_ring *) p->ring)->io_mutex);
+    }
+    if (p->engine)
+    {
+        pthread_mutex_unlock (&((struct read_engine *) p->engine)->io_mutex);
+    }
+}
+
 int adios_read_bp_check_reads (const ADIOS_FILE * fp, ADIOS_VARCHUNK ** chunk)
 {
     BP_PROC * p = GET_BP_PROC (fp);
@@ -3544,22 +5478,58 @@ int adios_read_bp_check_reads (const ADIOS_FILE * fp, ADIOS_VARCHUNK ** chunk)
  */
     log_debug ("adios_read_bp_check_reads()\n");
 
-    if (!p->local_read_request_list)
+    prefetch_wait (p);
+
+    // requests served from the read-ahead cache are complete already
+    if (p->prefetch && ((struct prefetcher *) p->prefetch)->served)
     {
-        return 0;
+        struct prefetcher * pf = (struct prefetcher *) p->prefetch;
+        struct read_engine_chunk * c = pf->served;
+
+        pf->served = c->next;
+        if (!pf->served)
+            pf->served_tail = NULL;
+        * chunk = c->chunk;
+        free (c);
+        return 1;
+    }
+
+    if (p->engine)
+    {
+        int error;
+
+        varchunk = read_engine_next ((struct read_engine *) p->engine, &error);
+        if (varchunk)
+        {
+            * chunk = varchunk;
+            return 1;
+        }
+
+        read_engine_finish (p);
+        if (error)
+        {
+            adios_errno = error;
+            return error;
+        }
+    }
+
+    // requests with user memory are read first, one by one
+    read_request ** rp = &p->local_read_request_list;
+    while (*rp && !(*rp)->data)
+    {
+        rp = &(*rp)->next;
     }
 
-    // if memory is pre-allocated
-    if (p->local_read_request_list->data)
+    if (*rp)
     {
         log_debug ("adios_read_bp_check_reads(): memory is pre-allocated\n");
-        varchunk = read_var (fp, p->local_read_request_list);
+        varchunk = read_var (fp, *rp);
 
         if (varchunk)
         {
-            // remove head from list
-            r = p->local_read_request_list;
-            p->local_read_request_list = p->local_read_request_list->next;
+            // remove it from list
+            r = *rp;
+            *rp = r->next;
             a2sel_free (r->sel);
             r->sel = NULL;
             free(r);
@@ -3572,81 +5542,36 @@ int adios_read_bp_check_reads (const ADIOS_FILE * fp, ADIOS_VARCHUNK ** chunk)
             return adios_errno;
         }
     }
-    else // if memory is not pre-allocated
+
+    // the rest is read in chunks into our own buffers
+    if (!p->ring && p->local_read_request_list)
     {
         log_debug ("adios_read_bp_check_reads(): memory is not pre-allocated\n");
-        // memory is large enough to contain the data
-        if (chunk_buffer_size >= p->local_read_request_list->datasize)
+        p->ring = chunk_ring_start (fp, p->local_read_request_list);
+        if (!p->ring)
         {
-            log_debug ("adios_read_bp_check_reads(): memory is large enough to contain the data (%" PRIu64 ")\n",
-                       p->local_read_request_list->datasize);
-            assert (p->local_read_request_list->datasize);
-            p->b = realloc (p->b, p->local_read_request_list->datasize);
-            p->local_read_request_list->data = p->b;
-
-            varchunk = read_var (fp, p->local_read_request_list);
-
-            if (varchunk)
-            {
-                // remove head from list
-                r = p->local_read_request_list;
-                p->local_read_request_list = p->local_read_request_list->next;
-                a2sel_free (r->sel);
-                r->sel = NULL;
-                free(r);
-
-                * chunk = varchunk;
-                return 1;
-            }
-            else
-            {
-                return adios_errno;
-            }
+            adios_error (err_no_memory, "Could not allocate memory for chunked reads\n");
+            return err_no_memory;
         }
-        else // memory is smaller than what it takes to read the entire thing in.
-        {
-            log_debug ("adios_read_bp_check_reads(): memory is not large enough to contain the data (%" PRIu64 ")\n",
-                       p->local_read_request_list->datasize);
-            read_request * subreqs = split_req (fp, p->local_read_request_list, chunk_buffer_size);
-            assert (subreqs);
-
-            // remove head from list
-            r = p->local_read_request_list;
-            p->local_read_request_list = p->local_read_request_list->next;
-            a2sel_free (r->sel);
-            r->sel = NULL;
-            free(r);
-
-            r = subreqs;
-            while (r->next)
-            {
-                r = r->next;
-            }
-
-            r->next = p->local_read_request_list;
-            p->local_read_request_list = subreqs;
-
-            p->b = realloc (p->b, p->local_read_request_list->datasize);
-            p->local_read_request_list->data = p->b;
+        p->local_read_request_list = 0;
+    }
 
-            varchunk = read_var (fp, p->local_read_request_list);
+    if (p->ring)
+    {
+        int error;
 
-            if (varchunk)
-            {
-                // remove head from list
-                r = p->local_read_request_list;
-                p->local_read_request_list = p->local_read_request_list->next;
-                a2sel_free (r->sel);
-                r->sel = NULL;
-                free(r);
+        varchunk = chunk_ring_next ((struct chunk_ring *) p->ring, &error);
+        if (varchunk)
+        {
+            * chunk = varchunk;
+            return 1;
+        }
 
-                * chunk = varchunk;
-                return 1;
-            }
-            else
-            {
-                return adios_errno;
-            }
+        chunk_ring_finish (p);
+        if (error)
+        {
+            adios_errno = error;
+            return error;
         }
     }
 
@@ -3803,6 +5728,8 @@ int adios_read_bp_get_attr_byid (const ADIOS_FILE * fp, int attrid, enum ADIOS_D
             return adios_errno;
         }
 
+        bp_load_var (fh, var_root);
+
         /* default values in case of error */
         *data = NULL;
         *size = 0;
@@ -3893,7 +5820,9 @@ int adios_read_bp_get_attr_byid (const ADIOS_FILE * fp, int attrid, enum ADIOS_D
             r->priv = 0;
             r->next = 0;
 
+            background_reads_pause (GET_BP_PROC (fp));
             vc = read_var_bb (fp, r);
+            background_reads_resume (GET_BP_PROC (fp));
 
             free (r->sel);
             free (r);
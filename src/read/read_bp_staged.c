@@ -2152,6 +2152,17 @@ ADIOS_FILE * adios_read_bp_staged_open_file (const char * fname, MPI_Comm comm)
     fh->vars_root = 0;
     fh->attrs_root = 0;
     fh->vars_table = 0;
+    fh->mmap_enabled = 0;
+    fh->mmap_base = 0;
+    fh->mmap_size = 0;
+    fh->index_cache_enabled = 0;
+    fh->index_cache = 0;
+    fh->index_cache_size = 0;
+    fh->lazy_index_enabled = 0;
+    fh->vars_index_offsets = 0;
+    fh->index_b = 0;
+    fh->sieve = 0;
+    fh->sieve_count = 0;
     fh->b = malloc (sizeof (struct adios_bp_buffer_struct_v1));
     assert (fh->b);
     adios_buffer_struct_init (fh->b);
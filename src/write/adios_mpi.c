@@ -10,6 +10,8 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
 #if defined(__APPLE__)
 #    include <sys/param.h>
 #    include <sys/mount.h>
@@ -52,6 +54,10 @@ struct adios_MPI_data_struct
 
     struct adios_bp_buffer_struct_v1 b;
     struct adios_index_struct_v1 * index;
+
+    uint64_t zero_copy_min_size; // > 0: large payloads are written from user memory 
+    int index_fanout; // > 0: gather the index through a tree with this fanout
+    int step_marker; // = 1: rank 0 touches <name>.ready when a step is complete
 };
 
 #if COLLECT_METRICS
@@ -323,6 +329,57 @@ void adios_mpi_init (const PairStruct * parameters
     md->index = adios_alloc_index_v1(1); // with hashtables
 
     adios_buffer_struct_init (&md->b);
+    md->zero_copy_min_size = 0;
+    md->index_fanout = 0;
+    md->step_marker = 0;
+
+    const PairStruct * ps = parameters;
+    while (ps)
+    {
+        if (!strcasecmp (ps->name, "zero-copy"))
+        {
+            errno = 0;
+            long kb = strtol (ps->value, NULL, 10);
+            if (!errno && kb >= 0) {
+                md->zero_copy_min_size = (uint64_t) kb * 1024;
+                log_debug ("Parameter 'zero-copy' set to %ld KB for MPI write method\n", kb);
+            } else {
+                log_error ("Invalid 'zero-copy' parameter given to the MPI write "
+                           "method: '%s'\n", ps->value);
+            }
+        }
+        else if (!strcasecmp (ps->name, "index-fanout"))
+        {
+            errno = 0;
+            long k = strtol (ps->value, NULL, 10);
+            if (!errno && k >= 0 && k <= INT_MAX) {
+                md->index_fanout = (int) k;
+                log_debug ("Parameter 'index-fanout' set to %ld for MPI write method\n", k);
+            } else {
+                log_error ("Invalid 'index-fanout' parameter given to the MPI write "
+                           "method: '%s'\n", ps->value);
+            }
+        }
+        else if (!strcasecmp (ps->name, "step-marker"))
+        {
+            errno = 0;
+            md->step_marker = strtol (ps->value, NULL, 10);
+            if (!errno) {
+                log_debug ("Parameter 'step-marker' set to %d for MPI write method\n",
+                           md->step_marker);
+            } else {
+                log_error ("Invalid 'step-marker' parameter given to the MPI write "
+                           "method: '%s'\n", ps->value);
+            }
+        }
+        else
+        {
+            log_warn ("Parameter name %s is not recognized by the MPI write "
+                      "method\n", ps->name);
+        }
+        ps = ps->next;
+    }
+
     init_mpi_chain (md->group_comm);
 #if COLLECT_METRICS
     // init the pointer for the first go around avoiding the bad free in open
@@ -381,6 +438,8 @@ int adios_mpi_open (struct adios_file_struct * fd
         MPI_Comm_size (md->group_comm, &md->size);
     }
     fd->group->process_id = md->rank;
+    if (fd->mode != adios_mode_read)
+        fd->zero_copy_min_size = md->zero_copy_min_size;
 
     char * name;
     int err;
@@ -1161,6 +1220,93 @@ void adios_mpi_buffer_overflow (struct adios_file_struct * fd,
 }
 
 
+/* Write the buffer at the current file position, with the zero-copy holes filled 
+   from the user's memory. Each MPI_File_write() writes a derived datatype describing 
+   at most MAX_MPIWRITE_SIZE bytes of memory segments, given with absolute addresses.
+*/
+#define ADIOS_MPI_ZERO_COPY_MAX_BLOCKS 1024
+static int adios_mpi_write_zero_copy (struct adios_file_struct * fd
+                                     ,struct adios_MPI_data_struct * md
+                                     )
+{
+    struct iovec * iov;
+    int niov, i = 0;
+    uint64_t done = 0;  // bytes of iov[i] already included in a write
+    int lens [ADIOS_MPI_ZERO_COPY_MAX_BLOCKS];
+    MPI_Aint displs [ADIOS_MPI_ZERO_COPY_MAX_BLOCKS];
+    MPI_Datatype blocks;
+    int err = MPI_SUCCESS;
+
+    niov = adios_databuffer_get_iovec (fd, &iov);
+    if (niov < 0)
+        return MPI_ERR_OTHER;
+
+    while (i < niov && err == MPI_SUCCESS)
+    {
+        int nblocks = 0;
+        uint64_t batch = 0;
+        while (i < niov && nblocks < ADIOS_MPI_ZERO_COPY_MAX_BLOCKS && batch < MAX_MPIWRITE_SIZE)
+        {
+            uint64_t len = iov[i].iov_len - done;
+            if (len > MAX_MPIWRITE_SIZE - batch)
+                len = MAX_MPIWRITE_SIZE - batch;
+            MPI_Get_address ((char *) iov[i].iov_base + done, &displs[nblocks]);
+            lens[nblocks] = (int) len;
+            nblocks++;
+            batch += len;
+            done += len;
+            if (done == iov[i].iov_len)
+            {
+                i++;
+                done = 0;
+            }
+        }
+
+        MPI_Type_create_hindexed (nblocks, lens, displs, MPI_BYTE, &blocks);
+        MPI_Type_commit (&blocks);
+        err = MPI_File_write (md->fh, MPI_BOTTOM, 1, blocks, &md->status);
+        MPI_Type_free (&blocks);
+    }
+
+    free (iov);
+    return err;
+}
+
+/* Gather the index of all processes into md->index on rank 0 through a
+   tree, instead of gathering all of them to rank 0 directly.
+*/
+static void adios_mpi_gather_index_tree (struct adios_MPI_data_struct * md
+                                        ,char ** buffer
+                                        ,uint64_t * buffer_size
+                                        ,uint64_t * buffer_offset
+                                        )
+{
+    char ** index_buffers = 0;
+    uint64_t * index_buffer_sizes = 0;
+    int i, n;
+
+    if (md->rank != 0)
+    {
+        adios_write_index_v1 (buffer, buffer_size, buffer_offset, 0, md->index);
+    }
+    n = adios_gather_indices_tree_v1 (md->group_comm, md->index_fanout,
+                                      *buffer, *buffer_offset, 0,
+                                      &index_buffers, &index_buffer_sizes);
+    if (md->rank == 0)
+    {
+        // do not merge attributes from other processes from 1.4
+        // the first (own) buffer is empty, rank 0's index is md->index
+        adios_merge_index_buffers_v1 (md->index, n, index_buffers,
+                                      index_buffer_sizes, -1, 0);
+        for (i = 1; i < n; i++)
+        {
+            free (index_buffers [i]);
+        }
+        free (index_buffers);
+        free (index_buffer_sizes);
+    }
+}
+
 void adios_mpi_close (struct adios_file_struct * fd
                      ,struct adios_method_struct * method
                      )
@@ -1169,9 +1315,6 @@ void adios_mpi_close (struct adios_file_struct * fd
                                                  method->method_data;
     //struct adios_attribute_struct * a = fd->group->attributes;
 
-    struct adios_index_process_group_struct_v1 * new_pg_root = 0;
-    struct adios_index_var_struct_v1 * new_vars_root = 0;
-    struct adios_index_attribute_struct_v1 * new_attrs_root = 0;
 #if COLLECT_METRICS
     gettimeofday (&timing.t23, NULL);
     timing.t19.tv_sec = timing.t23.tv_sec;
@@ -1214,62 +1357,36 @@ void adios_mpi_close (struct adios_file_struct * fd
             adios_build_index_v1 (fd, md->index);
 
             // if collective, gather the indexes from the rest and call
-            if (md->group_comm != MPI_COMM_NULL)
+            if (md->group_comm != MPI_COMM_NULL && md->index_fanout > 0)
+            {
+                adios_mpi_gather_index_tree (md, &buffer, &buffer_size, &buffer_offset);
+            }
+            else if (md->group_comm != MPI_COMM_NULL)
             {
                 if (md->rank == 0)
                 {
-                    int * index_sizes = malloc (4 * md->size);
-                    int * index_offsets = malloc (4 * md->size);
+                    uint64_t * index_sizes = malloc (8 * md->size);
+                    uint64_t * index_offsets = malloc (8 * md->size);
                     char * recv_buffer = 0;
-                    uint32_t size = 0;
-                    uint32_t total_size = 0;
                     int i;
 
-                    MPI_Gather (&size, 1, MPI_INT
-                               ,index_sizes, 1, MPI_INT
-                               ,0, md->group_comm
-                               );
-
-                    for (i = 0; i < md->size; i++)
-                    {
-                        index_offsets [i] = total_size;
-                        total_size += index_sizes [i];
-                    } 
-
-                    recv_buffer = malloc (total_size);
+                    recv_buffer = adios_gather_buffers (md->group_comm, 0, 0
+                                                       ,index_sizes, index_offsets);
 
-                    MPI_Gatherv (&size, 0, MPI_BYTE
-                                ,recv_buffer, index_sizes, index_offsets
-                                ,MPI_BYTE, 0, md->group_comm
-                                );
-
-                    char * buffer_save = md->b.buff;
-                    uint64_t buffer_size_save = md->b.length;
-                    uint64_t offset_save = md->b.offset;
+                    char ** index_buffers = malloc (md->size * sizeof (char *));
+                    uint64_t * index_buffer_sizes = malloc (md->size * sizeof (uint64_t));
 
                     for (i = 1; i < md->size; i++)
                     {
-                        md->b.buff = recv_buffer + index_offsets [i];
-                        md->b.length = index_sizes [i];
-                        md->b.offset = 0;
-
-                        adios_parse_process_group_index_v1 (&md->b, &new_pg_root, NULL);
-                        adios_parse_vars_index_v1 (&md->b, &new_vars_root, NULL, NULL);
-                        // do not merge attributes from other processes from 1.4
-                        /*
-                        adios_parse_attributes_index_v1 (&md->b
-                                                        ,&new_attrs_root
-                                                        );
-                        */
-                        adios_merge_index_v1 (md->index, new_pg_root, 
-                                              new_vars_root, new_attrs_root, 0);
-                        new_pg_root = 0;
-                        new_vars_root = 0;
-                        new_attrs_root = 0;
+                        index_buffers [i - 1] = recv_buffer + index_offsets [i];
+                        index_buffer_sizes [i - 1] = index_sizes [i];
                     }
-                    md->b.buff = buffer_save;
-                    md->b.length = buffer_size_save;
-                    md->b.offset = offset_save;
+                    // do not merge attributes from other processes from 1.4
+                    adios_merge_index_buffers_v1 (md->index, md->size - 1, index_buffers,
+                                                  index_buffer_sizes, -1, 0);
+
+                    free (index_buffers);
+                    free (index_buffer_sizes);
 
                     free (recv_buffer);
                     free (index_sizes);
@@ -1280,14 +1397,7 @@ void adios_mpi_close (struct adios_file_struct * fd
                     adios_write_index_v1 (&buffer, &buffer_size, &buffer_offset
                                          ,0, md->index);
 
-                    uint32_t tmp_buffer_size = (uint32_t) buffer_offset;
-                    MPI_Gather (&tmp_buffer_size, 1, MPI_INT, 0, 0, MPI_INT
-                               ,0, md->group_comm
-                               );
-                    MPI_Gatherv (buffer, buffer_offset, MPI_BYTE
-                                ,0, 0, 0, MPI_BYTE
-                                ,0, md->group_comm
-                                );
+                    adios_gather_buffers (md->group_comm, buffer, buffer_offset, 0, 0);
                 }
             }
 
@@ -1300,6 +1410,22 @@ void adios_mpi_close (struct adios_file_struct * fd
             // since count is limited to MAX_MPIWRITE_SIZE (signed 32-bit max).
             uint64_t bytes_written = 0;
             int32_t to_write = 0;
+            if (fd->zero_copy)
+            {
+                err = adios_mpi_write_zero_copy (fd, md);
+                if (err != MPI_SUCCESS) 
+                {              
+                    char e [MPI_MAX_ERROR_STRING];
+                    int len = 0;
+                    memset (e, 0, MPI_MAX_ERROR_STRING);
+                    MPI_Error_string (err, e, &len);
+                    adios_error (err_write_error, 
+                            "MPI method, rank %d: adios_close(): writing of buffered data "
+                            "to file %s failed: '%s'\n",
+                            md->rank, fd->name, e);       
+                }
+                bytes_written = fd->bytes_written; // nothing left for the loop below
+            }
             if (fd->bytes_written > MAX_MPIWRITE_SIZE)
             {
                 to_write = MAX_MPIWRITE_SIZE;
@@ -1433,62 +1559,36 @@ timeval_subtract (&timing.t8, &b, &a);
             // build index appending to any existing index
             adios_build_index_v1 (fd, md->index);
             // if collective, gather the indexes from the rest and call
-            if (md->group_comm != MPI_COMM_NULL)
+            if (md->group_comm != MPI_COMM_NULL && md->index_fanout > 0)
+            {
+                adios_mpi_gather_index_tree (md, &buffer, &buffer_size, &buffer_offset);
+            }
+            else if (md->group_comm != MPI_COMM_NULL)
             {
                 if (md->rank == 0)
                 {
-                    int * index_sizes = malloc (4 * md->size);
-                    int * index_offsets = malloc (4 * md->size);
+                    uint64_t * index_sizes = malloc (8 * md->size);
+                    uint64_t * index_offsets = malloc (8 * md->size);
                     char * recv_buffer = 0;
-                    uint32_t size = 0;
-                    uint32_t total_size = 0;
                     int i;
 
-                    MPI_Gather (&size, 1, MPI_INT
-                               ,index_sizes, 1, MPI_INT
-                               ,0, md->group_comm
-                               );
-
-                    for (i = 0; i < md->size; i++)
-                    {
-                        index_offsets [i] = total_size;
-                        total_size += index_sizes [i];
-                    }
-
-                    recv_buffer = malloc (total_size);
+                    recv_buffer = adios_gather_buffers (md->group_comm, 0, 0
+                                                       ,index_sizes, index_offsets);
 
-                    MPI_Gatherv (&size, 0, MPI_BYTE
-                                ,recv_buffer, index_sizes, index_offsets
-                                ,MPI_BYTE, 0, md->group_comm
-                                );
-
-                    char * buffer_save = md->b.buff;
-                    uint64_t buffer_size_save = md->b.length;
-                    uint64_t offset_save = md->b.offset;
+                    char ** index_buffers = malloc (md->size * sizeof (char *));
+                    uint64_t * index_buffer_sizes = malloc (md->size * sizeof (uint64_t));
 
                     for (i = 1; i < md->size; i++)
                     {
-                        md->b.buff = recv_buffer + index_offsets [i];
-                        md->b.length = index_sizes [i];
-                        md->b.offset = 0;
-
-                        adios_parse_process_group_index_v1 (&md->b, &new_pg_root, NULL);
-                        adios_parse_vars_index_v1 (&md->b, &new_vars_root, NULL, NULL);
-                        // do not merge attributes from other processes from 1.4
-                        /*
-                        adios_parse_attributes_index_v1 (&md->b
-                                                        ,&new_attrs_root
-                                                        );
-                        */
-                        adios_merge_index_v1 (md->index, new_pg_root, 
-                                              new_vars_root, new_attrs_root, 0);
-                        new_pg_root = 0;
-                        new_vars_root = 0;
-                        new_attrs_root = 0;
+                        index_buffers [i - 1] = recv_buffer + index_offsets [i];
+                        index_buffer_sizes [i - 1] = index_sizes [i];
                     }
-                    md->b.buff = buffer_save;
-                    md->b.length = buffer_size_save;
-                    md->b.offset = offset_save;
+                    // do not merge attributes from other processes from 1.4
+                    adios_merge_index_buffers_v1 (md->index, md->size - 1, index_buffers,
+                                                  index_buffer_sizes, -1, 0);
+
+                    free (index_buffers);
+                    free (index_buffer_sizes);
 
                     free (recv_buffer);
                     free (index_sizes);
@@ -1499,15 +1599,7 @@ timeval_subtract (&timing.t8, &b, &a);
                     adios_write_index_v1 (&buffer, &buffer_size, &buffer_offset
                                          ,0, md->index);
 
-                    int _buffer_size = buffer_offset;
-
-                    MPI_Gather (&_buffer_size, 1, MPI_INT, 0, 0, MPI_INT
-                               ,0, md->group_comm
-                               );
-                    MPI_Gatherv (buffer, buffer_offset, MPI_BYTE
-                                ,0, 0, 0, MPI_BYTE
-                                ,0, md->group_comm
-                                );
+                    adios_gather_buffers (md->group_comm, buffer, buffer_offset, 0, 0);
                 }
             }
 
@@ -1518,6 +1610,11 @@ timeval_subtract (&timing.t8, &b, &a);
                     ,MPI_BYTE, &md->status
                     );
 #endif
+            if (fd->zero_copy)
+            {
+                err = adios_mpi_write_zero_copy (fd, md);
+            }
+            else
             {              
                 uint64_t total_written = 0;
                 uint64_t to_write = fd->bytes_written;
@@ -1622,6 +1719,12 @@ timeval_subtract (&timing.t8, &b, &a);
         MPI_File_sync (md->fh);
 #endif
         MPI_File_close (&md->fh);
+
+        // the footer written by rank 0 is complete now
+        if (md->step_marker && md->rank == 0 && fd->mode != adios_mode_read)
+        {
+            adios_write_step_marker_v1 (method->base_path, fd->name);
+        }
     }
 
 #if COLLECT_METRICS
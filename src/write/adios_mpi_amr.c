@@ -43,6 +43,10 @@ enum ADIOS_MPI_AMR_IO_TYPE
     ADIOS_MPI_AMR_IO_BG   = 2, // Brigade aggregation
 };
 
+// staging buffers of the aggregator in AG mode
+#define ADIOS_MPI_AMR_PIPELINE_DEPTH 2
+#define ADIOS_MPI_AMR_PIPELINE_BUFFER_SIZE (16*1024*1024)
+
 static int adios_mpi_amr_initialized = 0;
 
 //#define is_aggregator(rank)  md->g_is_aggregator[rank]
@@ -107,6 +111,16 @@ struct adios_MPI_data_struct
     int g_color2;
     MPI_Comm g_comm1;
     MPI_Comm g_comm2;
+    int g_node_local; // whether PGs are first collected on each node in shared memory
+    MPI_Comm g_node_comm; // processes of g_comm1 on the same node
+    MPI_Comm g_leader_comm; // node leaders of g_comm1, MPI_COMM_NULL elsewhere
+    int g_pipeline_depth; // number of staging buffers on the aggregator (AG)
+    uint64_t g_pipeline_buffer_size; // size of one staging buffer (AG)
+    int g_adaptive; // 1: group ranks by PG sizes, 2: also keep nodes in one group
+    int g_adaptive_naggr; // number of aggregators requested for adaptive grouping
+    int g_adaptive_nproc; // number of processes the cached grouping is for
+    uint64_t * g_adaptive_sizes; // PG sizes the cached grouping is made for
+    int * g_adaptive_colors; // cached grouping, aggregation group of each rank
     MPI_Offset * g_offsets;
     int * g_ost_skipping_list;
     pthread_t g_sot;
@@ -478,6 +492,10 @@ adios_mpi_amr_set_have_mdf (char * parameters, struct adios_MPI_data_struct * md
     free (temp_string);
 }
 
+static void adios_mpi_amr_adaptive_group (struct adios_MPI_data_struct * md
+                                         ,uint64_t * sizes
+                                         );
+
 static void
 adios_mpi_amr_set_aggregation_parameters(char * parameters, struct adios_MPI_data_struct * md)
 {
@@ -600,6 +618,92 @@ adios_mpi_amr_set_aggregation_parameters(char * parameters, struct adios_MPI_dat
     }
     free (temp_string);
 
+    // set up whether to collect PGs on each node in shared memory first
+    temp_string = a2s_trim_spaces (parameters);
+    if ( (p_size = strstr (temp_string, "node_local")) )
+    {
+        char * p = strchr (p_size, '=');
+        char * q = strtok (p, ";");
+        if (!q)
+            md->g_node_local = atoi(q + 1);
+        else
+            md->g_node_local = atoi(p + 1);
+    }
+    else
+    {
+        // by default, every process sends its PG to the aggregator
+        md->g_node_local = 0;
+    }
+    free (temp_string);
+
+    // set up the staging buffers of the aggregator (aggregation_type=1)
+    temp_string = a2s_trim_spaces (parameters);
+    if ( (p_size = strstr (temp_string, "pipeline_depth")) )
+    {
+        char * p = strchr (p_size, '=');
+        char * q = strtok (p, ";");
+        if (!q)
+            md->g_pipeline_depth = atoi(q + 1);
+        else
+            md->g_pipeline_depth = atoi(p + 1);
+    }
+    else
+    {
+        md->g_pipeline_depth = ADIOS_MPI_AMR_PIPELINE_DEPTH;
+    }
+    free (temp_string);
+
+    temp_string = a2s_trim_spaces (parameters);
+    if ( (p_size = strstr (temp_string, "pipeline_buffer_size")) )
+    {
+        char * p = strchr (p_size, '=');
+        char * q = strtok (p, ";");
+        if (!q)
+            md->g_pipeline_buffer_size = strtoull (q + 1, NULL, 10);
+        else
+            md->g_pipeline_buffer_size = strtoull (p + 1, NULL, 10);
+    }
+    else
+    {
+        md->g_pipeline_buffer_size = ADIOS_MPI_AMR_PIPELINE_BUFFER_SIZE;
+    }
+    free (temp_string);
+
+    // set up adaptive grouping of processes by the size of their output
+    temp_string = a2s_trim_spaces (parameters);
+    if ( (p_size = strstr (temp_string, "adaptive")) )
+    {
+        char * p = strchr (p_size, '=');
+        char * q = strtok (p, ";");
+        if (!q)
+            md->g_adaptive = atoi(q + 1);
+        else
+            md->g_adaptive = atoi(p + 1);
+    }
+    else
+    {
+        // by default, groups are contiguous ranges of equal number of processes
+        md->g_adaptive = 0;
+    }
+    free (temp_string);
+#if MPI_VERSION < 3
+    if (md->g_adaptive == 2)
+    {
+        log_warn ("MPI_AMR method: adaptive=2 needs MPI-3 to find the processes "
+                  "of a node, falling back to adaptive=1.\n");
+        md->g_adaptive = 1;
+    }
+#endif
+
+    if (md->g_pipeline_depth < 1)
+    {
+        md->g_pipeline_depth = 1;
+    }
+    if (md->g_pipeline_buffer_size == 0 || md->g_pipeline_buffer_size > INT32_MAX)
+    {
+        md->g_pipeline_buffer_size = ADIOS_MPI_AMR_PIPELINE_BUFFER_SIZE;
+    }
+
     // set up which ost's to skip
     temp_string = a2s_trim_spaces (parameters);
 
@@ -650,7 +754,44 @@ adios_mpi_amr_set_aggregation_parameters(char * parameters, struct adios_MPI_dat
     }
     memset (md->g_is_aggregator, 0, nproc * sizeof(int));
 
-    if (!md->is_color_set)
+    md->g_adaptive_naggr = md->g_num_aggregators;
+    if (!md->is_color_set && md->g_adaptive
+        && (!md->g_adaptive_colors || md->g_adaptive_nproc != nproc))
+    {
+        // no PG sizes known yet, group by the number of processes
+        uint64_t * ones = (uint64_t *) malloc (nproc * 8);
+        for (i = 0; i < nproc; i++)
+        {
+            ones[i] = 1;
+        }
+        FREE (md->g_adaptive_sizes);
+        adios_mpi_amr_adaptive_group (md, ones);
+        free (ones);
+    }
+
+    if (!md->is_color_set && md->g_adaptive && md->g_adaptive_colors)
+    {
+        // groups of about equal size made from the PG sizes of a
+        // previous step, see adios_mpi_amr_adaptive_update()
+        md->g_color1 = md->g_adaptive_colors[rank];
+        md->g_color2 = 0;
+        md->g_num_aggregators = md->g_adaptive_colors[nproc - 1] + 1;
+        for (i = 0; i < nproc; i++)
+        {
+            if (i == 0 || md->g_adaptive_colors[i] != md->g_adaptive_colors[i - 1])
+            {
+                md->g_is_aggregator[i] = 1;
+            }
+            if (i < rank && md->g_adaptive_colors[i] == md->g_color1)
+            {
+                md->g_color2++;
+            }
+        }
+
+        MPI_Comm_split (md->group_comm, md->g_color1, md->rank, &md->g_comm1);
+        MPI_Comm_split (md->group_comm, md->g_color2, md->rank, &md->g_comm2);
+    }
+    else if (!md->is_color_set)
     {
         aggr_group_size = nproc / md->g_num_aggregators;
         remain = nproc - (int) aggr_group_size * md->g_num_aggregators;
@@ -697,6 +838,28 @@ adios_mpi_amr_set_aggregation_parameters(char * parameters, struct adios_MPI_dat
         MPI_Comm_split (md->group_comm, md->g_color1, md->rank, &md->g_comm1);
         MPI_Comm_rank (md->g_comm1, &md->g_color2);
     }
+
+    // Split each aggregation group by node. The aggregator has rank 0 in
+    // g_comm1, so it is the leader of its node and rank 0 among the leaders.
+    md->g_node_comm = MPI_COMM_NULL;
+    md->g_leader_comm = MPI_COMM_NULL;
+    if (md->g_node_local)
+    {
+#if MPI_VERSION >= 3
+        int new_rank, node_rank;
+
+        MPI_Comm_rank (md->g_comm1, &new_rank);
+        MPI_Comm_split_type (md->g_comm1, MPI_COMM_TYPE_SHARED, new_rank
+                            ,MPI_INFO_NULL, &md->g_node_comm);
+        MPI_Comm_rank (md->g_node_comm, &node_rank);
+        MPI_Comm_split (md->g_comm1, (node_rank == 0 ? 0 : MPI_UNDEFINED), new_rank
+                       ,&md->g_leader_comm);
+#else
+        log_warn ("MPI_AMR method: node_local=1 needs MPI-3 shared memory windows, "
+                  "falling back to the default aggregation.\n");
+        md->g_node_local = 0;
+#endif
+    }
 }
 
 /*
@@ -1120,6 +1283,16 @@ void adios_mpi_amr_init (const PairStruct * parameters
     md->is_color_set = 0;
     md->g_color1 = 0;
     md->g_color2 = 0;
+    md->g_node_local = 0;
+    md->g_node_comm = MPI_COMM_NULL;
+    md->g_leader_comm = MPI_COMM_NULL;
+    md->g_pipeline_depth = ADIOS_MPI_AMR_PIPELINE_DEPTH;
+    md->g_pipeline_buffer_size = ADIOS_MPI_AMR_PIPELINE_BUFFER_SIZE;
+    md->g_adaptive = 0;
+    md->g_adaptive_naggr = 0;
+    md->g_adaptive_nproc = 0;
+    md->g_adaptive_sizes = 0;
+    md->g_adaptive_colors = 0;
     md->g_offsets = 0;
     md->g_ost_skipping_list = 0;
     md->open_thread_data = 0;
@@ -1630,6 +1803,271 @@ int adios_MPI_Irecv(void *buf, uint64_t count, int source,
     return n;
 }
 
+/* Node-local aggregation (node_local=1): every process copies its PG into a
+ * shared memory window owned by the leader of its node, ordered by rank.
+ * On return, the leader has all PGs of the node in *node_buff (node_size
+ * bytes) which it passes on to the aggregator instead of its own PG, while
+ * other processes have nothing to send. *pg_offset is the offset of this
+ * process' PG within the node's block. The window must be released with
+ * adios_mpi_amr_node_release() after the leader has sent the block.
+ */
+static void adios_mpi_amr_node_gather (struct adios_file_struct * fd
+                                      ,struct adios_MPI_data_struct * md
+                                      ,MPI_Win * win
+                                      ,void ** node_buff
+                                      ,uint64_t * node_size
+                                      ,uint64_t * pg_offset
+                                      )
+{
+#if MPI_VERSION >= 3
+    uint64_t pg_size = fd->bytes_written;
+    uint64_t * pg_sizes;
+    int i, node_rank, node_nproc, disp_unit;
+    MPI_Aint win_size;
+    char * base;
+
+    MPI_Comm_rank (md->g_node_comm, &node_rank);
+    MPI_Comm_size (md->g_node_comm, &node_nproc);
+
+    pg_sizes = (uint64_t *) malloc (node_nproc * 8);
+    MPI_Allgather (&pg_size, 1, MPI_UNSIGNED_LONG_LONG
+                  ,pg_sizes, 1, MPI_UNSIGNED_LONG_LONG
+                  ,md->g_node_comm);
+
+    *pg_offset = 0;
+    *node_size = 0;
+    for (i = 0; i < node_nproc; i++)
+    {
+        if (i < node_rank)
+            *pg_offset += pg_sizes[i];
+        *node_size += pg_sizes[i];
+    }
+    free (pg_sizes);
+
+    MPI_Win_allocate_shared ((node_rank == 0 ? (MPI_Aint) *node_size : 0), 1
+                            ,MPI_INFO_NULL, md->g_node_comm, &base, win);
+    MPI_Win_shared_query (*win, 0, &win_size, &disp_unit, &base);
+
+    MPI_Win_lock_all (MPI_MODE_NOCHECK, *win);
+    memcpy (base + *pg_offset, fd->buffer, pg_size);
+    MPI_Win_sync (*win);
+    MPI_Barrier (md->g_node_comm);
+    MPI_Win_sync (*win);
+    MPI_Win_unlock_all (*win);
+
+    *node_buff = (node_rank == 0) ? base : 0;
+#endif
+}
+
+/* Release the node's shared memory window and return the offset of the
+ * node's block among the blocks of the aggregation group (known by the
+ * leader only) to every process of the node.
+ */
+static uint64_t adios_mpi_amr_node_release (struct adios_MPI_data_struct * md
+                                           ,MPI_Win * win
+                                           ,uint64_t block_offset
+                                           )
+{
+#if MPI_VERSION >= 3
+    MPI_Bcast (&block_offset, 1, MPI_UNSIGNED_LONG_LONG, 0, md->g_node_comm);
+    MPI_Win_free (win);
+#endif
+    return block_offset;
+}
+
+/* Pipelined aggregation (aggregation_type=1): the PGs of the group are
+ * cut into pieces of at most g_pipeline_buffer_size bytes and received by
+ * the aggregator into g_pipeline_depth staging buffers. While one piece is
+ * written to the subfile, the next ones are being received, so the
+ * aggregator never holds more than the staging buffers. The aggregator's
+ * own PG is written directly from own_buff, starting at base_offset.
+ * The aggregator broadcasts whether it could set up the staging buffers
+ * before anything is sent, so that the senders do not block on a receiver
+ * that gave up (see adios_mpi_amr_pipeline_send()).
+ * Returns 0, or 1 if the pipeline could not be set up or a write failed.
+ */
+static int adios_mpi_amr_pipeline_write (struct adios_file_struct * fd
+                                        ,struct adios_MPI_data_struct * md
+                                        ,MPI_Comm comm
+                                        ,int group_size
+                                        ,uint64_t * pg_sizes
+                                        ,void * own_buff
+                                        ,uint64_t base_offset
+                                        )
+{
+    int depth = md->g_pipeline_depth;
+    uint64_t piece_size = md->g_pipeline_buffer_size;
+    uint64_t max_piece = 0, offset = base_offset, count;
+    int * piece_src;
+    int * piece_len;
+    int npieces = 0, i, k, status = 0;
+    void ** buffs;
+    MPI_Request * requests;
+
+    for (i = 1; i < group_size; i++)
+    {
+        npieces += (pg_sizes[i] + piece_size - 1) / piece_size;
+        if (pg_sizes[i] > max_piece)
+            max_piece = pg_sizes[i];
+    }
+    if (max_piece > piece_size)
+        max_piece = piece_size;
+    if (depth > npieces)
+        depth = npieces;
+
+    piece_src = (int *) malloc ((npieces + 1) * sizeof (int));
+    piece_len = (int *) malloc ((npieces + 1) * sizeof (int));
+    buffs = (void **) calloc (depth + 1, sizeof (void *));
+    requests = (MPI_Request *) malloc ((depth + 1) * sizeof (MPI_Request));
+    if (!piece_src || !piece_len || !buffs || !requests)
+    {
+        adios_error (err_no_memory,
+                "MPI_AMR method (AG): Cannot allocate the aggregation pipeline "
+                "for %d pieces.\n", npieces);
+        status = 1;
+    }
+    else
+    {
+        npieces = 0;
+        for (i = 1; i < group_size; i++)
+        {
+            uint64_t remain = pg_sizes[i];
+            while (remain > 0)
+            {
+                piece_src[npieces] = i;
+                piece_len[npieces] = (int) (remain > piece_size ? piece_size : remain);
+                remain -= piece_len[npieces];
+                npieces++;
+            }
+        }
+
+        for (k = 0; k < depth; k++)
+        {
+            buffs[k] = malloc (max_piece);
+            if (buffs[k] == 0)
+            {
+                // run with the buffers we got
+                depth = k;
+                break;
+            }
+        }
+        if (depth == 0 && npieces > 0)
+        {
+            adios_error (err_no_memory,
+                    "MPI_AMR method (AG): Cannot allocate a %llu bytes staging buffer "
+                    "for aggregation. Decrease pipeline_buffer_size.\n", max_piece);
+            status = 1;
+        }
+    }
+
+    START_TIMER (ADIOS_TIMER_COMM);
+    MPI_Bcast (&status, 1, MPI_INT, 0, comm);
+    STOP_TIMER (ADIOS_TIMER_COMM);
+    if (status)
+    {
+        FREE (piece_src);
+        FREE (piece_len);
+        FREE (buffs);
+        FREE (requests);
+        return 1;
+    }
+
+    // start receiving while the aggregator writes its own PG
+    START_TIMER (ADIOS_TIMER_COMM);
+    for (k = 0; k < depth; k++)
+    {
+        MPI_Irecv (buffs[k], piece_len[k], MPI_BYTE, piece_src[k], 0, comm, &requests[k]);
+    }
+    STOP_TIMER (ADIOS_TIMER_COMM);
+
+    START_TIMER (ADIOS_TIMER_IO);
+    count = adios_mpi_amr_striping_unit_write (md->fh, offset, own_buff, pg_sizes[0]);
+    STOP_TIMER (ADIOS_TIMER_IO);
+    if (count != pg_sizes[0])
+    {
+        adios_error (err_unspecified,
+                "MPI_AMR method (AG): Wrote %llu bytes of the %llu bytes "
+                "of the aggregator's process group.\n", count, pg_sizes[0]);
+        status = 1;
+    }
+    offset += pg_sizes[0];
+
+    // after a failed write, the remaining pieces are still received
+    // so that the senders can finish
+    for (k = 0; k < npieces; k++)
+    {
+        int b = k % depth;
+
+        START_TIMER (ADIOS_TIMER_COMM);
+        MPI_Wait (&requests[b], MPI_STATUS_IGNORE);
+        STOP_TIMER (ADIOS_TIMER_COMM);
+
+        if (!status)
+        {
+            START_TIMER (ADIOS_TIMER_IO);
+            count = adios_mpi_amr_striping_unit_write (md->fh, offset, buffs[b], piece_len[k]);
+            STOP_TIMER (ADIOS_TIMER_IO);
+            if (count != (uint64_t) piece_len[k])
+            {
+                adios_error (err_unspecified,
+                        "MPI_AMR method (AG): Wrote %llu bytes of a %d bytes piece "
+                        "from rank %d of the aggregation group.\n",
+                        count, piece_len[k], piece_src[k]);
+                status = 1;
+            }
+        }
+        offset += piece_len[k];
+
+        if (k + depth < npieces)
+        {
+            START_TIMER (ADIOS_TIMER_COMM);
+            MPI_Irecv (buffs[b], piece_len[k + depth], MPI_BYTE, piece_src[k + depth]
+                      ,0, comm, &requests[b]);
+            STOP_TIMER (ADIOS_TIMER_COMM);
+        }
+    }
+
+    for (k = 0; k < depth; k++)
+    {
+        free (buffs[k]);
+    }
+    free (buffs);
+    free (requests);
+    free (piece_src);
+    free (piece_len);
+
+    return status;
+}
+
+/* Sender side of the pipelined aggregation: pass the PG to the aggregator
+ * (rank 0 of comm) in the same pieces the aggregator receives, unless the
+ * aggregator reports that it could not set up its staging buffers.
+ */
+static void adios_mpi_amr_pipeline_send (struct adios_MPI_data_struct * md
+                                        ,MPI_Comm comm
+                                        ,void * buff
+                                        ,uint64_t size
+                                        )
+{
+    char * p = buff;
+    int status;
+
+    MPI_Bcast (&status, 1, MPI_INT, 0, comm);
+    if (status)
+    {
+        log_warn ("MPI_AMR method (AG): The aggregator could not receive the "
+                  "process group of rank %d, it is not written.\n", md->rank);
+        return;
+    }
+    while (size > 0)
+    {
+        int len = (int) (size > md->g_pipeline_buffer_size ? md->g_pipeline_buffer_size : size);
+        MPI_Send (p, len, MPI_BYTE, 0, 0, comm);
+        p += len;
+        size -= len;
+    }
+}
+
 void adios_mpi_amr_bg_close (struct adios_file_struct * fd
                             ,struct adios_method_struct * method
                             )
@@ -1661,6 +2099,12 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
             struct adios_MPI_thread_data_write write_thread_data;
             int i, new_rank, new_group_size, new_rank2, new_group_size2;
             uint64_t max_data_size = 0, total_data_size = 0, total_data_size1 = 0;
+            // with node_local=1, only node leaders send (their node's block)
+            void * send_buff = fd->buffer;
+            uint64_t send_size = fd->bytes_written, pg_offset = 0, block_offset = 0;
+            MPI_Comm data_comm = md->g_comm1;
+            int data_rank = 0, data_group_size = 0;
+            MPI_Win node_win;
             START_TIMER (ADIOS_TIMER_COMM);
             //MPI_Comm_split (md->group_comm, md->g_color1, md->rank, &md->g_comm1);
             MPI_Comm_rank (md->g_comm1, &new_rank);
@@ -1669,17 +2113,28 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
             //MPI_Comm_split (md->group_comm, md->g_color2, md->rank, &md->g_comm2);
             MPI_Comm_rank (md->g_comm2, &new_rank2);
             MPI_Comm_size (md->g_comm2, &new_group_size2);
+            if (md->g_node_local)
+            {
+                adios_mpi_amr_node_gather (fd, md, &node_win, &send_buff
+                                          ,&send_size, &pg_offset);
+                data_comm = md->g_leader_comm;
+            }
+            if (data_comm != MPI_COMM_NULL)
+            {
+                MPI_Comm_rank (data_comm, &data_rank);
+                MPI_Comm_size (data_comm, &data_group_size);
+            }
             STOP_TIMER (ADIOS_TIMER_COMM);
 
             // if not merge PG's on the aggregator side
-            if (!md->g_merging_pgs)
+            if (!md->g_merging_pgs && data_comm != MPI_COMM_NULL)
             {
                 //printf ("do not merge pg\n");
                 uint64_t pg_size;
 
-                pg_size = fd->bytes_written;
-                pg_sizes = (uint64_t *) malloc (new_group_size * 8);
-                disp = (uint64_t *) malloc (new_group_size * 8);
+                pg_size = send_size;
+                pg_sizes = (uint64_t *) malloc (data_group_size * 8);
+                disp = (uint64_t *) malloc (data_group_size * 8);
                 if (pg_sizes == 0 || disp == 0)
                 {
                     adios_error (err_no_memory, "MPI_AMR method: Cannot allocate memory "
@@ -1690,13 +2145,13 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
                 START_TIMER (ADIOS_TIMER_COMM);
                 MPI_Allgather (&pg_size, 1, MPI_UNSIGNED_LONG_LONG
                               ,pg_sizes, 1, MPI_UNSIGNED_LONG_LONG
-                              ,md->g_comm1);
+                              ,data_comm);
                 STOP_TIMER (ADIOS_TIMER_COMM);
 
                 disp[0] = 0;
                 max_data_size = pg_size;
 
-                for (i = 1; i < new_group_size; i++)
+                for (i = 1; i < data_group_size; i++)
                 {
                     disp[i] = disp[i - 1] + pg_sizes[i - 1];
                     max_data_size = (pg_sizes[i] > max_data_size) ? pg_sizes[i] : max_data_size;
@@ -1735,8 +2190,8 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
                     }
                 }
 
-                total_data_size = disp[new_group_size - 1]
-                                + pg_sizes[new_group_size - 1];
+                total_data_size = disp[data_group_size - 1]
+                                + pg_sizes[data_group_size - 1];
 
                 if (is_aggregator (md->rank))
                 {
@@ -1746,19 +2201,19 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
                     }
 
                     index_start1 = md->b.pg_index_offset; // starting point to write data at this moment
-                    for (i = 0; i < new_group_size; i++)
+                    for (i = 0; i < data_group_size; i++)
                     {
-                        if (i + 1 < new_group_size)
+                        if (i + 1 < data_group_size)
                         {
                             START_TIMER (ADIOS_TIMER_COMM);
-                            nMPIrequests = adios_MPI_Irecv (recv_buff, pg_sizes[i + 1], new_rank + 1
-                                                            ,0, md->g_comm1, requests);
+                            nMPIrequests = adios_MPI_Irecv (recv_buff, pg_sizes[i + 1], data_rank + 1
+                                                            ,0, data_comm, requests);
                             STOP_TIMER (ADIOS_TIMER_COMM);
                         }
 
                         write_thread_data.fh = &md->fh;
                         write_thread_data.base_offset = &index_start1;
-                        write_thread_data.aggr_buff = (i == 0) ? fd->buffer : aggr_buff;
+                        write_thread_data.aggr_buff = (i == 0) ? send_buff : aggr_buff;
                         write_thread_data.total_data_size = &pg_sizes[i];
 
                         //printf ("rank %d: Write PG to subfile %d, offset=%llu, size=%u\n", md->rank,
@@ -1771,7 +2226,7 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
 
                         index_start1 += pg_sizes[i];
 
-                        if (i + 1 < new_group_size)
+                        if (i + 1 < data_group_size)
                         {
                             START_TIMER (ADIOS_TIMER_COMM);
                             MPI_Waitall (nMPIrequests, requests, statuses);
@@ -1786,31 +2241,31 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
                 }
                 else
                 {
-                    if (new_rank == new_group_size - 1)
+                    if (data_rank == data_group_size - 1)
                     {
                         START_TIMER (ADIOS_TIMER_COMM);
-                        adios_MPI_Send (fd->buffer, pg_size, new_rank - 1
-                                 ,0, md->g_comm1);
+                        adios_MPI_Send (send_buff, pg_size, data_rank - 1
+                                 ,0, data_comm);
                         STOP_TIMER (ADIOS_TIMER_COMM);
                     }
                     else
                     {
-                        for (i = new_rank + 1; i < new_group_size; i++)
+                        for (i = data_rank + 1; i < data_group_size; i++)
                         {
                             START_TIMER (ADIOS_TIMER_COMM);
                             // Recv data from upstream rank
-                            nMPIrequests = adios_MPI_Irecv (recv_buff, pg_sizes[i], new_rank + 1
-                                                            ,0, md->g_comm1, requests);
+                            nMPIrequests = adios_MPI_Irecv (recv_buff, pg_sizes[i], data_rank + 1
+                                                            ,0, data_comm, requests);
 
-                            if (i == new_rank + 1)
+                            if (i == data_rank + 1)
                                 // Send my data to downstream rank
-                                adios_MPI_Send (fd->buffer, pg_size, new_rank - 1
-                                         ,0, md->g_comm1);
+                                adios_MPI_Send (send_buff, pg_size, data_rank - 1
+                                         ,0, data_comm);
 
                             MPI_Waitall(nMPIrequests, requests, statuses);
                             // Send it to downstream rank
-                            adios_MPI_Send (recv_buff, pg_sizes[i], new_rank - 1
-                                     ,0, md->g_comm1);
+                            adios_MPI_Send (recv_buff, pg_sizes[i], data_rank - 1
+                                     ,0, data_comm);
                             STOP_TIMER (ADIOS_TIMER_COMM);
                         }
                     }
@@ -1821,7 +2276,7 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
                 FREE (requests);
                 FREE (statuses);
             }
-            else 
+            else if (md->g_merging_pgs)
             {
                 // Merge PG's on the aggregator side
                 log_warn ("MPI_AMR method (BG): Merging process blocks is not supported yet\n");
@@ -1832,10 +2287,18 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
             fd->current_pg->pg_start_in_file = md->b.pg_index_offset; // aggregator's starting offset (!0 on append)
             if (!md->g_merging_pgs)
             {
-                for (i = 0; i < new_rank; i++)
+                if (data_comm != MPI_COMM_NULL)
                 {
-                    fd->current_pg->pg_start_in_file += pg_sizes[i];
+                    for (i = 0; i < data_rank; i++)
+                    {
+                        block_offset += pg_sizes[i];
+                    }
                 }
+                if (md->g_node_local)
+                {
+                    block_offset = adios_mpi_amr_node_release (md, &node_win, block_offset);
+                }
+                fd->current_pg->pg_start_in_file += block_offset + pg_offset;
 
                 FREE (pg_sizes);
                 FREE (disp);
@@ -1851,32 +2314,14 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
                 // Collect index from all MPI processors
                 if (is_aggregator (md->rank))
                 {
-                    int * index_sizes = malloc (4 * new_group_size);
-                    int * index_offsets = malloc (4 * new_group_size);
+                    uint64_t * index_sizes = malloc (8 * new_group_size);
+                    uint64_t * index_offsets = malloc (8 * new_group_size);
                     char * recv_buffer = 0;
-                    uint32_t size = 0, total_size = 0;
                     int i;
 
                     START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gather (&size, 1, MPI_INT
-                               ,index_sizes, 1, MPI_INT
-                               ,0, md->g_comm1
-                               );
-                    STOP_TIMER (ADIOS_TIMER_COMM);
-
-                    for (i = 0; i < new_group_size; i++)
-                    {
-                        index_offsets [i] = total_size;
-                        total_size += index_sizes [i];
-                    }
-
-                    recv_buffer = malloc (total_size);
-
-                    START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gatherv (&size, 0, MPI_BYTE
-                                ,recv_buffer, index_sizes, index_offsets
-                                ,MPI_BYTE, 0, md->g_comm1
-                                );
+                    recv_buffer = adios_gather_buffers (md->g_comm1, 0, 0
+                                                       ,index_sizes, index_offsets);
                     STOP_TIMER (ADIOS_TIMER_COMM);
 
                     char * buffer_save = md->b.buff;
@@ -1920,14 +2365,7 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
                                          ,0, md->index);
 
                     START_TIMER (ADIOS_TIMER_COMM);
-                    uint32_t index_size = (uint32_t) buffer_offset;
-                    MPI_Gather (&index_size, 1, MPI_INT, 0, 0, MPI_INT
-                               ,0, md->g_comm1
-                               );
-                    MPI_Gatherv (buffer, index_size, MPI_BYTE
-                                ,0, 0, 0, MPI_BYTE
-                                ,0, md->g_comm1
-                                );
+                    adios_gather_buffers (md->g_comm1, buffer, buffer_offset, 0, 0);
                     STOP_TIMER (ADIOS_TIMER_COMM);
                 }
             }
@@ -1988,31 +2426,13 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
                 {
                     if (md->rank == 0)
                     {
-                        int * index_sizes = malloc (4 * new_group_size2);
-                        int * index_offsets = malloc (4 * new_group_size2);
+                        uint64_t * index_sizes = malloc (8 * new_group_size2);
+                        uint64_t * index_offsets = malloc (8 * new_group_size2);
                         char * recv_buffer = 0;
-                        uint32_t size = 0, total_size = 0;
 
                         START_TIMER (ADIOS_TIMER_COMM);
-                        MPI_Gather (&size, 1, MPI_INT
-                                   ,index_sizes, 1, MPI_INT
-                                   ,0, md->g_comm2
-                                   );
-                        STOP_TIMER (ADIOS_TIMER_COMM);
-
-                        for (i = 0; i < new_group_size2; i++)
-                        {
-                            index_offsets [i] = total_size;
-                            total_size += index_sizes [i];
-                        }
-
-                        recv_buffer = malloc (total_size);
-
-                        START_TIMER (ADIOS_TIMER_COMM);
-                        MPI_Gatherv (&size, 0, MPI_BYTE
-                                    ,recv_buffer, index_sizes, index_offsets
-                                    ,MPI_BYTE, 0, md->g_comm2
-                                    );
+                        recv_buffer = adios_gather_buffers (md->g_comm2, 0, 0
+                                                           ,index_sizes, index_offsets);
                         STOP_TIMER (ADIOS_TIMER_COMM);
 
                         char * buffer_save = md->b.buff;
@@ -2060,15 +2480,7 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
                                              ,0, md->index);
  
                         START_TIMER (ADIOS_TIMER_COMM);
-                        uint32_t index_size = (uint32_t) buffer_offset2;
-                        MPI_Gather (&index_size, 1, MPI_INT
-                                   ,0, 0, MPI_INT
-                                   ,0, md->g_comm2
-                                   );
-                        MPI_Gatherv (buffer2, index_size, MPI_BYTE
-                                    ,0, 0, 0, MPI_BYTE
-                                    ,0, md->g_comm2
-                                    );
+                        adios_gather_buffers (md->g_comm2, buffer2, buffer_offset2, 0, 0);
                         STOP_TIMER (ADIOS_TIMER_COMM);
 
                         if (buffer2)
@@ -2178,6 +2590,16 @@ void adios_mpi_amr_bg_close (struct adios_file_struct * fd
         MPI_Comm_free(&md->g_comm2);
     }
 
+    if (md->g_node_comm != MPI_COMM_NULL)
+    {
+        MPI_Comm_free(&md->g_node_comm);
+    }
+
+    if (md->g_leader_comm != MPI_COMM_NULL)
+    {
+        MPI_Comm_free(&md->g_leader_comm);
+    }
+
 
     md->fh = 0;
     md->mfh = 0;
@@ -2221,10 +2643,15 @@ void adios_mpi_amr_ag_close (struct adios_file_struct * fd
             uint64_t buffer_offset = 0;
             uint64_t index_start1;
             uint64_t * pg_sizes = 0, * disp = 0;
-            void * aggr_buff = 0;
             struct adios_MPI_thread_data_write write_thread_data;
             int i, new_rank, new_group_size, new_rank2, new_group_size2;
             uint64_t total_data_size = 0, total_data_size1 = 0;;
+            // with node_local=1, only node leaders send (their node's block)
+            void * send_buff = fd->buffer;
+            uint64_t send_size = fd->bytes_written, pg_offset = 0, block_offset = 0;
+            MPI_Comm data_comm = md->g_comm1;
+            int data_rank = 0, data_group_size = 0;
+            MPI_Win node_win;
 
             START_TIMER (ADIOS_TIMER_COMM);
             //MPI_Comm_split (md->group_comm, md->g_color1, md->rank, &new_comm);
@@ -2234,28 +2661,34 @@ void adios_mpi_amr_ag_close (struct adios_file_struct * fd
             //MPI_Comm_split (md->group_comm, md->g_color2, md->rank, &new_comm2);
             MPI_Comm_rank (md->g_comm2, &new_rank2);
             MPI_Comm_size (md->g_comm2, &new_group_size2);
+            if (md->g_node_local)
+            {
+                adios_mpi_amr_node_gather (fd, md, &node_win, &send_buff
+                                          ,&send_size, &pg_offset);
+                data_comm = md->g_leader_comm;
+            }
+            if (data_comm != MPI_COMM_NULL)
+            {
+                MPI_Comm_rank (data_comm, &data_rank);
+                MPI_Comm_size (data_comm, &data_group_size);
+            }
             STOP_TIMER (ADIOS_TIMER_COMM);
 
 
             // if not merge PG's on the aggregator side
-            if (!md->g_merging_pgs)
+            if (!md->g_merging_pgs && data_comm != MPI_COMM_NULL)
             {
                 uint64_t pg_size;
 
-                pg_size = fd->bytes_written;
-                if (pg_size > INT32_MAX)
-                {
-                    log_warn ("Each processor writes out more than %d bytes, Not supported in aggregation mode.\n", 
-                               INT32_MAX);
-                }
-                pg_sizes = (uint64_t *) malloc (new_group_size * 8);
-                disp = (uint64_t *) malloc (new_group_size * 8);
+                pg_size = send_size;
+                pg_sizes = (uint64_t *) malloc (data_group_size * 8);
+                disp = (uint64_t *) malloc (data_group_size * 8);
                 if (pg_sizes == 0 || disp == 0)
                 {
                     adios_error (err_no_memory, 
                             "MPI_AMR method (AG): Cannot allocate buffers (%d bytes) "
                             "for merging process blocks.\n",
-                            2*4*new_group_size
+                            2*4*data_group_size
                             );
                     return;
                 }
@@ -2263,63 +2696,47 @@ void adios_mpi_amr_ag_close (struct adios_file_struct * fd
                 START_TIMER (ADIOS_TIMER_COMM);
                 MPI_Allgather (&pg_size, 1, MPI_UNSIGNED_LONG_LONG
                               ,pg_sizes, 1, MPI_UNSIGNED_LONG_LONG
-                              ,md->g_comm1);
+                              ,data_comm);
                 STOP_TIMER (ADIOS_TIMER_COMM);
 
                 disp[0] = 0;
                 //if (md->rank==0) fprintf (stderr, "rank %d: pg_size[0]=%llu ", md->rank, pg_sizes[0]); 
-                for (i = 1; i < new_group_size; i++)
+                for (i = 1; i < data_group_size; i++)
                 {
                     disp[i] = disp[i - 1] + pg_sizes[i - 1];
                     //if (md->rank==0) fprintf (stderr, "pg_size[%d]=%llu ", i, pg_sizes[i]); 
                 }
-                total_data_size = disp[new_group_size - 1]
-                                + pg_sizes[new_group_size - 1];
+                total_data_size = disp[data_group_size - 1]
+                                + pg_sizes[data_group_size - 1];
                 //if (md->rank==0) fprintf (stderr, "total=%llu\n", total_data_size); 
 
+                // Receive the PGs piece by piece and write them out while
+                // the next pieces are coming in
                 if (is_aggregator (md->rank))
                 {
-                    aggr_buff = malloc (total_data_size);
-                    if (aggr_buff == 0)
+                    // Waiting for the subfile to open if pthread is enabled
+                    if (md->g_threading)
                     {
-                        adios_error (err_no_memory, 
-                                "MPI_AMR method (AG): Cannot allocate %lu bytes "
-                                "for aggregation buffer.\n"
-                                "Need to increase the number of aggregators.\n",
-                                total_data_size);
-                        return;
+                        pthread_join (md->g_sot, NULL);
                     }
-                }
-                else
-                {
-                }
 
-                START_TIMER (ADIOS_TIMER_COMM);
-                // This needs to be changed in the future to support > 2 GB data.
-                int * int_pg_sizes = (int*) malloc (new_group_size * sizeof(int));
-                int * int_disp = (int*) malloc (new_group_size * sizeof(int));
-                int int_total_data_size = (int) total_data_size;
-                for (i = 0; i < new_group_size; i++)
-                {
-                    int_pg_sizes[i] = pg_sizes[i];
-                    int_disp[i] = disp[i];
+                    if (adios_mpi_amr_pipeline_write (fd, md, data_comm
+                                                     ,data_group_size, pg_sizes
+                                                     ,send_buff, md->b.pg_index_offset))
+                    {
+                        adios_error (err_unspecified,
+                                "MPI_AMR method (AG): Could not write the %llu bytes "
+                                "of the aggregation group.\n", total_data_size);
+                    }
                 }
-                if (total_data_size != (uint64_t) int_total_data_size)
+                else
                 {
-                    adios_error (err_unspecified, 
-                            "MPI_AGGRGATE with aggregate_type=1 does not handle >2GB buffers. "
-                            "If each process writes less than 2GB, then increase the number of aggregators "
-                            "so that the total data size on each aggregator is still < 2GB. "
-                            "If some process has more than 2GB data, use aggregate_type=2 "
-                            "(the default aggregation method)."
-                            );
+                    START_TIMER (ADIOS_TIMER_COMM);
+                    adios_mpi_amr_pipeline_send (md, data_comm, send_buff, pg_size);
+                    STOP_TIMER (ADIOS_TIMER_COMM);
                 }
-                MPI_Gatherv (fd->buffer, (int)pg_size, MPI_BYTE
-                            ,aggr_buff, int_pg_sizes, int_disp, MPI_BYTE
-                            ,0, md->g_comm1);
-                STOP_TIMER (ADIOS_TIMER_COMM);
             }
-            else 
+            else if (md->g_merging_pgs)
             {
                 // Merge PG's on the aggregator side
                 log_warn ("MPI_AMR method (AG): Merging process blocks is not supported yet\n");
@@ -2329,10 +2746,18 @@ void adios_mpi_amr_ag_close (struct adios_file_struct * fd
             fd->current_pg->pg_start_in_file = md->b.pg_index_offset; // aggregator's starting offset (!0 on append)
             if (!md->g_merging_pgs)
             {
-                for (i = 0; i < new_rank; i++)
+                if (data_comm != MPI_COMM_NULL)
+                {
+                    for (i = 0; i < data_rank; i++)
+                    {
+                        block_offset += pg_sizes[i];
+                    }
+                }
+                if (md->g_node_local)
                 {
-                    fd->current_pg->pg_start_in_file += pg_sizes[i];
+                    block_offset = adios_mpi_amr_node_release (md, &node_win, block_offset);
                 }
+                fd->current_pg->pg_start_in_file += block_offset + pg_offset;
 
                 FREE (pg_sizes);
                 FREE (disp);
@@ -2348,44 +2773,14 @@ void adios_mpi_amr_ag_close (struct adios_file_struct * fd
                 // Collect index from all MPI processors
                 if (is_aggregator (md->rank))
                 {
-                    int * index_sizes = malloc (4 * new_group_size);
-                    int * index_offsets = malloc (4 * new_group_size);
+                    uint64_t * index_sizes = malloc (8 * new_group_size);
+                    uint64_t * index_offsets = malloc (8 * new_group_size);
                     char * recv_buffer = 0;
-                    uint32_t size = 0, total_size = 0;
                     int i;
 
                     START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gather (&size, 1, MPI_INT
-                               ,index_sizes, 1, MPI_INT
-                               ,0, md->g_comm1
-                               );
-                    STOP_TIMER (ADIOS_TIMER_COMM);
-
-                    //if (md->rank==0) fprintf (stderr, "rank %d: ", md->rank);
-                    for (i = 0; i < new_group_size; i++)
-                    {
-                        index_offsets [i] = total_size;
-                        total_size += index_sizes [i];
-                        //if (md->rank==0) fprintf (stderr, "index_sizes[%d]=%d ", i, index_sizes[i]); 
-                    } 
-                    //if (md->rank==0) fprintf (stderr, " total index size=%u\n", total_size);
-
-                    /*DEBUG if (md->rank==0) {
-                        fprintf (stderr, "rank %d: ", md->rank);
-                        for (i = 0; i < new_group_size; i++)
-                        {
-                            fprintf (stderr, "index_offsets[%d]=%d ", i, index_offsets[i]); 
-                        } 
-                        fprintf (stderr, " total index size=%u: ", total_size);
-                    }*/
-
-                    recv_buffer = malloc (total_size);
-
-                    START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gatherv (&size, 0, MPI_BYTE
-                                ,recv_buffer, index_sizes, index_offsets
-                                ,MPI_BYTE, 0, md->g_comm1
-                                );
+                    recv_buffer = adios_gather_buffers (md->g_comm1, 0, 0
+                                                       ,index_sizes, index_offsets);
                     STOP_TIMER (ADIOS_TIMER_COMM);
 
                     char * buffer_save = md->b.buff;
@@ -2429,14 +2824,7 @@ void adios_mpi_amr_ag_close (struct adios_file_struct * fd
 
                     //fprintf (stderr, "rank %d: buffer size = %llu buffer offset=%llu\n", md->rank, buffer_size, buffer_offset);
                     START_TIMER (ADIOS_TIMER_COMM);
-                    uint32_t index_size = (uint32_t) buffer_offset;
-                    MPI_Gather (&index_size, 1, MPI_INT, 0, 0, MPI_INT
-                               ,0, md->g_comm1
-                               );
-                    MPI_Gatherv (buffer, index_size, MPI_BYTE
-                                ,0, 0, 0, MPI_BYTE
-                                ,0, md->g_comm1
-                                );
+                    adios_gather_buffers (md->g_comm1, buffer, buffer_offset, 0, 0);
                     STOP_TIMER (ADIOS_TIMER_COMM);
                 }
             }
@@ -2477,23 +2865,15 @@ void adios_mpi_amr_ag_close (struct adios_file_struct * fd
                 //adios_write_version_v1 (&buffer, &buffer_size, &buffer_offset, flag);
                 adios_write_version_flag_v1 (&buffer, &buffer_size, &buffer_offset, flag);
 
-                aggr_buff = realloc (aggr_buff, total_data_size + buffer_offset);
-                memcpy (aggr_buff + total_data_size, buffer, buffer_offset); 
-
-                // Waiting for the subfile to open if pthread is enabled
-                if (md->g_threading)
-                {
-                    pthread_join (md->g_sot, NULL);
-                }
-
-                index_start1 = md->b.pg_index_offset; // starting point to write data at this moment
-                total_data_size1 = total_data_size + buffer_offset;
-                //fprintf (stderr,"rank %d: Write index+data with PG offset %llu, sizes %llu + %llu = %llu bytes\n", 
-                //        md->rank, index_start1, total_data_size, buffer_offset, total_data_size1);
+                // the PGs are already written by the pipeline, append the index
+                index_start1 = index_start;
+                total_data_size1 = buffer_offset;
+                //fprintf (stderr,"rank %d: Write index with offset %llu, size %llu bytes\n", 
+                //        md->rank, index_start1, total_data_size1);
 
                 write_thread_data.fh = &md->fh;
                 write_thread_data.base_offset = &index_start1;
-                write_thread_data.aggr_buff = aggr_buff;
+                write_thread_data.aggr_buff = buffer;
                 write_thread_data.total_data_size = &total_data_size1;
 
                 // Threading the write so that we can overlap write with index collection.
@@ -2525,31 +2905,13 @@ void adios_mpi_amr_ag_close (struct adios_file_struct * fd
             {
                 if (md->rank == 0)
                 {
-                    int * index_sizes = malloc (4 * new_group_size2);
-                    int * index_offsets = malloc (4 * new_group_size2);
+                    uint64_t * index_sizes = malloc (8 * new_group_size2);
+                    uint64_t * index_offsets = malloc (8 * new_group_size2);
                     char * recv_buffer = 0;
-                    uint32_t size = 0, total_size = 0;
-
-                    START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gather (&size, 1, MPI_INT
-                               ,index_sizes, 1, MPI_INT
-                               ,0, md->g_comm2
-                               );
-                    STOP_TIMER (ADIOS_TIMER_COMM);
-
-                    for (i = 0; i < new_group_size2; i++)
-                    {
-                        index_offsets [i] = total_size;
-                        total_size += index_sizes [i];
-                    }
-
-                    recv_buffer = malloc (total_size);
 
                     START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gatherv (&size, 0, MPI_BYTE
-                                ,recv_buffer, index_sizes, index_offsets
-                                ,MPI_BYTE, 0, md->g_comm2
-                                );
+                    recv_buffer = adios_gather_buffers (md->g_comm2, 0, 0
+                                                       ,index_sizes, index_offsets);
                     STOP_TIMER (ADIOS_TIMER_COMM);
 
                     char * buffer_save = md->b.buff;
@@ -2597,15 +2959,7 @@ void adios_mpi_amr_ag_close (struct adios_file_struct * fd
                                          ,0, md->index);
 
                     START_TIMER (ADIOS_TIMER_COMM);
-                    uint32_t index_size = (uint32_t) buffer_offset2;
-                    MPI_Gather (&index_size, 1, MPI_INT
-                               ,0, 0, MPI_INT
-                               ,0, md->g_comm2
-                               );
-                    MPI_Gatherv (buffer2, index_size, MPI_BYTE
-                                ,0, 0, 0, MPI_BYTE
-                                ,0, md->g_comm2
-                                );
+                    adios_gather_buffers (md->g_comm2, buffer2, buffer_offset2, 0, 0);
                     STOP_TIMER (ADIOS_TIMER_COMM);
 
                     if (buffer2)
@@ -2677,8 +3031,6 @@ void adios_mpi_amr_ag_close (struct adios_file_struct * fd
                 {
                     pthread_join (md->g_swt, NULL);
                 }
-
-                FREE (aggr_buff);
             }
             FREE (buffer);
             buffer_size = 0;
@@ -2731,6 +3083,16 @@ void adios_mpi_amr_ag_close (struct adios_file_struct * fd
         MPI_Comm_free(&md->g_comm2);
     }
 
+    if (md->g_node_comm != MPI_COMM_NULL)
+    {
+        MPI_Comm_free(&md->g_node_comm);
+    }
+
+    if (md->g_leader_comm != MPI_COMM_NULL)
+    {
+        MPI_Comm_free(&md->g_leader_comm);
+    }
+
 
     md->fh = 0;
     md->mfh = 0;
@@ -2756,6 +3118,185 @@ void adios_mpi_amr_buffer_overflow (struct adios_file_struct * fd,
             md->rank, fd->name);
 }
 
+/* Greedily cut the units (ranges of ranks that stay together) into groups
+ * of at most max_load bytes. A unit larger than that makes a group alone and
+ * when only as many units are left as groups are missing to have ngroups,
+ * every remaining unit makes a group. Returns the number of groups; sets
+ * the group of each unit if colors is not NULL.
+ */
+static int adios_mpi_amr_adaptive_cut (int nunits, uint64_t * loads
+                                      ,uint64_t max_load, int ngroups
+                                      ,int * colors)
+{
+    int j, n = 1;
+    uint64_t load = 0;
+
+    for (j = 0; j < nunits; j++)
+    {
+        if (j > 0 && ((load > 0 && load + loads[j] > max_load)
+                      || nunits - j <= ngroups - n))
+        {
+            n++;
+            load = 0;
+        }
+        load += loads[j];
+        if (colors)
+            colors[j] = n - 1;
+    }
+    return n;
+}
+
+/* Adaptive aggregation (adaptive=1): split the ranks into contiguous groups
+ * so that the largest group holds as few bytes of sizes[] as possible. With
+ * adaptive=2 groups are only cut between nodes. This needs the ranks of each
+ * node to be contiguous; a node whose ranks are interleaved with those of
+ * other nodes (e.g. round-robin placement) is split like with adaptive=1.
+ * The number of groups is num_aggregators (or the number of nodes if less),
+ * and does not change between steps because every aggregator appends to its
+ * own subfile.
+ * Collective over group_comm; the result goes to g_adaptive_colors.
+ */
+static void adios_mpi_amr_adaptive_group (struct adios_MPI_data_struct * md
+                                         ,uint64_t * sizes
+                                         )
+{
+    int nproc = md->size, i, j, nunits, ngroups, nsplit = 0;
+    uint64_t * loads, lo = 0, hi = 0;
+    int * node, * unit_colors;
+
+    node = (int *) malloc (nproc * sizeof (int));
+    loads = (uint64_t *) malloc (nproc * 8);
+    unit_colors = (int *) malloc (nproc * sizeof (int));
+    FREE (md->g_adaptive_colors);
+    md->g_adaptive_colors = (int *) malloc (nproc * sizeof (int));
+    if (!node || !loads || !unit_colors || !md->g_adaptive_colors)
+    {
+        adios_error (err_no_memory, "MPI_AMR method: Cannot allocate memory "
+                    "for adaptive aggregation of %d processes\n", nproc);
+        FREE (node);
+        FREE (loads);
+        FREE (unit_colors);
+        FREE (md->g_adaptive_colors);
+        return;
+    }
+
+    // node of each rank, identified by its lowest rank
+    for (i = 0; i < nproc; i++)
+    {
+        node[i] = i;
+    }
+#if MPI_VERSION >= 3
+    if (md->g_adaptive == 2)
+    {
+        MPI_Comm node_comm;
+        int leader = md->rank;
+
+        MPI_Comm_split_type (md->group_comm, MPI_COMM_TYPE_SHARED, md->rank
+                            ,MPI_INFO_NULL, &node_comm);
+        MPI_Bcast (&leader, 1, MPI_INT, 0, node_comm);
+        MPI_Comm_free (&node_comm);
+        MPI_Allgather (&leader, 1, MPI_INT, node, 1, MPI_INT, md->group_comm);
+    }
+#endif
+
+    // units are the ranges of ranks that must stay in the same group
+    nunits = 0;
+    for (i = 0; i < nproc; i++)
+    {
+        if (i == 0 || node[i] != node[i - 1])
+        {
+            // a node continues after ranks of other nodes
+            if (node[i] != i)
+                nsplit++;
+            loads[nunits++] = 0;
+        }
+        loads[nunits - 1] += sizes[i];
+        hi += sizes[i];
+    }
+    if (nsplit && md->rank == 0)
+    {
+        log_warn ("MPI_AMR method: adaptive=2 needs the ranks of each node to be "
+                  "contiguous, but %d ranges of ranks continue a node after ranks "
+                  "of other nodes. Processes of such nodes may be put in different "
+                  "aggregation groups.\n", nsplit);
+    }
+    for (j = 0; j < nunits; j++)
+    {
+        if (loads[j] > lo)
+            lo = loads[j];
+    }
+    ngroups = (md->g_adaptive_naggr < nunits) ? md->g_adaptive_naggr : nunits;
+
+    // smallest largest group that needs no more than ngroups groups
+    while (lo < hi)
+    {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (adios_mpi_amr_adaptive_cut (nunits, loads, mid, 0, NULL) <= ngroups)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    adios_mpi_amr_adaptive_cut (nunits, loads, lo, ngroups, unit_colors);
+
+    j = -1;
+    for (i = 0; i < nproc; i++)
+    {
+        if (i == 0 || node[i] != node[i - 1])
+            j++;
+        md->g_adaptive_colors[i] = unit_colors[j];
+    }
+    md->g_adaptive_nproc = nproc;
+
+    free (node);
+    free (loads);
+    free (unit_colors);
+}
+
+/* Collect the PG sizes of this step and regroup the processes for the next
+ * open, unless every PG stays within 10% of the size the current grouping
+ * was made for.
+ */
+static void adios_mpi_amr_adaptive_update (struct adios_file_struct * fd
+                                          ,struct adios_MPI_data_struct * md
+                                          )
+{
+    int nproc = md->size, i;
+    uint64_t pg_size = fd->bytes_written;
+    uint64_t * sizes;
+
+    sizes = (uint64_t *) malloc (nproc * 8);
+    if (!sizes)
+    {
+        adios_error (err_no_memory, "MPI_AMR method: Cannot allocate memory "
+                    "for adaptive aggregation of %d processes\n", nproc);
+        return;
+    }
+
+    MPI_Allgather (&pg_size, 1, MPI_UNSIGNED_LONG_LONG
+                  ,sizes, 1, MPI_UNSIGNED_LONG_LONG
+                  ,md->group_comm);
+
+    if (md->g_adaptive_sizes && md->g_adaptive_colors && md->g_adaptive_nproc == nproc)
+    {
+        for (i = 0; i < nproc; i++)
+        {
+            uint64_t base = md->g_adaptive_sizes[i];
+            if (sizes[i] > base + base / 10 || sizes[i] + sizes[i] / 10 < base)
+                break;
+        }
+        if (i == nproc)
+        {
+            // sizes are stable, keep the grouping
+            free (sizes);
+            return;
+        }
+    }
+
+    adios_mpi_amr_adaptive_group (md, sizes);
+    FREE (md->g_adaptive_sizes);
+    md->g_adaptive_sizes = sizes;
+}
+
 void adios_mpi_amr_close (struct adios_file_struct * fd
                      ,struct adios_method_struct * method
                      )
@@ -2763,6 +3304,12 @@ void adios_mpi_amr_close (struct adios_file_struct * fd
     START_TIMER (ADIOS_TIMER_AD_CLOSE);
     struct adios_MPI_data_struct * md = (struct adios_MPI_data_struct *)
                                                  method->method_data;
+    if (md->g_adaptive && !md->is_color_set
+        && fd->mode != adios_mode_read && md->group_comm != MPI_COMM_NULL)
+    {
+        adios_mpi_amr_adaptive_update (fd, md);
+    }
+
     if (md->g_io_type == ADIOS_MPI_AMR_IO_AG)
     {
         adios_mpi_amr_ag_close (fd, method);
@@ -2800,6 +3347,8 @@ void adios_mpi_amr_finalize (int mype, struct adios_method_struct * method)
                                                  method->method_data;
     adios_free_index_v1 (md->index);
     adios_buffer_struct_clear (&md->b);
+    FREE (md->g_adaptive_sizes);
+    FREE (md->g_adaptive_colors);
 
 #ifdef HAVE_FGR
     fgr_finalize ();
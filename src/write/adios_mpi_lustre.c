@@ -1381,9 +1381,6 @@ void adios_mpi_lustre_close (struct adios_file_struct * fd
                                                  method->method_data;
     //struct adios_attribute_struct * a = fd->group->attributes;
 
-    struct adios_index_process_group_struct_v1 * new_pg_root = 0;
-    struct adios_index_var_struct_v1 * new_vars_root = 0;
-    struct adios_index_attribute_struct_v1 * new_attrs_root = 0;
 #if COLLECT_METRICS
     gettimeofday (&t23, NULL);
     static int iteration = 0;
@@ -1462,33 +1459,20 @@ void adios_mpi_lustre_close (struct adios_file_struct * fd
                                 );
                     STOP_TIMER (ADIOS_TIMER_COMM);
 
-                    char * buffer_save = md->b.buff;
-                    uint64_t buffer_size_save = md->b.length;
-                    uint64_t offset_save = md->b.offset;
+                    char ** index_buffers = malloc (md->size * sizeof (char *));
+                    uint64_t * index_buffer_sizes = malloc (md->size * sizeof (uint64_t));
 
                     for (i = 1; i < md->size; i++)
                     {
-                        md->b.buff = recv_buffer + index_offsets [i];
-                        md->b.length = index_sizes [i];
-                        md->b.offset = 0;
-
-                        adios_parse_process_group_index_v1 (&md->b, &new_pg_root, NULL);
-                        adios_parse_vars_index_v1 (&md->b, &new_vars_root, NULL, NULL);
-                        // do not merge attributes from other processes from 1.4
-                        /*
-                        adios_parse_attributes_index_v1 (&md->b
-                                                        ,&new_attrs_root
-                                                        );
-                         */
-                        adios_merge_index_v1 (md->index, new_pg_root, 
-                                              new_vars_root, new_attrs_root, 0);
-                        new_pg_root = 0;
-                        new_vars_root = 0;
-                        new_attrs_root = 0;
+                        index_buffers [i - 1] = recv_buffer + index_offsets [i];
+                        index_buffer_sizes [i - 1] = index_sizes [i];
                     }
-                    md->b.buff = buffer_save;
-                    md->b.length = buffer_size_save;
-                    md->b.offset = offset_save;
+                    // do not merge attributes from other processes from 1.4
+                    adios_merge_index_buffers_v1 (md->index, md->size - 1, index_buffers,
+                                                  index_buffer_sizes, -1, 0);
+
+                    free (index_buffers);
+                    free (index_buffer_sizes);
 
                     free (recv_buffer);
                     free (index_sizes);
@@ -1616,33 +1600,20 @@ void adios_mpi_lustre_close (struct adios_file_struct * fd
                                 );
                     STOP_TIMER (ADIOS_TIMER_COMM);
 
-                    char * buffer_save = md->b.buff;
-                    uint64_t buffer_size_save = md->b.length;
-                    uint64_t offset_save = md->b.offset;
+                    char ** index_buffers = malloc (md->size * sizeof (char *));
+                    uint64_t * index_buffer_sizes = malloc (md->size * sizeof (uint64_t));
 
                     for (i = 1; i < md->size; i++)
                     {
-                        md->b.buff = recv_buffer + index_offsets [i];
-                        md->b.length = index_sizes [i];
-                        md->b.offset = 0;
-
-                        adios_parse_process_group_index_v1 (&md->b, &new_pg_root, NULL);
-                        adios_parse_vars_index_v1 (&md->b, &new_vars_root, NULL, NULL);
-                        // do not merge attributes from other processes from 1.4
-                        /*
-                        adios_parse_attributes_index_v1 (&md->b
-                                                        ,&new_attrs_root
-                                                        );
-                         */
-                        adios_merge_index_v1 (md->index, new_pg_root, 
-                                              new_vars_root, new_attrs_root, 0);
-                        new_pg_root = 0;
-                        new_vars_root = 0;
-                        new_attrs_root = 0;
+                        index_buffers [i - 1] = recv_buffer + index_offsets [i];
+                        index_buffer_sizes [i - 1] = index_sizes [i];
                     }
-                    md->b.buff = buffer_save;
-                    md->b.length = buffer_size_save;
-                    md->b.offset = offset_save;
+                    // do not merge attributes from other processes from 1.4
+                    adios_merge_index_buffers_v1 (md->index, md->size - 1, index_buffers,
+                                                  index_buffer_sizes, -1, 0);
+
+                    free (index_buffers);
+                    free (index_buffer_sizes);
 
                     free (recv_buffer);
                     free (index_sizes);
@@ -6,14 +6,18 @@
  */
 
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
 #include <stdint.h>
 #include <assert.h>
+#include <errno.h>
+#include <pthread.h>
 
 // see if we have MPI or other tools
 #include "config.h"
@@ -35,6 +39,10 @@
 #    define O_LARGEFILE 0
 #endif
 
+#ifndef IOV_MAX
+#    define IOV_MAX 1024
+#endif
+
 #if defined ADIOS_TIMERS || defined ADIOS_TIMER_EVENTS
 #define START_TIMER(t) adios_timing_go (fd->group->timing_obj, (t) ) 
 #else
@@ -50,6 +58,26 @@
 
 static int adios_posix_initialized = 0;
 
+/* Everything the background thread needs to finish a close() on its own.
+   The thread owns the data and index buffers and releases them at the end. */
+struct adios_POSIX_flush_struct
+{
+    int f;                    // file to write into
+    int close_file;           // = 1 in 'w' mode: close the file after writing
+    int rank;
+    char * name;              // file name for error messages
+    void * allocated_bufptr;  // data buffer taken over from the file struct
+    uint64_t allocated_size;
+    char * pg_buffer;         // start of PG data in allocated_bufptr
+    uint64_t pg_size;
+    off_t pg_offset;
+    char * index_buffer;
+    uint64_t index_size;
+    off_t index_offset;
+    const char * marker_base_path; // touch the "step ready" marker of name after writing, if not 0
+    int err;                  // = 1 if the data or the index could not be written
+};
+
 struct adios_POSIX_data_struct
 {
     // our file bits
@@ -64,6 +92,14 @@ struct adios_POSIX_data_struct
     MPI_Comm group_comm;
     int rank;
     int size;
+    // async close() with several processes: the metadata file and the step
+    // marker are written once every process has its data on disk
+    int complete_pending; // = 1 until adios_posix_complete_step() runs
+    MPI_Comm complete_comm; // copy of group_comm, which is freed in adios_close()
+    char * mdf_buffer; // global index to write into mf (rank 0)
+    uint64_t mdf_size;
+    const char * marker_base_path; // step marker to touch (rank 0), or 0
+    char * marker_name;
 #endif
     int g_have_mdf; // = 1 write global metadata file
     int local_fs; // = N  every N processes are writing to a local file system
@@ -76,6 +112,14 @@ struct adios_POSIX_data_struct
           index position will be fd->current_pg->pg_start_in_file + total_bytes_written
           it is calculated but not used; fd->current_pg->pg_start_in_file will point to index beginning
           */
+
+    int async; // = 1 close() leaves writing the data and index to a background thread
+    int index_fanout; // > 0: gather the index through a tree with this fanout
+    uint64_t zero_copy_min_size; // > 0: large payloads are written from user memory
+    int step_marker; // = 1: rank 0 touches <name>.ready when a step is complete
+    int flush_pending; // = 1 while the background thread of the previous close() is running
+    pthread_t flush_thread;
+    struct adios_POSIX_flush_struct flush;
 };
 
 
@@ -100,6 +144,12 @@ void adios_posix_init (const PairStruct * parameters
     p->group_comm = MPI_COMM_NULL;
     p->rank = 0;
     p->size = 0;
+    p->complete_pending = 0;
+    p->complete_comm = MPI_COMM_NULL;
+    p->mdf_buffer = 0;
+    p->mdf_size = 0;
+    p->marker_base_path = 0;
+    p->marker_name = 0;
 #endif
     p->g_have_mdf = 1;
     p->local_fs = 0; // only rank 0 creates the directory for sub-files
@@ -108,6 +158,13 @@ void adios_posix_init (const PairStruct * parameters
     p->index_is_in_memory = 0; 
     p->pg_start_next = 0;
     p->total_bytes_written = 0;
+    p->async = 0;
+    p->index_fanout = 0;
+    p->zero_copy_min_size = 0;
+    p->step_marker = 0;
+    p->flush_pending = 0;
+    memset (&p->flush, 0, sizeof (struct adios_POSIX_flush_struct));
+    p->flush.f = -1;
 
 
     // process user parameters
@@ -136,6 +193,55 @@ void adios_posix_init (const PairStruct * parameters
                 log_error ("Invalid 'local-fs' parameter given to the POSIX write "
                            "method: '%s'\n", ps->value);
             }
+        } 
+        else if (!strcasecmp (ps->name, "async")) 
+        {
+            errno = 0;
+            p->async = strtol(ps->value, NULL, 10);
+            if (!errno) {
+                log_debug ("Parameter 'async' set to %d for POSIX write method\n",
+                           p->async);
+            } else {
+                log_error ("Invalid 'async' parameter given to the POSIX write "
+                           "method: '%s'\n", ps->value);
+            }
+        } 
+        else if (!strcasecmp (ps->name, "zero-copy")) 
+        {
+            errno = 0;
+            long kb = strtol(ps->value, NULL, 10);
+            if (!errno && kb >= 0) {
+                p->zero_copy_min_size = (uint64_t) kb * 1024;
+                log_debug ("Parameter 'zero-copy' set to %ld KB for POSIX write method\n",
+                           kb);
+            } else {
+                log_error ("Invalid 'zero-copy' parameter given to the POSIX write "
+                           "method: '%s'\n", ps->value);
+            }
+        }
+        else if (!strcasecmp (ps->name, "index-fanout")) 
+        {
+            errno = 0;
+            long k = strtol(ps->value, NULL, 10);
+            if (!errno && k >= 0 && k <= INT_MAX) {
+                p->index_fanout = (int) k;
+                log_debug ("Parameter 'index-fanout' set to %ld for POSIX write method\n", k);
+            } else {
+                log_error ("Invalid 'index-fanout' parameter given to the POSIX write "
+                           "method: '%s'\n", ps->value);
+            }
+        }
+        else if (!strcasecmp (ps->name, "step-marker")) 
+        {
+            errno = 0;
+            p->step_marker = strtol(ps->value, NULL, 10);
+            if (!errno) {
+                log_debug ("Parameter 'step-marker' set to %d for POSIX write method\n",
+                           p->step_marker);
+            } else {
+                log_error ("Invalid 'step-marker' parameter given to the POSIX write "
+                           "method: '%s'\n", ps->value);
+            }
         } else {
             log_error ("Parameter name %s is not recognized by the POSIX write "
                         "method\n", ps->name);
@@ -157,6 +263,289 @@ static int ADIOS_TIMER_AD_OVERFLOW  = ADIOS_TIMING_MAX_USER_TIMERS + 6;
 static int ADIOS_TIMER_AD_CLOSE     = ADIOS_TIMING_MAX_USER_TIMERS + 7;
 #endif
 
+/* Write 'size' bytes of 'buf' into file 'f' at 'offset' in MAX_MPIWRITE_SIZE chunks.
+   Returns 0 or the errno of a failed write(), or -1 if a write() was incomplete.
+   *bytes_written is set to the number of bytes processed.
+   It does not touch adios_errno, so the background flush thread can use it too.
+*/
+static int adios_posix_do_write (int f, off_t offset, const char * buf, uint64_t size,
+                                 uint64_t * bytes_written)
+{
+    int32_t to_write;
+    int err = 0;
+    *bytes_written = 0;
+
+    lseek (f, offset, SEEK_SET);
+
+    while (*bytes_written < size)
+    {
+        if (size - *bytes_written > MAX_MPIWRITE_SIZE)
+        {
+            to_write = MAX_MPIWRITE_SIZE;
+        }
+        else
+        {
+            to_write = size - *bytes_written;
+        }
+
+        ssize_t wrote = write (f, buf + *bytes_written, to_write);
+        *bytes_written += to_write;
+
+        if (wrote == -1)
+        {
+            err = errno;
+            break;
+        }
+        else if (wrote != to_write)
+        {
+            err = -1;
+        }
+    }
+    return err;
+}
+
+/* Same as adios_posix_do_write() for a list of memory segments */
+static int adios_posix_do_writev (int f, off_t offset, struct iovec * iov, int iovcnt,
+                                  uint64_t * bytes_written)
+{
+    int err = 0;
+    *bytes_written = 0;
+
+    lseek (f, offset, SEEK_SET);
+
+    while (iovcnt > 0)
+    {
+        int n = (iovcnt > IOV_MAX ? IOV_MAX : iovcnt);
+        ssize_t wrote = writev (f, iov, n);
+        if (wrote == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            err = errno;
+            break;
+        }
+        else if (wrote == 0)
+        {
+            err = -1;
+            break;
+        }
+        *bytes_written += wrote;
+        // skip the segments written, continue with the rest of a partially written one
+        while (iovcnt > 0 && (size_t) wrote >= iov->iov_len)
+        {
+            wrote -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (wrote > 0)
+        {
+            iov->iov_base = (char *) iov->iov_base + wrote;
+            iov->iov_len -= wrote;
+        }
+    }
+    return err;
+}
+
+static void * adios_posix_flush_thread (void * arg)
+{
+    struct adios_POSIX_flush_struct * fl = (struct adios_POSIX_flush_struct *) arg;
+    uint64_t bytes_written;
+    int err;
+
+    err = adios_posix_do_write (fl->f, fl->pg_offset, fl->pg_buffer, fl->pg_size, &bytes_written);
+    if (err)
+    {
+        log_error ("Failure to write data to file %s by rank %d in background: %s\n",
+                fl->name, fl->rank, (err == -1 ? "incomplete write" : strerror(err)));
+        fl->err = 1;
+    }
+
+    err = adios_posix_do_write (fl->f, fl->index_offset, fl->index_buffer, fl->index_size, &bytes_written);
+    if (err)
+    {
+        log_error ("Failure to write index to file %s by rank %d in background: %s\n",
+                fl->name, fl->rank, (err == -1 ? "incomplete write" : strerror(err)));
+        fl->err = 1;
+    }
+
+    if (fl->close_file)
+    {
+        close (fl->f);
+    }
+
+    if (fl->marker_base_path && !fl->err)
+    {
+        adios_write_step_marker_v1 (fl->marker_base_path, fl->name);
+    }
+
+    // the buffer can be reused by the next step
+    adios_databuffer_release (fl->allocated_bufptr, fl->allocated_size);
+    free (fl->index_buffer);
+    free (fl->name);
+    fl->allocated_bufptr = 0;
+    fl->pg_buffer = 0;
+    fl->index_buffer = 0;
+    fl->name = 0;
+    fl->f = -1;
+
+    return NULL;
+}
+
+/* Block until the background writing of the previous step completes */
+static void adios_posix_flush_wait (struct adios_POSIX_data_struct * p)
+{
+    if (p->flush_pending)
+    {
+        pthread_join (p->flush_thread, NULL);
+        p->flush_pending = 0;
+    }
+}
+
+/* The base path of the "step ready" marker if this process touches it at
+   the end of each step, or 0. Rank 0 writes the metadata file, so it does. */
+static const char * adios_posix_marker_base_path (struct adios_POSIX_data_struct * p
+                                                 ,struct adios_method_struct * method
+                                                 )
+{
+#ifdef HAVE_MPI
+    if (p->rank != 0)
+        return 0;
+#endif
+    return p->step_marker ? method->base_path : 0;
+}
+
+/* The base path of the step marker for the background thread of an async
+   close(), or 0. With several processes, the step is complete only when all
+   of them have written their data, so the metadata file and the marker are
+   left to adios_posix_complete_step() and the thread touches nothing.
+*/
+static const char * adios_posix_async_marker (struct adios_file_struct * fd
+                                             ,struct adios_POSIX_data_struct * p
+                                             ,struct adios_method_struct * method
+                                             )
+{
+    const char * base_path = adios_posix_marker_base_path (p, method);
+#ifdef HAVE_MPI
+    if (p->group_comm != MPI_COMM_SELF)
+    {
+        p->complete_pending = 1;
+        MPI_Comm_dup (p->group_comm, &p->complete_comm);
+        if (base_path)
+        {
+            p->marker_base_path = base_path;
+            p->marker_name = strdup (fd->name);
+        }
+        return 0;
+    }
+#endif
+    return base_path;
+}
+
+/* Finish the previous async close() of several processes, after the
+   background writing has been joined: once every process reports its data
+   and index written, rank 0 writes the global metadata file and touches the
+   step marker. Collective over the processes of that close(), so it runs
+   at the next open and at finalize.
+*/
+static void adios_posix_complete_step (struct adios_POSIX_data_struct * p)
+{
+#ifdef HAVE_MPI
+    int err, nfailed = 0;
+
+    if (!p->complete_pending)
+        return;
+    p->complete_pending = 0;
+
+    err = p->flush.err;
+    MPI_Allreduce (&err, &nfailed, 1, MPI_INT, MPI_SUM, p->complete_comm);
+    MPI_Comm_free (&p->complete_comm);
+    if (p->rank != 0)
+        return;
+
+    if (p->mdf_buffer)
+    {
+        ssize_t s = write (p->mf, p->mdf_buffer, p->mdf_size);
+        if (s != p->mdf_size)
+        {
+            log_error("POSIX method tried to write %" PRIu64 ", "
+                             "only wrote %" PRId64 ". %s:%d\n"
+                             ,p->mdf_size
+                             ,(int64_t)s
+                             ,__func__, __LINE__
+                    );
+        }
+        close (p->mf);
+        free (p->mdf_buffer);
+        p->mdf_buffer = 0;
+    }
+
+    if (p->marker_name)
+    {
+        if (nfailed)
+        {
+            log_error ("POSIX method: %d processes failed to write the last step of %s, "
+                       "its step marker is not touched\n", nfailed, p->marker_name);
+        }
+        else
+        {
+            adios_write_step_marker_v1 (p->marker_base_path, p->marker_name);
+        }
+        free (p->marker_name);
+        p->marker_name = 0;
+        p->marker_base_path = 0;
+    }
+#endif
+}
+
+/* Hand over the data buffer of fd and the index buffer to a background thread.
+   The PG offset must have been set before in p->flush.pg_offset.
+   In 'w' mode the thread also takes over the file and closes it.
+   If marker_base_path is not 0, the thread touches the step marker at the end.
+*/
+static void adios_posix_flush_start (struct adios_file_struct * fd
+                                    ,struct adios_POSIX_data_struct * p
+                                    ,char * index_buffer
+                                    ,uint64_t index_size
+                                    ,int close_file
+                                    ,const char * marker_base_path
+                                    )
+{
+    struct adios_POSIX_flush_struct * fl = &p->flush;
+
+    fl->f = p->b.f;
+    fl->close_file = close_file;
+#ifdef HAVE_MPI
+    fl->rank = p->rank;
+#else
+    fl->rank = 0;
+#endif
+    fl->name = strdup (fd->name);
+    fl->pg_size = fd->bytes_written;
+    fl->allocated_bufptr = adios_databuffer_detach (fd, &fl->pg_buffer, &fl->allocated_size);
+    fl->index_buffer = index_buffer;
+    fl->index_size = index_size;
+    fl->index_offset = p->pg_start_next;
+    fl->marker_base_path = marker_base_path;
+    fl->err = 0;
+
+    if (close_file)
+    {
+        // the thread closes the file, not adios_posix_close_internal()
+        p->b.f = -1;
+    }
+
+    if (pthread_create (&p->flush_thread, NULL, adios_posix_flush_thread, (void *) fl))
+    {
+        log_warn ("POSIX method: cannot create background thread, "
+                  "writing %s synchronously\n", fd->name);
+        adios_posix_flush_thread ((void *) fl);
+    }
+    else
+    {
+        p->flush_pending = 1;
+    }
+}
+
 int adios_posix_open (struct adios_file_struct * fd
                      ,struct adios_method_struct * method, MPI_Comm comm
                      )
@@ -197,6 +586,15 @@ int adios_posix_open (struct adios_file_struct * fd
 
 START_TIMER (ADIOS_TIMER_AD_OPEN);
 
+    // the previous step may still be written out in the background
+    START_TIMER (ADIOS_TIMER_IO);
+    adios_posix_flush_wait (p);
+    adios_posix_complete_step (p);
+    STOP_TIMER (ADIOS_TIMER_IO);
+
+    if (fd->mode != adios_mode_read)
+        fd->zero_copy_min_size = p->zero_copy_min_size;
+
 #ifdef HAVE_MPI
     // Need to figure out new the new fd->name, such as restart.bp.0, restart.bp.1....
     p->group_comm = comm;
@@ -690,19 +1088,12 @@ void adios_posix_read (struct adios_file_struct * fd
     v->data_size = buffer_size;
 }
 
-static void adios_posix_write_pg (struct adios_file_struct * fd
-                                 ,struct adios_method_struct * method
-                                 )
+/* Set the position of the current PG in the file (needed by adios_build_index_v1())
+   and return the file offset where the buffered PG has to be written */
+static off_t adios_posix_set_pg_offset (struct adios_file_struct * fd
+                                       ,struct adios_POSIX_data_struct * p
+                                       )
 {
-    struct adios_POSIX_data_struct * p = (struct adios_POSIX_data_struct *)
-                                                          method->method_data;
-    int32_t to_write;
-    uint64_t bytes_written = 0;
-
-    int rank = 0;
-#ifdef HAVE_MPI
-    rank = p->rank;
-#endif
     // use offsets set at the end of previous append step
     // fd->current_pg->pg_start_in_file needs to be correctly set before
     // calling adios_build_index_v1()
@@ -717,39 +1108,56 @@ static void adios_posix_write_pg (struct adios_file_struct * fd
     if (p->b.end_of_pgs > fd->current_pg->pg_start_in_file)
         offset = p->b.end_of_pgs;
 
+    return offset;
+}
+
+static void adios_posix_write_pg (struct adios_file_struct * fd
+                                 ,struct adios_method_struct * method
+                                 )
+{
+    struct adios_POSIX_data_struct * p = (struct adios_POSIX_data_struct *)
+                                                          method->method_data;
+    uint64_t bytes_written = 0;
+
+    int rank = 0;
+#ifdef HAVE_MPI
+    rank = p->rank;
+#endif
+    off_t offset = adios_posix_set_pg_offset (fd, p);
+
     /*printf ("Write PG: pg_start_in_file = %" PRIu64 "  pg_start_next = %" PRIu64 "  "
             "buffer offset = %" PRIu64 "  total_bytes_written = %" PRIu64 "\n",
             fd->current_pg->pg_start_in_file, p->pg_start_next, fd->offset, p->total_bytes_written);*/
 
-    lseek (p->b.f, offset, SEEK_SET);
-
-    while (bytes_written < fd->bytes_written)
+    int err;
+    if (fd->zero_copy)
     {
-        if (fd->bytes_written - bytes_written > MAX_MPIWRITE_SIZE)
+        // large payloads are written from the user's memory
+        struct iovec * iov;
+        int iovcnt = adios_databuffer_get_iovec (fd, &iov);
+        if (iovcnt >= 0)
         {
-            to_write = MAX_MPIWRITE_SIZE;
+            err = adios_posix_do_writev (p->b.f, offset, iov, iovcnt, &bytes_written);
+            free (iov);
         }
         else
         {
-            to_write = fd->bytes_written - bytes_written;
+            err = ENOMEM;
         }
-
-        ssize_t wrote = write (p->b.f, fd->buffer+bytes_written, to_write);
-        bytes_written += to_write;
-
-        if (wrote == -1)
-        {
-            adios_error (err_write_error, "Failure to write data to file %s by rank %d: %s\n",
-                    fd->name, rank, strerror(errno));
-            break;
-        }
-        else if (wrote != to_write)
-        {
-            adios_error (err_write_error, "Failure to write data completely to file %s by rank %d: "
-                    "Wanted to write %ld bytes to file at once but only %ld was written\n",
-                    fd->name, rank, to_write, wrote);
-        }
-
+    }
+    else
+    {
+        err = adios_posix_do_write (p->b.f, offset, fd->buffer, fd->bytes_written, &bytes_written);
+    }
+    if (err == -1)
+    {
+        adios_error (err_write_error, "Failure to write data completely to file %s by rank %d\n",
+                fd->name, rank);
+    }
+    else if (err)
+    {
+        adios_error (err_write_error, "Failure to write data to file %s by rank %d: %s\n",
+                fd->name, rank, strerror(err));
     }
 
     p->total_bytes_written += bytes_written;
@@ -763,6 +1171,19 @@ static void adios_posix_write_pg (struct adios_file_struct * fd
 
 }
 
+/* In async mode, close() only calculates where the PG goes and
+   leaves the writing to the background thread */
+static void adios_posix_defer_pg (struct adios_file_struct * fd
+                                 ,struct adios_method_struct * method
+                                 )
+{
+    struct adios_POSIX_data_struct * p = (struct adios_POSIX_data_struct *)
+                                                          method->method_data;
+    p->flush.pg_offset = adios_posix_set_pg_offset (fd, p);
+    p->total_bytes_written += fd->bytes_written;
+    p->pg_start_next += fd->bytes_written;
+}
+
 static void adios_posix_write_index (struct adios_file_struct * fd
         ,struct adios_method_struct * method
         ,char * buffer
@@ -923,15 +1344,88 @@ void adios_posix_buffer_overflow (struct adios_file_struct * fd,
     STOP_TIMER (ADIOS_TIMER_AD_OVERFLOW);
 }
 
+#ifdef HAVE_MPI
+/* Gather the index buffers of all processes to rank 0, directly or through a
+   tree of processes (index-fanout parameter). On rank 0, it returns the number
+   of buffers, rank 0's own buffer being the first one. Free them with
+   adios_posix_free_indices().
+*/
+static int adios_posix_gather_indices (struct adios_POSIX_data_struct * p
+                                      ,char * buffer
+                                      ,uint64_t buffer_size
+                                      ,int needs_sorting
+                                      ,char *** index_buffers
+                                      ,uint64_t ** index_buffer_sizes
+                                      )
+{
+    int i;
+    *index_buffers = NULL;
+    *index_buffer_sizes = NULL;
+
+    if (p->index_fanout > 0)
+    {
+        return adios_gather_indices_tree_v1 (p->group_comm, p->index_fanout
+                                            ,buffer, buffer_size, needs_sorting
+                                            ,index_buffers, index_buffer_sizes);
+    }
+
+    if (p->rank == 0)
+    {
+        uint64_t * index_sizes = malloc (8 * p->size);
+        uint64_t * index_offsets = malloc (8 * p->size);
+        char * recv_buffer;
+
+        recv_buffer = adios_gather_buffers (p->group_comm, buffer, buffer_size
+                                           ,index_sizes, index_offsets);
+
+        // each buffer points into recv_buffer, which is freed with the first one
+        *index_buffers = malloc (p->size * sizeof (char *));
+        *index_buffer_sizes = index_sizes;
+        for (i = 0; i < p->size; i++)
+        {
+            (*index_buffers) [i] = recv_buffer + index_offsets [i];
+        }
+
+        free (index_offsets);
+        return p->size;
+    }
+    else
+    {
+        adios_gather_buffers (p->group_comm, buffer, buffer_size, 0, 0);
+        return 0;
+    }
+}
+
+static void adios_posix_free_indices (struct adios_POSIX_data_struct * p
+                                     ,int nbuffers
+                                     ,char ** index_buffers
+                                     ,uint64_t * index_buffer_sizes
+                                     )
+{
+    int i;
+    if (!index_buffers)
+        return;
+    if (p->index_fanout > 0)
+    {
+        // the first buffer is the caller's own
+        for (i = 1; i < nbuffers; i++)
+            free (index_buffers [i]);
+    }
+    else if (nbuffers > 0)
+    {
+        free (index_buffers [0]);
+    }
+    free (index_buffers);
+    free (index_buffer_sizes);
+}
+#endif
+
 void adios_posix_close (struct adios_file_struct * fd
                        ,struct adios_method_struct * method
                        )
 {
     struct adios_POSIX_data_struct * p = (struct adios_POSIX_data_struct *)
                                                           method->method_data;
-    struct adios_index_process_group_struct_v1 * new_pg_root = 0;
-    struct adios_index_var_struct_v1 * new_vars_root = 0;
-    struct adios_index_attribute_struct_v1 * new_attrs_root = 0;
 
     START_TIMER (ADIOS_TIMER_AD_CLOSE);
 
@@ -943,10 +1437,15 @@ void adios_posix_close (struct adios_file_struct * fd
             char * buffer = 0;
             uint64_t buffer_size = 0;
             uint64_t buffer_offset = 0;
+            // zero-copy payloads must be written before adios_close() returns
+            int async = p->async && !fd->zero_copy;
 
-            // write buffered data now
+            // write buffered data now (or later in the background)
             START_TIMER (ADIOS_TIMER_IO);
-            adios_posix_write_pg (fd, method); 
+            if (async)
+                adios_posix_defer_pg (fd, method);
+            else
+                adios_posix_write_pg (fd, method); 
             STOP_TIMER (ADIOS_TIMER_IO);
 
             // Note: adios_posix_write_pg() sets the fd->current_pg->pg_start_in_file
@@ -972,66 +1471,21 @@ void adios_posix_close (struct adios_file_struct * fd
             {
                 if (p->rank == 0)
                 {
-                    int * index_sizes = malloc (4 * p->size);
-                    int * index_offsets = malloc (4 * p->size);
-                    char * recv_buffer = 0;
-                    int i;
-                    uint32_t size = 0, total_size = 0;
-
-                    START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gather (&size, 1, MPI_INT
-                               ,index_sizes, 1, MPI_INT
-                               ,0, p->group_comm
-                               );
-                    STOP_TIMER (ADIOS_TIMER_COMM);
+                    char ** index_buffers;
+                    uint64_t * index_buffer_sizes;
+                    int nbuffers;
 
-                    for (i = 0; i < p->size; i++)
-                    {
-                        index_offsets [i] = total_size;
-                        total_size += index_sizes [i];
-                    }
-
-                    recv_buffer = malloc (total_size);
+                    // rank 0's own index is p->index, it sends nothing
                     START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gatherv (buffer, 0, MPI_BYTE // 0 == index_sizes[0]
-                                ,recv_buffer, index_sizes, index_offsets
-                                ,MPI_BYTE, 0, p->group_comm
-                                );
+                    nbuffers = adios_posix_gather_indices (p, buffer, 0, 0
+                                         ,&index_buffers, &index_buffer_sizes);
                     STOP_TIMER (ADIOS_TIMER_COMM);
 
-                    char * buffer_save = p->b.buff;
-                    uint64_t buffer_size_save = p->b.length;
-                    uint64_t offset_save = p->b.offset;
-
-                    for (i = 1; i < p->size; i++)
-                    {
-                        p->b.buff = recv_buffer + index_offsets [i];
-                        p->b.length = index_sizes [i];
-                        p->b.offset = 0;
-
-                        adios_parse_process_group_index_v1 (&p->b, &new_pg_root, NULL);
-                        adios_parse_vars_index_v1 (&p->b, &new_vars_root, NULL, NULL);
-                        // do not merge attributes from other processes from 1.4
-                        /*
-                        adios_parse_attributes_index_v1 (&p->b
-                                                        ,&new_attrs_root
-                                                        );
-                        */
-
-                        adios_merge_index_v1 (p->index, new_pg_root, 
-                                              new_vars_root, new_attrs_root, 0);
-                        new_pg_root = 0;
-                        new_vars_root = 0;
-                        new_attrs_root = 0;
-                    }
-
-                    p->b.buff = buffer_save;
-                    p->b.length = buffer_size_save;
-                    p->b.offset = offset_save;
-
-                    free (recv_buffer);
-                    free (index_sizes);
-                    free (index_offsets);
+                    // do not merge attributes from other processes from 1.4
+                    adios_merge_index_buffers_v1 (p->index, nbuffers, index_buffers,
+                                                  index_buffer_sizes, -1, 0);
+                    adios_posix_free_indices (p, nbuffers, index_buffers,
+                                              index_buffer_sizes);
 
                     char * global_index_buffer = 0;
                     uint64_t global_index_buffer_size = 0;
@@ -1050,36 +1504,39 @@ void adios_posix_close (struct adios_file_struct * fd
                                                 ,&global_index_buffer_offset
                                                 ,flag
                                                 );
-                    START_TIMER (ADIOS_TIMER_IO);
-                    ssize_t s = write (p->mf, global_index_buffer, global_index_buffer_offset);
-                    STOP_TIMER (ADIOS_TIMER_IO);
-                    if (s != global_index_buffer_offset)
+                    if (async)
                     {
-                        log_error("POSIX method tried to write %" PRIu64 ", "
-                                         "only wrote %" PRId64 ". %s:%d\n"
-                                         ,fd->bytes_written
-                                         ,(int64_t)s
-                                         ,__func__, __LINE__
-                                );
+                        // written when all processes have their data on disk
+                        p->mdf_buffer = global_index_buffer;
+                        p->mdf_size = global_index_buffer_offset;
+                        global_index_buffer = 0;
                     }
+                    else
+                    {
+                        START_TIMER (ADIOS_TIMER_IO);
+                        ssize_t s = write (p->mf, global_index_buffer, global_index_buffer_offset);
+                        STOP_TIMER (ADIOS_TIMER_IO);
+                        if (s != global_index_buffer_offset)
+                        {
+                            log_error("POSIX method tried to write %" PRIu64 ", "
+                                             "only wrote %" PRId64 ". %s:%d\n"
+                                             ,fd->bytes_written
+                                             ,(int64_t)s
+                                             ,__func__, __LINE__
+                                    );
+                        }
 
-                    close (p->mf);
+                        close (p->mf);
+                    }
                     free (global_index_buffer);
                 }
                 else
                 {
+                    char ** index_buffers;
+                    uint64_t * index_buffer_sizes;
                     START_TIMER (ADIOS_TIMER_COMM);
-                    // Added this explicit cast to avoid truncation of low-order bytes on BGP
-                    int i_buffer_offset = (int) buffer_offset;
-                    MPI_Gather (&i_buffer_offset, 1, MPI_INT
-                               ,0, 0, MPI_INT
-                               ,0, p->group_comm
-                               );
-
-                    MPI_Gatherv (buffer, i_buffer_offset, MPI_BYTE
-                                ,0, 0, 0, MPI_BYTE
-                                ,0, p->group_comm
-                                );
+                    adios_posix_gather_indices (p, buffer, buffer_offset, 0
+                                         ,&index_buffers, &index_buffer_sizes);
                     STOP_TIMER (ADIOS_TIMER_COMM);
                 }
             }
@@ -1088,12 +1545,26 @@ void adios_posix_close (struct adios_file_struct * fd
 
             // write buffered index now
             START_TIMER (ADIOS_TIMER_IO);
-            adios_posix_write_index (fd, method, buffer, buffer_offset); 
+            if (async)
+            {
+                // the thread writes the data and index, closes the file and frees the buffers
+                adios_posix_flush_start (fd, p, buffer, buffer_offset, 1,
+                                         adios_posix_async_marker (fd, p, method));
+                buffer = 0;
+            }
+            else
+            {
+                adios_posix_write_index (fd, method, buffer, buffer_offset); 
+            }
             STOP_TIMER (ADIOS_TIMER_IO);
 
             // close the file assuming we are done in 'w' mode
             adios_posix_close_internal (&p->b);
             p->file_is_open = 0;
+            if (!async && adios_posix_marker_base_path (p, method))
+            {
+                adios_write_step_marker_v1 (method->base_path, fd->name);
+            }
             // in 'w' mode we forget about index, first append needs to read it from file
             adios_clear_index_v1 (p->index); 
             // notify future append steps that write mode does not keep the index in memory
@@ -1111,10 +1582,15 @@ void adios_posix_close (struct adios_file_struct * fd
             char * buffer = 0;
             uint64_t buffer_size = 0;
             uint64_t buffer_offset = 0;
+            // zero-copy payloads must be written before adios_close() returns
+            int async = p->async && !fd->zero_copy;
 
-            // write buffered data now
+            // write buffered data now (or later in the background)
             START_TIMER (ADIOS_TIMER_IO);
-            adios_posix_write_pg (fd, method); 
+            if (async)
+                adios_posix_defer_pg (fd, method);
+            else
+                adios_posix_write_pg (fd, method); 
             STOP_TIMER (ADIOS_TIMER_IO);
 
             // Note: adios_posix_write_pg() sets the fd->current_pg->pg_start_in_file
@@ -1147,13 +1623,6 @@ void adios_posix_close (struct adios_file_struct * fd
             {
                 if (p->rank == 0)
                 {
-                    int * index_sizes = malloc (4 * p->size);
-                    int * index_offsets = malloc (4 * p->size);
-                    char * recv_buffer = 0;
-                    int i;
-                    uint32_t size = buffer_offset;
-                    uint32_t total_size = 0;
-
                     // Need to make a temporary copy of p->index and merge
                     // into that. p->index (or rank 0)  must be kept intact for 
                     // future append steps.
@@ -1162,66 +1631,22 @@ void adios_posix_close (struct adios_file_struct * fd
                     struct adios_index_struct_v1 * gindex;
                     gindex = adios_alloc_index_v1(1); // no hashtables
 
-                    START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gather (&size, 1, MPI_INT
-                               ,index_sizes, 1, MPI_INT
-                               ,0, p->group_comm
-                               );
-                    STOP_TIMER (ADIOS_TIMER_COMM);
-
-                    for (i = 0; i < p->size; i++)
-                    {
-                        index_offsets [i] = total_size;
-                        total_size += index_sizes [i];
-                        //printf ("index %d offset %d  size %d  total size %u\n",
-                        //         i, index_offsets[i], index_sizes[i], total_size);
-                    }
-
-                    recv_buffer = malloc (total_size);
+                    char ** index_buffers;
+                    uint64_t * index_buffer_sizes;
+                    int nbuffers;
 
                     START_TIMER (ADIOS_TIMER_COMM);
-                    MPI_Gatherv (buffer, index_sizes[0], MPI_BYTE
-                                ,recv_buffer, index_sizes, index_offsets
-                                ,MPI_BYTE, 0, p->group_comm
-                                );
+                    nbuffers = adios_posix_gather_indices (p, buffer, buffer_offset, 1
+                                         ,&index_buffers, &index_buffer_sizes);
                     STOP_TIMER (ADIOS_TIMER_COMM);
 
-                    char * buffer_save = p->b.buff;
-                    uint64_t buffer_size_save = p->b.length;
-                    uint64_t offset_save = p->b.offset;
-
-                    for (i = 0; i < p->size; i++)
-                    {
-                        p->b.buff = recv_buffer + index_offsets [i];
-                        p->b.length = index_sizes [i];
-                        p->b.offset = 0;
-
-                        //printf ("parse index %d offset %d  size %d\n",
-                        //        i, index_offsets[i], index_sizes[i]);
-                        adios_parse_process_group_index_v1 (&p->b, &new_pg_root, NULL);
-                        adios_parse_vars_index_v1 (&p->b, &new_vars_root, NULL, NULL);
-                        // do not merge attributes from other processes from 1.4
-                        if (i==0) {
-                            adios_parse_attributes_index_v1 (&p->b, &new_attrs_root);
-                        }
-
-                        // global index would become unsorted on main aggregator during merging 
-                        // so sort timesteps in this case (appending)
-                        adios_merge_index_v1 (gindex, new_pg_root, 
-                                              new_vars_root, new_attrs_root, 1);
-                    
-                        new_pg_root = 0;
-                        new_vars_root = 0;
-                        new_attrs_root = 0;
-                    }
-
-                    p->b.buff = buffer_save;
-                    p->b.length = buffer_size_save;
-                    p->b.offset = offset_save;
-
-                    free (recv_buffer);
-                    free (index_sizes);
-                    free (index_offsets);
+                    // do not merge attributes from other processes from 1.4
+                    // global index would become unsorted on main aggregator during merging 
+                    // so sort timesteps in this case (appending)
+                    adios_merge_index_buffers_v1 (gindex, nbuffers, index_buffers,
+                                                  index_buffer_sizes, 0, 1);
+                    adios_posix_free_indices (p, nbuffers, index_buffers,
+                                              index_buffer_sizes);
 
                     char * global_index_buffer = 0;
                     uint64_t global_index_buffer_size = 0;
@@ -1241,20 +1666,30 @@ void adios_posix_close (struct adios_file_struct * fd
                                                 ,flag
                                                 );
 
-                    START_TIMER (ADIOS_TIMER_IO);
-                    ssize_t s = write (p->mf, global_index_buffer, global_index_buffer_offset);
-                    STOP_TIMER (ADIOS_TIMER_IO);
-                    if (s != global_index_buffer_offset)
+                    if (async)
                     {
-                        log_error("POSIX method tried to write %" PRIu64 ", "
-                                         "only wrote %" PRId64 ", Mode: a. %s:%d\n"
-                                         ,global_index_buffer_offset
-                                         ,(int64_t)s
-                                         ,__func__, __LINE__
-                                );
+                        // written when all processes have their data on disk
+                        p->mdf_buffer = global_index_buffer;
+                        p->mdf_size = global_index_buffer_offset;
+                        global_index_buffer = 0;
                     }
+                    else
+                    {
+                        START_TIMER (ADIOS_TIMER_IO);
+                        ssize_t s = write (p->mf, global_index_buffer, global_index_buffer_offset);
+                        STOP_TIMER (ADIOS_TIMER_IO);
+                        if (s != global_index_buffer_offset)
+                        {
+                            log_error("POSIX method tried to write %" PRIu64 ", "
+                                             "only wrote %" PRId64 ", Mode: a. %s:%d\n"
+                                             ,global_index_buffer_offset
+                                             ,(int64_t)s
+                                             ,__func__, __LINE__
+                                    );
+                        }
 
-                    close (p->mf);
+                        close (p->mf);
+                    }
 
                     free (global_index_buffer);
                     adios_clear_index_v1 (gindex);
@@ -1262,18 +1697,11 @@ void adios_posix_close (struct adios_file_struct * fd
                 }
                 else
                 {
+                    char ** index_buffers;
+                    uint64_t * index_buffer_sizes;
                     START_TIMER (ADIOS_TIMER_COMM);
-                    // Added this explicit cast to avoid truncation of low-order bytes on BGP
-                    int i_buffer_offset = (int) buffer_offset;
-                    MPI_Gather (&i_buffer_offset, 1, MPI_INT
-                               ,0, 0, MPI_INT
-                               ,0, p->group_comm
-                               );
-
-                    MPI_Gatherv (buffer, i_buffer_offset, MPI_BYTE
-                                ,0, 0, 0, MPI_BYTE
-                                ,0, p->group_comm
-                                );
+                    adios_posix_gather_indices (p, buffer, buffer_offset, 1
+                                         ,&index_buffers, &index_buffer_sizes);
                     STOP_TIMER (ADIOS_TIMER_COMM);
                 }
             }
@@ -1282,7 +1710,21 @@ void adios_posix_close (struct adios_file_struct * fd
 
             // write buffered index now
             START_TIMER (ADIOS_TIMER_IO);
-            adios_posix_write_index (fd, method, buffer, buffer_offset); 
+            if (async)
+            {
+                // the file is kept open for future append steps
+                adios_posix_flush_start (fd, p, buffer, buffer_offset, 0,
+                                         adios_posix_async_marker (fd, p, method));
+                buffer = 0;
+            }
+            else
+            {
+                adios_posix_write_index (fd, method, buffer, buffer_offset); 
+                if (adios_posix_marker_base_path (p, method))
+                {
+                    adios_write_step_marker_v1 (method->base_path, fd->name);
+                }
+            }
             STOP_TIMER (ADIOS_TIMER_IO);
 
             free (buffer);
@@ -1333,6 +1775,9 @@ void adios_posix_finalize (int mype, struct adios_method_struct * method)
 {
     struct adios_POSIX_data_struct * p = (struct adios_POSIX_data_struct *)
                                                           method->method_data;
+    adios_posix_flush_wait (p);
+    adios_posix_complete_step (p);
+
     if (p->file_is_open) {
         adios_clear_index_v1 (p->index); // append and update methods never cleared the index
         adios_posix_close_internal (&p->b);
@@ -181,6 +181,15 @@ function build_indexed_datasets_minmax() {
   echo "Minmax method uses data as is, no index file is built"
 }
 
+function build_indexed_datasets_scan() {
+  local DSID="$1"
+  local DSOUTPUT="$2"
+  [[ $# -eq 2 ]] || die "ERROR: Internal testing error, invalid parameters to build_indexed_datasets_scan: $@"
+  
+  invoke_dataset_builder "$DSID" "$DSOUTPUT.noindex" "none"
+  echo "Scan method reads the data as is, no index file is built"
+}
+
 function build_datasets() {
   echo "STEP 2: INDEXING ALL TEST DATASETS USING ALL ENABLED INDEXING METHODS"
   echo "(ALSO PRODUCING A NON-INDEXED VERSION OF EACH DATASET FOR REFERENCE)"
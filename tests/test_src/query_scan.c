@@ -0,0 +1,456 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS C test:
+ *  Write a 2D array of 2D blocks. Each block is an LDIM x LDIM array.
+ *  The whole array is patterned like this:
+ *
+ *  1 2 3 4 ...
+ *  2 3 4 ...
+ *  3 4 ...
+ *  4 ..
+ *
+ *  in a float variable 'data', an integer variable 'idata' and unsigned
+ *  variables 'udata' (unsigned int) and 'uldata' (unsigned long).
+ *  Then test the scan query method if it returns exactly the points
+ *  satisfying the queries. The unsigned variables are compared with a
+ *  negative value, which is below all of their elements.
+ *
+ * How to run: ./query_scan <N> <steps> [<LDIM>]
+ * It writes N*N 2D blocks organized into a NxN 2D array.
+ * Output: query_scan.bp
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+#include "public/adios_query.h"
+
+#ifdef DMALLOC
+#include "dmalloc.h"
+#endif
+
+#define log(...) fprintf (stderr, "[rank=%3.3d, line %d]: ", rank, __LINE__); fprintf (stderr, __VA_ARGS__); fflush(stderr);
+#define printE(...) fprintf (stderr, "[rank=%3.3d, line %d]: ERROR: ", rank, __LINE__); fprintf (stderr, __VA_ARGS__); fflush(stderr);
+
+/* user arguments */
+int N = 1;       // organize blocks in NxN shape
+int NSTEPS = 1;  // number of output steps
+int ldim = 5;    // size of a block in each dimension
+
+static const char FILENAME[] = "query_scan.bp";
+
+/* value at global position (i,j) in step */
+#define VALUE(step, i, j) ((step) + 1 + (i) + (j))
+
+int gdim1, gdim2;
+int offs1, offs2;
+
+int64_t       m_adios_group;
+
+/* Variables to write */
+float  *a2;
+int    *i2;
+unsigned int       *u2;
+unsigned long long *ul2;
+
+MPI_Comm    comm = MPI_COMM_SELF; // dummy comm for sequential code
+int rank;
+int size;
+
+
+void set_gdim()
+{
+    gdim1 = N*ldim;
+    gdim2 = N*ldim;
+}
+
+void set_offsets (int row, int col)
+{
+    offs1 = row*ldim;
+    offs2 = col*ldim;
+}
+
+void fill_block(int step, int row, int col)
+{
+    int i, j, k = 0;
+    for (i=0; i<ldim; i++) {
+        for (j=0; j<ldim; j++) {
+            a2[k] = VALUE(step, row*ldim+i, col*ldim+j);
+            i2[k] = VALUE(step, row*ldim+i, col*ldim+j);
+            u2[k] = VALUE(step, row*ldim+i, col*ldim+j);
+            ul2[k] = VALUE(step, row*ldim+i, col*ldim+j);
+            k++;
+        }
+    }
+}
+
+
+void Usage()
+{
+    printf("Usage: query_scan <N> <nsteps> [<LDIM>]\n"
+            "    <N>:       Number of blocks in each of X and Y direction\n"
+            "    <nsteps>:  Number of write cycles (to same file)\n"
+            "    <LDIM>:    Size of a block in each direction (default 5)\n");
+}
+
+void define_vars ();
+int write_file (int step);
+int query_as_file ();
+
+int main (int argc, char ** argv)
+{
+    int err,i ;
+
+    MPI_Init (&argc, &argv);
+    MPI_Comm_rank (comm, &rank);
+    MPI_Comm_size (comm, &size);
+
+    if (argc == 1)
+    {
+        // this case is for the test harness. otherwise this should be calling for Usage();
+        N = 2;
+        NSTEPS = 2;
+        printf("Running query_scan <N=%d> <nsteps=%d>\n", N, NSTEPS);
+    }
+    else
+    {
+        if (argc < 3) { Usage(); return 1; }
+
+        errno = 0;
+        i = strtol (argv[1], NULL, 10);
+        if (errno || i < 1) { printf("Invalid 1st argument %s\n", argv[1]); Usage(); return 1;}
+        N = i;
+
+        errno = 0;
+        i = strtol (argv[2], NULL, 10);
+        if (errno || i < 1) { printf("Invalid 2nd argument %s\n", argv[2]); Usage(); return 1;}
+        NSTEPS = i;
+
+        if (argc > 3) {
+            errno = 0;
+            i = strtol (argv[3], NULL, 10);
+            if (errno || i < 1) { printf("Invalid 3rd argument %s\n", argv[3]); Usage(); return 1;}
+            ldim = i;
+        }
+    }
+
+    a2 = (float *) malloc (ldim * ldim * sizeof(float));
+    i2 = (int *) malloc (ldim * ldim * sizeof(int));
+    u2 = (unsigned int *) malloc (ldim * ldim * sizeof(unsigned int));
+    ul2 = (unsigned long long *) malloc (ldim * ldim * sizeof(unsigned long long));
+
+    adios_init_noxml (comm);
+    err = adios_read_init_method(ADIOS_READ_METHOD_BP, comm, "verbose=2");
+    if (err) {
+        printE ("%s\n", adios_errmsg());
+    }
+
+    adios_declare_group (&m_adios_group, "query_scan", "", adios_stat_default);
+    adios_select_method (m_adios_group, "POSIX", "", "");
+
+
+    define_vars();
+    set_gdim();
+
+    for (i=0; i<NSTEPS; i++) {
+        if (!err) {
+            err = write_file (i);
+        }
+    }
+
+    if (!err)
+        err = query_as_file ();
+
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    adios_finalize (rank);
+    MPI_Finalize ();
+    free (a2);
+    free (i2);
+    free (u2);
+    free (ul2);
+    return err;
+}
+
+void define_vars ()
+{
+    int i;
+
+    adios_define_var (m_adios_group, "ldim", "", adios_integer, 0, 0, 0);
+    adios_define_var (m_adios_group, "gdim1", "", adios_integer, 0, 0, 0);
+    adios_define_var (m_adios_group, "gdim2", "", adios_integer, 0, 0, 0);
+    adios_define_var (m_adios_group, "offs1", "", adios_integer, 0, 0, 0);
+    adios_define_var (m_adios_group, "offs2", "", adios_integer, 0, 0, 0);
+
+    for (i=0; i<N*N; i++) {
+        adios_define_var (m_adios_group, "data", "", adios_real,
+                "ldim,ldim",
+                "gdim1,gdim2",
+                "offs1,offs2");
+        adios_define_var (m_adios_group, "idata", "", adios_integer,
+                "ldim,ldim",
+                "gdim1,gdim2",
+                "offs1,offs2");
+        adios_define_var (m_adios_group, "udata", "", adios_unsigned_integer,
+                "ldim,ldim",
+                "gdim1,gdim2",
+                "offs1,offs2");
+        adios_define_var (m_adios_group, "uldata", "", adios_unsigned_long,
+                "ldim,ldim",
+                "gdim1,gdim2",
+                "offs1,offs2");
+    }
+}
+
+int write_file (int step)
+{
+    int64_t       fh;
+    uint64_t       groupsize=0, totalsize;
+    int           nblocks = N*N;
+    int           i, j;
+    double        tb, te;
+
+    log ("Write step %d to %s\n", step, FILENAME);
+    adios_open (&fh, "query_scan", FILENAME, (step ? "a" : "w"), comm);
+
+    groupsize  = (3 + nblocks*2) * sizeof(int);                           // dimensions
+    groupsize += nblocks * ldim * ldim * (sizeof(float) + sizeof(int)
+                 + sizeof(unsigned int) + sizeof(unsigned long long));    // 2D  blocks
+
+    adios_group_size (fh, groupsize, &totalsize);
+    log ("  groupsize %" PRIu64 ", totalsize %" PRIu64 "\n", groupsize, totalsize);
+
+    tb = MPI_Wtime();
+    for (i=0; i<N; i++) {
+        for (j=0; j<N; j++) {
+            set_offsets (i, j);
+            fill_block (step, i, j);
+            adios_write (fh, "gdim1", &gdim1);
+            adios_write (fh, "gdim2", &gdim2);
+            adios_write (fh, "ldim", &ldim);
+            adios_write (fh, "offs1", &offs1);
+            adios_write (fh, "offs2", &offs2);
+            adios_write (fh, "data", a2);
+            adios_write (fh, "idata", i2);
+            adios_write (fh, "udata", u2);
+            adios_write (fh, "uldata", ul2);
+        }
+    }
+    adios_close (fh);
+    te = MPI_Wtime();
+
+    if (rank==0) {
+        log ("  Write time for step %d was %6.3lf seconds\n", step, te-tb);
+    }
+    MPI_Barrier (comm);
+    return 0;
+}
+
+static const char minstr[] = "11.0";
+static const char maxstr[] = "21.5";
+static const char nestr[]  = "15";
+static const char negstr[] = "-5";
+
+/* the queries: 0: 11.0 <= data <= 21.5, 1: data >= 11.0 and idata != 15,
+   2: data >= 11.0 and udata > -5 (true everywhere),
+   3: data >= 11.0 or uldata <= -5 (false everywhere) */
+static int matches (int query, int v)
+{
+    if (query == 0)
+        return (v >= 11.0 && v <= 21.5);
+    else if (query == 1)
+        return (v >= 11.0 && v != 15);
+    else
+        return (v >= 11.0);
+}
+
+int query_test (ADIOS_FILE *f, ADIOS_SELECTION *boxsel, int query)
+{
+    int nerr = 0;
+    int step, i;
+    uint64_t n;
+    ADIOS_QUERY  *q1, *q2, *q;
+    double        tb, te;
+    double        teb, t_eval; // time for just evaluating query for one step
+
+    uint64_t start[2] = {0, 0};
+    uint64_t count[2] = {gdim1, gdim2};
+    if (boxsel) {
+        start[0] = boxsel->u.bb.start[0];
+        start[1] = boxsel->u.bb.start[1];
+        count[0] = boxsel->u.bb.count[0];
+        count[1] = boxsel->u.bb.count[1];
+    }
+
+    q1 = adios_query_create (f, boxsel, "data", ADIOS_GTEQ, minstr);
+    if (query == 0)
+        q2 = adios_query_create (f, boxsel, "data", ADIOS_LTEQ, maxstr);
+    else if (query == 1)
+        q2 = adios_query_create (f, boxsel, "idata", ADIOS_NE, nestr);
+    else if (query == 2)
+        q2 = adios_query_create (f, boxsel, "udata", ADIOS_GT, negstr);
+    else
+        q2 = adios_query_create (f, boxsel, "uldata", ADIOS_LTEQ, negstr);
+    q  = adios_query_combine (q1, (query == 3 ? ADIOS_QUERY_OP_OR : ADIOS_QUERY_OP_AND), q2);
+
+    if (q == NULL)  {
+        log ("ERROR: Query creation failed: %s\n", adios_errmsg());
+        return 1;
+    }
+
+    adios_query_set_method (q, ADIOS_QUERY_METHOD_SCAN);
+
+    for (step=0; step<NSTEPS; step++) {
+        tb = MPI_Wtime();
+        t_eval = 0;
+
+        // the expected number of hits in the box
+        uint64_t nexpected = 0, ngot = 0;
+        uint64_t x, y;
+        for (x = start[0]; x < start[0]+count[0]; x++)
+            for (y = start[1]; y < start[1]+count[1]; y++)
+                nexpected += matches (query, VALUE(step, x, y));
+
+        // retrieve the result in small batches
+        int64_t batchSize = 7;
+        int nbatches = 0;
+        while (1) {
+            teb = MPI_Wtime();
+            ADIOS_QUERY_RESULT *result = adios_query_evaluate(q, boxsel, step, batchSize);
+            t_eval += MPI_Wtime() - teb;
+            nbatches++;
+
+            if (result->status == ADIOS_QUERY_RESULT_ERROR) {
+                log ("ERROR: Query evaluation failed with error: %s\n", adios_errmsg());
+                nerr++;
+                free (result);
+                break;
+            }
+
+            uint64_t npoints = 0;
+            for (i = 0; i < result->nselections; i++) {
+                ADIOS_SELECTION_POINTS_STRUCT *pts = &result->selections[i].u.points;
+                if (result->selections[i].type != ADIOS_SELECTION_POINTS || pts->ndim != 2) {
+                    log ("ERROR: Query returned a selection that is not a 2D point list\n");
+                    nerr++;
+                    continue;
+                }
+                // check the points and read the data of the points
+                float *d = (float *) malloc (pts->npoints * sizeof(float));
+                adios_schedule_read (f, &result->selections[i], "data", step, 1, d);
+                adios_perform_reads (f, 1);
+                for (n = 0; n < pts->npoints; n++) {
+                    uint64_t px = pts->points[2*n], py = pts->points[2*n+1];
+                    int v = VALUE(step, px, py);
+                    if (px < start[0] || px >= start[0]+count[0] ||
+                        py < start[1] || py >= start[1]+count[1] || !matches (query, v))
+                    {
+                        log ("ERROR: Point (%" PRIu64 ",%" PRIu64 ") with value %d "
+                                "should not be in the result\n", px, py, v);
+                        nerr++;
+                    }
+                    else if (d[n] != (float) v)
+                    {
+                        log ("ERROR: Point (%" PRIu64 ",%" PRIu64 ") read value %g "
+                                "instead of %d\n", px, py, d[n], v);
+                        nerr++;
+                    }
+                }
+                npoints += pts->npoints;
+                free (d);
+                free (pts->points);
+            }
+            if (npoints != result->npoints) {
+                log ("ERROR: Query result npoints = %" PRIu64 " but the selections have %"
+                        PRIu64 " points\n", result->npoints, npoints);
+                nerr++;
+            }
+            ngot += npoints;
+            free (result->selections);
+
+            if (result->status == ADIOS_QUERY_NO_MORE_RESULTS) {
+                free (result);
+                break;
+            }
+            free (result);
+        }
+
+        if (ngot != nexpected) {
+            log ("ERROR: Query returned %" PRIu64 " points instead of %" PRIu64 "\n",
+                    ngot, nexpected);
+            nerr++;
+        }
+        log ("    Query returned %" PRIu64 " points in %d batches\n", ngot, nbatches);
+
+        MPI_Barrier (comm);
+        te = MPI_Wtime();
+        log ("  Processing time for step %d was %6.3lfs, query evaluation was %6.3lfs\n",
+                step, te-tb, t_eval);
+    }
+
+    adios_query_free(q);
+    adios_query_free(q2);
+    adios_query_free(q1);
+    return nerr;
+}
+
+
+int query_as_file ()
+{
+    ADIOS_FILE * f;
+    int err=0;
+    double        tb, te;
+
+    uint64_t start[2] = {0,0};
+    uint64_t count[2] = {gdim1,gdim2};
+    uint64_t sstart[2] = {1,2};
+    uint64_t scount[2] = {gdim1-1,gdim2-3};
+
+    log ("Query data in %s\n", FILENAME);
+    tb = MPI_Wtime();
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, comm);
+    if (f == NULL) {
+        printE ("Error at opening file: %s\n", adios_errmsg());
+        return 1;
+    }
+    te = MPI_Wtime();
+    log ("  File opening time was %6.3lfs\n", te-tb);
+
+    ADIOS_SELECTION *boxsel = adios_selection_boundingbox (2, start, count);
+    log ("  Query variable content with a bounding box selection...\n");
+    err += query_test (f, boxsel, 0);
+    err += query_test (f, boxsel, 1);
+    err += query_test (f, boxsel, 2);
+    err += query_test (f, boxsel, 3);
+    adios_selection_delete (boxsel);
+
+    // a box not aligned with the blocks
+    if (gdim1 > 1 && gdim2 > 3) {
+        boxsel = adios_selection_boundingbox (2, sstart, scount);
+        log ("  Query variable content with an unaligned bounding box selection...\n");
+        err += query_test (f, boxsel, 0);
+        err += query_test (f, boxsel, 1);
+        err += query_test (f, boxsel, 2);
+        err += query_test (f, boxsel, 3);
+        adios_selection_delete (boxsel);
+    }
+
+    // test with NULL bounding box selection, too
+    log ("  Query variable content with NULL as bounding box selection...\n");
+    err += query_test (f, NULL, 0);
+    err += query_test (f, NULL, 1);
+    err += query_test (f, NULL, 2);
+    err += query_test (f, NULL, 3);
+
+    adios_read_close(f);
+    MPI_Barrier (comm);
+    return err;
+}
@@ -0,0 +1,508 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS C test:
+ *  Read a BP file as a stream while new steps are appended to it.
+ *  Each step has N blocks of a joined array "table". Block k of step s has
+ *  k+1+s rows and NCOLS columns, so the global size and the offsets of the
+ *  blocks change in every step.
+ *
+ *  The reader opens the file in stream mode after the first step, then the
+ *  writer appends one step at a time and the reader advances to it. Each
+ *  advance extends the open index of the file with the new step only
+ *  (see bp_refresh()), so this tests that the joined dimension is computed
+ *  for the appended blocks as well.
+ *
+ *  Each step also has N blocks of LDIM elements of a 1D global array "data".
+ *  The complete stream is then read again with non-blocking reads of "data"
+ *  and read-ahead ("prefetch" parameter) turned on. From the second step on,
+ *  the reads are served from the read-ahead cache, and adios_check_reads()
+ *  still has to return a chunk for each of them.
+ *
+ *  Finally "data" is read in every step without user memory, so that it is
+ *  returned in chunks of at most 1MB from a ring of chunk buffers
+ *  ("max_chunk_size" and "chunk_buffers" parameters).
+ *
+ * How to run: ./read_stream <N> <steps>
+ * Output: read_stream.bp
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+
+#ifdef DMALLOC
+#include "dmalloc.h"
+#endif
+
+#define log(...) fprintf (stderr, "[rank=%3.3d, line %d]: ", rank, __LINE__); fprintf (stderr, __VA_ARGS__); fflush(stderr);
+#define printE(...) fprintf (stderr, "[rank=%3.3d, line %d]: ERROR: ", rank, __LINE__); fprintf (stderr, __VA_ARGS__); fflush(stderr);
+
+/* user arguments */
+int N = 3;       // number of blocks in each step
+int NSTEPS = 3;  // number of output steps
+
+static const char FILENAME[] = "read_stream.bp";
+
+#define NCOLS 4
+#define VALUE(step, row, col) ((step) * 100000.0 + (row) * 10.0 + (col))
+
+#define LDIM 50000
+#define DVALUE(step, i) ((step) * 10000000.0 + (i))
+
+static const int cols = NCOLS;
+static const int ldim = LDIM;
+int gdim, offs;
+
+int64_t       m_adios_group;
+
+MPI_Comm    comm = MPI_COMM_SELF; // dummy comm for sequential code
+int rank;
+int size;
+
+/* rows of block k in step */
+static int block_rows (int step, int k)
+{
+    return k + 1 + step;
+}
+
+/* rows of the joined array in step */
+static uint64_t total_rows (int step)
+{
+    uint64_t n = 0;
+    int k;
+    for (k = 0; k < N; k++)
+        n += block_rows (step, k);
+    return n;
+}
+
+void Usage()
+{
+    printf("Usage: read_stream <N> <nsteps>\n"
+            "    <N>:       Number of blocks in each step\n"
+            "    <nsteps>:  Number of steps appended to the stream\n");
+}
+
+void define_vars ();
+int write_step (int step);
+int read_stream ();
+int read_prefetch ();
+int read_chunks ();
+
+int main (int argc, char ** argv)
+{
+    int err = 0, i;
+
+    MPI_Init (&argc, &argv);
+    MPI_Comm_rank (comm, &rank);
+    MPI_Comm_size (comm, &size);
+
+    if (argc == 1)
+    {
+        // this case is for the test harness. otherwise this should be calling for Usage();
+        printf("Running read_stream <N=%d> <nsteps=%d>\n", N, NSTEPS);
+    }
+    else
+    {
+        if (argc < 3) { Usage(); return 1; }
+
+        errno = 0;
+        i = strtol (argv[1], NULL, 10);
+        if (errno || i < 1) { printf("Invalid 1st argument %s\n", argv[1]); Usage(); return 1;}
+        N = i;
+
+        errno = 0;
+        i = strtol (argv[2], NULL, 10);
+        if (errno || i < 2) { printf("Invalid 2nd argument %s\n", argv[2]); Usage(); return 1;}
+        NSTEPS = i;
+    }
+    adios_init_noxml (comm);
+
+    adios_declare_group (&m_adios_group, "read_stream", "", adios_stat_default);
+    adios_select_method (m_adios_group, "POSIX", "", "");
+
+    define_vars();
+    gdim = N * LDIM;
+
+    err = read_stream ();
+    if (!err)
+        err = read_prefetch ();
+    if (!err)
+        err = read_chunks ();
+
+    adios_finalize (rank);
+    MPI_Finalize ();
+    return err;
+}
+
+void define_vars ()
+{
+    int i;
+
+    adios_define_var (m_adios_group, "rows", "", adios_integer, 0, 0, 0);
+    adios_define_var (m_adios_group, "cols", "", adios_integer, 0, 0, 0);
+    adios_define_var (m_adios_group, "ldim", "", adios_integer, 0, 0, 0);
+    adios_define_var (m_adios_group, "gdim", "", adios_integer, 0, 0, 0);
+    adios_define_var (m_adios_group, "offs", "", adios_integer, 0, 0, 0);
+
+    for (i=0; i<N; i++) {
+        adios_define_var (m_adios_group, "table", "", adios_double,
+                "rows,cols",
+                "JoinedDim,cols",
+                "0,0");
+        adios_define_var (m_adios_group, "data", "", adios_double,
+                "ldim", "gdim", "offs");
+    }
+}
+
+int write_step (int step)
+{
+    int64_t       fh;
+    double      * table, * data;
+    uint64_t      row0 = 0;
+    int           k, i, j, rows;
+
+    log ("Write step %d to %s\n", step, FILENAME);
+    table = (double *) malloc (block_rows (step, N-1) * NCOLS * sizeof(double));
+    data = (double *) malloc (LDIM * sizeof(double));
+    if (!table || !data) {
+        printE ("Cannot allocate the arrays to write\n");
+        free (table);
+        free (data);
+        return 1;
+    }
+
+    adios_open (&fh, "read_stream", FILENAME, (step ? "a" : "w"), comm);
+    for (k=0; k<N; k++) {
+        rows = block_rows (step, k);
+        for (i=0; i<rows; i++) {
+            for (j=0; j<NCOLS; j++) {
+                table[i*NCOLS+j] = VALUE (step, row0+i, j);
+            }
+        }
+        adios_write (fh, "rows", &rows);
+        adios_write (fh, "cols", (void *) &cols);
+        adios_write (fh, "table", table);
+        row0 += rows;
+
+        offs = k * LDIM;
+        for (i=0; i<LDIM; i++) {
+            data[i] = DVALUE (step, offs+i);
+        }
+        adios_write (fh, "ldim", (void *) &ldim);
+        adios_write (fh, "gdim", &gdim);
+        adios_write (fh, "offs", &offs);
+        adios_write (fh, "data", data);
+    }
+    adios_close (fh);
+
+    free (table);
+    free (data);
+    return 0;
+}
+
+/* Check the dimensions and blocks of the table in the current step and read it */
+int check_step (ADIOS_FILE * f, int step)
+{
+    ADIOS_VARINFO * vi;
+    ADIOS_SELECTION * sel;
+    double * data = NULL;
+    uint64_t start[2] = {0, 0}, count[2], row0 = 0;
+    int err = 0, k, i, j;
+
+    log ("  Check step %d (current_step %d)\n", step, f->current_step);
+    vi = adios_inq_var (f, "table");
+    if (vi == NULL) {
+        printE ("No such variable: table\n");
+        return 101;
+    }
+    if (vi->ndim != 2 || vi->dims[0] != total_rows (step) || vi->dims[1] != NCOLS) {
+        printE ("Step %d: table has dimensions %" PRIu64 " x %" PRIu64 ", expected %" PRIu64 " x %d\n",
+                step, vi->dims[0], vi->ndim > 1 ? vi->dims[1] : 0, total_rows (step), NCOLS);
+        err = 102;
+        goto endcheck;
+    }
+
+    adios_inq_var_blockinfo (f, vi);
+    if (vi->nblocks[0] != N) {
+        printE ("Step %d: table has %d blocks, expected %d\n", step, vi->nblocks[0], N);
+        err = 103;
+        goto endcheck;
+    }
+    for (k=0; k<N; k++) {
+        if (vi->blockinfo[k].start[0] != row0 ||
+            vi->blockinfo[k].count[0] != (uint64_t) block_rows (step, k))
+        {
+            printE ("Step %d: block %d starts at row %" PRIu64 " with %" PRIu64 " rows, "
+                    "expected row %" PRIu64 " with %d rows\n", step, k,
+                    vi->blockinfo[k].start[0], vi->blockinfo[k].count[0],
+                    row0, block_rows (step, k));
+            err = 104;
+            goto endcheck;
+        }
+        row0 += block_rows (step, k);
+    }
+
+    count[0] = vi->dims[0];
+    count[1] = vi->dims[1];
+    data = (double *) calloc (count[0] * count[1], sizeof(double));
+    sel = adios_selection_boundingbox (2, start, count);
+    adios_schedule_read (f, sel, "table", 0, 1, data);
+    adios_perform_reads (f, 1);
+    adios_selection_delete (sel);
+
+    for (i=0; i<(int)count[0] && !err; i++) {
+        for (j=0; j<NCOLS; j++) {
+            if (data[i*NCOLS+j] != VALUE (step, i, j)) {
+                printE ("Step %d: table[%d,%d] = %g, expected %g\n",
+                        step, i, j, data[i*NCOLS+j], VALUE (step, i, j));
+                err = 105;
+                break;
+            }
+        }
+    }
+
+endcheck:
+    free (data);
+    adios_free_varinfo (vi);
+    return err;
+}
+
+int read_stream ()
+{
+    ADIOS_FILE * f;
+    int err, step;
+
+    err = adios_read_init_method (ADIOS_READ_METHOD_BP, comm, "verbose=2");
+    if (err) {
+        printE ("%s\n", adios_errmsg());
+        return err;
+    }
+
+    err = write_step (0);
+    if (err)
+        return err;
+
+    log ("Open %s as a stream\n", FILENAME);
+    f = adios_read_open (FILENAME, ADIOS_READ_METHOD_BP, comm, ADIOS_LOCKMODE_NONE, 0.0);
+    if (f == NULL) {
+        printE ("Error at opening stream: %s\n", adios_errmsg());
+        return 1;
+    }
+
+    err = check_step (f, 0);
+    for (step=1; step<NSTEPS && !err; step++) {
+        err = write_step (step);
+        if (err)
+            break;
+
+        adios_advance_step (f, 0, 0.0);
+        if (adios_errno) {
+            printE ("Could not advance to step %d: %s\n", step, adios_errmsg());
+            err = 106;
+            break;
+        }
+        err = check_step (f, step);
+    }
+
+    if (!err) {
+        adios_advance_step (f, 0, 0.0);
+        if (adios_errno != err_step_notready && adios_errno != err_end_of_stream) {
+            printE ("Advancing past the last step returned %d instead of an error\n", adios_errno);
+            err = 107;
+        }
+    }
+
+    adios_read_close (f);
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    return err;
+}
+
+/* Read all of "data" in every step with non-blocking reads into user memory.
+ * Each step must return exactly one chunk, whether it was read from the file
+ * or served from the read-ahead of the previous step.
+ */
+int read_prefetch ()
+{
+    ADIOS_FILE * f;
+    ADIOS_SELECTION * sel;
+    ADIOS_VARCHUNK * chunk;
+    double * data;
+    uint64_t start = 0, count = gdim;
+    int err, step, nchunks, i;
+
+    err = adios_read_init_method (ADIOS_READ_METHOD_BP, comm, "verbose=2;prefetch=yes");
+    if (err) {
+        printE ("%s\n", adios_errmsg());
+        return err;
+    }
+
+    log ("Open %s as a stream with read-ahead\n", FILENAME);
+    f = adios_read_open (FILENAME, ADIOS_READ_METHOD_BP, comm, ADIOS_LOCKMODE_NONE, 0.0);
+    if (f == NULL) {
+        printE ("Error at opening stream: %s\n", adios_errmsg());
+        adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+        return 1;
+    }
+
+    data = (double *) malloc (count * sizeof(double));
+    sel = adios_selection_boundingbox (1, &start, &count);
+
+    for (step=0; step<NSTEPS && !err; step++) {
+        if (step) {
+            adios_advance_step (f, 0, 0.0);
+            if (adios_errno) {
+                printE ("Could not advance to step %d: %s\n", step, adios_errmsg());
+                err = 111;
+                break;
+            }
+        }
+
+        log ("  Non-blocking read of data in step %d\n", step);
+        memset (data, 0, count * sizeof(double));
+        adios_schedule_read (f, sel, "data", 0, 1, data);
+        adios_perform_reads (f, 0);
+
+        nchunks = 0;
+        while (adios_check_reads (f, &chunk) > 0) {
+            if (chunk) {
+                if (chunk->data != data) {
+                    printE ("Step %d: chunk is not in the user buffer\n", step);
+                    err = 112;
+                }
+                nchunks++;
+                adios_free_chunk (chunk);
+            }
+        }
+        if (adios_errno) {
+            printE ("Step %d: %s\n", step, adios_errmsg());
+            err = 113;
+        }
+        if (nchunks != 1) {
+            printE ("Step %d: adios_check_reads() returned %d chunks, expected 1\n", step, nchunks);
+            err = 114;
+        }
+
+        for (i=0; i<(int)count && !err; i++) {
+            if (data[i] != DVALUE (step, i)) {
+                printE ("Step %d: data[%d] = %g, expected %g\n", step, i, data[i], DVALUE (step, i));
+                err = 115;
+            }
+        }
+    }
+
+    adios_selection_delete (sel);
+    free (data);
+    adios_read_close (f);
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    return err;
+}
+
+/* Read all of "data" in every step without user memory. The chunks must not
+ * be larger than 1MB, must not overlap and must cover the whole array, in
+ * any order.
+ */
+int read_chunks ()
+{
+    ADIOS_FILE * f;
+    ADIOS_SELECTION * sel;
+    ADIOS_VARCHUNK * chunk;
+    double * values;
+    char * covered;
+    uint64_t start = 0, count = gdim, nelems, cstart, ccount;
+    int err, step, nchunks, i;
+
+    err = adios_read_init_method (ADIOS_READ_METHOD_BP, comm,
+                                  "verbose=2;max_chunk_size=1;chunk_buffers=3");
+    if (err) {
+        printE ("%s\n", adios_errmsg());
+        return err;
+    }
+
+    log ("Open %s as a stream to read in chunks\n", FILENAME);
+    f = adios_read_open (FILENAME, ADIOS_READ_METHOD_BP, comm, ADIOS_LOCKMODE_NONE, 0.0);
+    if (f == NULL) {
+        printE ("Error at opening stream: %s\n", adios_errmsg());
+        adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+        return 1;
+    }
+
+    covered = (char *) malloc (count);
+    sel = adios_selection_boundingbox (1, &start, &count);
+
+    for (step=0; step<NSTEPS && !err; step++) {
+        if (step) {
+            adios_advance_step (f, 0, 0.0);
+            if (adios_errno) {
+                printE ("Could not advance to step %d: %s\n", step, adios_errmsg());
+                err = 121;
+                break;
+            }
+        }
+
+        log ("  Chunked read of data in step %d\n", step);
+        adios_schedule_read (f, sel, "data", 0, 1, NULL);
+        adios_perform_reads (f, 0);
+
+        nchunks = 0;
+        nelems = 0;
+        memset (covered, 0, count);
+        while (adios_check_reads (f, &chunk) > 0) {
+            if (!chunk)
+                continue;
+            if (chunk->sel->type != ADIOS_SELECTION_BOUNDINGBOX) {
+                printE ("Step %d: chunk %d is not a bounding box\n", step, nchunks);
+                err = 122;
+            } else {
+                cstart = chunk->sel->u.bb.start[0];
+                ccount = chunk->sel->u.bb.count[0];
+                if (ccount * sizeof(double) > 1024*1024 || cstart + ccount > count) {
+                    printE ("Step %d: chunk %d has %" PRIu64 " elements from %" PRIu64
+                            ", expected at most 1MB inside the array\n",
+                            step, nchunks, ccount, cstart);
+                    err = 123;
+                }
+                values = (double *) chunk->data;
+                for (i=0; i<(int)ccount && !err; i++) {
+                    if (covered[cstart+i]++) {
+                        printE ("Step %d: data[%" PRIu64 "] is in more than one chunk\n",
+                                step, cstart+i);
+                        err = 127;
+                    }
+                    else if (values[i] != DVALUE (step, cstart+i)) {
+                        printE ("Step %d: data[%" PRIu64 "] = %g, expected %g\n",
+                                step, cstart+i, values[i], DVALUE (step, cstart+i));
+                        err = 124;
+                    }
+                }
+                nelems += ccount;
+            }
+            nchunks++;
+            adios_free_chunk (chunk);
+        }
+        if (adios_errno) {
+            printE ("Step %d: %s\n", step, adios_errmsg());
+            err = 125;
+        }
+        if (!err && (nelems != count || nchunks < 2)) {
+            printE ("Step %d: got %" PRIu64 " elements in %d chunks, expected %" PRIu64
+                    " elements in more than one chunk\n", step, nelems, nchunks, count);
+            err = 126;
+        }
+    }
+
+    adios_selection_delete (sel);
+    free (covered);
+    adios_read_close (f);
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    return err;
+}
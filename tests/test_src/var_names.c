@@ -0,0 +1,278 @@
+/*
+ * ADIOS is freely available under the terms of the BSD license described
+ * in the COPYING file in the top level directory of this source distribution.
+ *
+ * Copyright (c) 2008 - 2009.  UT-BATTELLE, LLC. All rights reserved.
+ */
+
+/* ADIOS C test:
+ *  Look up variables by name prefix, by shell pattern and by path
+ *  (adios_inq_var_ids_by_prefix(), adios_inq_var_ids_by_pattern() and
+ *  adios_inq_var_path()).
+ *
+ *  Two groups are written into one file:
+ *    g1: /fields/a  /fields/b/x  /fieldsX/c  /fields.d
+ *    g2: /fields/b/y  /other  /fields0
+ *  The names are chosen around the '/' boundary: "fields.d" sorts before
+ *  and "fields0" right after all names under "fields/" ('0' is '/'+1), so
+ *  a lookup under "fields/" must not return them.
+ *
+ *  The lookups are done on the complete file and again with each group
+ *  in view (adios_group_view()), where only the variables of the group are
+ *  found and the returned ids index the variable list of the group.
+ *
+ * How to run: ./var_names
+ * Output: var_names.bp
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "public/adios.h"
+#include "public/adios_read.h"
+#include "public/adios_read_ext.h"
+
+#ifdef DMALLOC
+#include "dmalloc.h"
+#endif
+
+#define log(...) fprintf (stderr, "[rank=%3.3d, line %d]: ", rank, __LINE__); fprintf (stderr, __VA_ARGS__); fflush(stderr);
+#define printE(...) fprintf (stderr, "[rank=%3.3d, line %d]: ERROR: ", rank, __LINE__); fprintf (stderr, __VA_ARGS__); fflush(stderr);
+
+static const char FILENAME[] = "var_names.bp";
+
+MPI_Comm    comm = MPI_COMM_SELF; // dummy comm for sequential code
+int rank;
+int size;
+
+/* variables of the two groups as path and name */
+static const char * g1_vars[][2] = {
+    {"/fields",   "a"},
+    {"/fields/b", "x"},
+    {"/fieldsX",  "c"},
+    {"",          "fields.d"},
+    {NULL, NULL}
+};
+static const char * g2_vars[][2] = {
+    {"/fields/b", "y"},
+    {"",          "other"},
+    {"",          "fields0"},
+    {NULL, NULL}
+};
+
+/* Compare a list of names (leading '/' ignored) with the NULL terminated expected list.
+   The variables of ADIOS itself (timers) are skipped.
+*/
+static int check_names (int line, const char * what, const char * arg, int n,
+                        char ** names, const char ** expected)
+{
+    int i, k = 0, nexp = 0, nfound = 0;
+    const char * name;
+
+    while (expected[nexp])
+        nexp++;
+    for (i = 0; i < n; i++) {
+        name = (names[i][0] == '/' ? names[i] + 1 : names[i]);
+        if (!strncmp (name, "__adios__/", 10))
+            continue;
+        nfound++;
+        if (k < nexp && strcmp (name, expected[k])) {
+            fprintf (stderr, "[rank=%3.3d, line %d]: ERROR: %s(\"%s\") name %d is \"%s\" instead of \"%s\"\n",
+                     rank, line, what, arg, k, name, expected[k]);
+            return 1;
+        }
+        k++;
+    }
+    if (nfound != nexp) {
+        fprintf (stderr, "[rank=%3.3d, line %d]: ERROR: %s(\"%s\") returned %d names instead of %d\n",
+                 rank, line, what, arg, nfound, nexp);
+        return 1;
+    }
+    return 0;
+}
+
+/* Variable ids are checked by their names in the current view of the file */
+static int check_ids (int line, ADIOS_FILE * f, const char * what, const char * arg,
+                      int n, int * ids, const char ** expected)
+{
+    char ** names = NULL;
+    int i, err;
+
+    if (n < 0) {
+        fprintf (stderr, "[rank=%3.3d, line %d]: ERROR: %s(\"%s\") failed: %s\n",
+                 rank, line, what, arg, adios_errmsg());
+        return 1;
+    }
+    if (n > 0) {
+        names = (char **) malloc (n * sizeof (char *));
+        for (i = 0; i < n; i++) {
+            if (ids[i] < 0 || ids[i] >= f->nvars) {
+                fprintf (stderr, "[rank=%3.3d, line %d]: ERROR: %s(\"%s\") returned id %d "
+                         "outside of the %d variables in view\n",
+                         rank, line, what, arg, ids[i], f->nvars);
+                free (names);
+                free (ids);
+                return 1;
+            }
+            names[i] = f->var_namelist[ids[i]];
+        }
+    }
+    err = check_names (line, what, arg, n, names, expected);
+    free (names);
+    free (ids);
+    return err;
+}
+
+#define CHECK_PREFIX(prefix, ...) do { \
+        const char * exp[] = {__VA_ARGS__, NULL}; \
+        int * ids; \
+        int n = adios_inq_var_ids_by_prefix (f, prefix, &ids); \
+        err += check_ids (__LINE__, f, "adios_inq_var_ids_by_prefix", prefix, n, ids, exp); \
+    } while (0)
+
+#define CHECK_PATTERN(pattern, ...) do { \
+        const char * exp[] = {__VA_ARGS__, NULL}; \
+        int * ids; \
+        int n = adios_inq_var_ids_by_pattern (f, pattern, &ids); \
+        err += check_ids (__LINE__, f, "adios_inq_var_ids_by_pattern", pattern, n, ids, exp); \
+    } while (0)
+
+#define CHECK_PATH(path, ...) do { \
+        const char * exp[] = {__VA_ARGS__, NULL}; \
+        char ** names; \
+        int i, n = adios_inq_var_path (f, path, &names); \
+        if (n < 0) { \
+            printE ("adios_inq_var_path(\"%s\") failed: %s\n", path, adios_errmsg()); \
+            err++; \
+        } else { \
+            err += check_names (__LINE__, "adios_inq_var_path", path, n, names, exp); \
+            for (i = 0; i < n; i++) \
+                free (names[i]); \
+            free (names); \
+        } \
+    } while (0)
+
+int write_group (const char * group, const char * mode, const char * vars[][2]);
+int read_names ();
+
+int main (int argc, char ** argv)
+{
+    int err;
+
+    MPI_Init (&argc, &argv);
+    MPI_Comm_rank (comm, &rank);
+    MPI_Comm_size (comm, &size);
+
+    adios_init_noxml (comm);
+
+    err = write_group ("g1", "w", g1_vars);
+    if (!err)
+        err = write_group ("g2", "a", g2_vars);
+    if (!err)
+        err = read_names ();
+
+    adios_finalize (rank);
+    MPI_Finalize ();
+    return err;
+}
+
+int write_group (const char * group, const char * mode, const char * vars[][2])
+{
+    int64_t       g, fh;
+    int           i;
+
+    log ("Write group %s to %s\n", group, FILENAME);
+    adios_declare_group (&g, group, "", adios_stat_default);
+    adios_select_method (g, "POSIX", "", "");
+    for (i = 0; vars[i][0]; i++)
+        adios_define_var (g, vars[i][1], vars[i][0], adios_integer, 0, 0, 0);
+
+    adios_open (&fh, group, FILENAME, mode, comm);
+    for (i = 0; vars[i][0]; i++) {
+        char name[64];
+        if (vars[i][0][0])
+            snprintf (name, sizeof (name), "%s/%s", vars[i][0], vars[i][1]);
+        else
+            snprintf (name, sizeof (name), "%s", vars[i][1]);
+        adios_write (fh, name, &i);
+    }
+    adios_close (fh);
+    return 0;
+}
+
+int read_names ()
+{
+    ADIOS_FILE  * f;
+    char       ** groups;
+    int           err = 0, ngroups, g1 = -1, g2 = -1, i;
+
+    adios_read_init_method (ADIOS_READ_METHOD_BP, comm, "verbose=2");
+    f = adios_read_open_file (FILENAME, ADIOS_READ_METHOD_BP, comm);
+    if (f == NULL) {
+        printE ("Error at opening file: %s\n", adios_errmsg());
+        adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+        return 1;
+    }
+
+    ngroups = adios_get_grouplist (f, &groups);
+    for (i = 0; i < ngroups; i++) {
+        if (!strcmp (groups[i], "g1"))
+            g1 = i;
+        else if (!strcmp (groups[i], "g2"))
+            g2 = i;
+    }
+    if (g1 < 0 || g2 < 0) {
+        printE ("Groups g1 and g2 are not both in the file\n");
+        adios_read_close (f);
+        adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+        return 1;
+    }
+
+    log ("Look up names in the complete file\n");
+    CHECK_PREFIX ("/fields/", "fields/a", "fields/b/x", "fields/b/y");
+    CHECK_PREFIX ("fields/b", "fields/b/x", "fields/b/y");
+    CHECK_PREFIX ("fields", "fields.d", "fields/a", "fields/b/x", "fields/b/y", "fields0", "fieldsX/c");
+    CHECK_PREFIX ("", "fields.d", "fields/a", "fields/b/x", "fields/b/y", "fields0", "fieldsX/c", "other");
+    CHECK_PREFIX ("nothing", NULL);
+    CHECK_PATTERN ("fields/*", "fields/a");
+    CHECK_PATTERN ("/fields/*/?", "fields/b/x", "fields/b/y");
+    CHECK_PATTERN ("fields?", "fields0");
+    CHECK_PATTERN ("*/[ac]", "fields/a", "fieldsX/c");
+    CHECK_PATTERN ("*", "fields.d", "fields0", "other");
+    CHECK_PATH ("", "fields.d", "fields/", "fields0", "fieldsX/", "other");
+    CHECK_PATH ("/", "fields.d", "fields/", "fields0", "fieldsX/", "other");
+    CHECK_PATH ("/fields", "a", "b/");
+    CHECK_PATH ("fields/b/", "x", "y");
+    CHECK_PATH ("other", NULL);
+
+    log ("Look up names with group g1 in view\n");
+    adios_group_view (f, g1);
+    CHECK_PREFIX ("/fields/", "fields/a", "fields/b/x");
+    CHECK_PREFIX ("fields", "fields.d", "fields/a", "fields/b/x", "fieldsX/c");
+    CHECK_PATTERN ("*", "fields.d");
+    CHECK_PATTERN ("*/*/?", "fields/b/x");
+    CHECK_PATH ("", "fields.d", "fields/", "fieldsX/");
+    CHECK_PATH ("fields/b", "x");
+
+    log ("Look up names with group g2 in view\n");
+    adios_group_view (f, g2);
+    CHECK_PREFIX ("/fields/", "fields/b/y");
+    CHECK_PREFIX ("fields", "fields/b/y", "fields0");
+    CHECK_PATTERN ("*", "fields0", "other");
+    CHECK_PATTERN ("fields/a", NULL);
+    CHECK_PATH ("", "fields/", "fields0", "other");
+    CHECK_PATH ("fields", "b/");
+    CHECK_PATH ("fieldsX", NULL);
+
+    log ("Look up names in the complete file again\n");
+    adios_group_view (f, -1);
+    CHECK_PREFIX ("fields/b/", "fields/b/x", "fields/b/y");
+    CHECK_PATH ("fields/b", "x", "y");
+
+    adios_read_close (f);
+    adios_read_finalize_method (ADIOS_READ_METHOD_BP);
+    if (!err) {
+        log ("All lookups returned the expected names\n");
+    }
+    return (err ? 1 : 0);
+}